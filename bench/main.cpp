@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <initializer_list>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <sinaps.hpp>
+#include <sinaps/mapped_file.hpp>
+
+// Every benchmark reports the bytes it scanned per second. The pattern is planted at the end of each input, so a scan
+// covers the whole buffer unless the input happens to contain an earlier match (e.g. wildcard-heavy patterns on code).
+
+namespace {
+    constexpr size_t input_size = 16 << 20;
+
+    /// @brief Deterministic pattern of `Length` tokens, `Density` percent of them wildcards.
+    /// The first and last tokens are always fixed bytes, as in real signatures.
+    template <size_t Length, unsigned Density>
+    consteval std::array<sinaps::token_t, Length> make_tokens() {
+        std::array<sinaps::token_t, Length> tokens;
+        uint32_t state = 0x2545F491u ^ static_cast<uint32_t>(Length * 31 + Density);
+        for (size_t i = 0; i < Length; i++) {
+            state = state * 1664525u + 1013904223u;
+            bool wildcard = i != 0 && i + 1 != Length && (state >> 8) % 100 < Density;
+            tokens[i] = wildcard ? sinaps::token_t() : sinaps::token_t(static_cast<uint8_t>(state >> 24));
+        }
+        return tokens;
+    }
+
+    /// @brief Write the bytes of a pattern at `at` (wildcards are left as they are).
+    void plant(std::vector<uint8_t>& data, size_t at, std::span<sinaps::token_t const> tokens) {
+        for (size_t i = 0; i < tokens.size(); i++) {
+            if (tokens[i].type == sinaps::token_t::type_t::byte) {
+                data[at + i] = tokens[i].byte;
+            }
+        }
+    }
+
+    std::vector<uint8_t> random_input() {
+        std::vector<uint8_t> data(input_size);
+        std::mt19937_64 rng(42);
+        for (auto& byte : data) {
+            byte = static_cast<uint8_t>(rng());
+        }
+        return data;
+    }
+
+    /// @brief Code sections of an executable, repeated up to the input size.
+    /// The file is <c>SINAPS_BENCH_TEXT</c> if it's set, or the benchmark itself.
+    std::vector<uint8_t> text_input(std::filesystem::path const& self) {
+        char const* path = std::getenv("SINAPS_BENCH_TEXT");
+        sinaps::mapped_file file(path ? std::filesystem::path(path) : self);
+        auto mod = file.as_module();
+
+        std::vector<uint8_t> code;
+        for (auto const& section : mod.code_sections()) {
+            code.insert(code.end(), section.data, section.data + section.size);
+        }
+        if (code.empty()) {
+            return {};
+        }
+
+        std::vector<uint8_t> data;
+        data.reserve(input_size);
+        while (data.size() < input_size) {
+            data.insert(data.end(), code.begin(), code.begin() + static_cast<ptrdiff_t>(std::min(code.size(), input_size - data.size())));
+        }
+        return data;
+    }
+
+    /// @brief Copies of the pattern with its last byte changed, every copy passes the prefilter and fails late.
+    std::vector<uint8_t> repeated_prefix_input(std::span<sinaps::token_t const> tokens) {
+        std::vector<uint8_t> data(input_size);
+        for (size_t at = 0; at + tokens.size() <= data.size(); at += tokens.size()) {
+            plant(data, at, tokens);
+            data[at + tokens.size() - 1] ^= 0xFF;
+        }
+        return data;
+    }
+
+    enum class input_kind { random, text, repeated_prefix };
+
+    std::filesystem::path self_path;
+
+    /// @brief Input for a pattern, with the pattern planted at the end.
+    std::vector<uint8_t> make_input(input_kind kind, std::span<sinaps::token_t const> tokens) {
+        std::vector<uint8_t> data;
+        switch (kind) {
+            case input_kind::random: {
+                static auto const random = random_input();
+                data = random;
+            } break;
+            case input_kind::text: {
+                static auto const text = text_input(self_path);
+                data = text;
+            } break;
+            case input_kind::repeated_prefix: data = repeated_prefix_input(tokens); break;
+        }
+        if (data.size() >= tokens.size()) {
+            plant(data, data.size() - tokens.size(), tokens);
+        }
+        return data;
+    }
+
+    /// @brief Run a scan in a loop, and report the bytes it covered.
+    template <typename Find>
+    void run(benchmark::State& state, std::vector<uint8_t> const& data, Find&& find) {
+        if (data.empty()) {
+            state.SkipWithError("no input");
+            return;
+        }
+
+        intptr_t res = sinaps::not_found;
+        for (auto _ : state) {
+            res = find(data.data(), data.size());
+            benchmark::DoNotOptimize(res);
+        }
+        size_t scanned = res == sinaps::not_found ? data.size() : static_cast<size_t>(res);
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * scanned));
+        state.counters["found"] = static_cast<double>(res != sinaps::not_found);
+    }
+
+    enum class overload { templated, array, span, initializer_list, string_view, compiled };
+
+    template <size_t Length, unsigned Density, overload Overload, input_kind Kind>
+    void bm_find(benchmark::State& state) {
+        static constexpr auto tokens = make_tokens<Length, Density>();
+        auto data = make_input(Kind, tokens);
+
+        if constexpr (Overload == overload::templated) {
+            run(state, data, [](uint8_t const* p, size_t n) { return sinaps::find<tokens>(p, n); });
+        } else if constexpr (Overload == overload::array) {
+            run(state, data, [](uint8_t const* p, size_t n) { return sinaps::find(p, n, tokens); });
+        } else if constexpr (Overload == overload::span) {
+            run(state, data, [](uint8_t const* p, size_t n) { return sinaps::find(p, n, std::span<sinaps::token_t const>(tokens)); });
+        } else if constexpr (Overload == overload::initializer_list) {
+            run(state, data, []<size_t... I>(std::index_sequence<I...>) {
+                return [](uint8_t const* p, size_t n) { return sinaps::find(p, n, {tokens[I]...}); };
+            }(std::make_index_sequence<Length>()));
+        } else if constexpr (Overload == overload::string_view) {
+            std::string str = sinaps::to_string(tokens);
+            run(state, data, [&str](uint8_t const* p, size_t n) { return sinaps::find(p, n, std::string_view(str)); });
+        } else {
+            sinaps::compiled_pattern pattern(tokens);
+            run(state, data, [&pattern](uint8_t const* p, size_t n) { return sinaps::find(p, n, pattern); });
+        }
+    }
+
+    /// @brief Register every overload and input for a pattern shape.
+    template <size_t Length, unsigned Density>
+    void register_shape() {
+        auto add = [](char const* name, auto fn) {
+            benchmark::RegisterBenchmark(
+                (std::string(name) + "/len:" + std::to_string(Length) + "/wildcards:" + std::to_string(Density) + "%").c_str(), fn
+            )->Unit(benchmark::kMillisecond);
+        };
+
+        #define SINAPS_BENCH_INPUTS(overload_name, overload_value) \
+            add(overload_name "/random", bm_find<Length, Density, overload::overload_value, input_kind::random>); \
+            add(overload_name "/text", bm_find<Length, Density, overload::overload_value, input_kind::text>); \
+            add(overload_name "/repeated_prefix", bm_find<Length, Density, overload::overload_value, input_kind::repeated_prefix>);
+
+        SINAPS_BENCH_INPUTS("template", templated)
+        SINAPS_BENCH_INPUTS("array", array)
+        SINAPS_BENCH_INPUTS("span", span)
+        SINAPS_BENCH_INPUTS("initializer_list", initializer_list)
+        SINAPS_BENCH_INPUTS("string_view", string_view)
+        SINAPS_BENCH_INPUTS("compiled", compiled)
+
+        #undef SINAPS_BENCH_INPUTS
+    }
+
+    /// @brief Same scan with every kernel tier the CPU supports (see <c>sinaps::simd::dispatch_level</c>).
+    template <size_t Length, input_kind Kind>
+    void bm_dispatch(benchmark::State& state) {
+        static constexpr auto tokens = make_tokens<Length, 0>();
+        auto data = make_input(Kind, tokens);
+
+        auto detected = sinaps::simd::dispatch_level();
+        auto level = static_cast<sinaps::simd::level_t>(state.range(0));
+        if (sinaps::simd::limit_dispatch_level(level) != level) {
+            sinaps::simd::limit_dispatch_level(detected);
+            state.SkipWithError("tier not available");
+            return;
+        }
+        run(state, data, [](uint8_t const* p, size_t n) { return sinaps::find<tokens>(p, n); });
+        sinaps::simd::limit_dispatch_level(detected);
+    }
+
+    void register_dispatch() {
+        for (auto* bm : {
+            benchmark::RegisterBenchmark("dispatch/random/len:16", bm_dispatch<16, input_kind::random>),
+            benchmark::RegisterBenchmark("dispatch/text/len:16", bm_dispatch<16, input_kind::text>),
+        }) {
+            bm->ArgName("level")->DenseRange(0, 3)->Unit(benchmark::kMillisecond);
+        }
+    }
+
+    template <unsigned Density>
+    void register_lengths() {
+        register_shape<4, Density>();
+        register_shape<8, Density>();
+        register_shape<16, Density>();
+        register_shape<32, Density>();
+        register_shape<64, Density>();
+        register_shape<128, Density>();
+    }
+}
+
+int main(int argc, char** argv) {
+    self_path = std::filesystem::absolute(argv[0]);
+
+    register_lengths<0>();
+    register_lengths<25>();
+    register_lengths<50>();
+    register_dispatch();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
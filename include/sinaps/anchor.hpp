@@ -0,0 +1,91 @@
+#pragma once
+#ifndef SINAPS_ANCHOR_HPP
+#define SINAPS_ANCHOR_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "token.hpp"
+
+namespace sinaps {
+    /// @brief Approximate frequency of each byte value in machine code, on a log2 scale (16 steps per bit).
+    /// Measured over the .text sections of a few large x86-64 binaries, with the opcode bytes that are
+    /// common in A64 code (ldr/str, add/sub, bl, ret, stp/ldp, ...) raised to at least 1%.
+    /// Lower values are rarer, and make better anchors.
+    static constexpr std::array<uint8_t, 256> byte_frequency = {
+            207, 163, 136, 150, 139, 132, 112, 119, 151, 108, 101,  98, 115, 112, 103, 179, // 0_
+            148, 116, 150,  98, 110, 108,  99,  98, 134,  91,  85,  83,  93,  89, 114, 150, // 1_
+            135,  90,  83,  83, 171, 106,  80,  81, 127, 122, 150, 100,  92,  91, 113,  85, // 2_
+            125, 136,  77,  84, 150, 150,  82,  82, 119, 150,  90, 106, 111, 116,  85,  95, // 3_
+            139, 156,  99, 122, 156, 135, 102, 113, 197, 150,  93,  92, 162, 127,  89,  90, // 4_
+            127,  85, 150, 118, 150, 123, 103, 104, 111,  80,  80, 119, 119, 125, 102, 150, // 5_
+            113,  77,  92, 102, 113,  86, 147,  80, 108,  94,  87,  89, 105,  86,  96, 113, // 6_
+            122, 150,  93, 102, 147, 132,  97,  99, 112,  83,  82, 150, 124, 106,  95, 111, // 7_
+            133, 111,  92, 158, 157, 158,  93,  99, 115, 182,  74, 176,  92, 156,  87,  89, // 8_
+            150, 150,  80,  89, 150, 100,  76, 150,  98,  87,  73,  76,  88,  86,  74,  78, // 9_
+            108,  78,  74,  80,  85,  82,  75,  75,  98, 150, 150,  81,  90,  81,  75,  86, // A_
+            100,  80,  77,  82, 150, 150, 117, 106, 119, 150, 115,  91, 109, 108, 119, 113, // B_
+            149, 126, 117, 136, 123, 123, 126, 141, 112, 113, 106,  87,  92,  93,  94,  91, // C_
+            120, 150, 121,  99,  90,  92, 150,  99, 111,  89,  97, 104,  84,  90, 100, 124, // D_
+            150, 100, 104,  88, 100,  92, 105, 112, 164, 146, 106, 150, 114, 110, 110, 125, // E_
+            150, 101, 107, 126,  97, 106, 127, 120, 133, 150, 132, 123, 121, 150, 137, 192, // F_
+    };
+
+    /// @brief Offsets of the bytes used to prefilter the scan (in bytes, excluding zero-sized tokens).
+    struct anchor_t {
+        size_t first = 0;
+        size_t second = 0;
+        uint8_t first_byte = 0;
+        uint8_t second_byte = 0;
+        bool valid = false; // false if the pattern has no fully-specified bytes
+    };
+
+    /// @brief Pick the least frequent byte, and a second one to pair it with.
+    /// The second byte prefers a different value, since repeated bytes (e.g. padding) tend to come in runs.
+    /// @param tokens The pattern tokens, zero-sized tokens (cursor, follow) are skipped.
+    /// @return The anchor pair, <c>first == second</c> if there is only one fully-specified byte.
+    constexpr anchor_t select_anchor(std::span<token_t const> tokens) {
+        constexpr unsigned same_value_penalty = 32;
+
+        anchor_t anchor;
+        unsigned best = ~0u;
+        size_t offset = 0;
+        for (auto const& token : tokens) {
+            if (token.zero_sized()) continue;
+            if (token.type == token_t::type_t::byte && byte_frequency[token.byte] < best) {
+                best = byte_frequency[token.byte];
+                anchor.first = offset;
+                anchor.valid = true;
+                anchor.first_byte = token.byte;
+            }
+            offset++;
+        }
+
+        if (!anchor.valid) {
+            return anchor;
+        }
+
+        anchor.second = anchor.first;
+        anchor.second_byte = anchor.first_byte;
+        best = ~0u;
+        offset = 0;
+        for (auto const& token : tokens) {
+            if (token.zero_sized()) continue;
+            if (token.type == token_t::type_t::byte && offset != anchor.first) {
+                unsigned score = byte_frequency[token.byte] + (token.byte == anchor.first_byte ? same_value_penalty : 0);
+                if (score < best) {
+                    best = score;
+                    anchor.second = offset;
+                    anchor.second_byte = token.byte;
+                }
+            }
+            offset++;
+        }
+
+        return anchor;
+    }
+}
+
+#endif // SINAPS_ANCHOR_HPP
@@ -0,0 +1,279 @@
+#pragma once
+#ifndef SINAPS_ASYNC_HPP
+#define SINAPS_ASYNC_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "compiled_pattern.hpp"
+#include "find.hpp"
+#include "pattern.hpp"
+
+namespace sinaps {
+    /// @brief Fixed-size thread pool, usable as the executor of <c>sinaps::async_find</c> and <c>sinaps::find_parallel</c>.
+    /// Tasks run in the order they are submitted. The destructor runs the tasks that are still queued, then joins.
+    class thread_pool {
+    public:
+        /// @param threads Amount of workers, 0 means std::thread::hardware_concurrency().
+        explicit thread_pool(size_t threads = 0) {
+            threads = threads ? threads : std::max(std::thread::hardware_concurrency(), 1u);
+            m_workers.reserve(threads);
+            for (size_t t = 0; t < threads; t++) {
+                m_workers.emplace_back([this](std::stop_token stop) { run(stop); });
+            }
+        }
+
+        thread_pool(thread_pool const&) = delete;
+        thread_pool& operator=(thread_pool const&) = delete;
+
+        ~thread_pool() {
+            for (auto& worker : m_workers) {
+                worker.request_stop();
+            }
+            m_ready.notify_all();
+        }
+
+        /// @brief Queue a task.
+        void operator()(std::function<void()> task) {
+            {
+                std::lock_guard lock(m_mutex);
+                m_tasks.push_back(std::move(task));
+            }
+            m_ready.notify_one();
+        }
+
+        /// @brief Amount of workers.
+        [[nodiscard]] size_t size() const { return m_workers.size(); }
+
+    private:
+        void run(std::stop_token stop) {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock lock(m_mutex);
+                    if (!m_ready.wait(lock, stop, [this] { return !m_tasks.empty(); })) {
+                        return; // stopped, and nothing left to run
+                    }
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable_any m_ready;
+        std::deque<std::function<void()>> m_tasks;
+        std::vector<std::jthread> m_workers; // last, so they are joined before the queue is destroyed
+    };
+
+    namespace impl {
+        /// @brief Amount of starting positions scanned between two checks of the stop token.
+        constexpr size_t async_chunk_size = 1 << 20;
+
+        /// @brief Scan a buffer in chunks, and give up between two chunks once a stop is requested.
+        /// @param overlap Amount of bytes each chunk is extended by (the largest match size minus one).
+        /// @param find_range Callable that accepts the range <c>[begin, end)</c> of a chunk (see <c>find_range</c>).
+        /// @return The index of the first match, or <b>sinaps::not_found</b> if not found or stopped.
+        template <typename FindRange>
+        intptr_t find_cancellable(size_t size, size_t overlap, std::stop_token const& stop, FindRange&& find_range) {
+            for (size_t begin = 0; begin < size; begin += async_chunk_size) {
+                if (stop.stop_requested()) {
+                    return not_found;
+                }
+                intptr_t res = find_range(begin, std::min(begin + async_chunk_size + overlap, size));
+                if (res != not_found) {
+                    return res;
+                }
+            }
+            return not_found;
+        }
+
+        /// @brief Run a scan on an executor, and fulfil a promise with its result.
+        template <typename Executor, typename Scan>
+        std::future<intptr_t> submit_scan(Executor& executor, Scan scan) {
+            auto promise = std::make_shared<std::promise<intptr_t>>();
+            auto future = promise->get_future();
+            executor(std::function<void()>([promise, scan = std::move(scan)] {
+                try {
+                    promise->set_value(scan());
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            }));
+            return future;
+        }
+
+        /// @brief State shared by the tasks of an <c>async_find_all</c>.
+        template <typename Results, typename Callback>
+        struct async_batch {
+            std::promise<Results> promise;
+            Results results;
+            std::atomic<size_t> remaining;
+            std::atomic<bool> failed{false};
+            Callback on_result;
+
+            async_batch(Results results, Callback on_result)
+                : results(std::move(results)), remaining(this->results.size()), on_result(std::move(on_result)) {}
+
+            /// @brief Record the result of one pattern, the last one fulfils the promise.
+            void finish(size_t index, intptr_t result) {
+                results[index] = result;
+                on_result(index, result);
+                done();
+            }
+
+            void fail() {
+                if (!failed.exchange(true)) {
+                    promise.set_exception(std::current_exception());
+                }
+                done();
+            }
+
+            void done() {
+                if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && !failed.load()) {
+                    promise.set_value(std::move(results));
+                }
+            }
+        };
+
+        /// @brief Callback of <c>async_find_all</c> that ignores the results.
+        struct ignore_result {
+            void operator()(size_t, intptr_t) const {}
+        };
+
+        /// @brief Submit one task per pattern, each one reports its result as soon as it's done.
+        /// @param scan Callable that accepts a pattern index, and returns its result.
+        template <typename Results, typename Executor, typename Callback, typename Scan>
+        std::future<Results> submit_batch(Executor& executor, Results results, Callback on_result, Scan scan) {
+            auto batch = std::make_shared<async_batch<Results, Callback>>(std::move(results), std::move(on_result));
+            auto future = batch->promise.get_future();
+            size_t count = batch->results.size(); // the last task moves the results out
+            if (count == 0) {
+                batch->promise.set_value(std::move(batch->results));
+                return future;
+            }
+            for (size_t k = 0; k < count; k++) {
+                executor(std::function<void()>([batch, scan, k] {
+                    try {
+                        batch->finish(k, scan(k));
+                    } catch (...) {
+                        batch->fail();
+                    }
+                }));
+            }
+            return future;
+        }
+    }
+
+    /// @brief Find an index of a pattern in a data buffer, on an executor (e.g. a <c>sinaps::thread_pool</c>).
+    /// The buffer must stay alive until the future is ready.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param executor Callable that schedules a <c>std::function&lt;void()&gt;</c> task, it must outlive the scan.
+    /// @param stop Checked every <c>impl::async_chunk_size</c> positions, a stopped scan reports <b>sinaps::not_found</b>.
+    /// @return The future index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern, typename Executor>
+        requires utils::is_specialization<Pattern, pattern>::value && std::invocable<Executor&, std::function<void()>>
+    std::future<intptr_t> async_find(uint8_t const* data, size_t size, Executor& executor, std::stop_token stop = {}) {
+        return impl::submit_scan(executor, [data, size, stop] {
+            return impl::find_cancellable(size, Pattern::max_size - 1, stop, [data, size](size_t begin, size_t end) {
+                return impl::find_range<Pattern>(data, size, begin, end, 1, impl::buffer_memory{data, size});
+            });
+        });
+    }
+
+    /// @brief Find an index of a compiled pattern in a data buffer, on an executor (see <c>sinaps::async_find</c>).
+    /// The pattern and the buffer must stay alive until the future is ready.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param executor Callable that schedules a task.
+    /// @param stop Cancels the scan, a stopped scan reports <b>sinaps::not_found</b>.
+    /// @return The future index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Executor> requires std::invocable<Executor&, std::function<void()>>
+    std::future<intptr_t> async_find(uint8_t const* data, size_t size, compiled_pattern const& pattern, Executor& executor, std::stop_token stop = {}) {
+        return impl::submit_scan(executor, [data, size, &pattern, stop] {
+            size_t overlap = pattern.max_size() ? pattern.max_size() - 1 : 0;
+            return impl::find_cancellable(size, overlap, stop, [data, size, &pattern](size_t begin, size_t end) {
+                return impl::find_compiled_range(data, size, begin, end, pattern, 1, impl::buffer_memory{data, size});
+            });
+        });
+    }
+
+    /// @brief Find multiple patterns in a data buffer, each one as its own task on an executor.
+    /// Unlike <c>sinaps::find_all</c>, every pattern is reported as soon as its own scan is done, so work that
+    /// depends on it can start without waiting for the others.
+    /// @tparam Patterns List of patterns (see <c>sinaps::pattern</c>).
+    /// @param data The data buffer to search in, it must stay alive until the future is ready.
+    /// @param size The size of the data buffer.
+    /// @param executor Callable that schedules a task.
+    /// @param on_result Callable that accepts a pattern index and its result, called on the worker that found it
+    /// (possibly on several threads at once).
+    /// @param stop Cancels the scans, stopped patterns report <b>sinaps::not_found</b>.
+    /// @return The future index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename... Patterns, typename Executor, typename Callback = impl::ignore_result>
+        requires (sizeof...(Patterns) > 0 && (utils::is_specialization<Patterns, pattern>::value && ...)) &&
+            std::invocable<Executor&, std::function<void()>> && std::invocable<Callback&, size_t, intptr_t>
+    std::future<std::array<intptr_t, sizeof...(Patterns)>> async_find_all(
+        uint8_t const* data, size_t size, Executor& executor, Callback on_result = {}, std::stop_token stop = {}
+    ) {
+        using scan_t = intptr_t (*)(uint8_t const*, size_t, std::stop_token const&);
+        static constexpr std::array<scan_t, sizeof...(Patterns)> scans = {
+            [](uint8_t const* data, size_t size, std::stop_token const& stop) {
+                return impl::find_cancellable(size, Patterns::max_size - 1, stop, [data, size](size_t begin, size_t end) {
+                    return impl::find_range<Patterns>(data, size, begin, end, 1, impl::buffer_memory{data, size});
+                });
+            }...
+        };
+
+        std::array<intptr_t, sizeof...(Patterns)> results;
+        results.fill(not_found);
+        return impl::submit_batch(executor, results, std::move(on_result), [data, size, stop](size_t k) {
+            return scans[k](data, size, stop);
+        });
+    }
+
+    /// @brief Find multiple compiled patterns in a data buffer, each one as its own task (see <c>sinaps::async_find_all</c>).
+    /// The patterns and the buffer must stay alive until the future is ready.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param patterns The patterns to search for.
+    /// @param executor Callable that schedules a task.
+    /// @param on_result Callable that accepts a pattern index and its result, called on the worker that found it.
+    /// @param stop Cancels the scans, stopped patterns report <b>sinaps::not_found</b>.
+    /// @return The future index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Executor, typename Callback = impl::ignore_result>
+        requires std::invocable<Executor&, std::function<void()>> && std::invocable<Callback&, size_t, intptr_t>
+    std::future<std::vector<intptr_t>> async_find_all(
+        uint8_t const* data, size_t size, std::span<compiled_pattern const> patterns, Executor& executor,
+        Callback on_result = {}, std::stop_token stop = {}
+    ) {
+        return impl::submit_batch(
+            executor, std::vector<intptr_t>(patterns.size(), not_found), std::move(on_result),
+            [data, size, patterns, stop](size_t k) {
+                auto const& pattern = patterns[k];
+                size_t overlap = pattern.max_size() ? pattern.max_size() - 1 : 0;
+                return impl::find_cancellable(size, overlap, stop, [data, size, &pattern](size_t begin, size_t end) {
+                    return impl::find_compiled_range(data, size, begin, end, pattern, 1, impl::buffer_memory{data, size});
+                });
+            }
+        );
+    }
+}
+
+#endif // SINAPS_ASYNC_HPP
@@ -0,0 +1,298 @@
+#pragma once
+#ifndef SINAPS_BATCH_HPP
+#define SINAPS_BATCH_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "anchor.hpp"
+#include "compiled_pattern.hpp"
+#include "find.hpp"
+#include "pattern.hpp"
+#include "token.hpp"
+
+namespace sinaps {
+    namespace impl {
+        /// @brief Per-pattern data used by the batch scanner.
+        /// 32-bit offsets keep it at 16 bytes, so large sets stay in cache.
+        struct batch_entry_t {
+            uint32_t first = 0;  // offset of the anchor byte (the bucket key)
+            uint32_t second = 0; // offset of the second anchor byte
+            uint32_t size = 0;   // pattern size in bytes
+            uint8_t second_byte = 0;
+
+            constexpr batch_entry_t() = default;
+            constexpr batch_entry_t(size_t first, size_t second, uint8_t second_byte, size_t size)
+                : first(static_cast<uint32_t>(first)), second(static_cast<uint32_t>(second)),
+                  size(static_cast<uint32_t>(size)), second_byte(second_byte) {}
+        };
+
+        /// @brief Bucket key of a pattern without fully-specified bytes, such patterns are not bucketed.
+        constexpr uint16_t no_bucket = 256;
+
+        /// @brief Group pattern indices by their anchor byte (counting sort).
+        /// @param keys Anchor byte of each pattern, or <c>no_bucket</c>.
+        /// @param start Output, <c>[start[b], start[b + 1])</c> is the range of <c>order</c> anchored on byte <c>b</c>.
+        /// @param order Output, pattern indices sorted by their anchor byte.
+        constexpr void build_buckets(std::span<uint16_t const> keys, std::span<uint32_t, 257> start, std::span<uint32_t> order) {
+            for (auto& s : start) s = 0;
+            for (auto key : keys) {
+                if (key != no_bucket) start[key + 1]++;
+            }
+            for (size_t b = 0; b < 256; b++) {
+                start[b + 1] += start[b];
+            }
+
+            std::array<uint32_t, 256> fill{};
+            for (size_t k = 0; k < keys.size(); k++) {
+                if (keys[k] != no_bucket) {
+                    order[start[keys[k]] + fill[keys[k]]++] = static_cast<uint32_t>(k);
+                }
+            }
+        }
+
+        /// @brief Scan the buffer once, looking for all anchored patterns at the same time.
+        /// Each position is looked up in the bucket table, and only the patterns anchored on that byte are checked.
+        /// @param limit Only the matches that start before this position are reported, the rest of the buffer holds their tails.
+        /// @param start Bucket ranges (see <c>build_buckets</c>).
+        /// @param order Pattern indices sorted by their anchor byte.
+        /// @param entries Per-pattern data.
+        /// @param results Output, must be filled with <b>sinaps::not_found</b> for every pattern that should be searched.
+        /// @param remaining Amount of patterns left to find, the scan stops once it reaches zero.
+        /// @param match Callable that accepts a pattern index and a position, and returns the index to report if the pattern
+        /// matches there (including the cursor offset and follow tokens), or <b>sinaps::not_found</b>.
+        template <typename Match>
+        SINAPS_HOT void scan_batch(
+            uint8_t const* data, size_t size, size_t limit,
+            std::span<uint32_t const, 257> start, std::span<uint32_t const> order,
+            std::span<batch_entry_t const> entries, std::span<intptr_t> results,
+            size_t remaining, Match&& match
+        ) {
+            size_t p = 0;
+            for (; p < size && remaining > 0; p++) {
+                uint8_t byte = data[p];
+                for (uint32_t k = start[byte]; k < start[byte + 1]; k++) {
+                    uint32_t index = order[k];
+                    auto const& entry = entries[index];
+                    if (results[index] != not_found || p < entry.first) {
+                        continue;
+                    }
+
+                    size_t i = p - entry.first;
+                    SINAPS_STATS_ADD_PATTERN(index, candidates, 1);
+                    if (i >= limit || i + entry.size > size || data[i + entry.second] != entry.second_byte) {
+                        continue;
+                    }
+
+                    SINAPS_STATS_ADD_PATTERN(index, verifies, 1);
+                    intptr_t res = match(index, i);
+                    if (res != not_found) {
+                        SINAPS_STATS_ADD_PATTERN(index, matches, 1);
+                        results[index] = res;
+                        remaining--;
+                    }
+                }
+            }
+            SINAPS_STATS_ADD(bytes, p);
+        }
+    }
+
+    /// @brief Set of compile-time patterns, searched for in a single pass.
+    /// Patterns are grouped by their rarest byte, so every position of the buffer is read only once,
+    /// no matter how many patterns are searched. Follow tokens are resolved, so the results are the final targets.
+    /// All the tables (anchor buckets, per-pattern anchor offsets and matchers) are built at compile time,
+    /// so a scan does no setup work and no allocation.
+    /// @tparam Patterns List of patterns (see <c>sinaps::pattern</c>).
+    template <typename... Patterns>
+    struct pattern_set {
+        static_assert(sizeof...(Patterns) > 0, "A pattern set needs at least one pattern");
+        static_assert((utils::is_specialization<Patterns, pattern>::value && ...), "A pattern set holds sinaps::pattern types");
+
+        // amount of patterns in the set
+        static constexpr size_t count = sizeof...(Patterns);
+
+        // anchor byte of each pattern, or `impl::no_bucket` for patterns that are scanned on their own
+        static constexpr std::array<uint16_t, count> keys = {
+            (Patterns::anchor_pair.valid ? Patterns::bytes[Patterns::anchor_pair.first] : impl::no_bucket)...
+        };
+
+        // amount of patterns in the buckets
+        static constexpr size_t bucketed = ((Patterns::anchor_pair.valid ? 1 : 0) + ...);
+
+        static constexpr std::array<impl::batch_entry_t, count> entries = {
+            impl::batch_entry_t{
+                Patterns::anchor_pair.first,
+                Patterns::anchor_pair.second,
+                Patterns::bytes[Patterns::anchor_pair.second],
+                Patterns::size
+            }...
+        };
+
+        // bucket ranges and pattern indices sorted by anchor byte (see `impl::build_buckets`)
+        static constexpr auto buckets = [] {
+            struct {
+                std::array<uint32_t, 257> start{};
+                std::array<uint32_t, count> order{};
+            } buckets;
+            impl::build_buckets(keys, buckets.start, buckets.order);
+            return buckets;
+        }();
+
+        static constexpr std::array<intptr_t(*)(uint8_t const*, size_t, size_t), count> matchers = {&impl::match_candidate<Patterns>...};
+
+        // largest amount of bytes a match of any pattern spans
+        static constexpr size_t max_size = std::max({Patterns::max_size...});
+
+        /// @brief Find every pattern of the set in a data buffer, in a single pass.
+        /// @param data The data buffer to search in.
+        /// @param size The size of the data buffer.
+        /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+        static std::array<intptr_t, count> find_all(uint8_t const* data, size_t size) {
+            return find_all(data, size, size);
+        }
+
+        /// @brief Find every pattern of the set in a data buffer, only reporting the matches that start before a limit.
+        /// Used by the block scans, where the matches that start in the overlap are left to the next block.
+        /// @param limit End of the match starts, the rest of the buffer is only read for the tails and follow targets.
+        /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+        static std::array<intptr_t, count> find_all(uint8_t const* data, size_t size, size_t limit) {
+            std::array<intptr_t, count> results;
+            results.fill(not_found);
+
+            // patterns without fully-specified bytes can't be bucketed
+            [&]<size_t... I>(std::index_sequence<I...>) {
+                ((keys[I] == impl::no_bucket ? (void) (results[I] = impl::find_range<Patterns>(
+                    data, size, 0, impl::head_end(size, limit, Patterns::size), 1, impl::buffer_memory{data, size}
+                )) : (void) 0), ...);
+            }(std::make_index_sequence<count>());
+
+            impl::scan_batch(
+                data, size, limit, buckets.start, buckets.order, entries, results, bucketed,
+                [data, size](uint32_t index, size_t i) { return matchers[index](data, size, i); }
+            );
+
+            return results;
+        }
+    };
+
+    /// @brief Find multiple patterns in a data buffer, in a single pass (see <c>sinaps::pattern_set</c>).
+    /// @tparam Patterns List of patterns (see <c>sinaps::pattern</c>).
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename... Patterns> requires (sizeof...(Patterns) > 0 && (utils::is_specialization<Patterns, pattern>::value && ...))
+    std::array<intptr_t, sizeof...(Patterns)> find_all(uint8_t const* data, size_t size) {
+        return pattern_set<Patterns...>::find_all(data, size);
+    }
+
+    /// @brief Find every pattern of a set in a data buffer, in a single pass.
+    /// @tparam Set The pattern set (see <c>sinaps::pattern_set</c>).
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Set> requires utils::is_specialization<Set, pattern_set>::value
+    std::array<intptr_t, Set::count> find_all(uint8_t const* data, size_t size) {
+        return Set::find_all(data, size);
+    }
+
+    /// @brief Find multiple patterns in a data buffer, in a single pass. Patterns are lists of tokens.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param patterns The patterns to search for.
+    /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    inline std::vector<intptr_t> find_all(uint8_t const* data, size_t size, std::span<std::span<token_t const> const> patterns) {
+        size_t count = patterns.size();
+        std::vector<intptr_t> results(count, not_found);
+        std::vector<impl::batch_entry_t> entries(count);
+        std::vector<impl::token_layout_t> layouts(count);
+        std::vector<uint16_t> keys(count, impl::no_bucket);
+
+        size_t remaining = 0;
+        for (size_t k = 0; k < count; k++) {
+            auto const& layout = layouts[k] = impl::layout_tokens(patterns[k]);
+            if (!layout.anchor.valid) {
+                // nothing to bucket by, scan for it separately
+                results[k] = impl::find_tokens(data, size, patterns[k], layout);
+                continue;
+            }
+
+            entries[k] = impl::batch_entry_t{
+                layout.anchor.first, layout.anchor.second, layout.anchor.second_byte, layout.size
+            };
+            keys[k] = layout.anchor.first_byte;
+            remaining++;
+        }
+
+        std::array<uint32_t, 257> start;
+        std::vector<uint32_t> order(count);
+        impl::build_buckets(keys, start, order);
+
+        impl::scan_batch(
+            data, size, size, start, order, entries, results, remaining,
+            [&](uint32_t index, size_t i) {
+                return impl::verify_layout(data + i, layouts[index])
+                    ? impl::resolve_tokens(data, size, i, patterns[index], layouts[index], impl::buffer_memory{data, size})
+                    : not_found;
+            }
+        );
+
+        return results;
+    }
+
+    namespace impl {
+        /// @brief Find multiple compiled patterns in a data buffer, only reporting the matches that start before a limit
+        /// (see <c>pattern_set::find_all</c>).
+        inline std::vector<intptr_t> find_all_compiled(
+            uint8_t const* data, size_t size, size_t limit, std::span<compiled_pattern const> patterns
+        ) {
+            size_t count = patterns.size();
+            std::vector<intptr_t> results(count, not_found);
+            std::vector<batch_entry_t> entries(count);
+            std::vector<uint16_t> keys(count, no_bucket);
+
+            size_t remaining = 0;
+            for (size_t k = 0; k < count; k++) {
+                auto const& pattern = patterns[k];
+                auto const& anchor = pattern.anchor();
+                if (!anchor.valid) {
+                    results[k] = find_compiled_range(
+                        data, size, 0, head_end(size, limit, pattern.size()), pattern, 1, buffer_memory{data, size}
+                    );
+                    continue;
+                }
+
+                entries[k] = batch_entry_t{anchor.first, anchor.second, anchor.second_byte, pattern.size()};
+                keys[k] = anchor.first_byte;
+                remaining++;
+            }
+
+            std::array<uint32_t, 257> start;
+            std::vector<uint32_t> order(count);
+            build_buckets(keys, start, order);
+
+            scan_batch(
+                data, size, limit, start, order, entries, results, remaining,
+                [&](uint32_t index, size_t i) {
+                    auto const& pattern = patterns[index];
+                    return pattern.verify(data + i) ? pattern.resolve(data, size, i, buffer_memory{data, size}) : not_found;
+                }
+            );
+
+            return results;
+        }
+    }
+
+    /// @brief Find multiple compiled patterns in a data buffer, in a single pass.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param patterns The patterns to search for.
+    /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    inline std::vector<intptr_t> find_all(uint8_t const* data, size_t size, std::span<compiled_pattern const> patterns) {
+        return impl::find_all_compiled(data, size, size, patterns);
+    }
+}
+
+#endif // SINAPS_BATCH_HPP
@@ -0,0 +1,267 @@
+#pragma once
+#ifndef SINAPS_CACHE_HPP
+#define SINAPS_CACHE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include "compiled_pattern.hpp"
+#include "find.hpp"
+#include "module.hpp"
+#include "pattern.hpp"
+
+namespace sinaps {
+    namespace impl {
+        /// @brief Fast 64-bit hash (multiply-xorshift over 8-byte words), not cryptographic.
+        struct hasher {
+            uint64_t state = 0x9E3779B97F4A7C15ull;
+
+            void mix(uint64_t value) {
+                state ^= value;
+                state *= 0xBF58476D1CE4E5B9ull;
+                state ^= state >> 31;
+            }
+
+            void update(void const* data, size_t size) {
+                auto bytes = static_cast<uint8_t const*>(data);
+                mix(size);
+                for (; size >= 8; bytes += 8, size -= 8) {
+                    uint64_t word;
+                    std::memcpy(&word, bytes, 8);
+                    mix(word);
+                }
+                uint64_t tail = 0;
+                std::memcpy(&tail, bytes, size);
+                mix(tail);
+            }
+
+            [[nodiscard]] uint64_t digest() const {
+                uint64_t h = state;
+                h ^= h >> 33;
+                h *= 0xFF51AFD7ED558CCDull;
+                h ^= h >> 33;
+                return h;
+            }
+        };
+
+        /// @brief Check a cached offset: it must lie in a code section of the module, and the pattern must match there.
+        template <typename Matches>
+        bool check_cached(module const& mod, intptr_t offset, Matches&& matches) {
+            for (auto const& section : mod.code_sections()) {
+                intptr_t begin = section.data - mod.base();
+                if (offset >= begin && static_cast<size_t>(offset - begin) <= section.size) {
+                    return matches(section.data, section.size, offset - begin);
+                }
+            }
+            return false;
+        }
+    }
+
+    /// @brief Fingerprint of a module, changes whenever the module is rebuilt.
+    /// By default only the headers are hashed: PE timestamp, image size and checksum, or the first page for ELF and
+    /// Mach-O (which holds the build-id note / <c>LC_UUID</c>), plus the layout of every section.
+    /// @param mod The module.
+    /// @param hash_code Also hash the whole content of the code sections, catches in-place patches.
+    /// Relocated images (e.g. 32-bit PE) may get a different hash on every load with this option.
+    inline uint64_t module_fingerprint(module const& mod, bool hash_code = false) {
+        impl::hasher hash;
+        hash.mix(static_cast<uint64_t>(mod.format()));
+
+        size_t extent = 0; // bytes known to be readable from the base
+        for (auto const& section : mod.sections()) {
+            extent = std::max(extent, static_cast<size_t>(section.data - mod.base()) + section.size);
+            hash.update(section.name.data(), section.name.size());
+            hash.mix(static_cast<uint64_t>(section.data - mod.base()));
+            hash.mix(section.size);
+            hash.mix(uint64_t(section.executable) | uint64_t(section.writable) << 1);
+        }
+
+        impl::header_reader reader{mod.base(), extent};
+        uint32_t nt_offset = 0, timestamp = 0, image_size = 0, checksum = 0;
+        if (mod.format() == module_format::pe && reader.read(0x3C, nt_offset) && reader.read(nt_offset + 8, timestamp) &&
+            reader.read(nt_offset + 24 + 56, image_size) && reader.read(nt_offset + 24 + 64, checksum)) {
+            // the rest of the loaded headers can be updated by the loader (e.g. the image base)
+            hash.mix(timestamp);
+            hash.mix(image_size);
+            hash.mix(checksum);
+        } else if (mod.valid()) {
+            hash.update(mod.base(), std::min<size_t>(extent, 4096));
+        }
+
+        if (hash_code) {
+            for (auto const& section : mod.code_sections()) {
+                hash.update(section.data, section.size);
+            }
+        }
+
+        return hash.digest();
+    }
+
+    /// @brief Persistent cache of pattern offsets, keyed by module fingerprint and pattern string.
+    /// The file is a plain text list of <c>fingerprint offset pattern</c> lines.
+    class result_cache {
+    public:
+        result_cache() = default;
+
+        /// @brief Open a cache file, it's loaded if it exists.
+        explicit result_cache(std::filesystem::path path) : m_path(std::move(path)) { load(); }
+
+        /// @brief Load the cache file, replacing the current entries.
+        /// @return Whether the file was read (a missing file leaves the cache empty).
+        bool load() {
+            m_entries.clear();
+            m_dirty = false;
+            std::ifstream file(m_path);
+            if (!file) {
+                return false;
+            }
+
+            std::string line;
+            while (std::getline(file, line)) {
+                unsigned long long fingerprint = 0;
+                long long offset = 0;
+                int consumed = 0;
+                if (std::sscanf(line.c_str(), "%llx %lld %n", &fingerprint, &offset, &consumed) == 2 && consumed > 0) {
+                    m_entries[{fingerprint, line.substr(static_cast<size_t>(consumed))}] = static_cast<intptr_t>(offset);
+                }
+            }
+            return true;
+        }
+
+        /// @brief Write the cache file, if anything changed since the last load or save.
+        /// The file is replaced atomically, so concurrent readers never see a partial file.
+        /// @return Whether the file is up to date.
+        bool save() {
+            if (!m_dirty) {
+                return true;
+            }
+
+            auto temp = m_path;
+            temp += ".tmp";
+            {
+                std::ofstream file(temp, std::ios::trunc);
+                for (auto const& [key, offset] : m_entries) {
+                    char prefix[64];
+                    std::snprintf(prefix, sizeof(prefix), "%016llx %lld ",
+                        static_cast<unsigned long long>(key.first), static_cast<long long>(offset));
+                    file << prefix << key.second << '\n';
+                }
+                if (!file.flush()) {
+                    return false;
+                }
+            }
+
+            std::error_code error;
+            std::filesystem::rename(temp, m_path, error);
+            if (error) {
+                return false;
+            }
+            m_dirty = false;
+            return true;
+        }
+
+        /// @brief Cached offset of a pattern, if any.
+        [[nodiscard]] std::optional<intptr_t> lookup(uint64_t fingerprint, std::string_view pattern) const {
+            auto it = m_entries.find({fingerprint, std::string(pattern)});
+            return it == m_entries.end() ? std::nullopt : std::optional(it->second);
+        }
+
+        /// @brief Remember the offset of a pattern.
+        void store(uint64_t fingerprint, std::string_view pattern, intptr_t offset) {
+            auto [it, inserted] = m_entries.try_emplace({fingerprint, std::string(pattern)}, offset);
+            if (inserted || it->second != offset) {
+                it->second = offset;
+                m_dirty = true;
+            }
+        }
+
+        /// @brief Forget the offset of a pattern.
+        void erase(uint64_t fingerprint, std::string_view pattern) {
+            m_dirty |= m_entries.erase({fingerprint, std::string(pattern)}) != 0;
+        }
+
+        [[nodiscard]] size_t size() const { return m_entries.size(); }
+        [[nodiscard]] std::filesystem::path const& path() const { return m_path; }
+
+    private:
+        std::filesystem::path m_path;
+        std::map<std::pair<uint64_t, std::string>, intptr_t> m_entries;
+        bool m_dirty = false;
+    };
+
+    /// @brief Find a pattern in the executable sections of a module, using the cache.
+    /// A cached offset is only trusted if the pattern still matches there, otherwise the module is scanned
+    /// and the cache is updated. Patterns that are not found are not cached.
+    /// Patterns with follow tokens are not cached, since their target can't be checked with a single match,
+    /// and neither are patterns with the cursor after a gap.
+    /// @param cache The cache.
+    /// @param mod The module to search in.
+    /// @param fingerprint Fingerprint of the module (see <c>sinaps::module_fingerprint</c>), compute it once per module.
+    /// @return The offset of the pattern from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    intptr_t find_cached(result_cache& cache, module const& mod, uint64_t fingerprint) {
+        if constexpr (Pattern::follow_count > 0 || Pattern::tail_cursor) {
+            return find<Pattern>(mod);
+        } else {
+            static constexpr auto key = Pattern::to_string();
+            if (auto cached = cache.lookup(fingerprint, key)) {
+                bool valid = impl::check_cached(mod, *cached, [](uint8_t const* data, size_t size, intptr_t index) {
+                    return matches_at<Pattern>(data, size, index);
+                });
+                if (valid) {
+                    return *cached;
+                }
+            }
+
+            intptr_t res = find<Pattern>(mod);
+            if (res != not_found) {
+                cache.store(fingerprint, key, res);
+            } else {
+                cache.erase(fingerprint, key);
+            }
+            return res;
+        }
+    }
+
+    /// @brief Find a compiled pattern in the executable sections of a module, using the cache.
+    /// @param cache The cache.
+    /// @param mod The module to search in.
+    /// @param fingerprint Fingerprint of the module (see <c>sinaps::module_fingerprint</c>).
+    /// @param pattern The pattern to search for.
+    /// @return The offset of the pattern from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    inline intptr_t find_cached(result_cache& cache, module const& mod, uint64_t fingerprint, compiled_pattern const& pattern) {
+        if (pattern.has_follow() || pattern.tail_cursor()) {
+            return find(mod, pattern);
+        }
+        std::string key = pattern.to_string();
+
+        if (auto cached = cache.lookup(fingerprint, key)) {
+            bool valid = impl::check_cached(mod, *cached, [&pattern](uint8_t const* data, size_t size, intptr_t index) {
+                return matches_at(data, size, index, pattern);
+            });
+            if (valid) {
+                return *cached;
+            }
+        }
+
+        intptr_t res = find(mod, pattern);
+        if (res != not_found) {
+            cache.store(fingerprint, key, res);
+        } else {
+            cache.erase(fingerprint, key);
+        }
+        return res;
+    }
+}
+
+#endif // SINAPS_CACHE_HPP
@@ -0,0 +1,309 @@
+#pragma once
+#ifndef SINAPS_COMPILED_PATTERN_HPP
+#define SINAPS_COMPILED_PATTERN_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "anchor.hpp"
+#include "find.hpp"
+#include "pattern.hpp"
+#include "skip.hpp"
+#include "stats.hpp"
+#include "token.hpp"
+
+namespace sinaps {
+    /// @brief Pattern parsed at runtime, with the same precomputed layout as <c>sinaps::pattern</c>.
+    /// Parse once (e.g. from a config file) and reuse it for every scan, <c>find</c> does not allocate.
+    /// The head is stored as two rows (bytes, then masks) aligned and padded to <c>impl::row_alignment</c>,
+    /// so it's verified with a few wide compares, and the token types are implied by the masks.
+    class compiled_pattern {
+    public:
+        constexpr compiled_pattern() = default;
+
+        /// @brief Parse a pattern string (e.g. "48 8B ? ^ E8").
+        constexpr explicit compiled_pattern(std::string_view pattern)
+            : compiled_pattern(impl::tokenizePatternStringRuntime(pattern)) {}
+
+        /// @brief Build a pattern from a list of tokens.
+        /// @throws std::invalid_argument If the pattern starts with a gap.
+        constexpr explicit compiled_pattern(std::span<token_t const> tokens) {
+            m_tokens.assign(tokens.begin(), tokens.end());
+
+            while (m_head < tokens.size() && tokens[m_head].type != token_t::type_t::gap) m_head++;
+            auto head = tokens.first(m_head);
+
+            for (auto const& token : head) {
+                if (token.type == token_t::type_t::cursor) {
+                    m_cursor_pos = m_size;
+                } else if (token.type == token_t::type_t::follow) {
+                    m_has_follow = true;
+                } else {
+                    m_size++;
+                }
+            }
+
+            m_stride = (m_size + impl::row_alignment - 1) / impl::row_alignment * impl::row_alignment;
+            m_rows.assign(m_stride * 2, 0);
+
+            size_t offset = 0, last_byte = 0;
+            for (auto const& token : head) {
+                if (token.zero_sized()) continue;
+
+                // same masks and bytes as `sinaps::pattern::match_masks` and `match_bytes`
+                uint8_t& byte = m_rows[offset];
+                uint8_t& mask = m_rows[m_stride + offset];
+                switch (token.type) {
+                    case token_t::type_t::byte:
+                        byte = token.byte;
+                        mask = 0xFF;
+                        last_byte = offset;
+                        break;
+                    case token_t::type_t::masked:
+                        byte = token.byte;
+                        mask = token.mask;
+                        break;
+                    case token_t::type_t::either:
+                        byte = token.byte & token.mask;
+                        mask = static_cast<uint8_t>(~(token.byte ^ token.mask));
+                        m_either.push_back({static_cast<uint32_t>(offset), token.byte, token.mask});
+                        break;
+                    default: break;
+                }
+                offset++;
+            }
+
+            m_min_size = m_max_size = m_size;
+            if (has_gap()) {
+                if (m_size == 0) {
+                    throw std::invalid_argument("A pattern can't start with a gap");
+                }
+                for (auto const& token : tail()) {
+                    if (token.type == token_t::type_t::follow) {
+                        m_has_follow = true;
+                    } else if (token.type == token_t::type_t::cursor) {
+                        m_tail_cursor = true;
+                    } else if (token.type == token_t::type_t::gap) {
+                        m_min_size += token.byte;
+                        m_max_size += token.mask;
+                    } else {
+                        m_min_size++;
+                        m_max_size++;
+                    }
+                }
+            }
+
+            m_anchor = select_anchor(head);
+            if (m_anchor.valid) {
+                m_skip = build_skip_table(head, last_byte);
+            }
+        }
+
+        /// @brief Size of the pattern in bytes (excluding zero-sized tokens), only the head if it has gaps.
+        [[nodiscard]] constexpr size_t size() const { return m_size; }
+        /// @brief Smallest amount of bytes a match spans (the size, if there are no gaps).
+        [[nodiscard]] constexpr size_t min_size() const { return m_min_size; }
+        /// @brief Largest amount of bytes a match spans (the size, if there are no gaps).
+        [[nodiscard]] constexpr size_t max_size() const { return m_max_size; }
+        /// @brief Whether the pattern has gaps, only its head is scanned for and the tail is matched after it.
+        [[nodiscard]] constexpr bool has_gap() const { return m_head < m_tokens.size(); }
+        /// @brief Whether the pattern has follow tokens, matches then report their target.
+        [[nodiscard]] constexpr bool has_follow() const { return m_has_follow; }
+        /// @brief Whether the cursor is after the first gap, <c>cursor_pos()</c> is then not used.
+        [[nodiscard]] constexpr bool tail_cursor() const { return m_tail_cursor; }
+        /// @brief Position of the cursor token in the pattern.
+        [[nodiscard]] constexpr size_t cursor_pos() const { return m_cursor_pos; }
+        /// @brief Pair of the least frequent fully-specified bytes, used to prefilter the scan.
+        [[nodiscard]] constexpr anchor_t const& anchor() const { return m_anchor; }
+        /// @brief Bad-character skip table, indexed by the last fully-specified byte.
+        [[nodiscard]] constexpr skip_table_t const& skip_table() const { return m_skip; }
+
+        /// @brief Original tokens (including zero-sized ones), follow tokens are applied in this order.
+        [[nodiscard]] constexpr std::span<token_t const> tokens() const { return m_tokens; }
+        /// @brief Tokens from the first gap on (see <c>impl::match_tail</c>), empty if there are no gaps.
+        [[nodiscard]] constexpr std::span<token_t const> tail() const { return tokens().subspan(m_head); }
+        /// @brief Bytes the masked data of the head is compared to (0x00 for wildcards, the bits both bytes share
+        /// for either tokens), aligned on <c>impl::row_alignment</c>.
+        [[nodiscard]] constexpr std::span<uint8_t const> bytes() const { return std::span(m_rows).first(m_size); }
+        /// @brief Masks applied to the data of the head (0xFF for bytes, 0x00 for wildcards), aligned on <c>impl::row_alignment</c>.
+        [[nodiscard]] constexpr std::span<uint8_t const> masks() const { return std::span(m_rows).subspan(m_stride, m_size); }
+        /// @brief Either tokens of the head, checked exactly after the masked compare.
+        [[nodiscard]] constexpr std::span<impl::either_t const> either() const { return m_either; }
+
+        /// @brief Index to report for a match (the cursor, or the target of the follow tokens).
+        /// The tail is matched here if the pattern has gaps, the head must already match.
+        /// @param data Origin of the positions, the tail is read before <c>data + size</c>.
+        /// @param start Start of the match.
+        /// @param memory Memory the follow tokens are resolved in (see <c>impl::resolve_follows</c>).
+        /// @return The index, or <b>sinaps::not_found</b> if the tail doesn't match or a follow token can't be resolved.
+        template <typename Memory>
+        [[nodiscard]] constexpr intptr_t resolve(uint8_t const* data, size_t size, size_t start, Memory const& memory) const {
+            auto index = static_cast<intptr_t>(start + m_cursor_pos);
+            if (has_gap() && !impl::match_tail(data, size, start + m_size, tail(), index)) {
+                return not_found;
+            }
+            return m_has_follow ? impl::resolve_follows(index, m_tokens, memory) : index;
+        }
+
+        /// @brief Check whether the pattern matches the data at the given pointer.
+        /// @param data Pointer to the first byte of the potential match (at least <c>size()</c> bytes).
+        [[nodiscard]] constexpr bool verify(uint8_t const* data) const {
+            return impl::verify_masked(data, m_rows.data() + m_stride, m_rows.data(), m_size) && impl::verify_either(data, m_either);
+        }
+
+        [[nodiscard]] std::string to_string() const { return sinaps::to_string(m_tokens); }
+
+    private:
+        std::vector<token_t> m_tokens;
+        std::vector<uint8_t, utils::aligned_allocator<uint8_t, impl::row_alignment>> m_rows; // bytes, then masks, `m_stride` bytes each
+        std::vector<impl::either_t> m_either;
+        size_t m_head = 0;   // amount of tokens before the first gap
+        size_t m_size = 0;
+        size_t m_stride = 0; // size rounded up to `impl::row_alignment`
+        size_t m_cursor_pos = 0;
+        size_t m_min_size = 0;
+        size_t m_max_size = 0;
+        bool m_has_follow = false;
+        bool m_tail_cursor = false;
+        anchor_t m_anchor;
+        skip_table_t m_skip;
+    };
+
+    namespace impl {
+        /// @brief Find the first position where a compiled pattern starts (ignoring the cursor).
+        /// @return The position of the first match, or <b>sinaps::not_found</b> if not found.
+        SINAPS_HOT constexpr intptr_t find_compiled_start(uint8_t const* data, size_t size, compiled_pattern const& pattern, size_t step_size) {
+            size_t pattern_size = pattern.size();
+            if (size < pattern_size) {
+                return not_found;
+            }
+
+            // the skip table is only built for patterns that have fully-specified bytes, i.e. a valid anchor
+            auto const& skip = pattern.skip_table();
+            auto const& anchor = pattern.anchor();
+            if (anchor.valid && prefer_skip_table(skip, anchor.valid) && step_size == 1 && !std::is_constant_evaluated()) {
+                return scan_skip(
+                    data, size - pattern_size + 1, skip, pattern.bytes()[skip.offset],
+                    [data, &pattern](size_t i) { return pattern.verify(data + i); }
+                );
+            }
+
+            if (anchor.valid && step_size == 1 && !std::is_constant_evaluated()) {
+                return scan_anchor_dispatch(
+                    data, size - pattern_size + 1,
+                    anchor.first, anchor.first_byte, anchor.second, anchor.second_byte,
+                    [data, &pattern](size_t i) { return pattern.verify(data + i); }
+                );
+            }
+
+            for (size_t i = 0; i <= size - pattern_size; i += step_size) {
+                SINAPS_STATS_ADD(verifies, 1);
+                if (pattern.verify(data + i)) {
+                    SINAPS_STATS_ADD(bytes, i + 1);
+                    return static_cast<intptr_t>(i);
+                }
+            }
+
+            SINAPS_STATS_ADD(bytes, size - pattern_size + 1);
+            return not_found;
+        }
+
+        /// @brief Find the last position where a compiled pattern starts (ignoring the cursor), scanning backwards.
+        /// @return The position of the last match, or <b>sinaps::not_found</b> if not found.
+        constexpr intptr_t find_compiled_start_reverse(uint8_t const* data, size_t size, compiled_pattern const& pattern) {
+            size_t pattern_size = pattern.size();
+            if (size < pattern_size) {
+                return not_found;
+            }
+
+            auto verify = [data, &pattern](size_t i) { return pattern.verify(data + i); };
+            auto const& anchor = pattern.anchor();
+            if (anchor.valid && !std::is_constant_evaluated()) {
+                return scan_anchor_reverse_dispatch(
+                    data, size - pattern_size + 1, anchor.first, anchor.first_byte, anchor.second, anchor.second_byte, verify
+                );
+            }
+            return scan_reverse(size - pattern_size + 1, verify);
+        }
+
+        /// @brief Find the first match of a compiled pattern that starts in a range (see <c>find_range</c>).
+        template <typename Memory>
+        constexpr intptr_t find_compiled_range(
+            uint8_t const* data, size_t size, size_t begin, size_t end, compiled_pattern const& pattern, size_t step_size, Memory const& memory
+        ) {
+            if (!pattern.has_follow() && !pattern.has_gap()) {
+                auto res = find_compiled_start(data + begin, end - begin, pattern, step_size);
+                if (res == not_found) {
+                    return not_found;
+                }
+                SINAPS_STATS_ADD(matches, 1);
+                return res + static_cast<intptr_t>(begin + pattern.cursor_pos());
+            }
+            return find_resolved(
+                begin, end, step_size,
+                [&](size_t from, size_t count) { return find_compiled_start(data + from, count, pattern, step_size); },
+                [&](size_t start) { return pattern.resolve(data, size, start, memory); }
+            );
+        }
+    }
+
+    /// @brief Find an index of a compiled pattern in a data buffer.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    constexpr intptr_t find(uint8_t const* data, size_t size, compiled_pattern const& pattern, size_t step_size = 1) {
+        return impl::find_compiled_range(data, size, 0, size, pattern, step_size, impl::buffer_memory{data, size});
+    }
+
+    /// @brief Find an index of a pattern in a data buffer. Pattern is a string.
+    /// The string is parsed on every call, use <c>sinaps::compiled_pattern</c> to parse it once.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    constexpr intptr_t find(uint8_t const* data, size_t size, std::string_view pattern, size_t step_size = 1) {
+        return find(data, size, compiled_pattern(pattern), step_size);
+    }
+
+    /// @brief Check whether a compiled pattern matches at a known position, e.g. a cached result of <c>find</c>.
+    /// @param ptr Pointer to the position <c>find</c> would report (the cursor), the pattern is read from
+    /// <c>ptr - pattern.cursor_pos()</c> to <c>ptr - pattern.cursor_pos() + pattern.max_size()</c>.
+    /// @param pattern The pattern to check.
+    /// @return Whether the pattern matches there, always <c>false</c> if the cursor is after the first gap.
+    constexpr bool matches_at(uint8_t const* ptr, compiled_pattern const& pattern) {
+        if (pattern.tail_cursor()) {
+            return false;
+        }
+        uint8_t const* start = ptr - pattern.cursor_pos();
+        intptr_t cursor = 0;
+        return pattern.verify(start) &&
+            (!pattern.has_gap() || impl::match_tail(start, pattern.max_size(), pattern.size(), pattern.tail(), cursor));
+    }
+
+    /// @brief Check whether a compiled pattern matches at a known index of a data buffer.
+    /// @param data The data buffer.
+    /// @param size The size of the data buffer.
+    /// @param index The index <c>find</c> would report (including the cursor offset).
+    /// @param pattern The pattern to check.
+    /// @return Whether the pattern matches there, <c>false</c> if it doesn't fit in the buffer or the cursor
+    /// is after the first gap.
+    constexpr bool matches_at(uint8_t const* data, size_t size, intptr_t index, compiled_pattern const& pattern) {
+        intptr_t start = index - static_cast<intptr_t>(pattern.cursor_pos());
+        if (pattern.tail_cursor() || start < 0 || static_cast<size_t>(start) > size || size - static_cast<size_t>(start) < pattern.size()) {
+            return false;
+        }
+        intptr_t cursor = 0;
+        return pattern.verify(data + start) &&
+            (!pattern.has_gap() || impl::match_tail(data, size, static_cast<size_t>(start) + pattern.size(), pattern.tail(), cursor));
+    }
+}
+
+#endif // SINAPS_COMPILED_PATTERN_HPP
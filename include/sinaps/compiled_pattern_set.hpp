@@ -0,0 +1,330 @@
+#pragma once
+#ifndef SINAPS_COMPILED_PATTERN_SET_HPP
+#define SINAPS_COMPILED_PATTERN_SET_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "batch.hpp"
+#include "compiled_pattern.hpp"
+#include "find.hpp"
+#include "token.hpp"
+#include "utils.hpp"
+
+namespace sinaps {
+    namespace impl {
+        /// @brief Start of a pattern set arena. Every offset is in bytes from the start of the arena,
+        /// so an arena can be copied or mapped anywhere (as long as it stays aligned on <c>row_alignment</c>).
+        struct set_header_t {
+            uint32_t size = 0;     // size of the arena in bytes
+            uint32_t count = 0;    // amount of patterns
+            uint32_t bucketed = 0; // amount of patterns with an anchor, the others are scanned on their own
+            uint32_t max_size = 0; // largest amount of bytes a match of any pattern spans
+            uint32_t entries = 0;  // batch_entry_t[count]
+            uint32_t start = 0;    // uint32_t[257], bucket ranges (see `build_buckets`)
+            uint32_t order = 0;    // uint32_t[bucketed], pattern indices sorted by anchor byte
+            uint32_t records = 0;  // set_record_t[count]
+        };
+
+        /// @brief What a pattern set arena knows about one of its patterns (see <c>sinaps::compiled_pattern</c>).
+        struct set_record_t {
+            // bits of `flags`
+            static constexpr uint32_t anchored = 1; // the pattern is in the buckets
+            static constexpr uint32_t has_gap = 2;
+            static constexpr uint32_t has_follow = 4;
+            static constexpr uint32_t tail_cursor = 8;
+
+            uint32_t rows = 0;         // bytes row, the masks row is `stride` bytes after it
+            uint32_t stride = 0;
+            uint32_t size = 0;         // size of the head in bytes
+            uint32_t cursor = 0;       // cursor offset in bytes
+            uint32_t tokens = 0;       // token_t[token_count], the original tokens
+            uint32_t token_count = 0;
+            uint32_t head = 0;         // amount of tokens before the first gap
+            uint32_t either = 0;       // either_t[either_count]
+            uint32_t either_count = 0;
+            uint32_t flags = 0;
+        };
+
+        /// @brief Read-only view of a pattern set arena, used by the scans.
+        class set_view {
+        public:
+            constexpr set_view() = default;
+
+            /// @param base Start of the arena, aligned on <c>row_alignment</c>. It must be a valid arena.
+            explicit set_view(uint8_t const* base) : m_base(base) {
+                std::memcpy(&m_header, base, sizeof(m_header));
+            }
+
+            [[nodiscard]] set_header_t const& header() const { return m_header; }
+            [[nodiscard]] size_t count() const { return m_header.count; }
+
+            [[nodiscard]] std::span<batch_entry_t const> entries() const { return {at<batch_entry_t>(m_header.entries), count()}; }
+            [[nodiscard]] std::span<uint32_t const, 257> start() const { return std::span<uint32_t const, 257>(at<uint32_t>(m_header.start), 257); }
+            [[nodiscard]] std::span<uint32_t const> order() const { return {at<uint32_t>(m_header.order), m_header.bucketed}; }
+            [[nodiscard]] set_record_t const& record(size_t index) const { return at<set_record_t>(m_header.records)[index]; }
+
+            [[nodiscard]] std::span<token_t const> tokens(set_record_t const& record) const {
+                return {at<token_t>(record.tokens), record.token_count};
+            }
+
+            /// @brief Check whether a pattern matches the data at the given pointer (at least <c>record.size</c> bytes).
+            [[nodiscard]] bool verify(set_record_t const& record, uint8_t const* data) const {
+                uint8_t const* bytes = m_base + record.rows;
+                return verify_masked(data, bytes + record.stride, bytes, record.size) &&
+                    verify_either(data, {at<either_t>(record.either), record.either_count});
+            }
+
+            /// @brief Index to report for a match of a pattern (see <c>sinaps::compiled_pattern::resolve</c>).
+            template <typename Memory>
+            [[nodiscard]] intptr_t resolve(set_record_t const& record, uint8_t const* data, size_t size, size_t start, Memory const& memory) const {
+                auto index = static_cast<intptr_t>(start + record.cursor);
+                auto tokens = this->tokens(record);
+                if ((record.flags & set_record_t::has_gap) && !match_tail(data, size, start + record.size, tokens.subspan(record.head), index)) {
+                    return not_found;
+                }
+                return (record.flags & set_record_t::has_follow) ? resolve_follows(index, tokens, memory) : index;
+            }
+
+        private:
+            template <typename T>
+            [[nodiscard]] T const* at(uint32_t offset) const { return reinterpret_cast<T const*>(m_base + offset); }
+
+            uint8_t const* m_base = nullptr;
+            set_header_t m_header;
+        };
+
+        /// @brief Whether <c>count</c> items of <c>T</c> at <c>offset</c> are aligned and inside an arena.
+        template <typename T>
+        bool arena_holds(std::span<uint8_t const> arena, uint64_t offset, uint64_t count, size_t alignment = alignof(T)) {
+            return offset % alignment == 0 && offset <= arena.size() && count * sizeof(T) <= arena.size() - offset;
+        }
+
+        /// @brief Check that an arena from an untrusted source (e.g. a file) is consistent: every table and record
+        /// lies inside it, and every index it holds is in range. Scans can then use it without bounds checks.
+        /// @param arena The arena, aligned on <c>row_alignment</c>.
+        inline bool check_arena(std::span<uint8_t const> arena) {
+            set_header_t header;
+            if (arena.size() < sizeof(header) || reinterpret_cast<uintptr_t>(arena.data()) % row_alignment != 0) {
+                return false;
+            }
+            std::memcpy(&header, arena.data(), sizeof(header));
+            if (header.size != arena.size() || header.bucketed > header.count ||
+                !arena_holds<batch_entry_t>(arena, header.entries, header.count) ||
+                !arena_holds<uint32_t>(arena, header.start, 257) ||
+                !arena_holds<uint32_t>(arena, header.order, header.bucketed) ||
+                !arena_holds<set_record_t>(arena, header.records, header.count)) {
+                return false;
+            }
+
+            set_view set(arena.data());
+            auto start = set.start();
+            for (size_t b = 0; b < 256; b++) {
+                if (start[b] > start[b + 1]) return false;
+            }
+            if (start[0] != 0 || start[256] != header.bucketed) {
+                return false;
+            }
+            for (auto index : set.order()) {
+                if (index >= header.count || !(set.record(index).flags & set_record_t::anchored)) return false;
+            }
+
+            for (size_t k = 0; k < set.count(); k++) {
+                auto const& record = set.record(k);
+                auto const& entry = set.entries()[k];
+                if (!arena_holds<token_t>(arena, record.tokens, record.token_count) ||
+                    !arena_holds<either_t>(arena, record.either, record.either_count) ||
+                    !arena_holds<uint8_t>(arena, record.rows, uint64_t(record.stride) * 2, row_alignment) ||
+                    record.stride % row_alignment != 0 || record.size > record.stride ||
+                    record.cursor > record.size || record.head > record.token_count ||
+                    ((record.flags & set_record_t::has_gap) != 0) != (record.head < record.token_count)) {
+                    return false;
+                }
+                if ((record.flags & set_record_t::anchored) && (entry.size != record.size || entry.first >= record.size || entry.second >= record.size)) {
+                    return false;
+                }
+
+                auto either = std::span(reinterpret_cast<either_t const*>(arena.data() + record.either), record.either_count);
+                for (auto const& token : either) {
+                    if (token.offset >= record.size) return false;
+                }
+
+                // the head must be as long as the rows say, the tail is bounded by its gaps
+                auto tokens = set.tokens(record);
+                size_t head_size = 0;
+                for (size_t i = 0; i < tokens.size(); i++) {
+                    auto const& token = tokens[i];
+                    if (token.type > token_t::type_t::gap || (token.type == token_t::type_t::gap && token.byte > token.mask)) return false;
+                    if (i < record.head && !token.zero_sized()) head_size++;
+                }
+                if (head_size != record.size) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// @brief Find every pattern of an arena in a data buffer, in a single pass.
+        /// @param limit Only the matches that start before this position are reported (see <c>pattern_set::find_all</c>).
+        inline std::vector<intptr_t> find_all_set(uint8_t const* data, size_t size, size_t limit, set_view const& set) {
+            std::vector<intptr_t> results(set.count(), not_found);
+            if (results.empty()) {
+                return results;
+            }
+            buffer_memory memory{data, size};
+
+            // patterns without fully-specified bytes can't be bucketed, verify them on every position
+            for (size_t k = 0; k < set.count(); k++) {
+                auto const& record = set.record(k);
+                if (record.flags & set_record_t::anchored) {
+                    continue;
+                }
+                results[k] = find_resolved(
+                    0, head_end(size, limit, record.size), 1,
+                    [&](size_t from, size_t count) {
+                        for (size_t i = 0; i + record.size <= count; i++) {
+                            if (set.verify(record, data + from + i)) return static_cast<intptr_t>(i);
+                        }
+                        return not_found;
+                    },
+                    [&](size_t start) { return set.resolve(record, data, size, start, memory); }
+                );
+            }
+
+            scan_batch(
+                data, size, limit, set.start(), set.order(), set.entries(), results, set.header().bucketed,
+                [&](uint32_t index, size_t i) {
+                    auto const& record = set.record(index);
+                    return set.verify(record, data + i) ? set.resolve(record, data, size, i, memory) : not_found;
+                }
+            );
+
+            return results;
+        }
+    }
+
+    /// @brief Compiled patterns packed into one contiguous arena, with the batch tables built once.
+    /// The byte and mask rows, tokens, anchor entries and buckets of every pattern live in a single aligned buffer,
+    /// so a large set costs one allocation, stays dense in cache, and scans without any setup work.
+    class compiled_pattern_set {
+    public:
+        compiled_pattern_set() = default;
+
+        /// @brief Pack a list of patterns, they are not referenced afterwards.
+        /// @throws std::length_error If the arena would not fit in 32-bit offsets.
+        explicit compiled_pattern_set(std::span<compiled_pattern const> patterns) {
+            using impl::set_record_t;
+
+            size_t end = 0;
+            auto reserve = [&end](size_t bytes, size_t alignment) {
+                size_t offset = (end + alignment - 1) / alignment * alignment;
+                end = offset + bytes;
+                return offset;
+            };
+
+            size_t count = patterns.size(), bucketed = 0;
+            std::vector<uint16_t> keys(count, impl::no_bucket);
+            for (size_t k = 0; k < count; k++) {
+                if (patterns[k].anchor().valid) {
+                    keys[k] = patterns[k].anchor().first_byte;
+                    bucketed++;
+                }
+            }
+
+            impl::set_header_t header;
+            reserve(sizeof(header), alignof(impl::set_header_t));
+            header.count = static_cast<uint32_t>(count);
+            header.bucketed = static_cast<uint32_t>(bucketed);
+            header.entries = narrow(reserve(count * sizeof(impl::batch_entry_t), alignof(impl::batch_entry_t)));
+            header.start = narrow(reserve(257 * sizeof(uint32_t), alignof(uint32_t)));
+            header.order = narrow(reserve(bucketed * sizeof(uint32_t), alignof(uint32_t)));
+            header.records = narrow(reserve(count * sizeof(set_record_t), alignof(set_record_t)));
+
+            std::vector<set_record_t> records(count);
+            for (size_t k = 0; k < count; k++) {
+                auto const& pattern = patterns[k];
+                auto& record = records[k];
+                record.size = narrow(pattern.size());
+                record.cursor = narrow(pattern.cursor_pos());
+                record.token_count = narrow(pattern.tokens().size());
+                record.head = narrow(pattern.tokens().size() - pattern.tail().size());
+                record.either_count = narrow(pattern.either().size());
+                record.flags = (pattern.anchor().valid ? set_record_t::anchored : 0u) |
+                    (pattern.has_gap() ? set_record_t::has_gap : 0u) |
+                    (pattern.has_follow() ? set_record_t::has_follow : 0u) |
+                    (pattern.tail_cursor() ? set_record_t::tail_cursor : 0u);
+                record.tokens = narrow(reserve(record.token_count * sizeof(token_t), alignof(token_t)));
+                record.either = narrow(reserve(record.either_count * sizeof(impl::either_t), alignof(impl::either_t)));
+                header.max_size = std::max(header.max_size, narrow(pattern.max_size()));
+            }
+            for (size_t k = 0; k < count; k++) {
+                auto& record = records[k];
+                record.stride = narrow((record.size + impl::row_alignment - 1) / impl::row_alignment * impl::row_alignment);
+                record.rows = narrow(reserve(record.stride * 2, impl::row_alignment));
+            }
+            header.size = narrow(reserve(0, impl::row_alignment));
+
+            m_arena.assign(header.size, 0);
+            auto write = [this](size_t offset, auto const& values) {
+                auto bytes = std::as_bytes(std::span(values));
+                if (!bytes.empty()) std::memcpy(m_arena.data() + offset, bytes.data(), bytes.size());
+            };
+
+            write(0, std::span(&header, 1));
+            for (size_t k = 0; k < count; k++) {
+                auto const& pattern = patterns[k];
+                auto const& record = records[k];
+                auto const& anchor = pattern.anchor();
+                impl::batch_entry_t entry{anchor.first, anchor.second, anchor.second_byte, pattern.size()};
+                write(header.entries + k * sizeof(entry), std::span(&entry, 1));
+                write(header.records + k * sizeof(record), std::span(&record, 1));
+                write(record.tokens, pattern.tokens());
+                write(record.either, pattern.either());
+                write(record.rows, pattern.bytes());
+                write(record.rows + record.stride, pattern.masks());
+            }
+
+            std::array<uint32_t, 257> start;
+            std::vector<uint32_t> order(bucketed);
+            impl::build_buckets(keys, start, order);
+            write(header.start, start);
+            write(header.order, order);
+        }
+
+        /// @brief Amount of patterns in the set.
+        [[nodiscard]] size_t size() const { return view().count(); }
+        /// @brief Largest amount of bytes a match of any pattern spans.
+        [[nodiscard]] size_t max_size() const { return view().header().max_size; }
+        /// @brief The arena, aligned on <c>impl::row_alignment</c>.
+        [[nodiscard]] std::span<uint8_t const> arena() const { return m_arena; }
+        /// @brief View of the arena, used by the scans.
+        [[nodiscard]] impl::set_view view() const { return m_arena.empty() ? impl::set_view() : impl::set_view(m_arena.data()); }
+
+    private:
+        static uint32_t narrow(size_t value) {
+            if (value > std::numeric_limits<uint32_t>::max()) {
+                throw std::length_error("Pattern set is too large");
+            }
+            return static_cast<uint32_t>(value);
+        }
+
+        std::vector<uint8_t, utils::aligned_allocator<uint8_t, impl::row_alignment>> m_arena;
+    };
+
+    /// @brief Find every pattern of a set in a data buffer, in a single pass.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param set The patterns to search for.
+    /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    inline std::vector<intptr_t> find_all(uint8_t const* data, size_t size, compiled_pattern_set const& set) {
+        return impl::find_all_set(data, size, size, set.view());
+    }
+}
+
+#endif // SINAPS_COMPILED_PATTERN_SET_HPP
@@ -0,0 +1,281 @@
+#pragma once
+#ifndef SINAPS_DATABASE_HPP
+#define SINAPS_DATABASE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "compiled_pattern.hpp"
+#include "compiled_pattern_set.hpp"
+#include "mapped_file.hpp"
+#include "utils.hpp"
+
+namespace sinaps {
+    namespace impl {
+        /// @brief Start of a database blob, followed by the arena (see <c>compiled_pattern_set</c>) and the names.
+        /// The blob is written in the byte order and layout of the machine that built it, and is only loaded back
+        /// by builds with the same version and byte order.
+        struct database_header_t {
+            char magic[8] = {'S', 'I', 'N', 'A', 'P', 'S', 'D', 'B'};
+            uint32_t version = 1;
+            uint32_t byte_order = 0x01020304;
+            uint32_t arena = 0;       // offset of the arena, aligned on `row_alignment`
+            uint32_t arena_size = 0;
+            uint32_t names = 0;       // offset of uint32_t[count] end offsets of each name (aligned), followed by the characters
+            uint32_t names_size = 0;
+            uint32_t count = 0;       // amount of patterns
+        };
+
+        /// @brief Blobs are built where the arena can stay aligned when the file is mapped (at offset 0).
+        constexpr size_t database_arena_offset = row_alignment;
+        static_assert(sizeof(database_header_t) <= database_arena_offset);
+    }
+
+    /// @brief Named signatures, kept as a precompiled blob that is mapped and scanned in place.
+    /// The text format has one signature per line, <c>name = pattern</c> (any pattern string, including the cursor,
+    /// follow tokens and gaps). Blank lines and lines starting with <c>#</c> are skipped.
+    /// <c>save</c> writes the blob (versioned, see <c>impl::database_header_t</c>), and <c>open</c> maps it back:
+    /// nothing is parsed or allocated, only the tables are checked, and <c>find_all</c> scans them right away.
+    class pattern_database {
+    public:
+        pattern_database() = default;
+
+        /// @brief Map a database blob, check <c>valid()</c> (or <c>error()</c>) for the result.
+        explicit pattern_database(std::filesystem::path const& path) { open(path); }
+
+        pattern_database(pattern_database const&) = delete;
+        pattern_database& operator=(pattern_database const&) = delete;
+        pattern_database(pattern_database&&) noexcept = default;
+        pattern_database& operator=(pattern_database&&) noexcept = default;
+
+        /// @brief Compile signatures from the text format.
+        /// @throws std::invalid_argument If a line is malformed, the message holds the line number.
+        static pattern_database compile(std::string_view text) {
+            std::vector<std::string_view> names;
+            std::vector<compiled_pattern> patterns;
+
+            size_t number = 0;
+            for (size_t begin = 0; begin < text.size();) {
+                size_t end = std::min(text.find('\n', begin), text.size());
+                auto line = trim(text.substr(begin, end - begin));
+                begin = end + 1;
+                number++;
+
+                if (line.empty() || line[0] == '#') {
+                    continue;
+                }
+                size_t equal = line.find('=');
+                auto name = equal == std::string_view::npos ? std::string_view() : trim(line.substr(0, equal));
+                if (name.empty()) {
+                    throw std::invalid_argument("Line " + std::to_string(number) + ": expected `name = pattern`");
+                }
+                try {
+                    patterns.emplace_back(trim(line.substr(equal + 1)));
+                } catch (std::exception const& e) {
+                    throw std::invalid_argument("Line " + std::to_string(number) + ": " + e.what());
+                }
+                names.push_back(name);
+            }
+
+            pattern_database db;
+            db.build(patterns, names);
+            return db;
+        }
+
+        /// @brief Compile a text signature file (see <c>compile</c>).
+        /// @throws std::invalid_argument If a line is malformed.
+        /// @throws std::system_error If the file can't be read.
+        static pattern_database compile_file(std::filesystem::path const& path) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file) {
+                throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path.string());
+            }
+            std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            return compile(text);
+        }
+
+        /// @brief Map a database blob, replacing the current content.
+        /// @return Whether the blob was mapped and is well-formed, see <c>error()</c> otherwise.
+        bool open(std::filesystem::path const& path) {
+            *this = pattern_database();
+            if (!m_file.open(path)) {
+                m_error = m_file.error();
+                return false;
+            }
+            if (!attach({m_file.data(), m_file.size()})) {
+                m_file.close();
+                m_error = std::make_error_code(std::errc::illegal_byte_sequence);
+                return false;
+            }
+            return true;
+        }
+
+        /// @brief Write the database blob, it's replaced atomically.
+        /// @return Whether the file was written.
+        bool save(std::filesystem::path const& path) const {
+            auto temp = path;
+            temp += ".tmp";
+            {
+                std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<char const*>(m_blob.data()), static_cast<std::streamsize>(m_blob.size()));
+                if (!file.flush()) {
+                    return false;
+                }
+            }
+
+            std::error_code error;
+            std::filesystem::rename(temp, path, error);
+            return !error;
+        }
+
+        /// @brief Whether the database holds a blob (an empty one is valid).
+        [[nodiscard]] bool valid() const { return !m_blob.empty(); }
+        /// @brief Reason why the last <c>open</c> failed (<c>std::errc::illegal_byte_sequence</c> for malformed blobs).
+        [[nodiscard]] std::error_code error() const { return m_error; }
+
+        /// @brief Amount of signatures.
+        [[nodiscard]] size_t size() const { return m_set.count(); }
+
+        /// @brief Name of a signature.
+        [[nodiscard]] std::string_view name(size_t index) const {
+            uint32_t begin = index == 0 ? 0 : m_name_ends[index - 1];
+            return m_names.substr(begin, m_name_ends[index] - begin);
+        }
+
+        /// @brief Tokens of a signature, e.g. to build a <c>compiled_pattern</c> of it.
+        [[nodiscard]] std::span<token_t const> tokens(size_t index) const { return m_set.tokens(m_set.record(index)); }
+
+        /// @brief Index of a signature by name.
+        [[nodiscard]] std::optional<size_t> index_of(std::string_view name) const {
+            for (size_t k = 0; k < size(); k++) {
+                if (this->name(k) == name) return k;
+            }
+            return std::nullopt;
+        }
+
+        /// @brief The blob, as written by <c>save</c>.
+        [[nodiscard]] std::span<uint8_t const> blob() const { return m_blob; }
+        /// @brief View of the arena, used by the scans.
+        [[nodiscard]] impl::set_view const& view() const { return m_set; }
+
+        /// @brief Find every signature in a data buffer, in a single pass.
+        /// @return The index of each signature (in the order of the file), or <b>sinaps::not_found</b> if not found.
+        [[nodiscard]] std::vector<intptr_t> find_all(uint8_t const* data, size_t size) const {
+            return impl::find_all_set(data, size, size, m_set);
+        }
+
+    private:
+        static std::string_view trim(std::string_view str) {
+            auto space = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+            while (!str.empty() && space(str.front())) str.remove_prefix(1);
+            while (!str.empty() && space(str.back())) str.remove_suffix(1);
+            return str;
+        }
+
+        /// @brief Lay out the blob in memory, then use it as if it was mapped.
+        void build(std::span<compiled_pattern const> patterns, std::span<std::string_view const> names) {
+            compiled_pattern_set set(patterns);
+            auto arena = set.arena();
+
+            std::vector<uint32_t> ends;
+            std::string chars;
+            for (auto name : names) {
+                chars += name;
+                ends.push_back(static_cast<uint32_t>(chars.size()));
+            }
+
+            impl::database_header_t header;
+            header.count = static_cast<uint32_t>(patterns.size());
+            header.arena = static_cast<uint32_t>(impl::database_arena_offset);
+            header.arena_size = static_cast<uint32_t>(arena.size());
+            header.names = header.arena + header.arena_size;
+            header.names_size = static_cast<uint32_t>(ends.size() * sizeof(uint32_t) + chars.size());
+
+            auto& blob = m_owned;
+            blob.assign(header.names + header.names_size, 0);
+            std::memcpy(blob.data(), &header, sizeof(header));
+            if (!arena.empty()) {
+                std::memcpy(blob.data() + header.arena, arena.data(), arena.size());
+            }
+            if (!ends.empty()) {
+                std::memcpy(blob.data() + header.names, ends.data(), ends.size() * sizeof(uint32_t));
+            }
+            std::memcpy(blob.data() + header.names + ends.size() * sizeof(uint32_t), chars.data(), chars.size());
+
+            if (!attach(blob)) {
+                throw std::length_error("Pattern database is too large");
+            }
+        }
+
+        /// @brief Check a blob, and point the views into it.
+        bool attach(std::span<uint8_t const> blob) {
+            impl::database_header_t header, expected;
+            if (blob.size() < sizeof(header)) {
+                return false;
+            }
+            std::memcpy(&header, blob.data(), sizeof(header));
+            if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+                header.version != expected.version || header.byte_order != expected.byte_order ||
+                header.arena != impl::database_arena_offset || header.arena > blob.size() ||
+                header.arena_size > blob.size() - header.arena || header.names != header.arena + header.arena_size ||
+                header.names % alignof(uint32_t) != 0 || header.names_size > blob.size() - header.names ||
+                uint64_t(header.count) * sizeof(uint32_t) > header.names_size) {
+                return false;
+            }
+
+            auto arena = blob.subspan(header.arena, header.arena_size);
+            impl::set_view set;
+            if (header.count > 0 || !arena.empty()) {
+                if (!impl::check_arena(arena) || impl::set_view(arena.data()).count() != header.count) {
+                    return false;
+                }
+                set = impl::set_view(arena.data());
+            }
+
+            // names must be in order, and inside the characters
+            std::span<uint32_t const> name_ends = {reinterpret_cast<uint32_t const*>(blob.data() + header.names), header.count};
+            std::string_view names = {reinterpret_cast<char const*>(name_ends.data() + header.count), header.names_size - header.count * sizeof(uint32_t)};
+            uint32_t previous = 0;
+            for (auto end : name_ends) {
+                if (end < previous || end > names.size()) return false;
+                previous = end;
+            }
+
+            // only point into the blob once it's fully checked, a rejected blob leaves the database empty
+            m_set = set;
+            m_name_ends = name_ends;
+            m_names = names;
+            m_blob = blob;
+            return true;
+        }
+
+        mapped_file m_file;
+        std::vector<uint8_t, utils::aligned_allocator<uint8_t, impl::row_alignment>> m_owned; // blob built by `compile`
+        std::span<uint8_t const> m_blob;
+        impl::set_view m_set;
+        std::span<uint32_t const> m_name_ends;
+        std::string_view m_names;
+        std::error_code m_error;
+    };
+
+    /// @brief Find every signature of a database in a data buffer, in a single pass.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param db The signatures to search for.
+    /// @return The index of each signature in the data buffer, or <b>sinaps::not_found</b> if not found.
+    inline std::vector<intptr_t> find_all(uint8_t const* data, size_t size, pattern_database const& db) {
+        return db.find_all(data, size);
+    }
+}
+
+#endif // SINAPS_DATABASE_HPP
@@ -0,0 +1,1052 @@
+#pragma once
+#ifndef SINAPS_FIND_HPP
+#define SINAPS_FIND_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "anchor.hpp"
+#include "masks.hpp"
+#include "pattern.hpp"
+#include "simd.hpp"
+#include "skip.hpp"
+#include "stats.hpp"
+#include "utils.hpp"
+
+#ifndef SINAPS_RESTRICT
+    #if defined(_MSC_VER) || defined(__clang__)
+        #define SINAPS_RESTRICT __restrict
+    #elif defined(__GNUC__)
+        #define SINAPS_RESTRICT __attribute__((restrict))
+    #else
+        #define SINAPS_RESTRICT
+    #endif
+#endif
+
+#ifndef SINAPS_HOT
+    #if defined(__GNUC__) || defined(__clang__)
+        #define SINAPS_HOT [[gnu::hot]]
+    #else
+        #define SINAPS_HOT
+    #endif
+#endif
+
+namespace sinaps {
+    constexpr intptr_t not_found = -1;
+
+    namespace impl {
+        /// @brief Data buffer seen as memory, used to resolve follow tokens (see <c>resolve_follows</c>).
+        /// Positions are indices of the buffer.
+        struct buffer_memory {
+            uint8_t const* data;
+            size_t size;
+
+            /// @brief Whether a position is inside the buffer.
+            [[nodiscard]] constexpr bool readable(intptr_t pos) const {
+                return pos >= 0 && static_cast<size_t>(pos) < size;
+            }
+
+            /// @brief Read a little-endian 32-bit value, fails if it doesn't fit in the buffer.
+            constexpr bool load32(intptr_t pos, int32_t& value) const {
+                if (pos < 0 || static_cast<size_t>(pos) > size || size - static_cast<size_t>(pos) < 4) {
+                    return false;
+                }
+                uint8_t const* p = data + pos;
+                value = static_cast<int32_t>(uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24);
+                return true;
+            }
+        };
+
+        /// @brief Position <c>rel</c> bytes after <c>next</c>, through <c>memory.target(next, rel)</c> if the memory
+        /// has one (positions that are not laid out like addresses, e.g. file offsets of a module).
+        /// @return The target position, or <b>sinaps::not_found</b> if it can't be mapped.
+        template <typename Memory>
+        constexpr intptr_t follow_target(Memory const& memory, intptr_t next, int32_t rel) {
+            if constexpr (requires { memory.target(next, rel); }) {
+                return memory.target(next, rel);
+            } else {
+                return next + rel;
+            }
+        }
+
+        /// @brief Apply the follow tokens of a match, in order.
+        /// Each one reads the displacement at <c>index + offset</c>, and moves the index to its target.
+        /// @param index Index of the cursor of the match.
+        /// @param tokens The pattern tokens, only follow tokens are used.
+        /// @param memory Provides <c>load32(pos, value)</c> and <c>readable(pos)</c>, and optionally <c>target(next, rel)</c>.
+        /// @return The final target, or <b>sinaps::not_found</b> if a displacement or a target can't be read.
+        template <typename Memory>
+        constexpr intptr_t resolve_follows(intptr_t index, std::span<token_t const> tokens, Memory const& memory) {
+            for (auto const& token : tokens) {
+                if (token.type != token_t::type_t::follow) continue;
+
+                intptr_t at = index + token.byte;
+                int32_t rel = 0;
+                if (!memory.load32(at, rel)) {
+                    return not_found;
+                }
+                index = follow_target(memory, at + 4 + token.mask, rel);
+                if (index == not_found || !memory.readable(index)) {
+                    return not_found;
+                }
+            }
+            return index;
+        }
+
+        /// @brief Match the tail of a pattern (the tokens from its first gap on), right after the fixed head.
+        /// Gaps try their lengths from the shortest, so only the bounded window after the head is searched,
+        /// and every byte is read with a bounds check.
+        /// @param pos Position of the first tail byte (the end of the head).
+        /// @param tail The tail tokens, follow tokens are skipped.
+        /// @param cursor Set to the position of the cursor token, if the tail has one.
+        /// @return Whether the tail matches, the whole match must end before <c>size</c>.
+        constexpr bool match_tail(uint8_t const* data, size_t size, size_t pos, std::span<token_t const> tail, intptr_t& cursor) {
+            for (size_t k = 0; k < tail.size(); k++) {
+                auto const& token = tail[k];
+                switch (token.type) {
+                    case token_t::type_t::cursor:
+                        cursor = static_cast<intptr_t>(pos);
+                        continue;
+                    case token_t::type_t::follow:
+                        continue;
+                    case token_t::type_t::gap: {
+                        intptr_t saved = cursor;
+                        for (size_t length = token.byte; length <= token.mask && pos + length <= size; length++) {
+                            if (match_tail(data, size, pos + length, tail.subspan(k + 1), cursor)) {
+                                return true;
+                            }
+                            cursor = saved;
+                        }
+                        return false;
+                    }
+                    default:
+                        if (pos >= size || !token.matches(data[pos])) {
+                            return false;
+                        }
+                        pos++;
+                        break;
+                }
+            }
+            return true;
+        }
+
+        /// @brief Scan for the first candidate that resolves, candidates rejected by <c>resolve</c> are skipped.
+        /// @param begin First position to check.
+        /// @param end End of the scanned range (candidates must fit before it).
+        /// @param next Callable that accepts a position and a size, and returns the first candidate start relative to it.
+        /// @param resolve Callable that accepts a candidate start, and returns the index to report or <b>sinaps::not_found</b>.
+        /// @return The first resolved index, or <b>sinaps::not_found</b>.
+        template <typename Next, typename Resolve>
+        constexpr intptr_t find_resolved(size_t begin, size_t end, size_t step_size, Next&& next, Resolve&& resolve) {
+            for (size_t from = begin; from <= end;) {
+                intptr_t res = next(from, end - from);
+                if (res == not_found) break;
+
+                size_t start = from + static_cast<size_t>(res);
+                intptr_t index = resolve(start);
+                if (index != not_found) {
+                    SINAPS_STATS_ADD(matches, 1);
+                    return index;
+                }
+                from = start + step_size;
+            }
+            return not_found;
+        }
+
+        /// @brief Pattern masks and bytes, split into chunks of the kernel width.
+        /// The last chunk is shifted back to end with the pattern, so no byte past the pattern is ever read.
+        template <typename Pattern, typename Kernel = simd::packed_kernel<Pattern::size>>
+        struct packed_layout {
+            using kernel = Kernel;
+            static constexpr size_t width = Kernel::width;
+            static constexpr size_t chunks = (Pattern::size + width - 1) / width;
+
+            static constexpr size_t offset(size_t chunk) {
+                return chunk + 1 < chunks ? chunk * width : Pattern::size - width;
+            }
+
+            template <auto const& Source>
+            static constexpr auto split() {
+                std::array<uint8_t, chunks * width> result{};
+                for (size_t chunk = 0; chunk < chunks; chunk++) {
+                    for (size_t j = 0; j < width; j++) {
+                        result[chunk * width + j] = Source[offset(chunk) + j];
+                    }
+                }
+                return result;
+            }
+
+            alignas(64) static constexpr std::array<uint8_t, chunks * width> masks = split<Pattern::match_masks>();
+            alignas(64) static constexpr std::array<uint8_t, chunks * width> bytes = split<Pattern::match_bytes>();
+        };
+
+        /// @brief Branch-free verify, checks <c>(data & mask) == bytes</c> for the whole pattern with wide compares.
+        template <typename Pattern>
+        SINAPS_HOT bool verify_packed(uint8_t const* data) {
+            using layout = packed_layout<Pattern>;
+            using kernel = typename layout::kernel;
+
+            return [data]<size_t... I>(std::index_sequence<I...>) {
+                auto diff = kernel::masked_diff(data, layout::masks.data(), layout::bytes.data());
+                ((diff = kernel::merge(diff, kernel::masked_diff(
+                    data + layout::offset(I + 1),
+                    layout::masks.data() + (I + 1) * layout::width,
+                    layout::bytes.data() + (I + 1) * layout::width
+                ))), ...);
+                return kernel::none(diff);
+            }(std::make_index_sequence<layout::chunks - 1>());
+        }
+
+        /// @brief Alignment and padding of the byte and mask rows of runtime patterns (see <c>verify_masked</c>).
+        constexpr size_t row_alignment = 64;
+
+        /// @brief Branch-free verify of a runtime pattern, checks <c>(data & mask) == bytes</c> with the widest kernels
+        /// that fit in <c>size</c>, then narrower ones for the rest. No byte past <c>data + size</c> is read.
+        /// @param masks Masks applied to the data, aligned on <c>row_alignment</c>.
+        /// @param bytes Bytes the masked data is compared to, aligned on <c>row_alignment</c>.
+        SINAPS_HOT constexpr bool verify_masked(uint8_t const* data, uint8_t const* masks, uint8_t const* bytes, size_t size) {
+            if (std::is_constant_evaluated()) {
+                for (size_t j = 0; j < size; j++) {
+                    if ((data[j] & masks[j]) != bytes[j]) return false;
+                }
+                return true;
+            }
+
+            // offsets stay multiples of the kernel width, so the rows can be loaded aligned
+            size_t j = 0;
+            auto step = [&]<typename Kernel>(Kernel) {
+                for (; j + Kernel::width <= size; j += Kernel::width) {
+                    if (!Kernel::none(Kernel::masked_diff(data + j, masks + j, bytes + j))) return false;
+                }
+                return true;
+            };
+            return step(simd::packed_kernel<row_alignment>{}) && step(simd::packed_kernel<16>{}) &&
+                step(simd::word<uint64_t>{}) && step(simd::word<uint32_t>{}) && step(simd::word<uint16_t>{}) &&
+                (j == size || (data[j] & masks[j]) == bytes[j]);
+        }
+
+        /// @brief Either token of a runtime pattern, checked exactly after <c>verify_masked</c>.
+        struct either_t {
+            uint32_t offset = 0; // offset in bytes, excluding zero-sized tokens
+            uint8_t first = 0;
+            uint8_t second = 0;
+        };
+
+        /// @brief Exact check of the either tokens of a runtime pattern.
+        constexpr bool verify_either(uint8_t const* data, std::span<either_t const> either) {
+            for (auto const& token : either) {
+                if (data[token.offset] != token.first && data[token.offset] != token.second) return false;
+            }
+            return true;
+        }
+
+        /// @brief Exact check of the either tokens, the packed verify only compares the bits both bytes share.
+        template <typename Pattern>
+        constexpr bool verify_either(uint8_t const* data) {
+            for (size_t j : Pattern::either_offsets) {
+                if (data[j] != Pattern::bytes[j] && data[j] != Pattern::masks[j]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// @brief Masked compare of a single byte, for the verify used in constant evaluation.
+        struct byte_check_t {
+            size_t offset = 0;
+            uint8_t mask = 0;
+            uint8_t byte = 0;
+        };
+
+        /// @brief Checks of every byte that isn't a wildcard, the anchor pair first since it's the least likely
+        /// to match, so most positions are rejected after one or two compares.
+        template <typename Pattern>
+        consteval auto make_byte_checks() {
+            using pat = Pattern;
+            constexpr size_t count = [] {
+                size_t n = 0;
+                for (auto mask : pat::match_masks) n += mask != 0;
+                return n;
+            }();
+
+            std::array<byte_check_t, count> checks{};
+            size_t index = 0;
+            auto add = [&](size_t j) { checks[index++] = {j, pat::match_masks[j], pat::match_bytes[j]}; };
+            if constexpr (pat::anchor_pair.valid) {
+                add(pat::anchor_pair.first);
+                if (pat::anchor_pair.second != pat::anchor_pair.first) add(pat::anchor_pair.second);
+            }
+            for (size_t j = 0; j < pat::size; j++) {
+                bool anchor = pat::anchor_pair.valid && (j == pat::anchor_pair.first || j == pat::anchor_pair.second);
+                if (pat::match_masks[j] != 0 && !anchor) add(j);
+            }
+            return checks;
+        }
+
+        template <typename Pattern>
+        inline constexpr auto byte_checks = make_byte_checks<Pattern>();
+
+        /// @brief Verify used in constant evaluation: one compare per byte that isn't a wildcard, with an early exit.
+        template <typename Pattern>
+        constexpr bool verify_constant(uint8_t const* data) {
+            for (auto const& check : byte_checks<Pattern>) {
+                if ((data[check.offset] & check.mask) != check.byte) {
+                    return false;
+                }
+            }
+            return verify_either<Pattern>(data);
+        }
+
+        /// @brief Check whether the pattern matches the data at the given pointer.
+        /// @param data Pointer to the first byte of the potential match (at least <c>Pattern::size</c> bytes).
+        template <typename Pattern>
+        constexpr bool verify(uint8_t const* data) {
+            using pat = Pattern;
+
+            if (std::is_constant_evaluated()) {
+                return verify_constant<pat>(data);
+            }
+
+            if constexpr (pat::packed_verify) {
+                if constexpr (pat::either_count > 0) {
+                    return verify_packed<pat>(data) && verify_either<pat>(data);
+                } else {
+                    return verify_packed<pat>(data);
+                }
+            }
+
+            // check for groups
+            for (auto& group : pat::groups) {
+                if (std::memcmp(data + group.offset, pat::bytes.data() + group.offset, group.count) != 0) {
+                    return false;
+                }
+            }
+
+            // check for masked bytes
+            for (size_t j = 0; j < pat::size; j++) {
+                if (pat::types[j] == token_t::type_t::masked && (data[j] & pat::masks[j]) != pat::bytes[j]) {
+                    return false;
+                }
+            }
+
+            return verify_either<pat>(data);
+        }
+
+        /// @brief Size, cursor and anchor of a list of tokens, computed once per scan.
+        /// If the tokens have a gap, everything but <c>tail</c> describes the head (the tokens before it).
+        /// The head is also laid out as a bytes row followed by a masks row, in the same form as
+        /// <c>compiled_pattern</c>, so it's verified with the same packed compares.
+        struct token_layout_t {
+            size_t size = 0;   // size in bytes, excluding zero-sized tokens
+            size_t cursor = 0; // cursor offset in bytes
+            size_t head = 0;   // amount of tokens before the first gap
+            anchor_t anchor;
+            bool has_bytes = false; // whether there is at least one fully-specified byte
+            bool has_follow = false; // whether there is at least one follow token
+            bool has_gap = false;   // whether there is at least one gap token
+            uint8_t skip_byte = 0;  // value of the last fully-specified byte (the skip table reference)
+            skip_table_t skip;
+            size_t stride = 0; // size rounded up to `row_alignment`
+            std::vector<uint8_t, utils::aligned_allocator<uint8_t, row_alignment>> rows; // bytes, then masks, `stride` bytes each
+            std::vector<either_t> either; // either tokens of the head, checked exactly after the rows
+        };
+
+        constexpr token_layout_t layout_tokens(std::span<token_t const> tokens) {
+            token_layout_t layout;
+            size_t last_byte = 0;
+            for (auto const& token : tokens) {
+                if (token.type == token_t::type_t::gap) {
+                    layout.has_gap = true;
+                    break;
+                }
+                layout.head++;
+                if (token.type == token_t::type_t::cursor) {
+                    layout.cursor = layout.size;
+                    continue;
+                }
+                if (token.type == token_t::type_t::follow) {
+                    layout.has_follow = true;
+                    continue;
+                }
+                if (token.type == token_t::type_t::byte) {
+                    layout.has_bytes = true;
+                    layout.skip_byte = token.byte;
+                    last_byte = layout.size;
+                }
+                layout.size++;
+            }
+            for (auto const& token : tokens.subspan(layout.head)) {
+                layout.has_follow |= token.type == token_t::type_t::follow;
+            }
+
+            auto head = tokens.first(layout.head);
+            layout.stride = (layout.size + row_alignment - 1) / row_alignment * row_alignment;
+            layout.rows.assign(layout.stride * 2, 0);
+            size_t offset = 0;
+            for (auto const& token : head) {
+                if (token.zero_sized()) continue;
+
+                // same masks and bytes as `compiled_pattern`
+                uint8_t& byte = layout.rows[offset];
+                uint8_t& mask = layout.rows[layout.stride + offset];
+                switch (token.type) {
+                    case token_t::type_t::byte:
+                        byte = token.byte;
+                        mask = 0xFF;
+                        break;
+                    case token_t::type_t::masked:
+                        byte = token.byte;
+                        mask = token.mask;
+                        break;
+                    case token_t::type_t::either:
+                        byte = token.byte & token.mask;
+                        mask = static_cast<uint8_t>(~(token.byte ^ token.mask));
+                        layout.either.push_back({static_cast<uint32_t>(offset), token.byte, token.mask});
+                        break;
+                    default: break;
+                }
+                offset++;
+            }
+
+            layout.anchor = select_anchor(head);
+            if (layout.has_bytes) {
+                layout.skip = build_skip_table(head, last_byte);
+            }
+            return layout;
+        }
+
+        /// @brief Check whether a list of tokens matches the data at the given pointer, with the packed compares of
+        /// its rows (see <c>verify_masked</c>) and an exact check of the either tokens.
+        /// Only the head is checked if there's a gap (see <c>match_tail</c>).
+        /// @param layout Layout of the tokens (see <c>layout_tokens</c>).
+        constexpr bool verify_layout(uint8_t const* data, token_layout_t const& layout) {
+            return verify_masked(data, layout.rows.data() + layout.stride, layout.rows.data(), layout.size) &&
+                verify_either(data, layout.either);
+        }
+
+        /// @brief Scan for positions where both anchor bytes match, and run the full check only on those.
+        /// @param data The data buffer to search in.
+        /// @param count Amount of positions to check (the last one must leave room for the whole pattern).
+        /// @param off0 Offset of the first anchor byte in the pattern.
+        /// @param b0 Value of the first anchor byte.
+        /// @param off1 Offset of the second anchor byte in the pattern.
+        /// @param b1 Value of the second anchor byte.
+        /// @param verify Callable that accepts a position and returns whether the whole pattern matches there.
+        /// @return The first position accepted by <c>verify</c>, or <b>sinaps::not_found</b>.
+        template <typename Isa = simd::native, typename Verify>
+        SINAPS_HOT intptr_t scan_anchor(
+            uint8_t const* data, size_t count,
+            size_t off0, uint8_t b0, size_t off1, uint8_t b1,
+            Verify&& verify
+        ) {
+            size_t i = 0;
+            for (; i + Isa::width <= count; i += Isa::width) {
+                auto mask = Isa::match(data + i + off0, b0, data + i + off1, b1);
+                while (mask) {
+                    size_t lane = std::countr_zero(mask) / Isa::lane_bits;
+                    SINAPS_STATS_ADD(candidates, 1);
+                    SINAPS_STATS_ADD(verifies, 1);
+                    if (verify(i + lane)) {
+                        SINAPS_STATS_ADD(bytes, i + lane + 1);
+                        return static_cast<intptr_t>(i + lane);
+                    }
+
+                    if constexpr (Isa::lane_bits == 1) {
+                        mask &= mask - 1;
+                    } else {
+                        using mask_t = typename Isa::mask_t;
+                        mask &= ~(((mask_t(1) << Isa::lane_bits) - 1) << (lane * Isa::lane_bits));
+                    }
+                }
+            }
+
+            // tail, which is too short for a full vector
+            for (; i < count; i++) {
+                if (data[i + off0] == b0 && data[i + off1] == b1) {
+                    SINAPS_STATS_ADD(candidates, 1);
+                    SINAPS_STATS_ADD(verifies, 1);
+                    if (verify(i)) {
+                        SINAPS_STATS_ADD(bytes, i + 1);
+                        return static_cast<intptr_t>(i);
+                    }
+                }
+            }
+
+            SINAPS_STATS_ADD(bytes, count);
+            return not_found;
+        }
+
+#if defined(SINAPS_SIMD_DISPATCH)
+        /// @brief Anchored scan compiled for AVX2, the verify callable is inlined into it.
+        template <typename Verify>
+        SINAPS_TARGET_FLATTEN("avx2") intptr_t scan_anchor_avx2(
+            uint8_t const* data, size_t count, size_t off0, uint8_t b0, size_t off1, uint8_t b1, Verify&& verify
+        ) {
+            return scan_anchor<simd::avx2>(data, count, off0, b0, off1, b1, verify);
+        }
+
+        /// @brief Anchored scan compiled for AVX-512BW, the verify callable is inlined into it.
+        template <typename Verify>
+        SINAPS_TARGET_FLATTEN("avx2,avx512f,avx512bw") intptr_t scan_anchor_avx512(
+            uint8_t const* data, size_t count, size_t off0, uint8_t b0, size_t off1, uint8_t b1, Verify&& verify
+        ) {
+            return scan_anchor<simd::avx512>(data, count, off0, b0, off1, b1, verify);
+        }
+#endif
+
+        /// @brief Anchored scan with the widest kernel the CPU supports (see <c>simd::dispatch_level</c>).
+        /// Falls back to the kernel selected at compile time.
+        template <typename Verify>
+        SINAPS_HOT intptr_t scan_anchor_dispatch(
+            uint8_t const* data, size_t count, size_t off0, uint8_t b0, size_t off1, uint8_t b1, Verify&& verify
+        ) {
+#if defined(SINAPS_SIMD_DISPATCH)
+            switch (simd::dispatch_level()) {
+                case simd::level_t::avx512: return scan_anchor_avx512(data, count, off0, b0, off1, b1, verify);
+                case simd::level_t::avx2:
+                    if constexpr (simd::native_level < simd::level_t::avx2) {
+                        return scan_anchor_avx2(data, count, off0, b0, off1, b1, verify);
+                    }
+                    break;
+                default: break;
+            }
+#endif
+            return scan_anchor(data, count, off0, b0, off1, b1, verify);
+        }
+
+        /// @brief Anchored scan from the last position down to the first (see <c>scan_anchor</c>).
+        /// The vectors are loaded from the end, and their candidates are verified from the highest lane.
+        /// @return The last position accepted by <c>verify</c>, or <b>sinaps::not_found</b>.
+        template <typename Isa = simd::native, typename Verify>
+        SINAPS_HOT intptr_t scan_anchor_reverse(
+            uint8_t const* data, size_t count,
+            size_t off0, uint8_t b0, size_t off1, uint8_t b1,
+            Verify&& verify
+        ) {
+            size_t i = count;
+            for (; i >= Isa::width; i -= Isa::width) {
+                size_t base = i - Isa::width;
+                auto mask = Isa::match(data + base + off0, b0, data + base + off1, b1);
+                while (mask) {
+                    size_t lane = (std::bit_width(mask) - 1) / Isa::lane_bits;
+                    SINAPS_STATS_ADD(candidates, 1);
+                    SINAPS_STATS_ADD(verifies, 1);
+                    if (verify(base + lane)) {
+                        SINAPS_STATS_ADD(bytes, count - base - lane);
+                        return static_cast<intptr_t>(base + lane);
+                    }
+
+                    using mask_t = typename Isa::mask_t;
+                    mask &= ~(((mask_t(1) << Isa::lane_bits) - 1) << (lane * Isa::lane_bits));
+                }
+            }
+
+            // head, which is too short for a full vector
+            for (; i > 0; i--) {
+                if (data[i - 1 + off0] == b0 && data[i - 1 + off1] == b1) {
+                    SINAPS_STATS_ADD(candidates, 1);
+                    SINAPS_STATS_ADD(verifies, 1);
+                    if (verify(i - 1)) {
+                        SINAPS_STATS_ADD(bytes, count - i + 1);
+                        return static_cast<intptr_t>(i - 1);
+                    }
+                }
+            }
+
+            SINAPS_STATS_ADD(bytes, count);
+            return not_found;
+        }
+
+#if defined(SINAPS_SIMD_DISPATCH)
+        /// @brief Reverse anchored scan compiled for AVX2.
+        template <typename Verify>
+        SINAPS_TARGET_FLATTEN("avx2") intptr_t scan_anchor_reverse_avx2(
+            uint8_t const* data, size_t count, size_t off0, uint8_t b0, size_t off1, uint8_t b1, Verify&& verify
+        ) {
+            return scan_anchor_reverse<simd::avx2>(data, count, off0, b0, off1, b1, verify);
+        }
+
+        /// @brief Reverse anchored scan compiled for AVX-512BW.
+        template <typename Verify>
+        SINAPS_TARGET_FLATTEN("avx2,avx512f,avx512bw") intptr_t scan_anchor_reverse_avx512(
+            uint8_t const* data, size_t count, size_t off0, uint8_t b0, size_t off1, uint8_t b1, Verify&& verify
+        ) {
+            return scan_anchor_reverse<simd::avx512>(data, count, off0, b0, off1, b1, verify);
+        }
+#endif
+
+        /// @brief Reverse anchored scan with the widest kernel the CPU supports (see <c>scan_anchor_dispatch</c>).
+        template <typename Verify>
+        SINAPS_HOT intptr_t scan_anchor_reverse_dispatch(
+            uint8_t const* data, size_t count, size_t off0, uint8_t b0, size_t off1, uint8_t b1, Verify&& verify
+        ) {
+#if defined(SINAPS_SIMD_DISPATCH)
+            switch (simd::dispatch_level()) {
+                case simd::level_t::avx512: return scan_anchor_reverse_avx512(data, count, off0, b0, off1, b1, verify);
+                case simd::level_t::avx2:
+                    if constexpr (simd::native_level < simd::level_t::avx2) {
+                        return scan_anchor_reverse_avx2(data, count, off0, b0, off1, b1, verify);
+                    }
+                    break;
+                default: break;
+            }
+#endif
+            return scan_anchor_reverse(data, count, off0, b0, off1, b1, verify);
+        }
+
+        /// @brief Plain scan from the last position down to the first, for patterns without an anchor pair.
+        /// @return The last position accepted by <c>verify</c>, or <b>sinaps::not_found</b>.
+        template <typename Verify>
+        constexpr intptr_t scan_reverse(size_t count, Verify&& verify) {
+            for (size_t i = count; i > 0; i--) {
+                SINAPS_STATS_ADD(verifies, 1);
+                if (verify(i - 1)) {
+                    SINAPS_STATS_ADD(bytes, count - i + 1);
+                    return static_cast<intptr_t>(i - 1);
+                }
+            }
+            SINAPS_STATS_ADD(bytes, count);
+            return not_found;
+        }
+
+        /// @brief Whether the skip table should be used instead of the anchored scan.
+        /// On machine code the vector kernels check positions faster than the skip table moves, even for
+        /// long literal tails, so the table only replaces the scalar kernel, or the plain loop when there's no anchor.
+        /// @param skip The skip table of the pattern.
+        /// @param anchored Whether the pattern has a valid anchor pair.
+        constexpr bool prefer_skip_table(skip_table_t const& skip, bool anchored) {
+            return (simd::native::width == 1 || !anchored) && skip.average >= 2;
+        }
+
+        /// @brief Horspool-style scan, jumps ahead by the skip table on every position.
+        /// @param data The data buffer to search in.
+        /// @param count Amount of positions to check (the last one must leave room for the whole pattern).
+        /// @param skip The skip table, its reference byte must be fully-specified.
+        /// @param byte Value of the reference byte.
+        /// @param verify Callable that accepts a position and returns whether the whole pattern matches there.
+        /// @return The first position accepted by <c>verify</c>, or <b>sinaps::not_found</b>.
+        template <typename Verify>
+        SINAPS_HOT constexpr intptr_t scan_skip(uint8_t const* data, size_t count, skip_table_t const& skip, uint8_t byte, Verify&& verify) {
+            for (size_t i = 0; i < count;) {
+                uint8_t c = data[i + skip.offset];
+                if (c == byte) {
+                    SINAPS_STATS_ADD(candidates, 1);
+                    SINAPS_STATS_ADD(verifies, 1);
+                    if (verify(i)) {
+                        SINAPS_STATS_ADD(bytes, i + 1);
+                        return static_cast<intptr_t>(i);
+                    }
+                }
+                i += skip.table[c];
+            }
+            SINAPS_STATS_ADD(bytes, count);
+            return not_found;
+        }
+
+        /// @brief Positions scanned by each inner loop in constant evaluation. Compilers limit the iterations of a
+        /// single loop (GCC: 262144 by default), so longer buffers are scanned in blocks.
+        constexpr size_t constant_block_size = 1 << 16;
+
+        /// @brief Skip table used in constant evaluation: <c>Pattern::skip_table</c>, or the table indexed by the end
+        /// of the longest group if it moves further (the last group can be short, or follow a wildcard).
+        template <typename Pattern>
+        consteval skip_table_t make_constant_skip_table() {
+            using pat = Pattern;
+            if constexpr (pat::group_count < 2) {
+                return pat::skip_table;
+            } else {
+                group_t longest = pat::groups[0];
+                for (auto const& group : pat::groups) {
+                    if (group.count >= longest.count) longest = group;
+                }
+                auto skip = build_skip_table(pat::value, longest.offset + longest.count - 1);
+                return skip.average > pat::skip_table.average ? skip : pat::skip_table;
+            }
+        }
+
+        template <typename Pattern>
+        inline constexpr skip_table_t constant_skip_table = make_constant_skip_table<Pattern>();
+
+        /// @brief Scan used in constant evaluation, where every operation counts against the compiler's limits:
+        /// the skip table when it moves far enough, otherwise the first check of <c>byte_checks</c> (the rarest
+        /// anchor byte) before the rest of the verify.
+        /// @param count Amount of positions to check (the last one must leave room for the whole pattern).
+        template <typename Pattern>
+        constexpr intptr_t find_start_constant(uint8_t const* data, size_t count, size_t step_size) {
+            using pat = Pattern;
+            constexpr auto const& checks = byte_checks<pat>;
+            constexpr auto const& skip = constant_skip_table<pat>;
+
+            for (size_t i = 0; i < count;) {
+                for (size_t end = std::min(count, i + constant_block_size); i < end;) {
+                    if constexpr (pat::group_count > 0 && skip.average >= 2) {
+                        // the reference byte of the skip table ends a group, so it's fully specified
+                        uint8_t c = data[i + skip.offset];
+                        if (c == pat::bytes[skip.offset] && verify_constant<pat>(data + i)) {
+                            return static_cast<intptr_t>(i);
+                        }
+                        i += step_size == 1 ? skip.table[c] : step_size;
+                    } else if constexpr (!checks.empty()) {
+                        constexpr auto first = checks[0];
+                        if ((data[i + first.offset] & first.mask) == first.byte && verify_constant<pat>(data + i)) {
+                            return static_cast<intptr_t>(i);
+                        }
+                        i += step_size;
+                    } else {
+                        if (verify_either<pat>(data + i)) {
+                            return static_cast<intptr_t>(i);
+                        }
+                        i += step_size;
+                    }
+                }
+            }
+            return not_found;
+        }
+
+        /// @brief Find the first position where the pattern starts (ignoring the cursor).
+        /// @param data The data buffer to search in.
+        /// @param size The size of the data buffer.
+        /// @param step_size The step size for the search.
+        /// @return The position of the first match, or <b>sinaps::not_found</b> if not found.
+        template <typename Pattern>
+        SINAPS_HOT constexpr intptr_t find_start(uint8_t const* data, size_t size, size_t step_size) {
+            using pat = Pattern;
+
+            if (size < pat::size) {
+                return not_found;
+            }
+
+            if (std::is_constant_evaluated()) {
+                return find_start_constant<pat>(data, size - pat::size + 1, step_size);
+            }
+
+            // long literal tail: jump ahead using the skip table
+            if constexpr (pat::group_count > 0 && prefer_skip_table(pat::skip_table, pat::anchor_pair.valid)) {
+                if (step_size == 1) {
+                    return scan_skip(
+                        data, size - pat::size + 1, pat::skip_table, pat::bytes[pat::skip_table.offset],
+                        [data](size_t i) { return verify<pat>(data + i); }
+                    );
+                }
+            }
+
+            // look for the rarest bytes of the pattern first, and only verify the candidates
+            if constexpr (pat::anchor_pair.valid) {
+                if (step_size == 1) {
+                    constexpr size_t first = pat::anchor_pair.first;
+                    constexpr size_t second = pat::anchor_pair.second;
+
+                    return scan_anchor_dispatch(
+                        data, size - pat::size + 1,
+                        first, pat::bytes[first], second, pat::bytes[second],
+                        [data](size_t i) { return verify<pat>(data + i); }
+                    );
+                }
+            }
+
+            for (size_t i = 0; i <= size - pat::size; i += step_size) {
+                SINAPS_STATS_ADD(verifies, 1);
+                if (verify<pat>(data + i)) {
+                    SINAPS_STATS_ADD(bytes, i + 1);
+                    return static_cast<intptr_t>(i);
+                }
+            }
+
+            SINAPS_STATS_ADD(bytes, size - pat::size + 1);
+            return not_found;
+        }
+
+        /// @brief Find the last position where the pattern starts (ignoring the cursor), scanning backwards.
+        /// @return The position of the last match, or <b>sinaps::not_found</b> if not found.
+        template <typename Pattern>
+        SINAPS_HOT constexpr intptr_t find_start_reverse(uint8_t const* data, size_t size) {
+            using pat = Pattern;
+
+            if (size < pat::size) {
+                return not_found;
+            }
+
+            auto check = [data](size_t i) { return verify<pat>(data + i); };
+            if constexpr (pat::anchor_pair.valid) {
+                if (!std::is_constant_evaluated()) {
+                    constexpr size_t first = pat::anchor_pair.first;
+                    constexpr size_t second = pat::anchor_pair.second;
+                    return scan_anchor_reverse_dispatch(
+                        data, size - pat::size + 1, first, pat::bytes[first], second, pat::bytes[second], check
+                    );
+                }
+            }
+            return scan_reverse(size - pat::size + 1, check);
+        }
+
+        /// @brief Find the first position where a list of tokens starts (ignoring the cursor).
+        /// @param layout Layout of the tokens (see <c>layout_tokens</c>).
+        /// @param step_size The step size for the search.
+        /// @return The position of the first match, or <b>sinaps::not_found</b> if not found.
+        SINAPS_HOT constexpr intptr_t find_tokens_start(uint8_t const* data, size_t size, token_layout_t const& layout, size_t step_size = 1) {
+            if (size < layout.size) {
+                return not_found;
+            }
+
+            auto verify = [data, &layout](size_t i) { return verify_layout(data + i, layout); };
+
+            if (layout.has_bytes && prefer_skip_table(layout.skip, layout.anchor.valid) && step_size == 1 && !std::is_constant_evaluated()) {
+                return scan_skip(data, size - layout.size + 1, layout.skip, layout.skip_byte, verify);
+            }
+
+            if (layout.anchor.valid && step_size == 1 && !std::is_constant_evaluated()) {
+                return scan_anchor_dispatch(
+                    data, size - layout.size + 1,
+                    layout.anchor.first, layout.anchor.first_byte, layout.anchor.second, layout.anchor.second_byte,
+                    verify
+                );
+            }
+
+            for (size_t i = 0; i + layout.size <= size; i += step_size) {
+                SINAPS_STATS_ADD(verifies, 1);
+                if (verify(i)) {
+                    SINAPS_STATS_ADD(bytes, i + 1);
+                    return static_cast<intptr_t>(i);
+                }
+            }
+
+            SINAPS_STATS_ADD(bytes, size - layout.size + 1);
+            return not_found;
+        }
+
+        /// @brief Find the last position where a list of tokens starts (ignoring the cursor), scanning backwards.
+        /// @param layout Layout of the tokens (see <c>layout_tokens</c>).
+        /// @return The position of the last match, or <b>sinaps::not_found</b> if not found.
+        SINAPS_HOT constexpr intptr_t find_tokens_start_reverse(uint8_t const* data, size_t size, token_layout_t const& layout) {
+            if (size < layout.size) {
+                return not_found;
+            }
+
+            auto verify = [data, &layout](size_t i) { return verify_layout(data + i, layout); };
+            if (layout.anchor.valid && !std::is_constant_evaluated()) {
+                return scan_anchor_reverse_dispatch(
+                    data, size - layout.size + 1,
+                    layout.anchor.first, layout.anchor.first_byte, layout.anchor.second, layout.anchor.second_byte,
+                    verify
+                );
+            }
+            return scan_reverse(size - layout.size + 1, verify);
+        }
+
+        /// @brief Index to report for a match of a list of tokens (the cursor, or the target of the follow tokens).
+        /// @return The index, or <b>sinaps::not_found</b> if the tail doesn't match or a follow token can't be resolved.
+        template <typename Memory>
+        constexpr intptr_t resolve_tokens(
+            uint8_t const* data, size_t size, size_t start, std::span<token_t const> tokens, token_layout_t const& layout, Memory const& memory
+        ) {
+            auto index = static_cast<intptr_t>(start + layout.cursor);
+            if (layout.has_gap && !match_tail(data, size, start + layout.size, tokens.subspan(layout.head), index)) {
+                return not_found;
+            }
+            return layout.has_follow ? resolve_follows(index, tokens, memory) : index;
+        }
+
+        /// @brief Find an index of a list of tokens (see <c>find_tokens_start</c>), including the cursor offset.
+        constexpr intptr_t find_tokens(
+            uint8_t const* data, size_t size, std::span<token_t const> tokens, token_layout_t const& layout, size_t step_size = 1
+        ) {
+            return find_resolved(
+                0, size, step_size,
+                [&](size_t from, size_t count) { return find_tokens_start(data + from, count, layout, step_size); },
+                [&](size_t start) { return resolve_tokens(data, size, start, tokens, layout, buffer_memory{data, size}); }
+            );
+        }
+
+        /// @brief Index to report for a match of a pattern (the cursor, or the target of the follow tokens).
+        /// The tail of patterns with gaps is matched here (see <c>match_tail</c>), the head must already match.
+        /// @param data Origin of the positions, the tail is read before <c>data + size</c>.
+        /// @param start Start of the match.
+        /// @param memory Memory the follow tokens are resolved in (see <c>resolve_follows</c>).
+        /// @return The index, or <b>sinaps::not_found</b> if the tail doesn't match or a follow token can't be resolved.
+        template <typename Pattern, typename Memory>
+        constexpr intptr_t resolve(uint8_t const* data, size_t size, size_t start, Memory const& memory) {
+            auto index = static_cast<intptr_t>(start + Pattern::cursor_pos);
+            if constexpr (Pattern::has_gap) {
+                if (!match_tail(data, size, start + Pattern::size, Pattern::tail, index)) {
+                    return not_found;
+                }
+            }
+            if constexpr (Pattern::follow_count > 0) {
+                return resolve_follows(index, Pattern::follows, memory);
+            } else {
+                return index;
+            }
+        }
+
+        /// @brief Verify a candidate, and get the index to report for it.
+        /// @return The index (see <c>resolve</c>), or <b>sinaps::not_found</b> if the pattern doesn't match there.
+        template <typename Pattern>
+        constexpr intptr_t match_candidate(uint8_t const* data, size_t size, size_t start) {
+            return verify<Pattern>(data + start) ? resolve<Pattern>(data, size, start, buffer_memory{data, size}) : not_found;
+        }
+
+        /// @brief End of the range to scan for the heads of the matches that start before <c>limit</c> (see <c>find_range</c>).
+        constexpr size_t head_end(size_t size, size_t limit, size_t head_size) {
+            return limit < size && head_size > 0 ? std::min(size, limit + head_size - 1) : std::min(size, limit);
+        }
+
+        /// @brief Find the first match that starts in a range, including the cursor offset and follow tokens.
+        /// @param data Origin of the positions, the range <c>[begin, end)</c> is scanned for the head of the pattern.
+        /// @param size End of the data the tail of the pattern can be matched in (at least <c>end</c>).
+        /// @param memory Memory the follow tokens are resolved in, positions are relative to <c>data</c>.
+        /// @return The index of the first match (relative to <c>data</c>), or <b>sinaps::not_found</b> if not found.
+        template <typename Pattern, typename Memory>
+        SINAPS_HOT constexpr intptr_t find_range(
+            uint8_t const* data, size_t size, size_t begin, size_t end, size_t step_size, Memory const& memory
+        ) {
+            if constexpr (Pattern::follow_count == 0 && !Pattern::has_gap) {
+                auto res = find_start<Pattern>(data + begin, end - begin, step_size);
+                if (res == not_found) {
+                    return not_found;
+                }
+                SINAPS_STATS_ADD(matches, 1);
+                return res + static_cast<intptr_t>(begin + Pattern::cursor_pos);
+            } else {
+                return find_resolved(
+                    begin, end, step_size,
+                    [data, step_size](size_t from, size_t count) { return find_start<Pattern>(data + from, count, step_size); },
+                    [data, size, &memory](size_t start) { return resolve<Pattern>(data, size, start, memory); }
+                );
+            }
+        }
+    }
+
+    /// @brief Find an index of a pattern in a data buffer.
+    /// The pattern is a sequence of masks (see <c>sinaps::masks</c> namespace).
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    SINAPS_HOT constexpr intptr_t find(uint8_t const* SINAPS_RESTRICT data, size_t size, size_t step_size = 1) {
+        return impl::find_range<Pattern>(data, size, 0, size, step_size, impl::buffer_memory{data, size});
+    }
+
+    /// @brief Find an index of a pattern in a data buffer.
+    /// The pattern is a sequence of masks (see <c>sinaps::masks</c> namespace).
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename... Mask> requires (!utils::is_specialization<Mask, pattern>::value && ...)
+    constexpr intptr_t find(uint8_t const* data, size_t size, size_t step_size = 1) {
+        return find<pattern<Mask...>>(data, size, step_size);
+    }
+
+    /// @brief Find an index of a pattern in a data buffer. Pattern is an array of tokens.
+    /// This method is a helper for the other find methods, use if you know what you're doing.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <std::array pattern> requires (pattern.size() > 0)
+    constexpr intptr_t find(uint8_t const* data, size_t size, size_t step_size = 1) {
+        return find<impl::make_pattern<pattern>>(data, size, step_size);
+    }
+
+    /// @brief Find an index of a pattern in a data buffer.
+    /// Builds the pattern from a string literal.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <utils::FixedString S>
+    constexpr intptr_t find(uint8_t const* data, size_t size, size_t step_size = 1) {
+        return find<impl::tokenizePatternString<S>()>(data, size, step_size);
+    }
+
+    /// @brief Find an index of a pattern in a data buffer. Pattern is a list of tokens.
+    /// The layout of the tokens is computed on every call, parse the pattern once with <c>sinaps::compiled_pattern</c> to reuse it.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param pattern_size Amount of tokens in the pattern (including zero-sized ones).
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer (including the cursor offset and follow tokens), or <b>sinaps::not_found</b> if not found.
+    SINAPS_HOT constexpr intptr_t find(uint8_t const* SINAPS_RESTRICT data, size_t size, token_t const* SINAPS_RESTRICT pattern, size_t pattern_size, size_t step_size = 1) {
+        std::span<token_t const> tokens(pattern, pattern_size);
+        return impl::find_tokens(data, size, tokens, impl::layout_tokens(tokens), step_size);
+    }
+
+    /// @brief Find an index of a pattern in a data buffer. Pattern is a list of tokens.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <size_t N>
+    constexpr intptr_t find(uint8_t const* data, size_t size, std::array<token_t, N> const& pattern, size_t step_size = 1) {
+        return find(data, size, pattern.data(), N, step_size);
+    }
+
+    /// @brief Find an index of a pattern in a data buffer. Pattern is a list of tokens.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    constexpr intptr_t find(uint8_t const* data, size_t size, std::span<token_t const> pattern, size_t step_size = 1) {
+        return find(data, size, pattern.data(), pattern.size(), step_size);
+    }
+
+    /// @brief Find an index of a pattern in a data buffer. Pattern is a list of tokens.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    constexpr intptr_t find(uint8_t const* data, size_t size, std::initializer_list<token_t> pattern, size_t step_size = 1) {
+        return find(data, size, pattern.begin(), pattern.size(), step_size);
+    }
+
+    /// @brief Check whether a pattern matches at a known position, e.g. a cached result of <c>find</c>.
+    /// Follow tokens are not resolved, for such patterns the position is the cursor and not the target.
+    /// Patterns with gaps are supported if the cursor is before the first gap.
+    /// @param ptr Pointer to the position <c>find</c> would report (the cursor), the pattern is read from
+    /// <c>ptr - Pattern::cursor_pos</c> to <c>ptr - Pattern::cursor_pos + Pattern::max_size</c>.
+    /// @return Whether the pattern matches there.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    SINAPS_HOT constexpr bool matches_at(uint8_t const* ptr) {
+        static_assert(!Pattern::tail_cursor, "matches_at needs the cursor to be before the first gap");
+        uint8_t const* start = ptr - Pattern::cursor_pos;
+        if constexpr (Pattern::has_gap) {
+            intptr_t cursor = 0;
+            return impl::verify<Pattern>(start) && impl::match_tail(start, Pattern::max_size, Pattern::size, Pattern::tail, cursor);
+        } else {
+            return impl::verify<Pattern>(start);
+        }
+    }
+
+    /// @brief Check whether a pattern matches at a known index of a data buffer, e.g. a cached result of <c>find</c>.
+    /// @param data The data buffer.
+    /// @param size The size of the data buffer.
+    /// @param index The index <c>find</c> would report (including the cursor offset).
+    /// @return Whether the pattern matches there, <c>false</c> if it doesn't fit in the buffer.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr bool matches_at(uint8_t const* data, size_t size, intptr_t index) {
+        static_assert(!Pattern::tail_cursor, "matches_at needs the cursor to be before the first gap");
+        intptr_t start = index - static_cast<intptr_t>(Pattern::cursor_pos);
+        if (start < 0 || static_cast<size_t>(start) > size || size - static_cast<size_t>(start) < Pattern::size) {
+            return false;
+        }
+        if constexpr (Pattern::has_gap) {
+            intptr_t cursor = 0;
+            return impl::verify<Pattern>(data + start) &&
+                impl::match_tail(data, size, static_cast<size_t>(start) + Pattern::size, Pattern::tail, cursor);
+        } else {
+            return impl::verify<Pattern>(data + start);
+        }
+    }
+}
+
+#endif // SINAPS_FIND_HPP
@@ -0,0 +1,104 @@
+#pragma once
+#ifndef SINAPS_GENERATE_HPP
+#define SINAPS_GENERATE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "compiled_pattern.hpp"
+#include "find.hpp"
+#include "matches.hpp"
+#include "token.hpp"
+#include "x86.hpp"
+
+namespace sinaps {
+    /// @brief Options of <c>sinaps::make_pattern_at</c>.
+    struct generate_options {
+        size_t max_size = 64;  // longest pattern to try, in bytes
+        bool x86_code = true;  // decode x86-64 instructions at the target, and wildcard their volatile operands
+    };
+
+    namespace impl {
+        /// @brief Tokens of the bytes at <c>target</c>, up to <c>max_size</c> of them. If the bytes are decoded as code,
+        /// the operands that likely change between builds are wildcards (see <c>x86::is_volatile</c>), and bytes that
+        /// don't decode are kept as they are.
+        inline std::vector<token_t> code_tokens(uint8_t const* data, size_t size, size_t target, generate_options const& options) {
+            size_t end = target + std::min(options.max_size, size - target);
+            std::vector<token_t> tokens;
+            tokens.reserve(end - target);
+
+            for (size_t pos = target; pos < end;) {
+                auto ins = options.x86_code ? x86::decode(data + pos, size - pos) : x86::instruction_t{};
+                if (!ins.valid()) {
+                    tokens.emplace_back(data[pos++]);
+                    continue;
+                }
+                for (size_t k = 0; k < ins.length && pos + k < end; k++) {
+                    tokens.push_back(x86::is_volatile(ins, k) ? token_t() : token_t(data[pos + k]));
+                }
+                pos += ins.length;
+            }
+            return tokens;
+        }
+    }
+
+    /// @brief Generate the shortest pattern that only matches at a position of a buffer, e.g. to make a signature
+    /// for a function from its address. The pattern starts at the target, so <c>find</c> reports the target itself.
+    /// All matches of the first two fixed bytes are collected with a single scan, then the pattern grows one byte
+    /// at a time and only those candidates are checked again, until the target is the only one left.
+    /// @param data The data buffer (usually the code section of a module).
+    /// @param size The size of the data buffer.
+    /// @param target Position the pattern must match at.
+    /// @param options Longest pattern, and whether to wildcard the volatile operands of x86-64 code.
+    /// @return The tokens of the pattern (see <c>sinaps::to_string</c>), ending with a fixed byte,
+    /// or an empty list if no pattern up to <c>options.max_size</c> bytes is unique.
+    inline std::vector<token_t> make_pattern_at(uint8_t const* data, size_t size, size_t target, generate_options const& options = {}) {
+        if (target >= size) {
+            return {};
+        }
+        auto tokens = impl::code_tokens(data, size, target, options);
+
+        // the head has two fixed bytes, so it's scanned with the anchor prefilter
+        size_t length = 0, fixed = 0;
+        for (; length < tokens.size() && fixed < 2; length++) {
+            fixed += tokens[length].type == token_t::type_t::byte;
+        }
+        if (fixed == 0) {
+            return {};
+        }
+
+        std::vector<size_t> candidates;
+        compiled_pattern head(std::span<token_t const>(tokens).first(length));
+        for (auto index : matches(data, size, head)) {
+            candidates.push_back(static_cast<size_t>(index));
+        }
+
+        // the target always stays a candidate, since its own bytes are the pattern
+        while (true) {
+            if (candidates.size() == 1 && tokens[length - 1].type == token_t::type_t::byte) {
+                tokens.resize(length);
+                return tokens;
+            }
+            if (length == tokens.size()) {
+                return {};
+            }
+
+            auto const& token = tokens[length];
+            std::erase_if(candidates, [&](size_t start) {
+                return start + length >= size || !token.matches(data[start + length]);
+            });
+            length++;
+        }
+    }
+
+    /// @brief Generate the shortest pattern that only matches at a pointer (see <c>sinaps::make_pattern_at</c>).
+    /// @param data The data buffer, the pointer must be inside it.
+    /// @param target Position the pattern must match at.
+    inline std::vector<token_t> make_pattern_at(std::span<uint8_t const> data, uint8_t const* target, generate_options const& options = {}) {
+        return make_pattern_at(data.data(), data.size(), static_cast<size_t>(target - data.data()), options);
+    }
+}
+
+#endif // SINAPS_GENERATE_HPP
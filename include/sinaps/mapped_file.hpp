@@ -0,0 +1,274 @@
+#pragma once
+#ifndef SINAPS_MAPPED_FILE_HPP
+#define SINAPS_MAPPED_FILE_HPP
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "batch.hpp"
+#include "compiled_pattern.hpp"
+#include "compiled_pattern_set.hpp"
+#include "find.hpp"
+#include "matches.hpp"
+#include "module.hpp"
+#include "pattern.hpp"
+
+namespace sinaps {
+    /// @brief Read-only memory mapping of a whole file, scanned in place without copying it into a buffer.
+    /// The OS is told that the mapping will be read sequentially, so it can read ahead and drop pages behind.
+    class mapped_file {
+    public:
+        mapped_file() = default;
+
+        /// @brief Map a file, check <c>valid()</c> (or <c>error()</c>) for the result.
+        explicit mapped_file(std::filesystem::path const& path) { open(path); }
+
+        mapped_file(mapped_file const&) = delete;
+        mapped_file& operator=(mapped_file const&) = delete;
+
+        mapped_file(mapped_file&& other) noexcept { swap(other); }
+        mapped_file& operator=(mapped_file&& other) noexcept {
+            if (this != &other) {
+                close();
+                swap(other);
+            }
+            return *this;
+        }
+
+        ~mapped_file() { close(); }
+
+        /// @brief Map a file, unmapping the previous one.
+        /// @return Whether the file was mapped, see <c>error()</c> otherwise.
+        bool open(std::filesystem::path const& path) {
+            close();
+            m_error.clear();
+#if defined(_WIN32)
+            HANDLE file = CreateFileW(
+                path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+            );
+            if (file == INVALID_HANDLE_VALUE) {
+                return fail(static_cast<int>(GetLastError()));
+            }
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file, &size)) {
+                auto code = static_cast<int>(GetLastError());
+                CloseHandle(file);
+                return fail(code);
+            }
+
+            if (size.QuadPart != 0) {
+                HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+                auto code = static_cast<int>(GetLastError());
+                if (mapping) CloseHandle(mapping);
+                CloseHandle(file);
+                if (!view) {
+                    return fail(code);
+                }
+
+                m_data = static_cast<uint8_t const*>(view);
+                m_size = static_cast<size_t>(size.QuadPart);
+    #if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+                WIN32_MEMORY_RANGE_ENTRY range{view, m_size};
+                PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    #endif
+            } else {
+                CloseHandle(file);
+            }
+#else
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return fail(errno);
+            }
+
+            struct stat info;
+            if (fstat(fd, &info) != 0) {
+                int code = errno;
+                ::close(fd);
+                return fail(code);
+            }
+
+            if (info.st_size != 0) {
+                void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                int code = errno;
+                ::close(fd); // the mapping keeps the file alive
+                if (view == MAP_FAILED) {
+                    return fail(code);
+                }
+
+                m_data = static_cast<uint8_t const*>(view);
+                m_size = static_cast<size_t>(info.st_size);
+                posix_madvise(view, m_size, POSIX_MADV_SEQUENTIAL);
+                posix_madvise(view, m_size, POSIX_MADV_WILLNEED);
+            } else {
+                ::close(fd);
+            }
+#endif
+            // only once the view is mapped, so a failed map leaves the file closed
+            m_valid = true;
+            return true;
+        }
+
+        /// @brief Unmap the file.
+        void close() {
+            if (m_data) {
+#if defined(_WIN32)
+                UnmapViewOfFile(m_data);
+#else
+                munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+            }
+            m_data = nullptr;
+            m_size = 0;
+            m_valid = false;
+        }
+
+        /// @brief Whether a file is mapped (empty files are valid, with no data).
+        [[nodiscard]] bool valid() const { return m_valid; }
+        /// @brief Reason why the last <c>open</c> failed.
+        [[nodiscard]] std::error_code error() const { return m_error; }
+
+        [[nodiscard]] uint8_t const* data() const { return m_data; }
+        [[nodiscard]] size_t size() const { return m_size; }
+        [[nodiscard]] std::span<uint8_t const> bytes() const { return {m_data, m_size}; }
+
+        /// @brief Parse the file as an executable (see <c>sinaps::module</c>), results are file offsets.
+        [[nodiscard]] module as_module() const { return module(bytes()); }
+
+    private:
+        bool fail(int code) {
+#if defined(_WIN32)
+            m_error = std::error_code(code, std::system_category());
+#else
+            m_error = std::error_code(code, std::generic_category());
+#endif
+            return false;
+        }
+
+        void swap(mapped_file& other) noexcept {
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+            std::swap(m_valid, other.m_valid);
+            std::swap(m_error, other.m_error);
+        }
+
+        uint8_t const* m_data = nullptr;
+        size_t m_size = 0;
+        bool m_valid = false;
+        std::error_code m_error;
+    };
+
+    /// @brief Find an index of a pattern in a mapped file.
+    /// @param file The mapped file to search in.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The file offset of the pattern, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    intptr_t find(mapped_file const& file, size_t step_size = 1) {
+        return find<Pattern>(file.data(), file.size(), step_size);
+    }
+
+    /// @brief Find an index of a pattern in a mapped file.
+    /// The pattern is a sequence of masks (see <c>sinaps::masks</c> namespace).
+    /// @param file The mapped file to search in.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The file offset of the pattern, or <b>sinaps::not_found</b> if not found.
+    template <typename... Mask> requires (!utils::is_specialization<Mask, pattern>::value && ...)
+    intptr_t find(mapped_file const& file, size_t step_size = 1) {
+        return find<pattern<Mask...>>(file, step_size);
+    }
+
+    /// @brief Find an index of a pattern in a mapped file.
+    /// Builds the pattern from a string literal.
+    /// @param file The mapped file to search in.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The file offset of the pattern, or <b>sinaps::not_found</b> if not found.
+    template <utils::FixedString S>
+    intptr_t find(mapped_file const& file, size_t step_size = 1) {
+        return find<impl::make_pattern<impl::tokenizePatternString<S>()>>(file, step_size);
+    }
+
+    /// @brief Find an index of a compiled pattern in a mapped file.
+    /// @param file The mapped file to search in.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The file offset of the pattern, or <b>sinaps::not_found</b> if not found.
+    inline intptr_t find(mapped_file const& file, compiled_pattern const& pattern, size_t step_size = 1) {
+        return find(file.data(), file.size(), pattern, step_size);
+    }
+
+    /// @brief Find an index of a pattern in a mapped file. Pattern is a string.
+    /// @param file The mapped file to search in.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The file offset of the pattern, or <b>sinaps::not_found</b> if not found.
+    inline intptr_t find(mapped_file const& file, std::string_view pattern, size_t step_size = 1) {
+        return find(file.data(), file.size(), compiled_pattern(pattern), step_size);
+    }
+
+    /// @brief Find multiple patterns in a mapped file, in a single pass (see <c>sinaps::find_all</c>).
+    /// @param file The mapped file to search in.
+    /// @return The file offset of each pattern, or <b>sinaps::not_found</b> if not found.
+    template <typename... Patterns> requires (sizeof...(Patterns) > 0 && (utils::is_specialization<Patterns, pattern>::value && ...))
+    std::array<intptr_t, sizeof...(Patterns)> find_all(mapped_file const& file) {
+        return find_all<Patterns...>(file.data(), file.size());
+    }
+
+    /// @brief Find multiple compiled patterns in a mapped file, in a single pass.
+    /// @param file The mapped file to search in.
+    /// @param patterns The patterns to search for.
+    /// @return The file offset of each pattern, or <b>sinaps::not_found</b> if not found.
+    inline std::vector<intptr_t> find_all(mapped_file const& file, std::span<compiled_pattern const> patterns) {
+        return find_all(file.data(), file.size(), patterns);
+    }
+
+    /// @brief Find every pattern of a set in a mapped file, in a single pass.
+    /// @param file The mapped file to search in.
+    /// @param set The patterns to search for.
+    /// @return The file offset of each pattern, or <b>sinaps::not_found</b> if not found.
+    inline std::vector<intptr_t> find_all(mapped_file const& file, compiled_pattern_set const& set) {
+        return find_all(file.data(), file.size(), set);
+    }
+
+    /// @brief Find all occurrences of a pattern in a mapped file, and write them into a caller-provided buffer.
+    /// @param file The mapped file to search in.
+    /// @param out The output buffer for the file offsets.
+    /// @return Amount of offsets written to <c>out</c>.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    size_t find_all(mapped_file const& file, std::span<intptr_t> out) {
+        return find_all<Pattern>(file.data(), file.size(), out);
+    }
+
+    /// @brief Find all occurrences of a compiled pattern in a mapped file, and write them into a caller-provided buffer.
+    /// @param file The mapped file to search in.
+    /// @param pattern The pattern to search for.
+    /// @param out The output buffer for the file offsets.
+    /// @return Amount of offsets written to <c>out</c>.
+    inline size_t find_all(mapped_file const& file, compiled_pattern const& pattern, std::span<intptr_t> out) {
+        return find_all(file.data(), file.size(), pattern, out);
+    }
+}
+
+#endif // SINAPS_MAPPED_FILE_HPP
@@ -2,6 +2,7 @@
 #ifndef SINAPS_MASKS_HPP
 #define SINAPS_MASKS_HPP
 
+#include <bit>
 #include <cstdint>
 #include <tuple>
 #include "token.hpp"
@@ -93,13 +94,56 @@ namespace sinaps::mask {
         static constexpr std::tuple value = {token_t(token_t::type_t::cursor)};
     };
 
+    /// @brief Special mask, follows a 32-bit relative displacement (e.g. the target of a <c>call</c>, or a
+    /// rip-relative operand). The displacement is read at <c>index + Offset</c>, where <c>index</c> is the cursor,
+    /// or the target of the previous follow, and <c>sinaps::find</c> reports <c>index + Offset + 4 + Extra + rel32</c>.
+    /// Matches whose displacement or target is outside the buffer are skipped.
+    /// @tparam Offset Offset of the displacement from the current index.
+    /// @tparam Extra Amount of instruction bytes after the displacement (e.g. an immediate operand).
+    template <uint8_t Offset = 0, uint8_t Extra = 0>
+    struct follow {
+        static constexpr size_t size = 0;
+        static constexpr std::tuple value = {token_t(token_t::type_t::follow, Offset, Extra)};
+    };
+
+    /// @brief A 32-bit relative displacement (4 bytes), <c>sinaps::find</c> reports its target instead of the match.
+    /// Sets the cursor on the displacement, more <c>mask::follow</c> can be added after it to chain hops.
+    /// @tparam Extra Amount of instruction bytes after the displacement (e.g. 1 for <c>cmp byte [rip + rel32], imm8</c>).
+    template <uint8_t Extra = 0>
+    struct rel32 {
+        static constexpr size_t size = 4;
+        static constexpr std::tuple value = std::tuple_cat(cursor::value, follow<0, Extra>::value, any<4>::value);
+    };
+
     /// @brief A mask that matches a byte with a mask.
-    /// The mask is used to ignore certain bits in the byte.
+    /// The mask is used to ignore certain bits in the byte (e.g. <c>masked&lt;0x40, 0xF0&gt;</c> matches <c>4?</c>).
     template <uint8_t N, uint8_t M>
     struct masked {
         static constexpr size_t size = 1;
         static constexpr std::tuple value = {token_t(N, M)};
     };
+
+    /// @brief A mask that skips between <c>Min</c> and <c>Max</c> bytes (e.g. instructions whose length changes between builds).
+    /// The part of the pattern before the first gap is scanned for, and the rest is only searched for in the window
+    /// after it, shortest gaps first. A pattern can't start with a gap.
+    template <uint8_t Min, uint8_t Max>
+    struct gap {
+        static_assert(Min <= Max, "The minimum of a gap can't be larger than its maximum");
+        static constexpr size_t size = Min; // minimum size
+        static constexpr std::tuple value = {token_t(token_t::type_t::gap, Min, Max)};
+    };
+
+    /// @brief A mask that matches one of two bytes (e.g. <c>jz</c> or <c>jmp short</c>).
+    /// Bytes that only differ in one bit are stored as a masked byte.
+    template <uint8_t A, uint8_t B>
+    struct either {
+        static constexpr size_t size = 1;
+        static constexpr std::tuple value = {
+            std::has_single_bit(static_cast<unsigned>(A ^ B)) || A == B
+                ? token_t(A & B, static_cast<uint8_t>(~(A ^ B)))
+                : token_t(token_t::type_t::either, A, B)
+        };
+    };
 }
 
 #endif // SINAPS_MASKS_HPP
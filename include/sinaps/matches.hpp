@@ -0,0 +1,250 @@
+#pragma once
+#ifndef SINAPS_MATCHES_HPP
+#define SINAPS_MATCHES_HPP
+
+#include <cstdint>
+#include <iterator>
+#include <span>
+
+#include "compiled_pattern.hpp"
+#include "find.hpp"
+#include "pattern.hpp"
+#include "token.hpp"
+
+namespace sinaps {
+    namespace impl {
+        /// @brief Scanner for a compile-time pattern.
+        template <typename Pattern>
+        struct pattern_scanner {
+            [[nodiscard]] constexpr intptr_t next(uint8_t const* data, size_t size) const {
+                return find_start<Pattern>(data, size, 1);
+            }
+
+            [[nodiscard]] constexpr intptr_t prev(uint8_t const* data, size_t size) const {
+                return find_start_reverse<Pattern>(data, size);
+            }
+
+            [[nodiscard]] constexpr intptr_t result(size_t start) const {
+                return static_cast<intptr_t>(start + Pattern::cursor_pos);
+            }
+
+            [[nodiscard]] constexpr intptr_t resolve(uint8_t const* data, size_t size, size_t start) const {
+                return impl::resolve<Pattern>(data, size, start, buffer_memory{data, size});
+            }
+
+            [[nodiscard]] constexpr size_t size() const { return Pattern::size; }
+        };
+
+        /// @brief Scanner for a list of tokens, the layout is computed once for the whole range.
+        struct token_scanner {
+            std::span<token_t const> tokens;
+            token_layout_t layout;
+
+            constexpr explicit token_scanner(std::span<token_t const> tokens)
+                : tokens(tokens), layout(layout_tokens(tokens)) {}
+
+            [[nodiscard]] constexpr intptr_t next(uint8_t const* data, size_t size) const {
+                return find_tokens_start(data, size, layout);
+            }
+
+            [[nodiscard]] constexpr intptr_t prev(uint8_t const* data, size_t size) const {
+                return find_tokens_start_reverse(data, size, layout);
+            }
+
+            [[nodiscard]] constexpr intptr_t result(size_t start) const {
+                return static_cast<intptr_t>(start + layout.cursor);
+            }
+
+            [[nodiscard]] constexpr intptr_t resolve(uint8_t const* data, size_t size, size_t start) const {
+                return resolve_tokens(data, size, start, tokens, layout, buffer_memory{data, size});
+            }
+
+            [[nodiscard]] constexpr size_t size() const { return layout.size; }
+        };
+
+        /// @brief Scanner for a compiled pattern.
+        struct compiled_scanner {
+            compiled_pattern const* pattern;
+
+            [[nodiscard]] constexpr intptr_t next(uint8_t const* data, size_t size) const {
+                return find_compiled_start(data, size, *pattern, 1);
+            }
+
+            [[nodiscard]] constexpr intptr_t prev(uint8_t const* data, size_t size) const {
+                return find_compiled_start_reverse(data, size, *pattern);
+            }
+
+            [[nodiscard]] constexpr intptr_t result(size_t start) const {
+                return static_cast<intptr_t>(start + pattern->cursor_pos());
+            }
+
+            [[nodiscard]] constexpr intptr_t resolve(uint8_t const* data, size_t size, size_t start) const {
+                return pattern->resolve(data, size, start, buffer_memory{data, size});
+            }
+
+            [[nodiscard]] constexpr size_t size() const { return pattern->size(); }
+        };
+    }
+
+    /// @brief Lazy range of all matches of a pattern in a data buffer.
+    /// Matches may overlap, the next scan starts one byte after the start of the previous match.
+    /// Matches whose tail (after a gap) doesn't match, or whose follow tokens can't be resolved in the buffer, are skipped.
+    /// @tparam Scanner Type that provides <c>next(data, size)</c> (first match start), <c>prev(data, size)</c> (last match
+    /// start, used by the reverse scans), <c>result(start)</c> (cursor index),
+    /// <c>resolve(data, size, start)</c> (index to report, or <b>sinaps::not_found</b> to skip the match)
+    /// and <c>size()</c> (pattern size in bytes).
+    template <typename Scanner>
+    class match_range {
+    public:
+        class iterator {
+        public:
+            using iterator_concept = std::forward_iterator_tag;
+            using value_type = intptr_t;
+            using difference_type = std::ptrdiff_t;
+
+            constexpr iterator() = default;
+            constexpr iterator(match_range const* range, size_t from) : m_range(range) {
+                m_start = m_range->next(from, m_index);
+            }
+
+            /// @brief Index of the current match (including the cursor offset).
+            constexpr intptr_t operator*() const { return m_index; }
+
+            constexpr iterator& operator++() {
+                m_start = m_range->next(static_cast<size_t>(m_start) + 1, m_index);
+                return *this;
+            }
+
+            constexpr iterator operator++(int) {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            constexpr bool operator==(iterator const& other) const { return m_start == other.m_start; }
+            constexpr bool operator==(std::default_sentinel_t) const { return m_start == not_found; }
+
+        private:
+            match_range const* m_range = nullptr;
+            intptr_t m_start = not_found; // start of the current match (without the cursor offset)
+            intptr_t m_index = not_found; // index reported for the current match
+        };
+
+        constexpr match_range(uint8_t const* data, size_t size, Scanner scanner)
+            : m_data(data), m_size(size), m_scanner(scanner) {}
+
+        [[nodiscard]] constexpr iterator begin() const { return iterator(this, 0); }
+        [[nodiscard]] constexpr std::default_sentinel_t end() const { return {}; }
+
+    private:
+        /// @brief Start of the first match at or after the given position.
+        /// @param index Output, the index reported for the match.
+        constexpr intptr_t next(size_t from, intptr_t& index) const {
+            while (from <= m_size) {
+                auto res = m_scanner.next(m_data + from, m_size - from);
+                if (res == not_found) break;
+
+                size_t start = from + static_cast<size_t>(res);
+                index = m_scanner.resolve(m_data, m_size, start);
+                if (index != not_found) {
+                    SINAPS_STATS_ADD(matches, 1);
+                    return static_cast<intptr_t>(start);
+                }
+                from = start + 1;
+            }
+            index = not_found;
+            return not_found;
+        }
+
+        uint8_t const* m_data;
+        size_t m_size;
+        Scanner m_scanner;
+    };
+
+    /// @brief Get a lazy range of all matches of a pattern in a data buffer.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @return Range of indices (including the cursor offset) in ascending order.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr auto matches(uint8_t const* data, size_t size) {
+        return match_range(data, size, impl::pattern_scanner<Pattern>{});
+    }
+
+    /// @brief Get a lazy range of all matches of a pattern in a data buffer.
+    /// @param data The data buffer to search in.
+    /// @return Range of indices (including the cursor offset) in ascending order.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr auto matches(std::span<uint8_t const> data) {
+        return matches<Pattern>(data.data(), data.size());
+    }
+
+    /// @brief Get a lazy range of all matches of a pattern in a data buffer. Pattern is a list of tokens.
+    /// The tokens must outlive the range.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @return Range of indices (including the cursor offset) in ascending order.
+    constexpr auto matches(uint8_t const* data, size_t size, std::span<token_t const> pattern) {
+        return match_range(data, size, impl::token_scanner(pattern));
+    }
+
+    /// @brief Get a lazy range of all matches of a compiled pattern in a data buffer.
+    /// The pattern must outlive the range.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @return Range of indices (including the cursor offset) in ascending order.
+    constexpr auto matches(uint8_t const* data, size_t size, compiled_pattern const& pattern) {
+        return match_range(data, size, impl::compiled_scanner{&pattern});
+    }
+
+    namespace impl {
+        template <typename Scanner>
+        constexpr size_t collect_matches(match_range<Scanner> const& range, std::span<intptr_t> out) {
+            if (out.empty()) {
+                return 0;
+            }
+
+            size_t count = 0;
+            for (auto it = range.begin(); it != std::default_sentinel; ++it) {
+                out[count++] = *it;
+                if (count == out.size()) break; // don't scan for a match that can't be stored
+            }
+            return count;
+        }
+    }
+
+    /// @brief Find all occurrences of a pattern in a data buffer, and write them into a caller-provided buffer.
+    /// The scan stops once the output buffer is full.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param out The output buffer for the indices (including the cursor offset).
+    /// @return Amount of indices written to <c>out</c>.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr size_t find_all(uint8_t const* data, size_t size, std::span<intptr_t> out) {
+        return impl::collect_matches(matches<Pattern>(data, size), out);
+    }
+
+    /// @brief Find all occurrences of a pattern in a data buffer, and write them into a caller-provided buffer.
+    /// Pattern is a list of tokens.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param out The output buffer for the indices (including the cursor offset).
+    /// @return Amount of indices written to <c>out</c>.
+    constexpr size_t find_all(uint8_t const* data, size_t size, std::span<token_t const> pattern, std::span<intptr_t> out) {
+        return impl::collect_matches(matches(data, size, pattern), out);
+    }
+
+    /// @brief Find all occurrences of a compiled pattern in a data buffer, and write them into a caller-provided buffer.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param out The output buffer for the indices (including the cursor offset).
+    /// @return Amount of indices written to <c>out</c>.
+    constexpr size_t find_all(uint8_t const* data, size_t size, compiled_pattern const& pattern, std::span<intptr_t> out) {
+        return impl::collect_matches(matches(data, size, pattern), out);
+    }
+}
+
+#endif // SINAPS_MATCHES_HPP
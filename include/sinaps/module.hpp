@@ -0,0 +1,516 @@
+#pragma once
+#ifndef SINAPS_MODULE_HPP
+#define SINAPS_MODULE_HPP
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "compiled_pattern.hpp"
+#include "find.hpp"
+#include "pattern.hpp"
+
+namespace sinaps {
+    /// @brief Executable format of a module.
+    enum class module_format {
+        unknown,
+        pe,
+        elf,
+        macho
+    };
+
+    /// @brief How the module is laid out in memory.
+    enum class module_layout {
+        image, // loaded by the OS loader, sections are at their virtual addresses
+        file   // raw file contents, sections are at their file offsets
+    };
+
+    /// @brief Range of a module section (or segment, for loaded ELF images).
+    struct section_t {
+        std::string_view name;       // section name, empty for loaded ELF segments (they are unnamed)
+        uint8_t const* data = nullptr;
+        size_t size = 0;
+        uint64_t address = 0;        // offset from the module base once loaded (e.g. the RVA), also for raw files
+        bool executable = false;
+        bool writable = false;
+    };
+
+    namespace impl {
+        /// @brief Bounds-checked little-endian reads from module headers.
+        struct header_reader {
+            uint8_t const* base;
+            size_t size;
+
+            template <typename T>
+            [[nodiscard]] bool read(uint64_t offset, T& out) const {
+                if (offset > size || sizeof(T) > size - offset) {
+                    return false;
+                }
+                std::memcpy(&out, base + offset, sizeof(T));
+                return true;
+            }
+
+            /// @brief Read a fixed-size, possibly not null-terminated name.
+            [[nodiscard]] std::string_view name(uint64_t offset, size_t max) const {
+                if (offset >= size) {
+                    return {};
+                }
+                auto str = reinterpret_cast<char const*>(base + offset);
+                max = std::min<uint64_t>(max, size - offset);
+                return {str, static_cast<size_t>(std::find(str, str + max, '\0') - str)};
+            }
+
+            /// @brief Add a section, clipped to the known size of the module.
+            void add(std::vector<section_t>& out, section_t section, uint64_t offset, uint64_t section_size) const {
+                if (offset >= size || section_size == 0) {
+                    return;
+                }
+                section.data = base + offset;
+                section.size = static_cast<size_t>(std::min<uint64_t>(section_size, size - offset));
+                out.push_back(section);
+            }
+        };
+
+        inline module_format parse_pe(header_reader const& reader, module_layout layout, std::vector<section_t>& out) {
+            constexpr uint32_t scn_cnt_code = 0x00000020;
+            constexpr uint32_t scn_mem_execute = 0x20000000;
+            constexpr uint32_t scn_mem_write = 0x80000000;
+
+            uint16_t dos_magic = 0;
+            uint32_t nt_offset = 0, nt_magic = 0;
+            if (!reader.read(0, dos_magic) || dos_magic != 0x5A4D || !reader.read(0x3C, nt_offset) ||
+                !reader.read(nt_offset, nt_magic) || nt_magic != 0x00004550) {
+                return module_format::unknown;
+            }
+
+            uint16_t section_count = 0, optional_size = 0;
+            if (!reader.read(nt_offset + 6, section_count) || !reader.read(nt_offset + 20, optional_size)) {
+                return module_format::unknown;
+            }
+
+            uint64_t table = uint64_t(nt_offset) + 24 + optional_size;
+            for (uint64_t s = 0; s < section_count; s++) {
+                uint64_t header = table + s * 40;
+                uint32_t virtual_size = 0, virtual_address = 0, raw_size = 0, raw_offset = 0, characteristics = 0;
+                if (!reader.read(header + 8, virtual_size) || !reader.read(header + 12, virtual_address) ||
+                    !reader.read(header + 16, raw_size) || !reader.read(header + 20, raw_offset) ||
+                    !reader.read(header + 36, characteristics)) {
+                    break;
+                }
+
+                section_t section;
+                section.name = reader.name(header, 8);
+                section.executable = characteristics & (scn_mem_execute | scn_cnt_code);
+                section.writable = characteristics & scn_mem_write;
+                section.address = virtual_address;
+
+                if (layout == module_layout::image) {
+                    reader.add(out, section, virtual_address, virtual_size ? virtual_size : raw_size);
+                } else if (raw_offset != 0) {
+                    // the raw data is padded to the file alignment
+                    reader.add(out, section, raw_offset, virtual_size ? std::min(virtual_size, raw_size) : raw_size);
+                }
+            }
+
+            return module_format::pe;
+        }
+
+        template <bool Is64>
+        module_format parse_elf(header_reader const& reader, module_layout layout, std::vector<section_t>& out) {
+            using word_t = std::conditional_t<Is64, uint64_t, uint32_t>;
+            constexpr uint32_t pt_load = 1;
+            constexpr uint32_t pf_x = 1, pf_w = 2;
+            constexpr uint32_t sht_nobits = 8;
+            constexpr word_t shf_write = 1, shf_alloc = 2, shf_execinstr = 4;
+
+            word_t ph_offset = 0, sh_offset = 0;
+            uint16_t ph_size = 0, ph_count = 0, sh_size = 0, sh_count = 0, sh_strings = 0;
+            bool ok = Is64
+                ? reader.read(0x20, ph_offset) && reader.read(0x28, sh_offset) && reader.read(0x36, ph_size) &&
+                  reader.read(0x38, ph_count) && reader.read(0x3A, sh_size) && reader.read(0x3C, sh_count) &&
+                  reader.read(0x3E, sh_strings)
+                : reader.read(0x1C, ph_offset) && reader.read(0x20, sh_offset) && reader.read(0x2A, ph_size) &&
+                  reader.read(0x2C, ph_count) && reader.read(0x2E, sh_size) && reader.read(0x30, sh_count) &&
+                  reader.read(0x32, sh_strings);
+            if (!ok) {
+                return module_format::unknown;
+            }
+
+            // virtual address of the ELF header, from the first loadable segment
+            word_t bias = 0;
+            for (uint64_t p = 0; p < ph_count; p++) {
+                uint64_t header = ph_offset + p * ph_size;
+                uint32_t type = 0;
+                word_t offset = 0, vaddr = 0;
+                if (!reader.read(header, type) || !reader.read(header + (Is64 ? 8 : 4), offset) || !reader.read(header + (Is64 ? 0x10 : 8), vaddr)) {
+                    break;
+                }
+                if (type == pt_load) {
+                    bias = vaddr - offset;
+                    break;
+                }
+            }
+
+            // section headers are not loaded into memory, so loaded images use the program headers instead
+            if (layout == module_layout::file && sh_count != 0 && sh_offset != 0) {
+                word_t strings_offset = 0;
+                (void) reader.read(sh_offset + uint64_t(sh_strings) * sh_size + (Is64 ? 0x18 : 0x10), strings_offset);
+
+                for (uint64_t s = 0; s < sh_count; s++) {
+                    uint64_t header = sh_offset + s * sh_size;
+                    uint32_t name = 0, type = 0;
+                    word_t flags = 0, addr = 0, offset = 0, size = 0;
+                    if (!reader.read(header, name) || !reader.read(header + 4, type) || !reader.read(header + 8, flags) ||
+                        !reader.read(header + (Is64 ? 0x10 : 0x0C), addr) || !reader.read(header + (Is64 ? 0x18 : 0x10), offset) ||
+                        !reader.read(header + (Is64 ? 0x20 : 0x14), size)) {
+                        break;
+                    }
+                    if (!(flags & shf_alloc) || type == sht_nobits) {
+                        continue;
+                    }
+
+                    section_t section;
+                    section.name = strings_offset ? reader.name(uint64_t(strings_offset) + name, 256) : std::string_view();
+                    section.executable = flags & shf_execinstr;
+                    section.writable = flags & shf_write;
+                    section.address = addr - bias;
+                    reader.add(out, section, offset, size);
+                }
+                return module_format::elf;
+            }
+
+            for (uint64_t p = 0; p < ph_count; p++) {
+                uint64_t header = ph_offset + p * ph_size;
+                uint32_t type = 0, flags = 0;
+                word_t offset = 0, vaddr = 0, file_size = 0, mem_size = 0;
+                if (!reader.read(header, type) || !reader.read(header + (Is64 ? 4 : 0x18), flags) ||
+                    !reader.read(header + (Is64 ? 8 : 4), offset) || !reader.read(header + (Is64 ? 0x10 : 8), vaddr) ||
+                    !reader.read(header + (Is64 ? 0x20 : 0x10), file_size) || !reader.read(header + (Is64 ? 0x28 : 0x14), mem_size)) {
+                    break;
+                }
+                if (type != pt_load) {
+                    continue;
+                }
+
+                section_t section;
+                section.executable = flags & pf_x;
+                section.writable = flags & pf_w;
+                section.address = vaddr - bias;
+                if (layout == module_layout::image) {
+                    if (vaddr >= bias) reader.add(out, section, vaddr - bias, mem_size);
+                } else {
+                    reader.add(out, section, offset, file_size);
+                }
+            }
+
+            return module_format::elf;
+        }
+
+        template <bool Is64>
+        module_format parse_macho(header_reader const& reader, module_layout layout, std::vector<section_t>& out) {
+            using word_t = std::conditional_t<Is64, uint64_t, uint32_t>;
+            constexpr uint32_t lc_segment = Is64 ? 0x19 : 0x1;
+            constexpr uint64_t segment_size = Is64 ? 72 : 56;
+            constexpr uint64_t section_size = Is64 ? 80 : 68;
+            constexpr int32_t vm_prot_write = 2;
+            constexpr uint32_t s_attr_instructions = 0x80000000 | 0x00000400; // pure and some instructions
+            constexpr uint32_t s_type_mask = 0xFF, s_zerofill = 0x1, s_gb_zerofill = 0xC, s_thread_local_zerofill = 0x12;
+
+            uint32_t command_count = 0;
+            if (!reader.read(16, command_count)) {
+                return module_format::unknown;
+            }
+
+            struct segment_t {
+                uint64_t command; // offset of the load command
+                word_t vmaddr, fileoff, filesize;
+                int32_t initprot;
+                uint32_t section_count;
+            };
+
+            auto for_each_segment = [&](auto&& callback) {
+                uint64_t command = Is64 ? 32 : 28;
+                for (uint32_t c = 0; c < command_count; c++) {
+                    uint32_t cmd = 0, cmd_size = 0;
+                    if (!reader.read(command, cmd) || !reader.read(command + 4, cmd_size) || cmd_size == 0) {
+                        return;
+                    }
+
+                    segment_t segment{command, 0, 0, 0, 0, 0};
+                    if (cmd == lc_segment && reader.read(command + 24, segment.vmaddr) &&
+                        reader.read(command + (Is64 ? 40 : 32), segment.fileoff) &&
+                        reader.read(command + (Is64 ? 48 : 36), segment.filesize) &&
+                        reader.read(command + (Is64 ? 60 : 44), segment.initprot) &&
+                        reader.read(command + (Is64 ? 64 : 48), segment.section_count)) {
+                        callback(segment);
+                    }
+                    command += cmd_size;
+                }
+            };
+
+            // sections are placed relative to the segment that maps the header (__TEXT)
+            bool has_base = false;
+            word_t base_vmaddr = 0;
+            for_each_segment([&](segment_t const& segment) {
+                if (!has_base && segment.fileoff == 0 && segment.filesize != 0) {
+                    base_vmaddr = segment.vmaddr;
+                    has_base = true;
+                }
+            });
+            if (!has_base) {
+                return module_format::unknown;
+            }
+
+            for_each_segment([&](segment_t const& segment) {
+                for (uint64_t s = 0; s < segment.section_count; s++) {
+                    uint64_t header = segment.command + segment_size + s * section_size;
+                    word_t addr = 0, size = 0;
+                    uint32_t offset = 0, flags = 0;
+                    if (!reader.read(header + 32, addr) || !reader.read(header + (Is64 ? 40 : 36), size) ||
+                        !reader.read(header + (Is64 ? 48 : 40), offset) || !reader.read(header + (Is64 ? 64 : 56), flags)) {
+                        return;
+                    }
+
+                    uint32_t type = flags & s_type_mask;
+                    bool zerofill = type == s_zerofill || type == s_gb_zerofill || type == s_thread_local_zerofill;
+
+                    section_t section;
+                    section.name = reader.name(header, 16);
+                    section.executable = flags & s_attr_instructions;
+                    section.writable = segment.initprot & vm_prot_write;
+                    section.address = addr - base_vmaddr;
+                    if (layout == module_layout::image) {
+                        if (!zerofill && addr >= base_vmaddr) reader.add(out, section, addr - base_vmaddr, size);
+                    } else if (!zerofill) {
+                        reader.add(out, section, offset, size);
+                    }
+                }
+            });
+
+            return module_format::macho;
+        }
+    }
+
+    /// @brief Executable module (PE, ELF or Mach-O), split into its sections.
+    /// The headers are parsed once on construction, so the module can be kept around and scanned many times.
+    /// Only little-endian modules are supported.
+    class module {
+    public:
+        module() = default;
+
+        /// @brief Parse a module loaded by the OS loader, e.g. an <c>HMODULE</c> on Windows,
+        /// or <c>dli_fbase</c> (from <c>dladdr</c>) on Linux and macOS.
+        /// @param base Address of the module headers.
+        explicit module(void const* base)
+            : module(base, std::numeric_limits<size_t>::max(), module_layout::image) {}
+
+        /// @brief Parse the raw contents of an executable file.
+        /// @param file The file contents.
+        explicit module(std::span<uint8_t const> file)
+            : module(file.data(), file.size(), module_layout::file) {}
+
+        /// @brief Parse a module with a known size.
+        /// @param base Address of the module headers.
+        /// @param size Size of the module in bytes, sections are clipped to it.
+        /// @param layout Whether the module is loaded (sections at virtual addresses) or a raw file.
+        module(void const* base, size_t size, module_layout layout) : m_base(static_cast<uint8_t const*>(base)), m_layout(layout) {
+            impl::header_reader reader{m_base, size};
+            uint32_t magic = 0;
+            uint8_t elf_class = 0, elf_data = 0;
+            if (!m_base || !reader.read(0, magic)) {
+                return;
+            }
+
+            if (magic == 0x464C457F && reader.read(4, elf_class) && reader.read(5, elf_data) && elf_data == 1) {
+                m_format = elf_class == 2 ? impl::parse_elf<true>(reader, layout, m_sections)
+                         : elf_class == 1 ? impl::parse_elf<false>(reader, layout, m_sections)
+                         : module_format::unknown;
+            } else if (magic == 0xFEEDFACF) {
+                m_format = impl::parse_macho<true>(reader, layout, m_sections);
+            } else if (magic == 0xFEEDFACE) {
+                m_format = impl::parse_macho<false>(reader, layout, m_sections);
+            } else if ((magic & 0xFFFF) == 0x5A4D) {
+                m_format = impl::parse_pe(reader, layout, m_sections);
+            }
+
+            if (m_format == module_format::unknown) {
+                m_sections.clear();
+                return;
+            }
+
+            // scanning in address order keeps the result the lowest match
+            std::sort(m_sections.begin(), m_sections.end(), [](auto const& a, auto const& b) { return a.data < b.data; });
+            for (auto const& section : m_sections) {
+                if (section.executable) {
+                    m_code.push_back(section);
+                } else if (!section.writable) {
+                    m_readonly.push_back(section);
+                }
+            }
+        }
+
+        /// @brief Address of the module headers, results of the module scans are relative to it.
+        [[nodiscard]] uint8_t const* base() const { return m_base; }
+        /// @brief Format of the module, <c>module_format::unknown</c> if the headers could not be parsed.
+        [[nodiscard]] module_format format() const { return m_format; }
+        /// @brief Whether the sections are at their virtual addresses or at their file offsets.
+        [[nodiscard]] module_layout layout() const { return m_layout; }
+        /// @brief Whether the headers were parsed successfully.
+        [[nodiscard]] bool valid() const { return m_format != module_format::unknown; }
+
+        /// @brief All sections that are present in memory (or in the file), in address order.
+        [[nodiscard]] std::span<section_t const> sections() const { return m_sections; }
+        /// @brief Executable sections, in address order.
+        [[nodiscard]] std::span<section_t const> code_sections() const { return m_code; }
+        /// @brief Non-executable and non-writable sections (constants, strings), in address order.
+        [[nodiscard]] std::span<section_t const> readonly_sections() const { return m_readonly; }
+
+        /// @brief Find a section by name.
+        /// @return Pointer to the section, or <c>nullptr</c> if there is no such section.
+        [[nodiscard]] section_t const* section(std::string_view name) const {
+            auto it = std::find_if(m_sections.begin(), m_sections.end(), [name](auto const& s) { return s.name == name; });
+            return it == m_sections.end() ? nullptr : &*it;
+        }
+
+    private:
+        uint8_t const* m_base = nullptr;
+        module_format m_format = module_format::unknown;
+        module_layout m_layout = module_layout::image;
+        std::vector<section_t> m_sections;
+        std::vector<section_t> m_code;
+        std::vector<section_t> m_readonly;
+    };
+
+    namespace impl {
+        /// @brief Sections of a module seen as memory, used to resolve follow tokens (see <c>resolve_follows</c>),
+        /// so targets can be in any section. Positions are offsets from the module base.
+        /// In raw files, sections don't keep their distances, so targets go through the section addresses.
+        struct module_memory {
+            module const* mod;
+
+            /// @brief Section that holds <c>size</c> bytes at a position, or <c>nullptr</c>.
+            [[nodiscard]] section_t const* find_section(intptr_t pos, size_t size) const {
+                for (auto const& section : mod->sections()) {
+                    intptr_t begin = section.data - mod->base();
+                    if (pos >= begin && static_cast<size_t>(pos - begin) <= section.size && section.size - static_cast<size_t>(pos - begin) >= size) {
+                        return &section;
+                    }
+                }
+                return nullptr;
+            }
+
+            [[nodiscard]] bool readable(intptr_t pos) const { return find_section(pos, 1) != nullptr; }
+
+            bool load32(intptr_t pos, int32_t& value) const {
+                return find_section(pos, 4) && buffer_memory{mod->base() + pos, 4}.load32(0, value);
+            }
+
+            /// @brief Position <c>rel</c> bytes after <c>next</c> in the loaded module, see <c>follow_target</c>.
+            [[nodiscard]] intptr_t target(intptr_t next, int32_t rel) const {
+                if (mod->layout() == module_layout::image) {
+                    return next + rel;
+                }
+                auto const* source = find_section(next, 0);
+                if (!source) {
+                    return not_found;
+                }
+                uint64_t address = source->address + static_cast<uint64_t>(next - (source->data - mod->base())) + static_cast<uint64_t>(int64_t(rel));
+                for (auto const& section : mod->sections()) {
+                    if (address >= section.address && address - section.address < section.size) {
+                        return static_cast<intptr_t>(section.data - mod->base()) + static_cast<intptr_t>(address - section.address);
+                    }
+                }
+                return not_found;
+            }
+        };
+    }
+
+    /// @brief Run a search on each section, and stop at the first one with a match.
+    /// Matches can't straddle two sections.
+    /// @param mod The module the sections belong to.
+    /// @param sections The sections to search in (usually <c>mod.code_sections()</c>).
+    /// @param find_section Callable that accepts a pointer and a size, and returns the index of the first match.
+    /// @return The offset of the match from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    template <typename Find> requires std::invocable<Find&, uint8_t const*, size_t>
+    intptr_t find_in_sections(module const& mod, std::span<section_t const> sections, Find&& find_section) {
+        for (auto const& section : sections) {
+            intptr_t res = find_section(section.data, section.size);
+            if (res != not_found) {
+                return static_cast<intptr_t>(section.data - mod.base()) + res;
+            }
+        }
+        return not_found;
+    }
+
+    /// @brief Find a pattern in the executable sections of a module.
+    /// Follow tokens are resolved in the whole module, e.g. a rip-relative operand can point into a data section.
+    /// @param mod The module to search in.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The offset of the pattern from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    intptr_t find(module const& mod, size_t step_size = 1) {
+        impl::module_memory memory{&mod};
+        for (auto const& section : mod.code_sections()) {
+            auto begin = static_cast<size_t>(section.data - mod.base());
+            intptr_t res = impl::find_range<Pattern>(mod.base(), begin + section.size, begin, begin + section.size, step_size, memory);
+            if (res != not_found) {
+                return res;
+            }
+        }
+        return not_found;
+    }
+
+    /// @brief Find a pattern in the executable sections of a module.
+    /// The pattern is a sequence of masks (see <c>sinaps::masks</c> namespace).
+    /// @param mod The module to search in.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The offset of the pattern from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    template <typename... Mask> requires (!utils::is_specialization<Mask, pattern>::value && ...)
+    intptr_t find(module const& mod, size_t step_size = 1) {
+        return find<pattern<Mask...>>(mod, step_size);
+    }
+
+    /// @brief Find a pattern in the executable sections of a module.
+    /// Builds the pattern from a string literal.
+    /// @param mod The module to search in.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The offset of the pattern from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    template <utils::FixedString S>
+    intptr_t find(module const& mod, size_t step_size = 1) {
+        return find<impl::make_pattern<impl::tokenizePatternString<S>()>>(mod, step_size);
+    }
+
+    /// @brief Find a compiled pattern in the executable sections of a module.
+    /// @param mod The module to search in.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The offset of the pattern from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    inline intptr_t find(module const& mod, compiled_pattern const& pattern, size_t step_size = 1) {
+        impl::module_memory memory{&mod};
+        for (auto const& section : mod.code_sections()) {
+            auto begin = static_cast<size_t>(section.data - mod.base());
+            intptr_t res = impl::find_compiled_range(mod.base(), begin + section.size, begin, begin + section.size, pattern, step_size, memory);
+            if (res != not_found) {
+                return res;
+            }
+        }
+        return not_found;
+    }
+
+    /// @brief Find a pattern in the executable sections of a module. Pattern is a string.
+    /// @param mod The module to search in.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The offset of the pattern from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    inline intptr_t find(module const& mod, std::string_view pattern, size_t step_size = 1) {
+        return find(mod, compiled_pattern(pattern), step_size);
+    }
+}
+
+#endif // SINAPS_MODULE_HPP
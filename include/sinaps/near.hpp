@@ -0,0 +1,118 @@
+#pragma once
+#ifndef SINAPS_NEAR_HPP
+#define SINAPS_NEAR_HPP
+
+#include <algorithm>
+#include <cstdint>
+
+#include "compiled_pattern.hpp"
+#include "find.hpp"
+#include "matches.hpp"
+#include "pattern.hpp"
+#include "reverse.hpp"
+
+namespace sinaps {
+    namespace impl {
+        /// @brief Start of the first match that starts in <c>[begin, end)</c> and resolves, or <b>sinaps::not_found</b>.
+        template <typename Scanner>
+        constexpr intptr_t find_first_start(uint8_t const* data, size_t size, size_t begin, size_t end, Scanner const& scanner) {
+            for (size_t from = begin; from < end;) {
+                intptr_t res = scanner.next(data + from, end - from + scanner.size() - 1);
+                if (res == not_found) break;
+                size_t start = from + static_cast<size_t>(res);
+                if (scanner.resolve(data, size, start) != not_found) {
+                    return static_cast<intptr_t>(start);
+                }
+                from = start + 1;
+            }
+            return not_found;
+        }
+
+        /// @brief Find the match that starts nearest to <c>hint</c>, scanning outward in rings.
+        /// The first ring spans <c>radius</c> positions on each side of the hint, and every next ring doubles it,
+        /// until the whole buffer is covered. Each position is scanned once, and the scan stops after the first
+        /// ring with a match, since a nearer match would be in a ring that was already scanned.
+        /// @param hint The expected start of the match.
+        /// @param radius Size of the first ring, usually the expected distance from the hint.
+        /// @return The start of the nearest match (the lower one on a tie), or <b>sinaps::not_found</b>.
+        template <typename Scanner>
+        constexpr intptr_t find_near_start(uint8_t const* data, size_t size, Scanner const& scanner, size_t hint, size_t radius) {
+            size_t pattern_size = scanner.size();
+            if (size < pattern_size) {
+                return not_found;
+            }
+
+            size_t count = size - pattern_size + 1; // amount of possible starts
+            hint = std::min(hint, count - 1);
+            size_t ring = std::max<size_t>(radius, 1);
+
+            size_t forward = hint;  // starts in [hint, forward) were scanned
+            size_t backward = hint; // starts in [backward, hint) were scanned
+            while (forward < count || backward > 0) {
+                size_t forward_end = std::min(count, hint + std::min(ring, count));
+                intptr_t ahead = not_found;
+                if (forward < forward_end) {
+                    ahead = find_first_start(data, size, forward, forward_end, scanner);
+                    forward = forward_end;
+                }
+
+                size_t backward_begin = hint > ring ? hint - ring : 0;
+                intptr_t behind = not_found;
+                if (backward_begin < backward) {
+                    behind = find_last_start(data, size, backward_begin, backward, scanner);
+                    backward = backward_begin;
+                }
+
+                if (ahead != not_found && behind != not_found) {
+                    return static_cast<size_t>(ahead) - hint < hint - static_cast<size_t>(behind) ? ahead : behind;
+                }
+                if (ahead != not_found || behind != not_found) {
+                    return ahead != not_found ? ahead : behind;
+                }
+
+                ring = ring > count ? count : ring * 2;
+            }
+
+            return not_found;
+        }
+
+        template <typename Scanner>
+        constexpr intptr_t find_near(uint8_t const* data, size_t size, Scanner const& scanner, intptr_t hint, size_t radius) {
+            intptr_t cursor = scanner.result(0);
+            intptr_t start = std::max<intptr_t>(hint - cursor, 0);
+            auto res = find_near_start(data, size, scanner, static_cast<size_t>(start), radius);
+            if (res == not_found) {
+                return not_found;
+            }
+            SINAPS_STATS_ADD(matches, 1);
+            return scanner.resolve(data, size, static_cast<size_t>(res));
+        }
+    }
+
+    /// @brief Find the occurrence of a pattern that is nearest to a hint, e.g. a signature that is known to be
+    /// close to another resolved one. The scan starts around the hint and moves outward, so it only touches
+    /// a small part of the buffer when the hint is good, and falls back to the whole buffer otherwise.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param hint The expected index of the pattern (including the cursor offset). For patterns with follow tokens,
+    /// the distance is measured to the cursor of the match, not to the target.
+    /// @param radius Expected distance from the hint (size of the first window scanned on each side).
+    /// @return The index of the nearest occurrence (the lower one on a tie), or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr intptr_t find_near(uint8_t const* data, size_t size, intptr_t hint, size_t radius = 4096) {
+        return impl::find_near(data, size, impl::pattern_scanner<Pattern>{}, hint, radius);
+    }
+
+    /// @brief Find the occurrence of a compiled pattern that is nearest to a hint (see <c>sinaps::find_near</c>).
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param hint The expected index of the pattern (including the cursor offset).
+    /// @param radius Expected distance from the hint (size of the first window scanned on each side).
+    /// @return The index of the nearest occurrence (the lower one on a tie), or <b>sinaps::not_found</b> if not found.
+    constexpr intptr_t find_near(uint8_t const* data, size_t size, compiled_pattern const& pattern, intptr_t hint, size_t radius = 4096) {
+        return impl::find_near(data, size, impl::compiled_scanner{&pattern}, hint, radius);
+    }
+}
+
+#endif // SINAPS_NEAR_HPP
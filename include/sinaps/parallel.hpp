@@ -0,0 +1,210 @@
+#pragma once
+#ifndef SINAPS_PARALLEL_HPP
+#define SINAPS_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <latch>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "compiled_pattern.hpp"
+#include "find.hpp"
+#include "pattern.hpp"
+#include "stats.hpp"
+
+namespace sinaps {
+    /// @brief Options for the parallel scan.
+    struct parallel_options {
+        size_t threads = 0;            // amount of workers, 0 means std::thread::hardware_concurrency()
+        size_t chunk_size = 256 << 10; // amount of starting positions per chunk
+    };
+
+    namespace impl {
+        /// @brief Split the buffer into chunks, and scan them on multiple workers.
+        /// Neighbouring chunks overlap by <c>overlap</c> bytes, so matches that straddle a boundary are found
+        /// by the lower chunk. Workers take chunks in ascending order, and stop once a lower chunk has a match,
+        /// so the result is always the same one a sequential scan would return.
+        /// @param overlap Amount of bytes each chunk is extended by (usually the pattern size minus one).
+        /// @param find_chunk Callable that accepts the range <c>[begin, end)</c> of a chunk, and returns the index of the first
+        /// match that starts in it (an index of the whole buffer, follow tokens may point outside the chunk).
+        /// @param spawn Callable that runs the worker function on <c>workers - 1</c> other threads, and waits for them.
+        /// @return The index of the first match in the whole buffer, or <b>sinaps::not_found</b>.
+        template <typename Find, typename Spawn>
+        intptr_t find_chunked(
+            size_t size, size_t overlap, parallel_options const& options,
+            Find&& find_chunk, Spawn&& spawn
+        ) {
+            size_t chunk_size = std::max<size_t>(options.chunk_size, 1);
+            size_t chunk_count = (size + chunk_size - 1) / chunk_size;
+            if (chunk_count == 0) {
+                return not_found;
+            }
+
+            std::vector<intptr_t> results(chunk_count, not_found);
+            std::atomic<size_t> next_chunk{0};
+            std::atomic<size_t> best_chunk{chunk_count}; // lowest chunk with a match so far
+
+#ifdef SINAPS_ENABLE_STATS
+            // every worker counts on its own, and adds to the sink of the calling thread when it's done
+            scan_stats* caller_stats = impl::stats_sink().total;
+            std::mutex stats_mutex;
+#endif
+
+            auto scan = [&] {
+                while (true) {
+                    size_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+                    if (chunk >= best_chunk.load(std::memory_order_relaxed)) {
+                        return; // out of chunks, or a lower chunk already won
+                    }
+
+                    size_t begin = chunk * chunk_size;
+                    size_t end = std::min(begin + chunk_size + overlap, size);
+                    intptr_t res = find_chunk(begin, end);
+                    if (res == not_found) {
+                        continue;
+                    }
+
+                    results[chunk] = res;
+                    size_t current = best_chunk.load(std::memory_order_relaxed);
+                    while (chunk < current && !best_chunk.compare_exchange_weak(current, chunk, std::memory_order_relaxed)) {}
+                }
+            };
+
+            auto worker = [&] {
+#ifdef SINAPS_ENABLE_STATS
+                if (caller_stats) {
+                    scan_stats local;
+                    {
+                        stats_guard guard(stats_sink_t{&local, {}});
+                        scan();
+                    }
+                    std::lock_guard lock(stats_mutex);
+                    *caller_stats += local;
+                    return;
+                }
+#endif
+                scan();
+            };
+
+            spawn(worker);
+
+            size_t best = best_chunk.load();
+            return best == chunk_count ? not_found : results[best];
+        }
+
+        inline size_t worker_count(parallel_options const& options) {
+            return options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        /// @brief Runs the worker on the current thread and <c>threads - 1</c> new ones.
+        inline auto thread_spawner(size_t threads) {
+            return [threads](auto& worker) {
+                std::vector<std::thread> pool;
+                pool.reserve(threads - 1);
+                for (size_t t = 1; t < threads; t++) {
+                    pool.emplace_back(std::ref(worker));
+                }
+                worker();
+                for (auto& thread : pool) {
+                    thread.join();
+                }
+            };
+        }
+
+        /// @brief Submits the worker to a user-supplied executor <c>threads - 1</c> times, runs it on the current thread
+        /// and waits for the submitted ones to finish.
+        template <typename Executor>
+        auto executor_spawner(Executor& executor, size_t threads) {
+            return [&executor, threads](auto& worker) {
+                std::latch done(static_cast<ptrdiff_t>(threads - 1));
+                for (size_t t = 1; t < threads; t++) {
+                    executor(std::function<void()>([&worker, &done] {
+                        worker();
+                        done.count_down();
+                    }));
+                }
+                worker();
+                done.wait();
+            };
+        }
+    }
+
+    /// @brief Find an index of a pattern in a data buffer, using multiple threads.
+    /// The buffer is split into chunks, which are scanned by <c>options.threads</c> workers.
+    /// The result is always the lowest match, same as <c>sinaps::find</c>.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param options Amount of threads and chunk size.
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    intptr_t find_parallel(uint8_t const* data, size_t size, parallel_options options = {}) {
+        return impl::find_chunked(
+            size, Pattern::size - 1, options,
+            [data, size](size_t begin, size_t end) {
+                return impl::find_range<Pattern>(data, size, begin, end, 1, impl::buffer_memory{data, size});
+            },
+            impl::thread_spawner(impl::worker_count(options))
+        );
+    }
+
+    /// @brief Find an index of a pattern in a data buffer, using a user-supplied executor.
+    /// The executor is called with <c>std::function&lt;void()&gt;</c> tasks, and must eventually run all of them
+    /// (e.g. by posting them to a thread pool). The calling thread takes part in the scan, and waits for the tasks.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param executor Callable that schedules a task.
+    /// @param options Amount of tasks and chunk size.
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern, typename Executor>
+        requires utils::is_specialization<Pattern, pattern>::value && std::invocable<Executor&, std::function<void()>>
+    intptr_t find_parallel(uint8_t const* data, size_t size, Executor&& executor, parallel_options options = {}) {
+        return impl::find_chunked(
+            size, Pattern::size - 1, options,
+            [data, size](size_t begin, size_t end) {
+                return impl::find_range<Pattern>(data, size, begin, end, 1, impl::buffer_memory{data, size});
+            },
+            impl::executor_spawner(executor, impl::worker_count(options))
+        );
+    }
+
+    /// @brief Find an index of a compiled pattern in a data buffer, using multiple threads.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param options Amount of threads and chunk size.
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    inline intptr_t find_parallel(uint8_t const* data, size_t size, compiled_pattern const& pattern, parallel_options options = {}) {
+        return impl::find_chunked(
+            size, pattern.size() - 1, options,
+            [data, size, &pattern](size_t begin, size_t end) {
+                return impl::find_compiled_range(data, size, begin, end, pattern, 1, impl::buffer_memory{data, size});
+            },
+            impl::thread_spawner(impl::worker_count(options))
+        );
+    }
+
+    /// @brief Find an index of a compiled pattern in a data buffer, using a user-supplied executor.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param executor Callable that schedules a task.
+    /// @param options Amount of tasks and chunk size.
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Executor> requires std::invocable<Executor&, std::function<void()>>
+    intptr_t find_parallel(uint8_t const* data, size_t size, compiled_pattern const& pattern, Executor&& executor, parallel_options options = {}) {
+        return impl::find_chunked(
+            size, pattern.size() - 1, options,
+            [data, size, &pattern](size_t begin, size_t end) {
+                return impl::find_compiled_range(data, size, begin, end, pattern, 1, impl::buffer_memory{data, size});
+            },
+            impl::executor_spawner(executor, impl::worker_count(options))
+        );
+    }
+}
+
+#endif // SINAPS_PARALLEL_HPP
@@ -3,16 +3,40 @@
 #define SINAPS_PATTERN_HPP
 
 #include <array>
+#include <bit>
 #include <cstddef>
 #include <cstdint>
 #include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
+#include "anchor.hpp"
+#include "skip.hpp"
 #include "token.hpp"
 #include "utils.hpp"
 
 namespace sinaps {
+    /// @brief A run of consecutive fully-specified bytes in a pattern.
+    struct group_t {
+        size_t offset{};
+        size_t count{};
+        constexpr group_t() = default;
+        constexpr group_t(size_t offset, size_t count) : offset(offset), count(count) {}
+        [[nodiscard]] constexpr size_t size() const { return count; }
+        constexpr uint8_t* begin(uint8_t* data) const { return data + offset; }
+        constexpr uint8_t* end(uint8_t* data) const { return data + offset + count; }
+    };
+
+    namespace impl {
+        /// @brief Whether a masked token only checks one nibble (written <c>4?</c> or <c>?8</c>).
+        constexpr bool is_nibble(token_t token) {
+            return token.type == token_t::type_t::masked && (token.mask == 0xF0 || token.mask == 0x0F) && (token.byte & ~token.mask) == 0;
+        }
+    }
+
     /// @brief Primary container for mask patterns. It allows for easy pattern creation at compile-time.
     /// @tparam Mask List of masks that make up the pattern (e.g. mask::string<"abc">, mask::any<3>, etc.)
     template <typename... Mask>
@@ -24,45 +48,125 @@ namespace sinaps {
         static constexpr std::tuple raw_value = std::tuple_cat(Mask::value...);
         // size of the raw_value tuple
         static constexpr size_t raw_size = std::tuple_size_v<decltype(raw_value)>;
-        // size of the pattern bytes
-        static constexpr size_t size = (Mask::size + ...);
 
-        // whether the pattern contains a cursor token
-        static constexpr bool has_cursor = []<size_t... I>(std::index_sequence<I...>) {
-            return ((std::get<I>(raw_value).type == token_t::type_t::cursor) || ...);
+        // array of raw tokens (extracted from the raw_value tuple)
+        static constexpr auto raw_tokens = []<size_t... I>(std::index_sequence<I...>) {
+            return std::array<token_t, raw_size>{std::get<I>(raw_value)...};
         }(std::make_index_sequence<raw_size>());
 
-        // position of the cursor token in the pattern
-        static constexpr size_t cursor_pos = []<size_t... I>(std::index_sequence<I...>) {
+        // amount of raw tokens before the first gap (the fixed head, which is scanned for)
+        static constexpr size_t head_raw_size = [] {
+            size_t i = 0;
+            while (i < raw_size && raw_tokens[i].type != token_t::type_t::gap) i++;
+            return i;
+        }();
+
+        // whether the pattern contains a gap token
+        static constexpr bool has_gap = head_raw_size < raw_size;
+
+        // size of the pattern bytes (of the fixed head, if the pattern has gaps)
+        static constexpr size_t size = [] {
+            size_t size = 0;
+            for (size_t i = 0; i < head_raw_size; i++) size += !raw_tokens[i].zero_sized();
+            return size;
+        }();
+
+        static_assert(!has_gap || size > 0, "A pattern can't start with a gap");
+
+        // smallest and largest amount of bytes a match spans
+        static constexpr size_t min_size = [] {
+            size_t total = size;
+            for (size_t i = head_raw_size; i < raw_size; i++) {
+                total += raw_tokens[i].type == token_t::type_t::gap ? raw_tokens[i].byte : !raw_tokens[i].zero_sized();
+            }
+            return total;
+        }();
+        static constexpr size_t max_size = [] {
+            size_t total = size;
+            for (size_t i = head_raw_size; i < raw_size; i++) {
+                total += raw_tokens[i].type == token_t::type_t::gap ? raw_tokens[i].mask : !raw_tokens[i].zero_sized();
+            }
+            return total;
+        }();
+
+        // tokens from the first gap on, matched after the head (see impl::match_tail)
+        static constexpr auto tail = [] {
+            std::array<token_t, raw_size - head_raw_size> tail;
+            for (size_t i = head_raw_size; i < raw_size; i++) tail[i - head_raw_size] = raw_tokens[i];
+            return tail;
+        }();
+
+        // whether the pattern contains a cursor token
+        static constexpr bool has_cursor = [] {
+            for (auto const& token : raw_tokens) {
+                if (token.type == token_t::type_t::cursor) return true;
+            }
+            return false;
+        }();
+
+        // whether the cursor is after a gap, it's then found by the tail match and cursor_pos is not used
+        static constexpr bool tail_cursor = [] {
+            for (auto const& token : tail) {
+                if (token.type == token_t::type_t::cursor) return true;
+            }
+            return false;
+        }();
+
+        // position of the cursor token in the pattern (in bytes, excluding zero-sized tokens)
+        static constexpr size_t cursor_pos = [] {
             size_t pos = 0;
-            ((std::get<I>(raw_value).type == token_t::type_t::cursor ? (void) (pos = I) : void()), ...);
+            size_t offset = 0;
+            for (size_t i = 0; i < head_raw_size; i++) {
+                if (raw_tokens[i].type == token_t::type_t::cursor) {
+                    pos = offset;
+                } else if (!raw_tokens[i].zero_sized()) {
+                    offset++;
+                }
+            }
             return pos;
-        }(std::make_index_sequence<raw_size>());
+        }();
+
+        // amount of follow tokens in the pattern
+        static constexpr size_t follow_count = [] {
+            size_t count = 0;
+            for (auto const& token : raw_tokens) count += token.type == token_t::type_t::follow;
+            return count;
+        }();
+
+        // array of follow tokens, in the order they are applied
+        static constexpr auto follows = [] {
+            std::array<token_t, follow_count> follows;
+            size_t index = 0;
+            for (auto const& token : raw_tokens) {
+                if (token.type == token_t::type_t::follow) follows[index++] = token;
+            }
+            return follows;
+        }();
 
         // array of raw types (extracted from the raw_value tuple)
         static constexpr auto raw_types = []<size_t... I>(std::index_sequence<I...>) {
-            return std::array<token_t::type_t, raw_size>{std::get<I>(raw_value).type...};
+            return std::array<token_t::type_t, raw_size>{raw_tokens[I].type...};
         }(std::make_index_sequence<raw_size>());
 
         // array of raw bytes (extracted from the raw_value tuple)
         static constexpr auto raw_bytes = []<size_t... I>(std::index_sequence<I...>) {
-            return std::array<uint8_t, raw_size>{std::get<I>(raw_value).byte...};
+            return std::array<uint8_t, raw_size>{raw_tokens[I].byte...};
         }(std::make_index_sequence<raw_size>());
 
         // array of raw masks (extracted from the raw_value tuple)
         static constexpr auto raw_masks = []<size_t... I>(std::index_sequence<I...>) {
-            return std::array<uint8_t, raw_size>{std::get<I>(raw_value).mask...};
+            return std::array<uint8_t, raw_size>{raw_tokens[I].mask...};
         }(std::make_index_sequence<raw_size>());
 
-        // array of tokens (excluding zero-sized ones)
-        static constexpr auto value = []<size_t... I>(std::index_sequence<I...>) {
+        // array of tokens of the head (excluding zero-sized ones)
+        static constexpr auto value = [] {
             std::array<token_t, size> value;
             size_t index = 0;
-            ((std::get<I>(raw_value).type != token_t::type_t::cursor
-                  ? (void) (value[index++] = std::get<I>(raw_value))
-                  : void()), ...);
+            for (size_t i = 0; i < head_raw_size; i++) {
+                if (!raw_tokens[i].zero_sized()) value[index++] = raw_tokens[i];
+            }
             return value;
-        }(std::make_index_sequence<raw_size>());
+        }();
 
         #define EXTRACT_VALUES(type, val) \
             []<size_t... I>(std::index_sequence<I...>) { \
@@ -78,6 +182,46 @@ namespace sinaps {
 
         #undef EXTRACT_VALUES
 
+        // array of masks applied to the data before comparing (0xFF for bytes, 0x00 for wildcards,
+        // the bits both bytes share for either tokens)
+        static constexpr auto match_masks = []<size_t... I>(std::index_sequence<I...>) {
+            return std::array<uint8_t, size>{
+                (types[I] == token_t::type_t::byte ? uint8_t(0xFF)
+                 : types[I] == token_t::type_t::masked ? masks[I]
+                 : types[I] == token_t::type_t::either ? uint8_t(~(bytes[I] ^ masks[I]))
+                 : uint8_t(0))...
+            };
+        }(std::make_index_sequence<size>());
+
+        // array of bytes the masked data is compared to (0x00 for wildcards)
+        static constexpr auto match_bytes = []<size_t... I>(std::index_sequence<I...>) {
+            return std::array<uint8_t, size>{
+                (types[I] == token_t::type_t::wildcard ? uint8_t(0)
+                 : types[I] == token_t::type_t::either ? uint8_t(bytes[I] & masks[I])
+                 : bytes[I])...
+            };
+        }(std::make_index_sequence<size>());
+
+        // amount of either tokens, they need an exact check after the masked compare
+        static constexpr size_t either_count = [] {
+            size_t count = 0;
+            for (auto type : types) count += type == token_t::type_t::either;
+            return count;
+        }();
+
+        // offsets of the either tokens
+        static constexpr auto either_offsets = [] {
+            std::array<size_t, either_count> offsets{};
+            size_t index = 0;
+            for (size_t j = 0; j < size; j++) {
+                if (types[j] == token_t::type_t::either) offsets[index++] = j;
+            }
+            return offsets;
+        }();
+
+        // whether the whole pattern can be verified with a few wide `(data & mask) == bytes` compares
+        static constexpr bool packed_verify = size >= 2 && size <= 64;
+
         // count number of groups of consecutive tokens (e.g. "AB?^C" has 2 groups)
         static constexpr size_t group_count = []<size_t... I>(std::index_sequence<I...>) {
             size_t count = 0;
@@ -91,15 +235,7 @@ namespace sinaps {
             return count;
         }(std::make_index_sequence<size>());
 
-        struct group_t {
-            size_t offset{};
-            size_t count{};
-            constexpr group_t() = default;
-            constexpr group_t(size_t offset, size_t count) : offset(offset), count(count) {}
-            [[nodiscard]] constexpr size_t size() const { return count; }
-            constexpr uint8_t* begin(uint8_t* data) const { return data + offset; }
-            constexpr uint8_t* end(uint8_t* data) const { return data + offset + count; }
-        };
+        using group_t = sinaps::group_t;
 
         // array of groups
         static constexpr std::array<group_t, group_count> groups = []<size_t... I>(std::index_sequence<I...>) {
@@ -119,13 +255,30 @@ namespace sinaps {
             return groups;
         }(std::make_index_sequence<size>());
 
+        // pair of the least frequent fully-specified bytes, used to prefilter the scan
+        static constexpr anchor_t anchor_pair = select_anchor(value);
+        // offset of the least frequent fully-specified byte
+        static constexpr size_t anchor_offset = anchor_pair.first;
+
+        // bad-character skip table, indexed by the last byte of the last group
+        static constexpr skip_table_t skip_table = build_skip_table(
+            value, group_count > 0 ? groups[group_count - 1].offset + groups[group_count - 1].count - 1 : 0
+        );
+
         static consteval size_t count_string_length() {
             size_t length = 0;
             for (size_t i = 0; i < raw_size; i++) {
                 if (raw_types[i] == token_t::type_t::byte) {
                     length += 3;
                 } else if (raw_types[i] == token_t::type_t::masked) {
-                    length += 6;
+                    length += impl::is_nibble(raw_tokens[i]) ? 3 : 6;
+                } else if (raw_types[i] == token_t::type_t::either) {
+                    length += 8;
+                } else if (raw_types[i] == token_t::type_t::follow) {
+                    length += 2 + (raw_bytes[i] ? 2 : 0) + (raw_masks[i] ? 3 : 0);
+                } else if (raw_types[i] == token_t::type_t::gap) {
+                    length += 3 + utils::decimal_length(raw_bytes[i]);
+                    if (raw_bytes[i] != raw_masks[i]) length += 1 + utils::decimal_length(raw_masks[i]);
                 } else {
                     length += 2;
                 }
@@ -143,6 +296,10 @@ namespace sinaps {
                     auto hex = utils::hex_to_string(raw_bytes[i]);
                     str[index++] = hex[0];
                     str[index++] = hex[1];
+                } else if (type == token_t::type_t::masked && impl::is_nibble(raw_tokens[i])) {
+                    auto hex = utils::hex_to_string(raw_bytes[i]);
+                    str[index++] = raw_masks[i] == 0xF0 ? hex[0] : '?';
+                    str[index++] = raw_masks[i] == 0xF0 ? '?' : hex[1];
                 } else if (type == token_t::type_t::masked) {
                     auto hex = utils::hex_to_string(raw_bytes[i]);
                     str[index++] = hex[0];
@@ -151,8 +308,39 @@ namespace sinaps {
                     hex = utils::hex_to_string(raw_masks[i]);
                     str[index++] = hex[0];
                     str[index++] = hex[1];
+                } else if (type == token_t::type_t::either) {
+                    auto hex = utils::hex_to_string(raw_bytes[i]);
+                    str[index++] = '(';
+                    str[index++] = hex[0];
+                    str[index++] = hex[1];
+                    str[index++] = '|';
+                    hex = utils::hex_to_string(raw_masks[i]);
+                    str[index++] = hex[0];
+                    str[index++] = hex[1];
+                    str[index++] = ')';
                 } else if (type == token_t::type_t::wildcard) {
                     str[index++] = '?';
+                } else if (type == token_t::type_t::follow) {
+                    str[index++] = '@';
+                    if (raw_bytes[i]) {
+                        auto hex = utils::hex_to_string(raw_bytes[i]);
+                        str[index++] = hex[0];
+                        str[index++] = hex[1];
+                    }
+                    if (raw_masks[i]) {
+                        auto hex = utils::hex_to_string(raw_masks[i]);
+                        str[index++] = '+';
+                        str[index++] = hex[0];
+                        str[index++] = hex[1];
+                    }
+                } else if (type == token_t::type_t::gap) {
+                    str[index++] = '[';
+                    index = utils::write_decimal(str, index, raw_bytes[i]);
+                    if (raw_bytes[i] != raw_masks[i]) {
+                        str[index++] = '-';
+                        index = utils::write_decimal(str, index, raw_masks[i]);
+                    }
+                    str[index++] = ']';
                 } else {
                     str[index++] = '^';
                 }
@@ -164,79 +352,181 @@ namespace sinaps {
     };
 
     namespace impl {
-        template <utils::FixedString S>
-        consteval size_t sizeOfPatternString() {
-            size_t size = 0;
-            for (size_t i = 0; i < S.size(); i++) {
-                if (S[i] == ' ') {
-                    continue;
+        /// @brief Token for a set of byte values: a masked byte if the values only differ in a fixed set of bits
+        /// (e.g. <c>74</c> and <c>75</c>), an either token for any other pair.
+        /// @throws std::invalid_argument If the set is empty, or can't be stored in a single token.
+        constexpr token_t alternative_token(std::array<bool, 256> const& set) {
+            size_t count = 0;
+            unsigned first = 0, second = 0, diff = 0;
+            for (unsigned value = 0; value < 256; value++) {
+                if (!set[value]) continue;
+                if (count == 0) first = value;
+                if (count == 1) second = value;
+                diff |= value ^ first;
+                count++;
+            }
+
+            if (count == 0) {
+                throw std::invalid_argument("Empty alternative in pattern");
+            }
+            if (count == size_t(1) << std::popcount(diff)) {
+                return token_t(static_cast<uint8_t>(first & ~diff), static_cast<uint8_t>(~diff));
+            }
+            if (count == 2) {
+                return token_t(token_t::type_t::either, static_cast<uint8_t>(first), static_cast<uint8_t>(second));
+            }
+            throw std::invalid_argument("Pattern alternatives must be two bytes, or differ in a fixed set of bits");
+        }
+
+        /// @brief Parse a pattern string, and call <c>emit</c> with every token.
+        /// Tokens are separated by spaces: bytes (<c>48</c>), masked bytes (<c>48&F0</c>), nibbles (<c>4?</c>, <c>?8</c>),
+        /// wildcards (<c>?</c>), alternatives (<c>(74|75)</c>, see <c>alternative_token</c>), the cursor (<c>^</c>)
+        /// follows (<c>@</c>, <c>@OO</c> or <c>@OO+EE</c>, see <c>mask::follow</c>) and gaps (<c>[4-16]</c> or <c>[8]</c>,
+        /// in decimal, see <c>mask::gap</c>).
+        /// @throws std::invalid_argument If an alternative or a gap is malformed.
+        template <typename Emit>
+        constexpr void parsePatternString(std::string_view str, Emit&& emit) {
+            // up to two hex digits after position `i`, which is moved to the last one
+            auto read_hex = [str](size_t& i) {
+                uint8_t value = 0;
+                for (size_t n = 0; n < 2 && i + 1 < str.size() && utils::is_hex(str[i + 1]); n++) {
+                    value = static_cast<uint8_t>(value << 4 | utils::from_hex(str[++i]));
                 }
-                size++;
-                if (utils::is_hex(S[i])) {
+                return value;
+            };
+
+            // single byte at position `i` (byte, masked byte, nibble or wildcard), `i` is moved to its last character
+            auto read_byte = [str, read_hex](size_t& i) {
+                if (str[i] == '?') {
+                    if (i + 1 < str.size() && utils::is_hex(str[i + 1])) {
+                        return token_t(utils::from_hex(str[++i]), 0x0F);
+                    }
+                    return token_t();
+                }
+
+                auto byte = static_cast<uint8_t>(utils::from_hex(str[i]) << 4);
+                if (i + 1 < str.size() && str[i + 1] == '?') {
                     i++;
+                    return token_t(byte, 0xF0);
                 }
-                if (i + 1 < S.size() && S[i + 1] == '&') {
-                    i += 3;
+                if (i + 1 < str.size()) {
+                    byte |= utils::from_hex(str[++i]);
                 }
-                if (S[i] != '?' && S[i] != '^') {
+
+                // check for masked byte
+                if (i + 1 < str.size() && str[i + 1] == '&') {
                     i++;
+                    return token_t(byte, read_hex(i));
                 }
-            }
-            return size;
-        }
+                return token_t(byte);
+            };
+
+            // `(A|B|...)` at position `i`, `i` is moved to the closing parenthesis
+            auto read_alternatives = [str, read_byte](size_t& i) {
+                auto skip_spaces = [str](size_t& i) {
+                    while (++i < str.size() && str[i] == ' ') {}
+                    if (i >= str.size()) {
+                        throw std::invalid_argument("Unclosed alternative in pattern");
+                    }
+                };
+
+                std::array<bool, 256> set{};
+                while (true) {
+                    skip_spaces(i);
+                    if (str[i] != '?' && !utils::is_hex(str[i])) {
+                        throw std::invalid_argument("Expected a byte in pattern alternative");
+                    }
+                    token_t token = read_byte(i);
+                    for (unsigned value = 0; value < 256; value++) {
+                        set[value] = set[value] || token.matches(static_cast<uint8_t>(value));
+                    }
+
+                    skip_spaces(i);
+                    if (str[i] == ')') break;
+                    if (str[i] != '|') {
+                        throw std::invalid_argument("Expected '|' or ')' in pattern alternative");
+                    }
+                }
+                return alternative_token(set);
+            };
+
+            // `[min-max]` or `[count]` at position `i`, `i` is moved to the closing bracket
+            auto read_gap = [str](size_t& i) {
+                auto read_decimal = [str](size_t& i) {
+                    if (i + 1 >= str.size() || str[i + 1] < '0' || str[i + 1] > '9') {
+                        throw std::invalid_argument("Expected a number in pattern gap");
+                    }
+                    unsigned value = 0;
+                    while (i + 1 < str.size() && str[i + 1] >= '0' && str[i + 1] <= '9') {
+                        value = value * 10 + static_cast<unsigned>(str[++i] - '0');
+                        if (value > 255) {
+                            throw std::invalid_argument("Pattern gaps can't be longer than 255 bytes");
+                        }
+                    }
+                    return static_cast<uint8_t>(value);
+                };
 
-        template <utils::FixedString S, size_t N = sizeOfPatternString<S>()>
-        consteval std::array<token_t, N> tokenizePatternString() {
-            std::array<token_t, N> tokens;
+                uint8_t min = read_decimal(i);
+                uint8_t max = min;
+                if (i + 1 < str.size() && str[i + 1] == '-') {
+                    i++;
+                    max = read_decimal(i);
+                }
+                if (i + 1 >= str.size() || str[i + 1] != ']') {
+                    throw std::invalid_argument("Unclosed gap in pattern");
+                }
+                i++;
+                if (min > max) {
+                    throw std::invalid_argument("The minimum of a pattern gap can't be larger than its maximum");
+                }
+                return token_t(token_t::type_t::gap, min, max);
+            };
 
-            size_t index = 0;
-            for (size_t i = 0; i < S.size(); i++) {
-                switch (S[i]) {
+            bool sized = false; // whether a token that takes space was emitted
+            for (size_t i = 0; i < str.size(); i++) {
+                switch (str[i]) {
                     case ' ': continue;
-                    case '?': tokens[index++] = token_t(); break;
-                    case '^': tokens[index++] = token_t(token_t::type_t::cursor); break;
-                    default: {
-                        uint8_t byte = utils::from_hex(S[i]) << 4 | utils::from_hex(S[i + 1]);
-                        tokens[index++] = token_t(byte);
-                        i++;
-
-                        // check for masked byte
-                        if (i + 1 < S.size() && S[i + 1] == '&') {
-                            uint8_t mask = utils::from_hex(S[i + 2]) << 4 | utils::from_hex(S[i + 3]);
-                            tokens[index - 1] = token_t(byte, mask);
-                            i += 3;
+                    case '[':
+                        if (!sized) {
+                            throw std::invalid_argument("A pattern can't start with a gap");
+                        }
+                        emit(read_gap(i));
+                        break;
+                    case '^': emit(token_t(token_t::type_t::cursor)); break;
+                    case '(': emit(read_alternatives(i)); sized = true; break;
+                    case '@': {
+                        uint8_t offset = read_hex(i);
+                        uint8_t extra = 0;
+                        if (i + 1 < str.size() && str[i + 1] == '+') {
+                            i++;
+                            extra = read_hex(i);
                         }
+                        emit(token_t(token_t::type_t::follow, offset, extra));
                     } break;
+                    default: emit(read_byte(i)); sized = true; break;
                 }
             }
+        }
+
+        template <utils::FixedString S>
+        consteval size_t sizeOfPatternString() {
+            size_t size = 0;
+            parsePatternString(S, [&size](token_t) { size++; });
+            return size;
+        }
 
+        template <utils::FixedString S, size_t N = sizeOfPatternString<S>()>
+        consteval std::array<token_t, N> tokenizePatternString() {
+            std::array<token_t, N> tokens;
+            size_t index = 0;
+            parsePatternString(S, [&](token_t token) { tokens[index++] = token; });
             return tokens;
         }
 
         constexpr std::vector<token_t> tokenizePatternStringRuntime(std::string_view str) {
             std::vector<token_t> tokens;
             tokens.reserve(str.size() / 2);
-
-            for (size_t i = 0; i < str.size(); i++) {
-                switch (str[i]) {
-                    case ' ': continue;
-                    case '?': tokens.emplace_back(); break;
-                    case '^': tokens.emplace_back(token_t::type_t::cursor); break;
-                    default: {
-                        uint8_t byte = utils::from_hex(str[i]) << 4 | utils::from_hex(str[i + 1]);
-                        tokens.emplace_back(byte);
-                        i++;
-
-                        // check for masked byte
-                        if (i + 1 < str.size() && str[i + 1] == '&') {
-                            uint8_t mask = utils::from_hex(str[i + 2]) << 4 | utils::from_hex(str[i + 3]);
-                            tokens.back() = token_t(byte, mask);
-                            i += 3;
-                        }
-                    } break;
-                }
-            }
-
+            parsePatternString(str, [&tokens](token_t token) { tokens.push_back(token); });
             return tokens;
         }
 
@@ -244,10 +534,16 @@ namespace sinaps {
         consteval auto unwrapToken() {
             if constexpr (Token.type == token_t::type_t::cursor) {
                 return mask::cursor{};
+            } else if constexpr (Token.type == token_t::type_t::follow) {
+                return mask::follow<Token.byte, Token.mask>{};
             } else if constexpr (Token.type == token_t::type_t::byte) {
                 return mask::byte<Token.byte>{};
             } else if constexpr (Token.type == token_t::type_t::masked) {
                 return mask::masked<Token.byte, Token.mask>{};
+            } else if constexpr (Token.type == token_t::type_t::either) {
+                return mask::either<Token.byte, Token.mask>{};
+            } else if constexpr (Token.type == token_t::type_t::gap) {
+                return mask::gap<Token.byte, Token.mask>{};
             } else {
                 return mask::any{};
             }
@@ -274,14 +570,46 @@ namespace sinaps {
             case token_t::type_t::byte: return utils::hex_to_string(token.byte);
             case token_t::type_t::wildcard: return "?";
             case token_t::type_t::cursor: return "^";
+            case token_t::type_t::follow: {
+                std::string str = "@";
+                if (token.byte) {
+                    str += utils::hex_to_string(token.byte);
+                }
+                if (token.mask) {
+                    str += '+';
+                    str += utils::hex_to_string(token.mask);
+                }
+                return str;
+            }
             case token_t::type_t::masked: {
+                auto hex = utils::hex_to_string(token.byte);
+                if (impl::is_nibble(token)) {
+                    return token.mask == 0xF0 ? std::string{hex[0], '?'} : std::string{'?', hex[1]};
+                }
                 std::string str;
                 str.reserve(6);
-                str += utils::hex_to_string(token.byte);
+                str += hex;
                 str += '&';
                 str += utils::hex_to_string(token.mask);
                 return str;
             } break;
+            case token_t::type_t::gap: {
+                std::string str = "[" + std::to_string(token.byte);
+                if (token.byte != token.mask) {
+                    str += '-';
+                    str += std::to_string(token.mask);
+                }
+                str += ']';
+                return str;
+            }
+            case token_t::type_t::either: {
+                std::string str = "(";
+                str += utils::hex_to_string(token.byte);
+                str += '|';
+                str += utils::hex_to_string(token.mask);
+                str += ')';
+                return str;
+            }
             default: return "";
         }
     }
@@ -301,10 +629,11 @@ namespace sinaps {
                 case token_t::type_t::cursor:
                     str += "^ ";
                     break;
+                case token_t::type_t::follow:
                 case token_t::type_t::masked:
-                    str += utils::hex_to_string(token.byte);
-                    str += '&';
-                    str += utils::hex_to_string(token.mask);
+                case token_t::type_t::either:
+                case token_t::type_t::gap:
+                    str += to_string(token);
                     str += ' ';
                     break;
                 default: break;
@@ -0,0 +1,388 @@
+#pragma once
+#ifndef SINAPS_PROCESS_HPP
+#define SINAPS_PROCESS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <cstdio>
+    #include <sys/types.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+#include "batch.hpp"
+#include "compiled_pattern.hpp"
+#include "compiled_pattern_set.hpp"
+#include "find.hpp"
+#include "pattern.hpp"
+#include "stream.hpp"
+
+namespace sinaps {
+    /// @brief Committed, readable memory region of a process.
+    struct memory_region {
+        uintptr_t base = 0;
+        size_t size = 0;
+        bool executable = false;
+        bool writable = false;
+    };
+
+    /// @brief Options for the process scan.
+    struct process_scan_options {
+        size_t buffer_size = 1 << 20; // size of a single read, larger reads mean fewer syscalls
+        bool code_only = false;       // only scan executable regions
+    };
+
+    /// @brief Scanner for the memory of another process (or the current one).
+    /// Readable regions are enumerated once (<c>VirtualQueryEx</c> / <c>/proc/pid/maps</c>), then copied in large
+    /// reads into a buffer that is reused for every scan. Guard and unreadable pages are never touched, and pages
+    /// that become unreadable while scanning are skipped. Results are addresses in the target process.
+    class process_scanner {
+    public:
+#if defined(_WIN32)
+        using native_handle_t = HANDLE; // needs PROCESS_QUERY_INFORMATION and PROCESS_VM_READ
+#else
+        using native_handle_t = pid_t;
+#endif
+
+        /// @param process The target process.
+        /// @param options Read size and region filter.
+        explicit process_scanner(native_handle_t process, process_scan_options options = {})
+            : m_process(process), m_options(options) {
+            m_options.buffer_size = std::max<size_t>(m_options.buffer_size, page_size());
+            refresh();
+        }
+
+        /// @brief Enumerate the regions again (e.g. after the target allocated memory).
+        void refresh() {
+            m_regions.clear();
+            m_readable.clear();
+#if defined(_WIN32)
+            constexpr DWORD executable = PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+            constexpr DWORD readable = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY |
+                                       PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+            constexpr DWORD writable = PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+
+            MEMORY_BASIC_INFORMATION info;
+            uintptr_t address = 0;
+            while (VirtualQueryEx(m_process, reinterpret_cast<void const*>(address), &info, sizeof(info)) == sizeof(info)) {
+                uintptr_t base = reinterpret_cast<uintptr_t>(info.BaseAddress);
+                if (info.State == MEM_COMMIT && (info.Protect & readable) && !(info.Protect & (PAGE_GUARD | PAGE_NOACCESS))) {
+                    add_region(memory_region{base, info.RegionSize, (info.Protect & executable) != 0, (info.Protect & writable) != 0});
+                }
+                if (base + info.RegionSize <= address) break;
+                address = base + info.RegionSize;
+            }
+#else
+            char path[64];
+            std::snprintf(path, sizeof(path), "/proc/%d/maps", static_cast<int>(m_process));
+            FILE* maps = std::fopen(path, "r");
+            if (!maps) {
+                return;
+            }
+
+            char line[512];
+            while (std::fgets(line, sizeof(line), maps)) {
+                unsigned long long begin = 0, end = 0;
+                char perms[5] = {};
+                if (std::sscanf(line, "%llx-%llx %4s", &begin, &end, perms) != 3) {
+                    continue;
+                }
+                // [vvar] is readable but can't be copied
+                if (perms[0] == 'r' && !std::strstr(line, "[vvar")) {
+                    add_region(memory_region{static_cast<uintptr_t>(begin), static_cast<size_t>(end - begin), perms[2] == 'x', perms[1] == 'w'});
+                }
+                if (!std::strchr(line, '\n')) {
+                    // skip the rest of a long line
+                    int c;
+                    while ((c = std::fgetc(maps)) != '\n' && c != EOF) {}
+                }
+            }
+            std::fclose(maps);
+#endif
+        }
+
+        /// @brief Regions that are scanned, in address order.
+        [[nodiscard]] std::span<memory_region const> regions() const { return m_regions; }
+
+        /// @brief Copy memory from the target process.
+        /// @return Amount of bytes copied, reads stop at the first unreadable page.
+        size_t read(uintptr_t address, uint8_t* out, size_t size) const {
+#if defined(_WIN32)
+            SIZE_T done = 0;
+            if (!ReadProcessMemory(m_process, reinterpret_cast<void const*>(address), out, size, &done) &&
+                GetLastError() != ERROR_PARTIAL_COPY) {
+                return 0;
+            }
+            return static_cast<size_t>(done);
+#else
+            iovec local{out, size};
+            iovec remote{reinterpret_cast<void*>(address), size};
+            ssize_t done = process_vm_readv(m_process, &local, 1, &remote, 1, 0);
+            return done < 0 ? 0 : static_cast<size_t>(done);
+#endif
+        }
+
+        /// @brief Find a pattern in the memory of the process.
+        /// Follow tokens are resolved by reading the process, so targets can be in any region.
+        /// @return The address of the first match (including the cursor offset), or <b>sinaps::not_found</b>.
+        template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+        intptr_t find() {
+            if constexpr (Pattern::has_gap) {
+                return find_blocks(Pattern::size, Pattern::max_size, [](uint8_t const* data, size_t size, size_t end, auto const& memory) {
+                    return impl::find_range<Pattern>(data, size, 0, end, 1, memory);
+                });
+            } else {
+                return find_stream(stream_scanner<Pattern>(), Pattern::follows);
+            }
+        }
+
+        /// @brief Find a compiled pattern in the memory of the process.
+        /// @return The address of the first match (including the cursor offset), or <b>sinaps::not_found</b>.
+        intptr_t find(compiled_pattern const& pattern) {
+            if (pattern.has_gap()) {
+                return find_blocks(pattern.size(), pattern.max_size(), [&pattern](uint8_t const* data, size_t size, size_t end, auto const& memory) {
+                    return impl::find_compiled_range(data, size, 0, end, pattern, 1, memory);
+                });
+            }
+            return find_stream(make_stream_scanner(pattern), pattern.has_follow() ? pattern.tokens() : std::span<token_t const>());
+        }
+
+        /// @brief Find multiple patterns in the memory of the process, reading it only once.
+        /// Follow tokens are resolved inside the block that was read (<c>buffer_size</c> bytes), use <c>find</c>
+        /// for patterns whose targets are further away. Blocks overlap by the largest match size, so gaps are supported,
+        /// and each match is only checked in the block it starts in before the overlap (see <c>find_blocks</c>).
+        /// @return The address of each pattern, or <b>sinaps::not_found</b> if not found.
+        template <typename... Patterns> requires (sizeof...(Patterns) > 0 && (utils::is_specialization<Patterns, pattern>::value && ...))
+        std::array<intptr_t, sizeof...(Patterns)> find_all() {
+            std::array<intptr_t, sizeof...(Patterns)> results;
+            results.fill(not_found);
+            constexpr size_t overlap = std::max({Patterns::max_size...}) - 1;
+            scan_blocks(overlap, [&](uintptr_t address, uint8_t const* data, size_t size, bool more) {
+                auto found = pattern_set<Patterns...>::find_all(data, size, block_limit(size, overlap, more));
+                return merge_results(results, found, address);
+            });
+            return results;
+        }
+
+        /// @brief Find multiple compiled patterns in the memory of the process, reading it only once.
+        /// The patterns must outlive the call.
+        /// @return The address of each pattern, or <b>sinaps::not_found</b> if not found.
+        std::vector<intptr_t> find_all(std::span<compiled_pattern const> patterns) {
+            std::vector<intptr_t> results(patterns.size(), not_found);
+            size_t overlap = 0;
+            for (auto const& pattern : patterns) {
+                overlap = std::max(overlap, pattern.max_size() ? pattern.max_size() - 1 : 0);
+            }
+            scan_blocks(overlap, [&](uintptr_t address, uint8_t const* data, size_t size, bool more) {
+                auto found = impl::find_all_compiled(data, size, block_limit(size, overlap, more), patterns);
+                return merge_results(results, found, address);
+            });
+            return results;
+        }
+
+        /// @brief Find every pattern of a set in the memory of the process, reading it only once.
+        /// @return The address of each pattern, or <b>sinaps::not_found</b> if not found.
+        std::vector<intptr_t> find_all(compiled_pattern_set const& set) {
+            std::vector<intptr_t> results(set.size(), not_found);
+            size_t overlap = set.max_size() ? set.max_size() - 1 : 0;
+            scan_blocks(overlap, [&](uintptr_t address, uint8_t const* data, size_t size, bool more) {
+                auto found = impl::find_all_set(data, size, block_limit(size, overlap, more), set.view());
+                return merge_results(results, found, address);
+            });
+            return results;
+        }
+
+    private:
+        static size_t page_size() {
+#if defined(_WIN32)
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return static_cast<size_t>(info.dwPageSize);
+#else
+            return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+        }
+
+        /// @brief Append a region to a list in address order, merging it with its neighbour.
+        static void push_region(std::vector<memory_region>& regions, memory_region region) {
+            // merge neighbours, so matches that straddle them are found
+            if (!regions.empty() && regions.back().base + regions.back().size == region.base) {
+                regions.back().size += region.size;
+                regions.back().executable |= region.executable;
+                regions.back().writable |= region.writable;
+                return;
+            }
+            regions.push_back(region);
+        }
+
+        void add_region(memory_region region) {
+            // follow targets can point anywhere (e.g. rip-relative loads from data), so the filter only applies to the scan
+            push_region(m_readable, region);
+            if (m_options.code_only && !region.executable) {
+                return;
+            }
+            push_region(m_regions, region);
+        }
+
+        /// @brief Read every region in blocks, calls <c>on_block(address, data, size, more)</c> for each one.
+        /// Each block starts with the last <c>overlap</c> bytes of the previous one (within the same contiguous range),
+        /// so matches that straddle two reads are found. <c>more</c> tells whether the next block continues this one.
+        /// The scan stops once <c>on_block</c> returns <c>false</c>.
+        template <typename Callback>
+        void scan_blocks(size_t overlap, Callback&& on_block) {
+            size_t page = page_size();
+            m_buffer.resize(m_options.buffer_size + overlap);
+
+            for (auto const& region : m_regions) {
+                size_t carry = 0;
+                for (size_t offset = 0; offset < region.size;) {
+                    size_t want = std::min(m_options.buffer_size, region.size - offset);
+                    size_t got = read(region.base + offset, m_buffer.data() + carry, want);
+                    bool more = got == want && offset + got < region.size;
+                    if (got > 0 && !on_block(region.base + offset - carry, m_buffer.data(), carry + got, more)) {
+                        return;
+                    }
+
+                    if (got < want) {
+                        // unreadable page, skip it and drop the carry
+                        offset = (offset + got + page) / page * page;
+                        carry = 0;
+                        continue;
+                    }
+
+                    offset += got;
+                    size_t keep = std::min(overlap, carry + got);
+                    std::memmove(m_buffer.data(), m_buffer.data() + carry + got - keep, keep);
+                    carry = keep;
+                }
+            }
+        }
+
+        /// @brief Memory of the process, used to resolve follow tokens. Positions are addresses, and any readable
+        /// region counts (not only the scanned ones), as in <c>find(module)</c>.
+        struct remote_memory {
+            process_scanner const* scanner;
+
+            [[nodiscard]] bool readable(intptr_t pos) const {
+                auto address = static_cast<uintptr_t>(pos);
+                auto const& regions = scanner->m_readable;
+                auto it = std::upper_bound(
+                    regions.begin(), regions.end(), address,
+                    [](uintptr_t value, memory_region const& region) { return value < region.base; }
+                );
+                return it != regions.begin() && address - std::prev(it)->base < std::prev(it)->size;
+            }
+
+            bool load32(intptr_t pos, int32_t& value) const {
+                uint8_t bytes[4];
+                return scanner->read(static_cast<uintptr_t>(pos), bytes, 4) == 4 && impl::buffer_memory{bytes, 4}.load32(0, value);
+            }
+        };
+
+        /// @brief Memory of the process seen from a block, positions are relative to the block address.
+        struct block_memory {
+            remote_memory remote;
+            intptr_t address;
+
+            [[nodiscard]] bool readable(intptr_t pos) const { return remote.readable(address + pos); }
+            bool load32(intptr_t pos, int32_t& value) const { return remote.load32(address + pos, value); }
+        };
+
+        /// @brief End of the match starts a block is responsible for, the starts in the overlap are left to the next block.
+        static size_t block_limit(size_t size, size_t overlap, bool more) {
+            if (!more) {
+                return size;
+            }
+            return size > overlap ? size - overlap : 0;
+        }
+
+        /// @brief Single pattern scan over blocks, for patterns with gaps (which can't be streamed).
+        /// The heads that start in the last <c>max_size - 1</c> bytes of a block are left to the next one,
+        /// so every match is checked against a block it fits in, and the first one is reported.
+        /// @param find_block Callable that accepts a block, its size, the end of the heads to check (see
+        /// <c>impl::find_range</c>) and a memory, and returns the index of the first match in the block.
+        template <typename Find>
+        intptr_t find_blocks(size_t head_size, size_t max_size, Find&& find_block) {
+            size_t overlap = max_size - 1;
+            intptr_t res = not_found;
+            scan_blocks(overlap, [&](uintptr_t address, uint8_t const* data, size_t size, bool more) {
+                size_t end = impl::head_end(size, block_limit(size, overlap, more), head_size);
+                intptr_t found = find_block(data, size, end, block_memory{remote_memory{this}, static_cast<intptr_t>(address)});
+                if (found != not_found) {
+                    res = static_cast<intptr_t>(address) + found;
+                }
+                return res == not_found;
+            });
+            return res;
+        }
+
+        /// @brief Single pattern scan, feeds the blocks into a stream scanner.
+        /// @param follows Follow tokens of the pattern (other tokens are skipped), resolved on every match until one succeeds.
+        template <typename Scanner>
+        intptr_t find_stream(Scanner scanner, std::span<token_t const> follows) {
+            size_t page = page_size();
+            m_buffer.resize(m_options.buffer_size);
+
+            for (auto const& region : m_regions) {
+                scanner.reset(region.base);
+                for (size_t offset = 0; offset < region.size;) {
+                    size_t want = std::min(m_options.buffer_size, region.size - offset);
+                    size_t got = read(region.base + offset, m_buffer.data(), want);
+                    intptr_t res = not_found;
+                    scanner.feed(m_buffer.data(), got, [&](intptr_t address) {
+                        res = follows.empty() ? address : impl::resolve_follows(address, follows, remote_memory{this});
+                        return res == not_found;
+                    });
+                    if (res != not_found) {
+                        return res;
+                    }
+
+                    offset += got;
+                    if (got < want) {
+                        offset = (offset + page) / page * page;
+                        scanner.reset(region.base + offset);
+                    }
+                }
+            }
+            return not_found;
+        }
+
+        /// @brief Record the first match of each pattern not found yet.
+        /// @return Whether some patterns are still missing.
+        template <typename Results, typename Found>
+        static bool merge_results(Results& results, Found const& found, uintptr_t address) {
+            bool missing = false;
+            for (size_t k = 0; k < results.size(); k++) {
+                if (results[k] == not_found && found[k] != not_found) {
+                    results[k] = static_cast<intptr_t>(address) + found[k];
+                }
+                missing |= results[k] == not_found;
+            }
+            return missing;
+        }
+
+        native_handle_t m_process;
+        process_scan_options m_options;
+        std::vector<memory_region> m_regions;  // scanned regions
+        std::vector<memory_region> m_readable; // every readable region, for follow targets
+        std::vector<uint8_t> m_buffer;
+    };
+}
+
+#endif // SINAPS_PROCESS_HPP
@@ -0,0 +1,106 @@
+#pragma once
+#ifndef SINAPS_REVERSE_HPP
+#define SINAPS_REVERSE_HPP
+
+#include <algorithm>
+#include <cstdint>
+
+#include "compiled_pattern.hpp"
+#include "find.hpp"
+#include "matches.hpp"
+#include "pattern.hpp"
+
+namespace sinaps {
+    namespace impl {
+        /// @brief Start of the last match that starts in <c>[begin, end)</c> and resolves, or <b>sinaps::not_found</b>.
+        /// The range is scanned from <c>end</c> down, so only the part after the match is touched.
+        template <typename Scanner>
+        constexpr intptr_t find_last_start(uint8_t const* data, size_t size, size_t begin, size_t end, Scanner const& scanner) {
+            for (size_t to = end; to > begin;) {
+                intptr_t res = scanner.prev(data + begin, to - begin + scanner.size() - 1);
+                if (res == not_found) break;
+                size_t start = begin + static_cast<size_t>(res);
+                if (scanner.resolve(data, size, start) != not_found) {
+                    return static_cast<intptr_t>(start);
+                }
+                to = start;
+            }
+            return not_found;
+        }
+
+        /// @brief Find the last match whose cursor is in <c>[first, last]</c>, scanning backwards from <c>last</c>.
+        /// @return The index of the match (see <c>resolve</c>), or <b>sinaps::not_found</b>.
+        template <typename Scanner>
+        constexpr intptr_t find_reverse(uint8_t const* data, size_t size, Scanner const& scanner, intptr_t first, intptr_t last) {
+            size_t pattern_size = scanner.size();
+            intptr_t cursor = scanner.result(0);
+            if (size < pattern_size || last < cursor) {
+                return not_found;
+            }
+
+            // range of match starts, the last possible start leaves room for the pattern
+            size_t count = size - pattern_size + 1;
+            size_t begin = static_cast<size_t>(std::max<intptr_t>(first - cursor, 0));
+            size_t end = std::min(static_cast<size_t>(last - cursor) + 1, count);
+            if (begin >= end) {
+                return not_found;
+            }
+
+            auto res = find_last_start(data, size, begin, end, scanner);
+            if (res == not_found) {
+                return not_found;
+            }
+            SINAPS_STATS_ADD(matches, 1);
+            return scanner.resolve(data, size, static_cast<size_t>(res));
+        }
+    }
+
+    /// @brief Find the last index of a pattern in a data buffer, scanning from the end.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @return The index of the last occurrence of the pattern, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr intptr_t find_reverse(uint8_t const* data, size_t size) {
+        return impl::find_reverse(data, size, impl::pattern_scanner<Pattern>{}, 0, static_cast<intptr_t>(size));
+    }
+
+    /// @brief Find the last index of a compiled pattern in a data buffer, scanning from the end.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @return The index of the last occurrence of the pattern, or <b>sinaps::not_found</b> if not found.
+    constexpr intptr_t find_reverse(uint8_t const* data, size_t size, compiled_pattern const& pattern) {
+        return impl::find_reverse(data, size, impl::compiled_scanner{&pattern}, 0, static_cast<intptr_t>(size));
+    }
+
+    /// @brief Find the nearest occurrence of a pattern at or before a position, e.g. the prologue of the function
+    /// that contains a known address. The scan moves backwards from <c>from</c>, so it stops as soon as it meets
+    /// the pattern instead of scanning the whole buffer forward.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param from The last index (including the cursor offset) the pattern may be reported at. For patterns with
+    /// follow tokens, the distance is measured to the cursor of the match, not to the target.
+    /// @param max_distance Amount of bytes before <c>from</c> that are searched.
+    /// @return The index of the nearest occurrence, or <b>sinaps::not_found</b> if there's none in the window.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr intptr_t find_backward_from(uint8_t const* data, size_t size, intptr_t from, size_t max_distance) {
+        return impl::find_reverse(
+            data, size, impl::pattern_scanner<Pattern>{}, from - static_cast<intptr_t>(std::min(max_distance, size)), from
+        );
+    }
+
+    /// @brief Find the nearest occurrence of a compiled pattern at or before a position (see <c>sinaps::find_backward_from</c>).
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param from The last index (including the cursor offset) the pattern may be reported at.
+    /// @param max_distance Amount of bytes before <c>from</c> that are searched.
+    /// @return The index of the nearest occurrence, or <b>sinaps::not_found</b> if there's none in the window.
+    constexpr intptr_t find_backward_from(uint8_t const* data, size_t size, compiled_pattern const& pattern, intptr_t from, size_t max_distance) {
+        return impl::find_reverse(
+            data, size, impl::compiled_scanner{&pattern}, from - static_cast<intptr_t>(std::min(max_distance, size)), from
+        );
+    }
+}
+
+#endif // SINAPS_REVERSE_HPP
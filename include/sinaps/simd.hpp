@@ -0,0 +1,313 @@
+#pragma once
+#ifndef SINAPS_SIMD_HPP
+#define SINAPS_SIMD_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifndef SINAPS_NO_SIMD
+    #if defined(__AVX2__)
+        #define SINAPS_SIMD_AVX2
+        #include <immintrin.h>
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define SINAPS_SIMD_SSE2
+        #include <emmintrin.h>
+    #elif defined(__ARM_NEON) || defined(_M_ARM64)
+        #define SINAPS_SIMD_NEON
+        #include <arm_neon.h>
+    #endif
+
+    // wider x86 kernels are compiled with target attributes, and picked at runtime from cpuid
+    #if !defined(SINAPS_NO_DISPATCH) && (defined(SINAPS_SIMD_SSE2) || defined(SINAPS_SIMD_AVX2)) && \
+        (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+        #define SINAPS_SIMD_DISPATCH
+        #include <immintrin.h>
+        #if defined(_MSC_VER) && !defined(__clang__)
+            #include <intrin.h>
+        #else
+            #include <cpuid.h>
+        #endif
+    #endif
+#endif
+
+#if defined(SINAPS_SIMD_DISPATCH) && (defined(__GNUC__) || defined(__clang__))
+    #define SINAPS_TARGET(isa) [[gnu::target(isa)]]
+    #define SINAPS_TARGET_FLATTEN(isa) [[gnu::target(isa), gnu::flatten]]
+#else
+    #define SINAPS_TARGET(isa)
+    #define SINAPS_TARGET_FLATTEN(isa)
+#endif
+
+#if defined(SINAPS_SIMD_AVX2)
+    #define SINAPS_TARGET_AVX2
+#else
+    #define SINAPS_TARGET_AVX2 SINAPS_TARGET("avx2")
+#endif
+
+namespace sinaps::simd {
+    // Every kernel exposes the same interface:
+    // - width: amount of positions compared at once
+    // - lane_bits: amount of bits each position occupies in the returned mask
+    // - match(a, b0, b, b1): bitmask of positions `i` in [0, width) where `a[i] == b0 && b[i] == b1`
+    //
+    // Kernels that can verify a whole window of `width` bytes also expose:
+    // - vector_t: register type
+    // - masked_diff(data, mask, bytes): non-zero lanes where `(data & mask) != bytes`
+    // - merge(a, b): combines two results of `masked_diff`
+    // - none(a): whether all lanes are zero
+
+    /// @brief Word kernel, verifies <c>sizeof(T)</c> bytes at once using general purpose registers.
+    template <typename T>
+    struct word {
+        static constexpr size_t width = sizeof(T);
+        using vector_t = T;
+
+        static vector_t masked_diff(uint8_t const* data, uint8_t const* mask, uint8_t const* bytes) {
+            T d, m, b;
+            std::memcpy(&d, data, sizeof(T));
+            std::memcpy(&m, mask, sizeof(T));
+            std::memcpy(&b, bytes, sizeof(T));
+            return static_cast<T>((d & m) ^ b);
+        }
+
+        static vector_t merge(vector_t a, vector_t b) { return a | b; }
+        static bool none(vector_t a) { return a == 0; }
+    };
+
+    /// @brief Fallback kernel, compares one position at a time.
+    struct scalar {
+        static constexpr size_t width = 1;
+        static constexpr size_t lane_bits = 1;
+        using mask_t = uint32_t;
+
+        static mask_t match(uint8_t const* a, uint8_t b0, uint8_t const* b, uint8_t b1) {
+            return a[0] == b0 && b[0] == b1;
+        }
+    };
+
+#if defined(SINAPS_SIMD_SSE2) || defined(SINAPS_SIMD_AVX2)
+    /// @brief SSE2 kernel, compares 16 positions at once.
+    struct sse2 {
+        static constexpr size_t width = 16;
+        static constexpr size_t lane_bits = 1;
+        using mask_t = uint32_t;
+
+        static mask_t match(uint8_t const* a, uint8_t b0, uint8_t const* b, uint8_t b1) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b));
+            __m128i eq = _mm_and_si128(
+                _mm_cmpeq_epi8(va, _mm_set1_epi8(static_cast<char>(b0))),
+                _mm_cmpeq_epi8(vb, _mm_set1_epi8(static_cast<char>(b1)))
+            );
+            return static_cast<mask_t>(_mm_movemask_epi8(eq));
+        }
+
+        using vector_t = __m128i;
+
+        static vector_t masked_diff(uint8_t const* data, uint8_t const* mask, uint8_t const* bytes) {
+            __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data));
+            __m128i m = _mm_load_si128(reinterpret_cast<__m128i const*>(mask));
+            __m128i b = _mm_load_si128(reinterpret_cast<__m128i const*>(bytes));
+            return _mm_xor_si128(_mm_and_si128(d, m), b);
+        }
+
+        static vector_t merge(vector_t a, vector_t b) { return _mm_or_si128(a, b); }
+        static bool none(vector_t a) { return _mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_setzero_si128())) == 0xFFFF; }
+    };
+#endif
+
+#if defined(SINAPS_SIMD_AVX2) || defined(SINAPS_SIMD_DISPATCH)
+    /// @brief AVX2 kernel, compares 32 positions at once.
+    /// Without <c>-mavx2</c> it's compiled for AVX2 on its own, and only used if the CPU has it (see <c>dispatch_level</c>).
+    struct avx2 {
+        static constexpr size_t width = 32;
+        static constexpr size_t lane_bits = 1;
+        using mask_t = uint32_t;
+
+        SINAPS_TARGET_AVX2 static mask_t match(uint8_t const* a, uint8_t b0, uint8_t const* b, uint8_t b1) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b));
+            __m256i eq = _mm256_and_si256(
+                _mm256_cmpeq_epi8(va, _mm256_set1_epi8(static_cast<char>(b0))),
+                _mm256_cmpeq_epi8(vb, _mm256_set1_epi8(static_cast<char>(b1)))
+            );
+            return static_cast<mask_t>(_mm256_movemask_epi8(eq));
+        }
+
+        using vector_t = __m256i;
+
+        SINAPS_TARGET_AVX2 static vector_t masked_diff(uint8_t const* data, uint8_t const* mask, uint8_t const* bytes) {
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data));
+            __m256i m = _mm256_load_si256(reinterpret_cast<__m256i const*>(mask));
+            __m256i b = _mm256_load_si256(reinterpret_cast<__m256i const*>(bytes));
+            return _mm256_xor_si256(_mm256_and_si256(d, m), b);
+        }
+
+        SINAPS_TARGET_AVX2 static vector_t merge(vector_t a, vector_t b) { return _mm256_or_si256(a, b); }
+        SINAPS_TARGET_AVX2 static bool none(vector_t a) { return _mm256_testz_si256(a, a) != 0; }
+    };
+#endif
+
+#if defined(SINAPS_SIMD_DISPATCH)
+    /// @brief AVX-512 kernel, compares 64 positions at once. Only used for the anchor scan, and only if the CPU has
+    /// AVX-512BW (see <c>dispatch_level</c>).
+    struct avx512 {
+        static constexpr size_t width = 64;
+        static constexpr size_t lane_bits = 1;
+        using mask_t = uint64_t;
+
+        SINAPS_TARGET("avx512f,avx512bw") static mask_t match(uint8_t const* a, uint8_t b0, uint8_t const* b, uint8_t b1) {
+            __m512i va = _mm512_loadu_si512(a);
+            __m512i vb = _mm512_loadu_si512(b);
+            return _mm512_cmpeq_epi8_mask(va, _mm512_set1_epi8(static_cast<char>(b0))) &
+                   _mm512_cmpeq_epi8_mask(vb, _mm512_set1_epi8(static_cast<char>(b1)));
+        }
+    };
+#endif
+
+#if defined(SINAPS_SIMD_NEON)
+    /// @brief NEON kernel, compares 16 positions at once.
+    /// NEON has no movemask, so each position occupies a nibble of the mask.
+    struct neon {
+        static constexpr size_t width = 16;
+        static constexpr size_t lane_bits = 4;
+        using mask_t = uint64_t;
+
+        static mask_t match(uint8_t const* a, uint8_t b0, uint8_t const* b, uint8_t b1) {
+            uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(a), vdupq_n_u8(b0)), vceqq_u8(vld1q_u8(b), vdupq_n_u8(b1)));
+            uint8x8_t packed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+            return vget_lane_u64(vreinterpret_u64_u8(packed), 0);
+        }
+
+        using vector_t = uint8x16_t;
+
+        static vector_t masked_diff(uint8_t const* data, uint8_t const* mask, uint8_t const* bytes) {
+            return veorq_u8(vandq_u8(vld1q_u8(data), vld1q_u8(mask)), vld1q_u8(bytes));
+        }
+
+        static vector_t merge(vector_t a, vector_t b) { return vorrq_u8(a, b); }
+        static bool none(vector_t a) {
+            return vget_lane_u64(vreinterpret_u64_u8(vorr_u8(vget_low_u8(a), vget_high_u8(a))), 0) == 0;
+        }
+    };
+#endif
+
+    /// @brief Kernel selected at compile time, based on the target instruction set.
+#if defined(SINAPS_SIMD_AVX2)
+    using native = avx2;
+#elif defined(SINAPS_SIMD_SSE2)
+    using native = sse2;
+#elif defined(SINAPS_SIMD_NEON)
+    using native = neon;
+#else
+    using native = scalar;
+#endif
+
+    /// @brief Instruction set tiers, for the kernels picked at runtime.
+    enum class level_t : uint8_t {
+        scalar,
+        sse2,   // 16-byte vectors (SSE2, or NEON)
+        avx2,   // 32-byte vectors
+        avx512  // 64-byte vectors (AVX-512BW)
+    };
+
+    /// @brief Tier of the kernel selected at compile time.
+    constexpr level_t native_level =
+#if defined(SINAPS_SIMD_AVX2)
+        level_t::avx2;
+#elif defined(SINAPS_SIMD_SSE2) || defined(SINAPS_SIMD_NEON)
+        level_t::sse2;
+#else
+        level_t::scalar;
+#endif
+
+    namespace impl {
+        /// @brief Highest tier supported by both the CPU and the OS (which must save the wide registers).
+        inline level_t detect_level() {
+#if defined(SINAPS_SIMD_DISPATCH)
+            auto cpuid = [](unsigned leaf, unsigned subleaf, unsigned (&regs)[4]) {
+    #if defined(_MSC_VER) && !defined(__clang__)
+                int out[4];
+                __cpuidex(out, static_cast<int>(leaf), static_cast<int>(subleaf));
+                for (int i = 0; i < 4; i++) regs[i] = static_cast<unsigned>(out[i]);
+                return true;
+    #else
+                return __get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3]) != 0;
+    #endif
+            };
+            auto xgetbv = []() -> uint64_t {
+    #if defined(_MSC_VER) && !defined(__clang__)
+                return _xgetbv(0);
+    #else
+                unsigned lo, hi;
+                __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+                return uint64_t(hi) << 32 | lo;
+    #endif
+            };
+
+            unsigned leaf1[4], leaf7[4];
+            if (!cpuid(1, 0, leaf1) || !(leaf1[2] & (1u << 27)) || !(leaf1[2] & (1u << 28))) {
+                return native_level; // no OSXSAVE or no AVX
+            }
+            uint64_t xcr0 = xgetbv();
+            if ((xcr0 & 0x6) != 0x6 || !cpuid(7, 0, leaf7)) {
+                return native_level;
+            }
+
+            bool avx2 = leaf7[1] & (1u << 5);
+            bool avx512 = (leaf7[1] & (1u << 16)) && (leaf7[1] & (1u << 30)) && (xcr0 & 0xE0) == 0xE0;
+            if (avx2 && avx512) return level_t::avx512;
+            if (avx2) return level_t::avx2;
+#endif
+            return native_level;
+        }
+
+        inline std::atomic<level_t>& dispatch_level_ref() {
+            static std::atomic<level_t> level{detect_level()};
+            return level;
+        }
+    }
+
+    /// @brief Tier used by the scans, detected once on first use. Never lower than <c>native_level</c>.
+    inline level_t dispatch_level() {
+        return impl::dispatch_level_ref().load(std::memory_order_relaxed);
+    }
+
+    /// @brief Lower the tier used by the scans (e.g. to compare kernels), it can't be raised above what the CPU supports.
+    /// @return The tier now in use.
+    inline level_t limit_dispatch_level(level_t level) {
+        level_t supported = impl::detect_level();
+        level_t used = level < supported ? level : supported;
+        if (used < native_level) used = native_level;
+        impl::dispatch_level_ref().store(used, std::memory_order_relaxed);
+        return used;
+    }
+
+    namespace impl {
+        template <size_t N>
+        constexpr auto select_packed_kernel() {
+#if defined(SINAPS_SIMD_AVX2)
+            if constexpr (N >= 32) return avx2{};
+            else
+#endif
+#if defined(SINAPS_SIMD_SSE2) || defined(SINAPS_SIMD_AVX2)
+            if constexpr (N >= 16) return sse2{};
+            else
+#elif defined(SINAPS_SIMD_NEON)
+            if constexpr (N >= 16) return neon{};
+            else
+#endif
+            if constexpr (N >= 8) return word<uint64_t>{};
+            else if constexpr (N >= 4) return word<uint32_t>{};
+            else return word<uint16_t>{};
+        }
+    }
+
+    /// @brief Widest kernel that can verify a window of <c>N</c> bytes (wider windows are split into chunks).
+    template <size_t N>
+    using packed_kernel = decltype(impl::select_packed_kernel<N>());
+}
+
+#endif // SINAPS_SIMD_HPP
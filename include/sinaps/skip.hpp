@@ -0,0 +1,69 @@
+#pragma once
+#ifndef SINAPS_SKIP_HPP
+#define SINAPS_SKIP_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "anchor.hpp"
+#include "token.hpp"
+
+namespace sinaps {
+    /// @brief Bad-character skip table (Horspool), adapted for wildcard and masked tokens.
+    /// The scan looks at the data byte aligned with <c>offset</c>, and moves the pattern forward by
+    /// <c>table[byte]</c>: the smallest shift that lines the byte up with a token that can match it.
+    /// Wildcards before <c>offset</c> match everything, so the table is most useful when <c>offset</c>
+    /// ends a long run of fully-specified bytes.
+    struct skip_table_t {
+        std::array<uint8_t, 256> table{};
+        size_t offset = 0; // offset of the byte the table is indexed by (in bytes, excluding zero-sized tokens)
+        double average = 1; // expected shift for machine code (see sinaps::byte_frequency)
+    };
+
+    /// @brief Build the skip table for a list of tokens.
+    /// @param tokens The pattern tokens, zero-sized tokens (cursor, follow) are skipped.
+    /// @param offset Offset of the reference byte, usually the last byte of the last group.
+    constexpr skip_table_t build_skip_table(std::span<token_t const> tokens, size_t offset) {
+        constexpr size_t max_skip = 255;
+
+        // last `max_skip` tokens up to and including the reference byte
+        std::array<token_t, max_skip> window{};
+        size_t window_size = 0;
+        size_t index = 0;
+        for (auto const& token : tokens) {
+            if (token.zero_sized()) continue;
+            if (index > offset) break;
+            if (index + max_skip > offset) window[window_size++] = token;
+            index++;
+        }
+
+        skip_table_t skip;
+        skip.offset = offset;
+
+        double total = 0;
+        double weighted = 0;
+        for (size_t c = 0; c < 256; c++) {
+            size_t shift = window_size;
+            for (size_t k = 1; k < window_size; k++) {
+                if (window[window_size - 1 - k].matches(static_cast<uint8_t>(c))) {
+                    shift = k;
+                    break;
+                }
+            }
+            skip.table[c] = static_cast<uint8_t>(shift);
+
+            // approximate 2^(frequency / 16)
+            uint8_t score = byte_frequency[c];
+            double weight = static_cast<double>(uint64_t(1) << (score >> 4)) * (1.0 + (score & 15) / 16.0);
+            total += weight;
+            weighted += weight * static_cast<double>(shift);
+        }
+        skip.average = weighted / total;
+
+        return skip;
+    }
+}
+
+#endif // SINAPS_SKIP_HPP
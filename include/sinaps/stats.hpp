@@ -0,0 +1,113 @@
+#pragma once
+#ifndef SINAPS_STATS_HPP
+#define SINAPS_STATS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+namespace sinaps {
+    /// @brief Counters of the scans run inside a <c>sinaps::stats_scope</c>.
+    /// The counters are only collected if <c>SINAPS_ENABLE_STATS</c> is defined (for the whole program),
+    /// otherwise the hooks compile to nothing and only the time is measured.
+    struct scan_stats {
+        uint64_t bytes = 0;       // positions examined by the scan loops
+        uint64_t candidates = 0;  // positions that passed the prefilter (anchor pair, skip byte or batch bucket)
+        uint64_t verifies = 0;    // full checks of the pattern
+        uint64_t matches = 0;     // matches found (parallel scans may find more than the one they return)
+        uint64_t nanoseconds = 0; // time spent in the scope
+
+        constexpr scan_stats& operator+=(scan_stats const& other) {
+            bytes += other.bytes;
+            candidates += other.candidates;
+            verifies += other.verifies;
+            matches += other.matches;
+            nanoseconds += other.nanoseconds;
+            return *this;
+        }
+    };
+
+    namespace impl {
+        /// @brief Where the hooks of the current thread record to.
+        struct stats_sink_t {
+            scan_stats* total = nullptr;
+            std::span<scan_stats> patterns; // per-pattern counters of batch scans, empty if not wanted
+        };
+
+        inline stats_sink_t& stats_sink() {
+            thread_local stats_sink_t sink;
+            return sink;
+        }
+
+        inline void count_stat(uint64_t scan_stats::* field, uint64_t amount) {
+            if (auto* total = stats_sink().total) {
+                total->*field += amount;
+            }
+        }
+
+        /// @brief Count for a single pattern of a batch scan, and for the total.
+        inline void count_pattern_stat(size_t index, uint64_t scan_stats::* field, uint64_t amount) {
+            auto& sink = stats_sink();
+            if (index < sink.patterns.size()) {
+                sink.patterns[index].*field += amount;
+            }
+            if (sink.total) {
+                sink.total->*field += amount;
+            }
+        }
+
+        /// @brief Install a sink on the current thread, the previous one is restored on destruction.
+        class stats_guard {
+        public:
+            explicit stats_guard(stats_sink_t sink) : m_previous(stats_sink()) { stats_sink() = sink; }
+            ~stats_guard() { stats_sink() = m_previous; }
+
+            stats_guard(stats_guard const&) = delete;
+            stats_guard& operator=(stats_guard const&) = delete;
+
+        private:
+            stats_sink_t m_previous;
+        };
+    }
+
+    /// @brief Collect the counters of every scan run on this thread (and by the parallel workers it starts) while
+    /// the scope is alive, and the time it was alive. Scopes nest, the innermost one gets the counters.
+    /// Wrap each <c>find</c> in its own scope to get the numbers of a single pattern.
+    class stats_scope {
+    public:
+        /// @param stats Output, the counters are added to it.
+        explicit stats_scope(scan_stats& stats) : stats_scope(stats, {}) {}
+
+        /// @param stats Output, the counters of all patterns are added to it.
+        /// @param patterns Output, batch scans (<c>sinaps::find_all</c>) also add the counters of pattern <c>k</c>
+        /// to <c>patterns[k]</c>. Patterns without a fully-specified byte are scanned on their own, and only counted in the total.
+        stats_scope(scan_stats& stats, std::span<scan_stats> patterns)
+            : m_stats(stats), m_guard({&stats, patterns}), m_start(std::chrono::steady_clock::now()) {}
+
+        ~stats_scope() {
+            auto elapsed = std::chrono::steady_clock::now() - m_start;
+            m_stats.nanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+        stats_scope(stats_scope const&) = delete;
+        stats_scope& operator=(stats_scope const&) = delete;
+
+    private:
+        scan_stats& m_stats;
+        impl::stats_guard m_guard;
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
+
+#ifdef SINAPS_ENABLE_STATS
+    #define SINAPS_STATS_ADD(field, amount) \
+        do { if (!std::is_constant_evaluated()) ::sinaps::impl::count_stat(&::sinaps::scan_stats::field, amount); } while (false)
+    #define SINAPS_STATS_ADD_PATTERN(index, field, amount) \
+        do { if (!std::is_constant_evaluated()) ::sinaps::impl::count_pattern_stat(index, &::sinaps::scan_stats::field, amount); } while (false)
+#else
+    #define SINAPS_STATS_ADD(field, amount) ((void) 0)
+    #define SINAPS_STATS_ADD_PATTERN(index, field, amount) ((void) 0)
+#endif
+
+#endif // SINAPS_STATS_HPP
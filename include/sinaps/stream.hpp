@@ -0,0 +1,146 @@
+#pragma once
+#ifndef SINAPS_STREAM_HPP
+#define SINAPS_STREAM_HPP
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "compiled_pattern.hpp"
+#include "find.hpp"
+#include "matches.hpp"
+#include "pattern.hpp"
+
+namespace sinaps {
+    /// @brief Incremental scanner for data that arrives in chunks (e.g. page-by-page reads, network captures).
+    /// Only the last <c>size - 1</c> bytes of the previous chunks are kept, so matches that straddle two chunks
+    /// are still found, and the memory use does not depend on the amount of data.
+    /// Matches may overlap, and are reported in ascending order as absolute offsets in the stream.
+    /// Follow tokens are not resolved, since their targets may be in data that's gone: the cursor offset is reported.
+    /// Patterns with gaps are not supported, the chunks could cut their tail at any point.
+    /// @tparam Scanner Scanner policy (see <c>sinaps::match_range</c>).
+    template <typename Scanner>
+    class basic_stream_scanner {
+    public:
+        /// @param scanner The scanner policy.
+        /// @param origin Offset of the first byte of the stream (e.g. the address of the first page).
+        explicit basic_stream_scanner(Scanner scanner, uint64_t origin = 0)
+            : m_scanner(scanner), m_overlap(scanner.size() ? scanner.size() - 1 : 0), m_position(origin) {
+            m_carry.reserve(m_overlap);
+            m_joined.resize(m_overlap * 2);
+        }
+
+        /// @brief Scan the next chunk of the stream, and report every match that ends in it.
+        /// @param data The chunk.
+        /// @param size The size of the chunk.
+        /// @param on_match Callable that accepts the offset of a match (including the cursor offset).
+        /// If it returns <c>bool</c>, returning <c>false</c> stops the scan of this chunk (the chunk is still consumed).
+        template <typename Callback> requires std::invocable<Callback&, intptr_t>
+        void feed(uint8_t const* data, size_t size, Callback&& on_match) {
+            auto report = [&](uint64_t start) {
+                if constexpr (std::is_convertible_v<std::invoke_result_t<Callback&, intptr_t>, bool>) {
+                    return static_cast<bool>(on_match(m_scanner.result(static_cast<size_t>(start))));
+                } else {
+                    on_match(m_scanner.result(static_cast<size_t>(start)));
+                    return true;
+                }
+            };
+
+            bool running = true;
+
+            // matches that start in the carry, they can't be complete in it
+            size_t carry = m_carry.size();
+            if (carry > 0 && size > 0) {
+                size_t head = std::min(size, m_overlap);
+                std::memcpy(m_joined.data(), m_carry.data(), carry);
+                std::memcpy(m_joined.data() + carry, data, head);
+                for (size_t from = 0; running && from < carry;) {
+                    intptr_t res = m_scanner.next(m_joined.data() + from, carry + head - from);
+                    if (res == not_found || from + static_cast<size_t>(res) >= carry) break;
+                    from += static_cast<size_t>(res);
+                    running = report(m_position - carry + from);
+                    from++;
+                }
+            }
+
+            // matches inside the chunk
+            for (size_t from = 0; running && from < size;) {
+                intptr_t res = m_scanner.next(data + from, size - from);
+                if (res == not_found) break;
+                from += static_cast<size_t>(res);
+                running = report(m_position + from);
+                from++;
+            }
+
+            // keep the tail for the next chunk
+            if (size >= m_overlap) {
+                m_carry.assign(data + size - m_overlap, data + size);
+            } else {
+                size_t keep = std::min(carry, m_overlap - size);
+                m_carry.erase(m_carry.begin(), m_carry.begin() + static_cast<ptrdiff_t>(carry - keep));
+                m_carry.insert(m_carry.end(), data, data + size);
+            }
+            m_position += size;
+        }
+
+        /// @brief Scan the next chunk of the stream.
+        /// @param data The chunk.
+        /// @param size The size of the chunk.
+        /// @return The offset of the first match that ends in this chunk, or <b>sinaps::not_found</b> if there is none.
+        /// Later matches of the same chunk are skipped, use the callback overload to get all of them.
+        intptr_t feed(uint8_t const* data, size_t size) {
+            intptr_t first = not_found;
+            feed(data, size, [&first](intptr_t offset) {
+                first = offset;
+                return false;
+            });
+            return first;
+        }
+
+        /// @brief Start a new stream, dropping the carry.
+        /// @param origin Offset of the first byte of the new stream.
+        void reset(uint64_t origin = 0) {
+            m_carry.clear();
+            m_position = origin;
+        }
+
+        /// @brief Offset of the next byte to be fed.
+        [[nodiscard]] uint64_t position() const { return m_position; }
+
+    private:
+        Scanner m_scanner;
+        size_t m_overlap;            // pattern size - 1
+        uint64_t m_position;         // offset of the next chunk
+        std::vector<uint8_t> m_carry;  // last `m_overlap` bytes fed so far (fewer at the start of the stream)
+        std::vector<uint8_t> m_joined; // carry followed by the start of the chunk
+    };
+
+    /// @brief Incremental scanner for a compile-time pattern (see <c>sinaps::basic_stream_scanner</c>).
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    class stream_scanner : public basic_stream_scanner<impl::pattern_scanner<Pattern>> {
+        static_assert(!Pattern::has_gap, "Patterns with gaps can't be streamed");
+
+    public:
+        /// @param origin Offset of the first byte of the stream.
+        explicit stream_scanner(uint64_t origin = 0)
+            : basic_stream_scanner<impl::pattern_scanner<Pattern>>(impl::pattern_scanner<Pattern>{}, origin) {}
+    };
+
+    /// @brief Incremental scanner for a compiled pattern (see <c>sinaps::basic_stream_scanner</c>).
+    /// The pattern must outlive the scanner.
+    /// @param pattern The pattern to search for.
+    /// @param origin Offset of the first byte of the stream.
+    /// @throws std::invalid_argument If the pattern has gaps.
+    inline basic_stream_scanner<impl::compiled_scanner> make_stream_scanner(compiled_pattern const& pattern, uint64_t origin = 0) {
+        if (pattern.has_gap()) {
+            throw std::invalid_argument("Patterns with gaps can't be streamed");
+        }
+        return basic_stream_scanner<impl::compiled_scanner>(impl::compiled_scanner{&pattern}, origin);
+    }
+}
+
+#endif // SINAPS_STREAM_HPP
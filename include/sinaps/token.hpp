@@ -10,7 +10,10 @@ namespace sinaps {
             byte,
             wildcard,
             cursor,
-            masked
+            masked,
+            follow, // zero-sized, `byte` is the displacement offset and `mask` the extra instruction bytes
+            either, // matches `byte` or `mask`
+            gap     // skips `byte` to `mask` bytes, splits the pattern into a fixed head and a tail
         } type;
 
         uint8_t byte;
@@ -25,7 +28,23 @@ namespace sinaps {
         }
         constexpr token_t(uint8_t byte) : type(type_t::byte), byte(byte) {}
         constexpr token_t(type_t type) : type(type), byte(0) {}
+        constexpr token_t(type_t type, uint8_t byte, uint8_t mask) : type(type), byte(byte), mask(mask) {}
         constexpr token_t() : type(type_t::wildcard), byte(0) {}
+
+        /// @brief Whether the token takes no space in the data (cursor and follow tokens).
+        [[nodiscard]] constexpr bool zero_sized() const {
+            return type == type_t::cursor || type == type_t::follow;
+        }
+
+        /// @brief Whether a data byte satisfies this token (always true for zero-sized tokens).
+        [[nodiscard]] constexpr bool matches(uint8_t value) const {
+            switch (type) {
+                case type_t::byte: return value == byte;
+                case type_t::masked: return (value & mask) == byte;
+                case type_t::either: return value == byte || value == mask;
+                default: return true;
+            }
+        }
     };
 }
 
@@ -3,11 +3,15 @@
 #define SINAPS_UTILS_HPP
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <new>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <tuple>
+#include <type_traits>
 
 namespace sinaps::utils {
     /// @brief A fixed-size string class.
@@ -71,6 +75,54 @@ namespace sinaps::utils {
         return str;
     }
 
+    constexpr size_t decimal_length(uint8_t value) {
+        return value >= 100 ? 3 : value >= 10 ? 2 : 1;
+    }
+
+    /// @brief Write `value` in decimal into `str` at `index`.
+    /// @return The index after the last digit.
+    template <typename String>
+    constexpr size_t write_decimal(String& str, size_t index, uint8_t value) {
+        size_t length = decimal_length(value);
+        for (size_t i = length; i > 0; i--) {
+            str[index + i - 1] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+        return index + length;
+    }
+
+    /// @brief Allocator with a fixed alignment, so vector kernels can use aligned loads on the storage.
+    /// Constant evaluation uses <c>std::allocator</c>, alignment doesn't matter there.
+    template <typename T, size_t Alignment>
+    struct aligned_allocator {
+        using value_type = T;
+
+        template <typename U>
+        struct rebind { using other = aligned_allocator<U, Alignment>; };
+
+        constexpr aligned_allocator() noexcept = default;
+        template <typename U>
+        constexpr aligned_allocator(aligned_allocator<U, Alignment> const&) noexcept {}
+
+        [[nodiscard]] constexpr T* allocate(size_t n) {
+            if (std::is_constant_evaluated()) {
+                return std::allocator<T>().allocate(n);
+            }
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+        }
+
+        constexpr void deallocate(T* ptr, size_t n) noexcept {
+            if (std::is_constant_evaluated()) {
+                std::allocator<T>().deallocate(ptr, n);
+                return;
+            }
+            ::operator delete(ptr, n * sizeof(T), std::align_val_t(Alignment));
+        }
+
+        template <typename U>
+        constexpr bool operator==(aligned_allocator<U, Alignment> const&) const noexcept { return true; }
+    };
+
     template <class, template <class...> class>
     struct is_specialization : std::false_type {};
 
@@ -0,0 +1,237 @@
+#pragma once
+#ifndef SINAPS_X86_HPP
+#define SINAPS_X86_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+namespace sinaps::x86 {
+    /// @brief Layout of a decoded x86-64 instruction: its length, and where its operand fields are.
+    /// Offsets are from the first byte of the instruction (prefixes included), sizes are 0 if the field is absent.
+    struct instruction_t {
+        uint8_t length = 0;       // 0 if the bytes don't decode
+        uint8_t disp_offset = 0;  // ModRM displacement
+        uint8_t disp_size = 0;
+        uint8_t imm_offset = 0;   // immediate, branch displacement or memory offset
+        uint8_t imm_size = 0;
+        bool rip_relative = false; // the displacement is relative to the next instruction
+        bool relative = false;     // the immediate is a branch displacement (rel8/rel32)
+
+        [[nodiscard]] constexpr bool valid() const { return length != 0; }
+    };
+
+    namespace impl {
+        /// @brief Kind of immediate that follows an opcode (and its ModRM, if any).
+        enum class imm_t : uint8_t {
+            none,
+            byte,   // 8 bits
+            word,   // 16 bits
+            enter,  // 16 + 8 bits
+            z,      // 16 bits with the operand size prefix, otherwise 32
+            v,      // 16/32/64 bits, following the operand size (mov r64, imm64)
+            moffs,  // 64-bit address, or 32 with the address size prefix
+            rel8,
+            rel32,
+            group3  // imm8 (F6) or immz (F7) only for /0 and /1
+        };
+
+        struct opcode_t {
+            bool modrm = false;
+            bool invalid = false;
+            imm_t imm = imm_t::none;
+        };
+
+        /// @brief One-byte opcode map, in 64-bit mode. Prefixes, REX, VEX and EVEX are handled by <c>decode</c>.
+        constexpr auto make_primary_map() {
+            struct map_t { opcode_t op[256]; } map{};
+            for (int i = 0; i < 0x40; i++) {
+                // ALU ops: r/m,r / r,r/m forms, then AL,imm8 and eAX,immz
+                switch (i & 7) {
+                    case 0: case 1: case 2: case 3: map.op[i].modrm = true; break;
+                    case 4: map.op[i].imm = imm_t::byte; break;
+                    case 5: map.op[i].imm = imm_t::z; break;
+                    default: break;
+                }
+            }
+            for (int i : {0x06, 0x07, 0x0E, 0x16, 0x17, 0x1E, 0x1F, 0x27, 0x2F, 0x37, 0x3F, 0x60, 0x61, 0x82, 0x9A, 0xCE, 0xD4, 0xD5, 0xD6, 0xEA}) {
+                map.op[i].invalid = true;
+            }
+            for (int i : {0x63, 0x69, 0x6B, 0x8F, 0xC0, 0xC1, 0xC6, 0xC7, 0xD0, 0xD1, 0xD2, 0xD3, 0xF6, 0xF7, 0xFE, 0xFF}) {
+                map.op[i].modrm = true;
+            }
+            for (int i = 0x80; i <= 0x8E; i++) map.op[i].modrm = true;
+            for (int i = 0xD8; i <= 0xDF; i++) map.op[i].modrm = true;
+            for (int i = 0x70; i <= 0x7F; i++) map.op[i].imm = imm_t::rel8;
+            for (int i = 0xB0; i <= 0xB7; i++) map.op[i].imm = imm_t::byte;
+            for (int i = 0xB8; i <= 0xBF; i++) map.op[i].imm = imm_t::v;
+            for (int i = 0xA0; i <= 0xA3; i++) map.op[i].imm = imm_t::moffs;
+            for (int i = 0xE0; i <= 0xE3; i++) map.op[i].imm = imm_t::rel8;
+            for (int i = 0xE4; i <= 0xE7; i++) map.op[i].imm = imm_t::byte;
+            for (int i : {0x6A, 0x6B, 0x80, 0x83, 0xA8, 0xC0, 0xC1, 0xC6, 0xCD}) map.op[i].imm = imm_t::byte;
+            for (int i : {0x68, 0x69, 0x81, 0xA9, 0xC7}) map.op[i].imm = imm_t::z;
+            map.op[0xC2].imm = imm_t::word;
+            map.op[0xCA].imm = imm_t::word;
+            map.op[0xC8].imm = imm_t::enter;
+            map.op[0xE8].imm = imm_t::rel32;
+            map.op[0xE9].imm = imm_t::rel32;
+            map.op[0xEB].imm = imm_t::rel8;
+            map.op[0xF6].imm = imm_t::group3;
+            map.op[0xF7].imm = imm_t::group3;
+            return map;
+        }
+
+        /// @brief Two-byte opcode map (<c>0F xx</c>), also used for VEX/EVEX map 1.
+        constexpr auto make_secondary_map() {
+            struct map_t { opcode_t op[256]; } map{};
+            for (auto& op : map.op) op.modrm = true;
+            for (int i : {0x05, 0x06, 0x07, 0x08, 0x09, 0x0B, 0x0E, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x37, 0x77, 0xA0, 0xA1, 0xA2, 0xA8, 0xA9, 0xAA}) {
+                map.op[i].modrm = false;
+            }
+            for (int i : {0x04, 0x0A, 0x0C, 0x24, 0x25, 0x26, 0x27, 0x36, 0x39, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F}) {
+                map.op[i] = {false, true, imm_t::none};
+            }
+            for (int i = 0x80; i <= 0x8F; i++) map.op[i] = {false, false, imm_t::rel32};
+            for (int i = 0xC8; i <= 0xCF; i++) map.op[i].modrm = false;
+            for (int i : {0x0F, 0x70, 0x71, 0x72, 0x73, 0xA4, 0xAC, 0xBA, 0xC2, 0xC4, 0xC5, 0xC6}) map.op[i].imm = imm_t::byte;
+            return map;
+        }
+
+        inline constexpr auto primary_map = make_primary_map();
+        inline constexpr auto secondary_map = make_secondary_map();
+
+        /// @brief Map 1 opcodes of VEX/EVEX instructions that take an imm8.
+        constexpr bool vex_imm8(uint8_t op) {
+            return (op >= 0x70 && op <= 0x73) || op == 0xC2 || op == 0xC4 || op == 0xC5 || op == 0xC6;
+        }
+    }
+
+    /// @brief Decode the length and operand fields of an x86-64 instruction (64-bit mode).
+    /// Covers the legacy, REX, VEX and EVEX encodings, but not 3DNow! and XOP.
+    /// @param code The instruction bytes.
+    /// @param size Amount of readable bytes, at most 15 are read.
+    /// @return The instruction layout, <c>length</c> is 0 if the bytes are not a valid or complete instruction.
+    constexpr instruction_t decode(uint8_t const* code, size_t size) {
+        using impl::imm_t;
+        constexpr size_t max_length = 15;
+        size_t limit = size < max_length ? size : max_length;
+        size_t pos = 0;
+
+        bool operand_size = false, address_size = false, rex_w = false;
+        for (; pos < limit; pos++) {
+            uint8_t b = code[pos];
+            if (b == 0x66) operand_size = true;
+            else if (b == 0x67) address_size = true;
+            else if (b == 0xF0 || b == 0xF2 || b == 0xF3 || b == 0x2E || b == 0x36 || b == 0x3E || b == 0x26 || b == 0x64 || b == 0x65) continue;
+            else break;
+        }
+        if (pos < limit && (code[pos] & 0xF0) == 0x40) {
+            rex_w = (code[pos] & 0x08) != 0;
+            pos++;
+        }
+        if (pos >= limit) {
+            return {};
+        }
+
+        impl::opcode_t op;
+        uint8_t opcode = code[pos++];
+        if (opcode == 0xC4 || opcode == 0xC5 || opcode == 0x62) {
+            // VEX (2 or 3 bytes) and EVEX (4 bytes): payload, opcode, then always a ModRM
+            size_t payload = opcode == 0xC5 ? 1 : opcode == 0xC4 ? 2 : 3;
+            if (pos + payload >= limit) {
+                return {};
+            }
+            uint8_t map = opcode == 0xC5 ? 1 : opcode == 0xC4 ? (code[pos] & 0x1F) : (code[pos] & 0x07);
+            rex_w = opcode != 0xC5 && (code[pos + 1] & 0x80) != 0;
+            pos += payload;
+            opcode = code[pos++];
+            op.modrm = !(map == 1 && opcode == 0x77 && payload < 3); // vzeroupper / vzeroall
+            op.imm = map == 3 || (map == 1 && impl::vex_imm8(opcode)) ? imm_t::byte : imm_t::none;
+        } else if (opcode == 0x0F) {
+            if (pos >= limit) {
+                return {};
+            }
+            opcode = code[pos++];
+            if (opcode == 0x38 || opcode == 0x3A) {
+                if (pos >= limit) {
+                    return {};
+                }
+                pos++; // the opcode, both maps always have a ModRM
+                op.modrm = true;
+                op.imm = opcode == 0x3A ? imm_t::byte : imm_t::none;
+            } else {
+                op = impl::secondary_map.op[opcode];
+            }
+        } else {
+            op = impl::primary_map.op[opcode];
+        }
+        if (op.invalid) {
+            return {};
+        }
+
+        instruction_t ins;
+        uint8_t reg = 0;
+        if (op.modrm) {
+            if (pos >= limit) {
+                return {};
+            }
+            uint8_t modrm = code[pos++];
+            uint8_t mod = modrm >> 6, rm = modrm & 7;
+            reg = (modrm >> 3) & 7;
+            size_t disp = 0;
+            if (mod != 3) {
+                if (rm == 4) {
+                    if (pos >= limit) {
+                        return {};
+                    }
+                    uint8_t sib = code[pos++];
+                    if (mod == 0 && (sib & 7) == 5) disp = 4;
+                } else if (mod == 0 && rm == 5) {
+                    disp = 4;
+                    ins.rip_relative = true;
+                }
+                if (mod == 1) disp = 1;
+                if (mod == 2) disp = 4;
+            }
+            ins.disp_offset = static_cast<uint8_t>(pos);
+            ins.disp_size = static_cast<uint8_t>(disp);
+            pos += disp;
+        }
+
+        size_t imm = 0;
+        switch (op.imm) {
+            case imm_t::none: break;
+            case imm_t::byte: imm = 1; break;
+            case imm_t::word: imm = 2; break;
+            case imm_t::enter: imm = 3; break;
+            case imm_t::z: imm = operand_size ? 2 : 4; break;
+            case imm_t::v: imm = rex_w ? 8 : operand_size ? 2 : 4; break;
+            case imm_t::moffs: imm = address_size ? 4 : 8; break;
+            case imm_t::rel8: imm = 1; ins.relative = true; break;
+            case imm_t::rel32: imm = 4; ins.relative = true; break;
+            case imm_t::group3: imm = reg > 1 ? 0 : opcode == 0xF6 ? 1 : operand_size ? 2 : 4; break;
+        }
+        ins.imm_offset = static_cast<uint8_t>(pos);
+        ins.imm_size = static_cast<uint8_t>(imm);
+        pos += imm;
+
+        if (pos > limit) {
+            return {};
+        }
+        ins.length = static_cast<uint8_t>(pos);
+        return ins;
+    }
+
+    /// @brief Whether a byte of an instruction likely changes between builds or load addresses: branch displacements,
+    /// RIP-relative displacements, and immediates or memory offsets of 32 bits or more (often addresses).
+    /// Small immediates and ModRM displacements (struct offsets, stack slots) are kept.
+    /// @param ins The decoded instruction.
+    /// @param offset Offset of the byte in the instruction.
+    constexpr bool is_volatile(instruction_t const& ins, size_t offset) {
+        bool in_disp = ins.disp_size && offset >= ins.disp_offset && offset < size_t(ins.disp_offset) + ins.disp_size;
+        bool in_imm = ins.imm_size && offset >= ins.imm_offset && offset < size_t(ins.imm_offset) + ins.imm_size;
+        return (in_disp && ins.rip_relative) || (in_imm && (ins.relative || ins.imm_size >= 4));
+    }
+}
+
+#endif // SINAPS_X86_HPP
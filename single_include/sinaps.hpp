@@ -6,11 +6,15 @@
 #define SINAPS_UTILS_HPP
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <new>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <tuple>
+#include <type_traits>
 
 namespace sinaps::utils {
     /// @brief A fixed-size string class.
@@ -74,6 +78,54 @@ namespace sinaps::utils {
         return str;
     }
 
+    constexpr size_t decimal_length(uint8_t value) {
+        return value >= 100 ? 3 : value >= 10 ? 2 : 1;
+    }
+
+    /// @brief Write `value` in decimal into `str` at `index`.
+    /// @return The index after the last digit.
+    template <typename String>
+    constexpr size_t write_decimal(String& str, size_t index, uint8_t value) {
+        size_t length = decimal_length(value);
+        for (size_t i = length; i > 0; i--) {
+            str[index + i - 1] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+        return index + length;
+    }
+
+    /// @brief Allocator with a fixed alignment, so vector kernels can use aligned loads on the storage.
+    /// Constant evaluation uses <c>std::allocator</c>, alignment doesn't matter there.
+    template <typename T, size_t Alignment>
+    struct aligned_allocator {
+        using value_type = T;
+
+        template <typename U>
+        struct rebind { using other = aligned_allocator<U, Alignment>; };
+
+        constexpr aligned_allocator() noexcept = default;
+        template <typename U>
+        constexpr aligned_allocator(aligned_allocator<U, Alignment> const&) noexcept {}
+
+        [[nodiscard]] constexpr T* allocate(size_t n) {
+            if (std::is_constant_evaluated()) {
+                return std::allocator<T>().allocate(n);
+            }
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+        }
+
+        constexpr void deallocate(T* ptr, size_t n) noexcept {
+            if (std::is_constant_evaluated()) {
+                std::allocator<T>().deallocate(ptr, n);
+                return;
+            }
+            ::operator delete(ptr, n * sizeof(T), std::align_val_t(Alignment));
+        }
+
+        template <typename U>
+        constexpr bool operator==(aligned_allocator<U, Alignment> const&) const noexcept { return true; }
+    };
+
     template <class, template <class...> class>
     struct is_specialization : std::false_type {};
 
@@ -94,7 +146,10 @@ namespace sinaps {
             byte,
             wildcard,
             cursor,
-            masked
+            masked,
+            follow, // zero-sized, `byte` is the displacement offset and `mask` the extra instruction bytes
+            either, // matches `byte` or `mask`
+            gap     // skips `byte` to `mask` bytes, splits the pattern into a fixed head and a tail
         } type;
 
         uint8_t byte;
@@ -109,15 +164,189 @@ namespace sinaps {
         }
         constexpr token_t(uint8_t byte) : type(type_t::byte), byte(byte) {}
         constexpr token_t(type_t type) : type(type), byte(0) {}
+        constexpr token_t(type_t type, uint8_t byte, uint8_t mask) : type(type), byte(byte), mask(mask) {}
         constexpr token_t() : type(type_t::wildcard), byte(0) {}
+
+        /// @brief Whether the token takes no space in the data (cursor and follow tokens).
+        [[nodiscard]] constexpr bool zero_sized() const {
+            return type == type_t::cursor || type == type_t::follow;
+        }
+
+        /// @brief Whether a data byte satisfies this token (always true for zero-sized tokens).
+        [[nodiscard]] constexpr bool matches(uint8_t value) const {
+            switch (type) {
+                case type_t::byte: return value == byte;
+                case type_t::masked: return (value & mask) == byte;
+                case type_t::either: return value == byte || value == mask;
+                default: return true;
+            }
+        }
     };
 }
 
 #endif // SINAPS_TOKEN_HPP
 
+#ifndef SINAPS_ANCHOR_HPP
+#define SINAPS_ANCHOR_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+
+namespace sinaps {
+    /// @brief Approximate frequency of each byte value in machine code, on a log2 scale (16 steps per bit).
+    /// Measured over the .text sections of a few large x86-64 binaries, with the opcode bytes that are
+    /// common in A64 code (ldr/str, add/sub, bl, ret, stp/ldp, ...) raised to at least 1%.
+    /// Lower values are rarer, and make better anchors.
+    static constexpr std::array<uint8_t, 256> byte_frequency = {
+            207, 163, 136, 150, 139, 132, 112, 119, 151, 108, 101,  98, 115, 112, 103, 179, // 0_
+            148, 116, 150,  98, 110, 108,  99,  98, 134,  91,  85,  83,  93,  89, 114, 150, // 1_
+            135,  90,  83,  83, 171, 106,  80,  81, 127, 122, 150, 100,  92,  91, 113,  85, // 2_
+            125, 136,  77,  84, 150, 150,  82,  82, 119, 150,  90, 106, 111, 116,  85,  95, // 3_
+            139, 156,  99, 122, 156, 135, 102, 113, 197, 150,  93,  92, 162, 127,  89,  90, // 4_
+            127,  85, 150, 118, 150, 123, 103, 104, 111,  80,  80, 119, 119, 125, 102, 150, // 5_
+            113,  77,  92, 102, 113,  86, 147,  80, 108,  94,  87,  89, 105,  86,  96, 113, // 6_
+            122, 150,  93, 102, 147, 132,  97,  99, 112,  83,  82, 150, 124, 106,  95, 111, // 7_
+            133, 111,  92, 158, 157, 158,  93,  99, 115, 182,  74, 176,  92, 156,  87,  89, // 8_
+            150, 150,  80,  89, 150, 100,  76, 150,  98,  87,  73,  76,  88,  86,  74,  78, // 9_
+            108,  78,  74,  80,  85,  82,  75,  75,  98, 150, 150,  81,  90,  81,  75,  86, // A_
+            100,  80,  77,  82, 150, 150, 117, 106, 119, 150, 115,  91, 109, 108, 119, 113, // B_
+            149, 126, 117, 136, 123, 123, 126, 141, 112, 113, 106,  87,  92,  93,  94,  91, // C_
+            120, 150, 121,  99,  90,  92, 150,  99, 111,  89,  97, 104,  84,  90, 100, 124, // D_
+            150, 100, 104,  88, 100,  92, 105, 112, 164, 146, 106, 150, 114, 110, 110, 125, // E_
+            150, 101, 107, 126,  97, 106, 127, 120, 133, 150, 132, 123, 121, 150, 137, 192, // F_
+    };
+
+    /// @brief Offsets of the bytes used to prefilter the scan (in bytes, excluding zero-sized tokens).
+    struct anchor_t {
+        size_t first = 0;
+        size_t second = 0;
+        uint8_t first_byte = 0;
+        uint8_t second_byte = 0;
+        bool valid = false; // false if the pattern has no fully-specified bytes
+    };
+
+    /// @brief Pick the least frequent byte, and a second one to pair it with.
+    /// The second byte prefers a different value, since repeated bytes (e.g. padding) tend to come in runs.
+    /// @param tokens The pattern tokens, zero-sized tokens (cursor, follow) are skipped.
+    /// @return The anchor pair, <c>first == second</c> if there is only one fully-specified byte.
+    constexpr anchor_t select_anchor(std::span<token_t const> tokens) {
+        constexpr unsigned same_value_penalty = 32;
+
+        anchor_t anchor;
+        unsigned best = ~0u;
+        size_t offset = 0;
+        for (auto const& token : tokens) {
+            if (token.zero_sized()) continue;
+            if (token.type == token_t::type_t::byte && byte_frequency[token.byte] < best) {
+                best = byte_frequency[token.byte];
+                anchor.first = offset;
+                anchor.valid = true;
+                anchor.first_byte = token.byte;
+            }
+            offset++;
+        }
+
+        if (!anchor.valid) {
+            return anchor;
+        }
+
+        anchor.second = anchor.first;
+        anchor.second_byte = anchor.first_byte;
+        best = ~0u;
+        offset = 0;
+        for (auto const& token : tokens) {
+            if (token.zero_sized()) continue;
+            if (token.type == token_t::type_t::byte && offset != anchor.first) {
+                unsigned score = byte_frequency[token.byte] + (token.byte == anchor.first_byte ? same_value_penalty : 0);
+                if (score < best) {
+                    best = score;
+                    anchor.second = offset;
+                    anchor.second_byte = token.byte;
+                }
+            }
+            offset++;
+        }
+
+        return anchor;
+    }
+}
+
+#endif // SINAPS_ANCHOR_HPP
+
+#ifndef SINAPS_SKIP_HPP
+#define SINAPS_SKIP_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+
+namespace sinaps {
+    /// @brief Bad-character skip table (Horspool), adapted for wildcard and masked tokens.
+    /// The scan looks at the data byte aligned with <c>offset</c>, and moves the pattern forward by
+    /// <c>table[byte]</c>: the smallest shift that lines the byte up with a token that can match it.
+    /// Wildcards before <c>offset</c> match everything, so the table is most useful when <c>offset</c>
+    /// ends a long run of fully-specified bytes.
+    struct skip_table_t {
+        std::array<uint8_t, 256> table{};
+        size_t offset = 0; // offset of the byte the table is indexed by (in bytes, excluding zero-sized tokens)
+        double average = 1; // expected shift for machine code (see sinaps::byte_frequency)
+    };
+
+    /// @brief Build the skip table for a list of tokens.
+    /// @param tokens The pattern tokens, zero-sized tokens (cursor, follow) are skipped.
+    /// @param offset Offset of the reference byte, usually the last byte of the last group.
+    constexpr skip_table_t build_skip_table(std::span<token_t const> tokens, size_t offset) {
+        constexpr size_t max_skip = 255;
+
+        // last `max_skip` tokens up to and including the reference byte
+        std::array<token_t, max_skip> window{};
+        size_t window_size = 0;
+        size_t index = 0;
+        for (auto const& token : tokens) {
+            if (token.zero_sized()) continue;
+            if (index > offset) break;
+            if (index + max_skip > offset) window[window_size++] = token;
+            index++;
+        }
+
+        skip_table_t skip;
+        skip.offset = offset;
+
+        double total = 0;
+        double weighted = 0;
+        for (size_t c = 0; c < 256; c++) {
+            size_t shift = window_size;
+            for (size_t k = 1; k < window_size; k++) {
+                if (window[window_size - 1 - k].matches(static_cast<uint8_t>(c))) {
+                    shift = k;
+                    break;
+                }
+            }
+            skip.table[c] = static_cast<uint8_t>(shift);
+
+            // approximate 2^(frequency / 16)
+            uint8_t score = byte_frequency[c];
+            double weight = static_cast<double>(uint64_t(1) << (score >> 4)) * (1.0 + (score & 15) / 16.0);
+            total += weight;
+            weighted += weight * static_cast<double>(shift);
+        }
+        skip.average = weighted / total;
+
+        return skip;
+    }
+}
+
+#endif // SINAPS_SKIP_HPP
+
 #ifndef SINAPS_MASKS_HPP
 #define SINAPS_MASKS_HPP
 
+#include <bit>
 #include <cstdint>
 #include <tuple>
 
@@ -207,13 +436,56 @@ namespace sinaps::mask {
         static constexpr std::tuple value = {token_t(token_t::type_t::cursor)};
     };
 
+    /// @brief Special mask, follows a 32-bit relative displacement (e.g. the target of a <c>call</c>, or a
+    /// rip-relative operand). The displacement is read at <c>index + Offset</c>, where <c>index</c> is the cursor,
+    /// or the target of the previous follow, and <c>sinaps::find</c> reports <c>index + Offset + 4 + Extra + rel32</c>.
+    /// Matches whose displacement or target is outside the buffer are skipped.
+    /// @tparam Offset Offset of the displacement from the current index.
+    /// @tparam Extra Amount of instruction bytes after the displacement (e.g. an immediate operand).
+    template <uint8_t Offset = 0, uint8_t Extra = 0>
+    struct follow {
+        static constexpr size_t size = 0;
+        static constexpr std::tuple value = {token_t(token_t::type_t::follow, Offset, Extra)};
+    };
+
+    /// @brief A 32-bit relative displacement (4 bytes), <c>sinaps::find</c> reports its target instead of the match.
+    /// Sets the cursor on the displacement, more <c>mask::follow</c> can be added after it to chain hops.
+    /// @tparam Extra Amount of instruction bytes after the displacement (e.g. 1 for <c>cmp byte [rip + rel32], imm8</c>).
+    template <uint8_t Extra = 0>
+    struct rel32 {
+        static constexpr size_t size = 4;
+        static constexpr std::tuple value = std::tuple_cat(cursor::value, follow<0, Extra>::value, any<4>::value);
+    };
+
     /// @brief A mask that matches a byte with a mask.
-    /// The mask is used to ignore certain bits in the byte.
+    /// The mask is used to ignore certain bits in the byte (e.g. <c>masked&lt;0x40, 0xF0&gt;</c> matches <c>4?</c>).
     template <uint8_t N, uint8_t M>
     struct masked {
         static constexpr size_t size = 1;
         static constexpr std::tuple value = {token_t(N, M)};
     };
+
+    /// @brief A mask that skips between <c>Min</c> and <c>Max</c> bytes (e.g. instructions whose length changes between builds).
+    /// The part of the pattern before the first gap is scanned for, and the rest is only searched for in the window
+    /// after it, shortest gaps first. A pattern can't start with a gap.
+    template <uint8_t Min, uint8_t Max>
+    struct gap {
+        static_assert(Min <= Max, "The minimum of a gap can't be larger than its maximum");
+        static constexpr size_t size = Min; // minimum size
+        static constexpr std::tuple value = {token_t(token_t::type_t::gap, Min, Max)};
+    };
+
+    /// @brief A mask that matches one of two bytes (e.g. <c>jz</c> or <c>jmp short</c>).
+    /// Bytes that only differ in one bit are stored as a masked byte.
+    template <uint8_t A, uint8_t B>
+    struct either {
+        static constexpr size_t size = 1;
+        static constexpr std::tuple value = {
+            std::has_single_bit(static_cast<unsigned>(A ^ B)) || A == B
+                ? token_t(A & B, static_cast<uint8_t>(~(A ^ B)))
+                : token_t(token_t::type_t::either, A, B)
+        };
+    };
 }
 
 #endif // SINAPS_MASKS_HPP
@@ -222,14 +494,36 @@ namespace sinaps::mask {
 #define SINAPS_PATTERN_HPP
 
 #include <array>
+#include <bit>
 #include <cstddef>
 #include <cstdint>
 #include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
 
 namespace sinaps {
+    /// @brief A run of consecutive fully-specified bytes in a pattern.
+    struct group_t {
+        size_t offset{};
+        size_t count{};
+        constexpr group_t() = default;
+        constexpr group_t(size_t offset, size_t count) : offset(offset), count(count) {}
+        [[nodiscard]] constexpr size_t size() const { return count; }
+        constexpr uint8_t* begin(uint8_t* data) const { return data + offset; }
+        constexpr uint8_t* end(uint8_t* data) const { return data + offset + count; }
+    };
+
+    namespace impl {
+        /// @brief Whether a masked token only checks one nibble (written <c>4?</c> or <c>?8</c>).
+        constexpr bool is_nibble(token_t token) {
+            return token.type == token_t::type_t::masked && (token.mask == 0xF0 || token.mask == 0x0F) && (token.byte & ~token.mask) == 0;
+        }
+    }
+
     /// @brief Primary container for mask patterns. It allows for easy pattern creation at compile-time.
     /// @tparam Mask List of masks that make up the pattern (e.g. mask::string<"abc">, mask::any<3>, etc.)
     template <typename... Mask>
@@ -241,45 +535,125 @@ namespace sinaps {
         static constexpr std::tuple raw_value = std::tuple_cat(Mask::value...);
         // size of the raw_value tuple
         static constexpr size_t raw_size = std::tuple_size_v<decltype(raw_value)>;
-        // size of the pattern bytes
-        static constexpr size_t size = (Mask::size + ...);
 
-        // whether the pattern contains a cursor token
-        static constexpr bool has_cursor = []<size_t... I>(std::index_sequence<I...>) {
-            return ((std::get<I>(raw_value).type == token_t::type_t::cursor) || ...);
+        // array of raw tokens (extracted from the raw_value tuple)
+        static constexpr auto raw_tokens = []<size_t... I>(std::index_sequence<I...>) {
+            return std::array<token_t, raw_size>{std::get<I>(raw_value)...};
         }(std::make_index_sequence<raw_size>());
 
-        // position of the cursor token in the pattern
-        static constexpr size_t cursor_pos = []<size_t... I>(std::index_sequence<I...>) {
+        // amount of raw tokens before the first gap (the fixed head, which is scanned for)
+        static constexpr size_t head_raw_size = [] {
+            size_t i = 0;
+            while (i < raw_size && raw_tokens[i].type != token_t::type_t::gap) i++;
+            return i;
+        }();
+
+        // whether the pattern contains a gap token
+        static constexpr bool has_gap = head_raw_size < raw_size;
+
+        // size of the pattern bytes (of the fixed head, if the pattern has gaps)
+        static constexpr size_t size = [] {
+            size_t size = 0;
+            for (size_t i = 0; i < head_raw_size; i++) size += !raw_tokens[i].zero_sized();
+            return size;
+        }();
+
+        static_assert(!has_gap || size > 0, "A pattern can't start with a gap");
+
+        // smallest and largest amount of bytes a match spans
+        static constexpr size_t min_size = [] {
+            size_t total = size;
+            for (size_t i = head_raw_size; i < raw_size; i++) {
+                total += raw_tokens[i].type == token_t::type_t::gap ? raw_tokens[i].byte : !raw_tokens[i].zero_sized();
+            }
+            return total;
+        }();
+        static constexpr size_t max_size = [] {
+            size_t total = size;
+            for (size_t i = head_raw_size; i < raw_size; i++) {
+                total += raw_tokens[i].type == token_t::type_t::gap ? raw_tokens[i].mask : !raw_tokens[i].zero_sized();
+            }
+            return total;
+        }();
+
+        // tokens from the first gap on, matched after the head (see impl::match_tail)
+        static constexpr auto tail = [] {
+            std::array<token_t, raw_size - head_raw_size> tail;
+            for (size_t i = head_raw_size; i < raw_size; i++) tail[i - head_raw_size] = raw_tokens[i];
+            return tail;
+        }();
+
+        // whether the pattern contains a cursor token
+        static constexpr bool has_cursor = [] {
+            for (auto const& token : raw_tokens) {
+                if (token.type == token_t::type_t::cursor) return true;
+            }
+            return false;
+        }();
+
+        // whether the cursor is after a gap, it's then found by the tail match and cursor_pos is not used
+        static constexpr bool tail_cursor = [] {
+            for (auto const& token : tail) {
+                if (token.type == token_t::type_t::cursor) return true;
+            }
+            return false;
+        }();
+
+        // position of the cursor token in the pattern (in bytes, excluding zero-sized tokens)
+        static constexpr size_t cursor_pos = [] {
             size_t pos = 0;
-            ((std::get<I>(raw_value).type == token_t::type_t::cursor ? (void) (pos = I) : void()), ...);
+            size_t offset = 0;
+            for (size_t i = 0; i < head_raw_size; i++) {
+                if (raw_tokens[i].type == token_t::type_t::cursor) {
+                    pos = offset;
+                } else if (!raw_tokens[i].zero_sized()) {
+                    offset++;
+                }
+            }
             return pos;
-        }(std::make_index_sequence<raw_size>());
+        }();
+
+        // amount of follow tokens in the pattern
+        static constexpr size_t follow_count = [] {
+            size_t count = 0;
+            for (auto const& token : raw_tokens) count += token.type == token_t::type_t::follow;
+            return count;
+        }();
+
+        // array of follow tokens, in the order they are applied
+        static constexpr auto follows = [] {
+            std::array<token_t, follow_count> follows;
+            size_t index = 0;
+            for (auto const& token : raw_tokens) {
+                if (token.type == token_t::type_t::follow) follows[index++] = token;
+            }
+            return follows;
+        }();
 
         // array of raw types (extracted from the raw_value tuple)
         static constexpr auto raw_types = []<size_t... I>(std::index_sequence<I...>) {
-            return std::array<token_t::type_t, raw_size>{std::get<I>(raw_value).type...};
+            return std::array<token_t::type_t, raw_size>{raw_tokens[I].type...};
         }(std::make_index_sequence<raw_size>());
 
         // array of raw bytes (extracted from the raw_value tuple)
         static constexpr auto raw_bytes = []<size_t... I>(std::index_sequence<I...>) {
-            return std::array<uint8_t, raw_size>{std::get<I>(raw_value).byte...};
+            return std::array<uint8_t, raw_size>{raw_tokens[I].byte...};
         }(std::make_index_sequence<raw_size>());
 
         // array of raw masks (extracted from the raw_value tuple)
         static constexpr auto raw_masks = []<size_t... I>(std::index_sequence<I...>) {
-            return std::array<uint8_t, raw_size>{std::get<I>(raw_value).mask...};
+            return std::array<uint8_t, raw_size>{raw_tokens[I].mask...};
         }(std::make_index_sequence<raw_size>());
 
-        // array of tokens (excluding zero-sized ones)
-        static constexpr auto value = []<size_t... I>(std::index_sequence<I...>) {
+        // array of tokens of the head (excluding zero-sized ones)
+        static constexpr auto value = [] {
             std::array<token_t, size> value;
             size_t index = 0;
-            ((std::get<I>(raw_value).type != token_t::type_t::cursor
-                  ? (void) (value[index++] = std::get<I>(raw_value))
-                  : void()), ...);
+            for (size_t i = 0; i < head_raw_size; i++) {
+                if (!raw_tokens[i].zero_sized()) value[index++] = raw_tokens[i];
+            }
             return value;
-        }(std::make_index_sequence<raw_size>());
+        }();
 
         #define EXTRACT_VALUES(type, val) \
             []<size_t... I>(std::index_sequence<I...>) { \
@@ -295,6 +669,46 @@ namespace sinaps {
 
         #undef EXTRACT_VALUES
 
+        // array of masks applied to the data before comparing (0xFF for bytes, 0x00 for wildcards,
+        // the bits both bytes share for either tokens)
+        static constexpr auto match_masks = []<size_t... I>(std::index_sequence<I...>) {
+            return std::array<uint8_t, size>{
+                (types[I] == token_t::type_t::byte ? uint8_t(0xFF)
+                 : types[I] == token_t::type_t::masked ? masks[I]
+                 : types[I] == token_t::type_t::either ? uint8_t(~(bytes[I] ^ masks[I]))
+                 : uint8_t(0))...
+            };
+        }(std::make_index_sequence<size>());
+
+        // array of bytes the masked data is compared to (0x00 for wildcards)
+        static constexpr auto match_bytes = []<size_t... I>(std::index_sequence<I...>) {
+            return std::array<uint8_t, size>{
+                (types[I] == token_t::type_t::wildcard ? uint8_t(0)
+                 : types[I] == token_t::type_t::either ? uint8_t(bytes[I] & masks[I])
+                 : bytes[I])...
+            };
+        }(std::make_index_sequence<size>());
+
+        // amount of either tokens, they need an exact check after the masked compare
+        static constexpr size_t either_count = [] {
+            size_t count = 0;
+            for (auto type : types) count += type == token_t::type_t::either;
+            return count;
+        }();
+
+        // offsets of the either tokens
+        static constexpr auto either_offsets = [] {
+            std::array<size_t, either_count> offsets{};
+            size_t index = 0;
+            for (size_t j = 0; j < size; j++) {
+                if (types[j] == token_t::type_t::either) offsets[index++] = j;
+            }
+            return offsets;
+        }();
+
+        // whether the whole pattern can be verified with a few wide `(data & mask) == bytes` compares
+        static constexpr bool packed_verify = size >= 2 && size <= 64;
+
         // count number of groups of consecutive tokens (e.g. "AB?^C" has 2 groups)
         static constexpr size_t group_count = []<size_t... I>(std::index_sequence<I...>) {
             size_t count = 0;
@@ -308,15 +722,7 @@ namespace sinaps {
             return count;
         }(std::make_index_sequence<size>());
 
-        struct group_t {
-            size_t offset{};
-            size_t count{};
-            constexpr group_t() = default;
-            constexpr group_t(size_t offset, size_t count) : offset(offset), count(count) {}
-            [[nodiscard]] constexpr size_t size() const { return count; }
-            constexpr uint8_t* begin(uint8_t* data) const { return data + offset; }
-            constexpr uint8_t* end(uint8_t* data) const { return data + offset + count; }
-        };
+        using group_t = sinaps::group_t;
 
         // array of groups
         static constexpr std::array<group_t, group_count> groups = []<size_t... I>(std::index_sequence<I...>) {
@@ -336,13 +742,30 @@ namespace sinaps {
             return groups;
         }(std::make_index_sequence<size>());
 
+        // pair of the least frequent fully-specified bytes, used to prefilter the scan
+        static constexpr anchor_t anchor_pair = select_anchor(value);
+        // offset of the least frequent fully-specified byte
+        static constexpr size_t anchor_offset = anchor_pair.first;
+
+        // bad-character skip table, indexed by the last byte of the last group
+        static constexpr skip_table_t skip_table = build_skip_table(
+            value, group_count > 0 ? groups[group_count - 1].offset + groups[group_count - 1].count - 1 : 0
+        );
+
         static consteval size_t count_string_length() {
             size_t length = 0;
             for (size_t i = 0; i < raw_size; i++) {
                 if (raw_types[i] == token_t::type_t::byte) {
                     length += 3;
                 } else if (raw_types[i] == token_t::type_t::masked) {
-                    length += 6;
+                    length += impl::is_nibble(raw_tokens[i]) ? 3 : 6;
+                } else if (raw_types[i] == token_t::type_t::either) {
+                    length += 8;
+                } else if (raw_types[i] == token_t::type_t::follow) {
+                    length += 2 + (raw_bytes[i] ? 2 : 0) + (raw_masks[i] ? 3 : 0);
+                } else if (raw_types[i] == token_t::type_t::gap) {
+                    length += 3 + utils::decimal_length(raw_bytes[i]);
+                    if (raw_bytes[i] != raw_masks[i]) length += 1 + utils::decimal_length(raw_masks[i]);
                 } else {
                     length += 2;
                 }
@@ -360,6 +783,10 @@ namespace sinaps {
                     auto hex = utils::hex_to_string(raw_bytes[i]);
                     str[index++] = hex[0];
                     str[index++] = hex[1];
+                } else if (type == token_t::type_t::masked && impl::is_nibble(raw_tokens[i])) {
+                    auto hex = utils::hex_to_string(raw_bytes[i]);
+                    str[index++] = raw_masks[i] == 0xF0 ? hex[0] : '?';
+                    str[index++] = raw_masks[i] == 0xF0 ? '?' : hex[1];
                 } else if (type == token_t::type_t::masked) {
                     auto hex = utils::hex_to_string(raw_bytes[i]);
                     str[index++] = hex[0];
@@ -368,8 +795,39 @@ namespace sinaps {
                     hex = utils::hex_to_string(raw_masks[i]);
                     str[index++] = hex[0];
                     str[index++] = hex[1];
+                } else if (type == token_t::type_t::either) {
+                    auto hex = utils::hex_to_string(raw_bytes[i]);
+                    str[index++] = '(';
+                    str[index++] = hex[0];
+                    str[index++] = hex[1];
+                    str[index++] = '|';
+                    hex = utils::hex_to_string(raw_masks[i]);
+                    str[index++] = hex[0];
+                    str[index++] = hex[1];
+                    str[index++] = ')';
                 } else if (type == token_t::type_t::wildcard) {
                     str[index++] = '?';
+                } else if (type == token_t::type_t::follow) {
+                    str[index++] = '@';
+                    if (raw_bytes[i]) {
+                        auto hex = utils::hex_to_string(raw_bytes[i]);
+                        str[index++] = hex[0];
+                        str[index++] = hex[1];
+                    }
+                    if (raw_masks[i]) {
+                        auto hex = utils::hex_to_string(raw_masks[i]);
+                        str[index++] = '+';
+                        str[index++] = hex[0];
+                        str[index++] = hex[1];
+                    }
+                } else if (type == token_t::type_t::gap) {
+                    str[index++] = '[';
+                    index = utils::write_decimal(str, index, raw_bytes[i]);
+                    if (raw_bytes[i] != raw_masks[i]) {
+                        str[index++] = '-';
+                        index = utils::write_decimal(str, index, raw_masks[i]);
+                    }
+                    str[index++] = ']';
                 } else {
                     str[index++] = '^';
                 }
@@ -381,79 +839,181 @@ namespace sinaps {
     };
 
     namespace impl {
-        template <utils::FixedString S>
-        consteval size_t sizeOfPatternString() {
-            size_t size = 0;
-            for (size_t i = 0; i < S.size(); i++) {
-                if (S[i] == ' ') {
-                    continue;
+        /// @brief Token for a set of byte values: a masked byte if the values only differ in a fixed set of bits
+        /// (e.g. <c>74</c> and <c>75</c>), an either token for any other pair.
+        /// @throws std::invalid_argument If the set is empty, or can't be stored in a single token.
+        constexpr token_t alternative_token(std::array<bool, 256> const& set) {
+            size_t count = 0;
+            unsigned first = 0, second = 0, diff = 0;
+            for (unsigned value = 0; value < 256; value++) {
+                if (!set[value]) continue;
+                if (count == 0) first = value;
+                if (count == 1) second = value;
+                diff |= value ^ first;
+                count++;
+            }
+
+            if (count == 0) {
+                throw std::invalid_argument("Empty alternative in pattern");
+            }
+            if (count == size_t(1) << std::popcount(diff)) {
+                return token_t(static_cast<uint8_t>(first & ~diff), static_cast<uint8_t>(~diff));
+            }
+            if (count == 2) {
+                return token_t(token_t::type_t::either, static_cast<uint8_t>(first), static_cast<uint8_t>(second));
+            }
+            throw std::invalid_argument("Pattern alternatives must be two bytes, or differ in a fixed set of bits");
+        }
+
+        /// @brief Parse a pattern string, and call <c>emit</c> with every token.
+        /// Tokens are separated by spaces: bytes (<c>48</c>), masked bytes (<c>48&F0</c>), nibbles (<c>4?</c>, <c>?8</c>),
+        /// wildcards (<c>?</c>), alternatives (<c>(74|75)</c>, see <c>alternative_token</c>), the cursor (<c>^</c>)
+        /// follows (<c>@</c>, <c>@OO</c> or <c>@OO+EE</c>, see <c>mask::follow</c>) and gaps (<c>[4-16]</c> or <c>[8]</c>,
+        /// in decimal, see <c>mask::gap</c>).
+        /// @throws std::invalid_argument If an alternative or a gap is malformed.
+        template <typename Emit>
+        constexpr void parsePatternString(std::string_view str, Emit&& emit) {
+            // up to two hex digits after position `i`, which is moved to the last one
+            auto read_hex = [str](size_t& i) {
+                uint8_t value = 0;
+                for (size_t n = 0; n < 2 && i + 1 < str.size() && utils::is_hex(str[i + 1]); n++) {
+                    value = static_cast<uint8_t>(value << 4 | utils::from_hex(str[++i]));
                 }
-                size++;
-                if (utils::is_hex(S[i])) {
+                return value;
+            };
+
+            // single byte at position `i` (byte, masked byte, nibble or wildcard), `i` is moved to its last character
+            auto read_byte = [str, read_hex](size_t& i) {
+                if (str[i] == '?') {
+                    if (i + 1 < str.size() && utils::is_hex(str[i + 1])) {
+                        return token_t(utils::from_hex(str[++i]), 0x0F);
+                    }
+                    return token_t();
+                }
+
+                auto byte = static_cast<uint8_t>(utils::from_hex(str[i]) << 4);
+                if (i + 1 < str.size() && str[i + 1] == '?') {
                     i++;
+                    return token_t(byte, 0xF0);
                 }
-                if (i + 1 < S.size() && S[i + 1] == '&') {
-                    i += 3;
+                if (i + 1 < str.size()) {
+                    byte |= utils::from_hex(str[++i]);
                 }
-                if (S[i] != '?' && S[i] != '^') {
+
+                // check for masked byte
+                if (i + 1 < str.size() && str[i + 1] == '&') {
                     i++;
+                    return token_t(byte, read_hex(i));
                 }
-            }
-            return size;
-        }
+                return token_t(byte);
+            };
 
-        template <utils::FixedString S, size_t N = sizeOfPatternString<S>()>
-        consteval std::array<token_t, N> tokenizePatternString() {
-            std::array<token_t, N> tokens;
+            // `(A|B|...)` at position `i`, `i` is moved to the closing parenthesis
+            auto read_alternatives = [str, read_byte](size_t& i) {
+                auto skip_spaces = [str](size_t& i) {
+                    while (++i < str.size() && str[i] == ' ') {}
+                    if (i >= str.size()) {
+                        throw std::invalid_argument("Unclosed alternative in pattern");
+                    }
+                };
 
-            size_t index = 0;
-            for (size_t i = 0; i < S.size(); i++) {
-                switch (S[i]) {
-                    case ' ': continue;
-                    case '?': tokens[index++] = token_t(); break;
-                    case '^': tokens[index++] = token_t(token_t::type_t::cursor); break;
-                    default: {
-                        uint8_t byte = utils::from_hex(S[i]) << 4 | utils::from_hex(S[i + 1]);
-                        tokens[index++] = token_t(byte);
-                        i++;
-
-                        // check for masked byte
-                        if (i + 1 < S.size() && S[i + 1] == '&') {
-                            uint8_t mask = utils::from_hex(S[i + 2]) << 4 | utils::from_hex(S[i + 3]);
-                            tokens[index - 1] = token_t(byte, mask);
-                            i += 3;
-                        }
-                    } break;
+                std::array<bool, 256> set{};
+                while (true) {
+                    skip_spaces(i);
+                    if (str[i] != '?' && !utils::is_hex(str[i])) {
+                        throw std::invalid_argument("Expected a byte in pattern alternative");
+                    }
+                    token_t token = read_byte(i);
+                    for (unsigned value = 0; value < 256; value++) {
+                        set[value] = set[value] || token.matches(static_cast<uint8_t>(value));
+                    }
+
+                    skip_spaces(i);
+                    if (str[i] == ')') break;
+                    if (str[i] != '|') {
+                        throw std::invalid_argument("Expected '|' or ')' in pattern alternative");
+                    }
                 }
-            }
+                return alternative_token(set);
+            };
 
-            return tokens;
-        }
+            // `[min-max]` or `[count]` at position `i`, `i` is moved to the closing bracket
+            auto read_gap = [str](size_t& i) {
+                auto read_decimal = [str](size_t& i) {
+                    if (i + 1 >= str.size() || str[i + 1] < '0' || str[i + 1] > '9') {
+                        throw std::invalid_argument("Expected a number in pattern gap");
+                    }
+                    unsigned value = 0;
+                    while (i + 1 < str.size() && str[i + 1] >= '0' && str[i + 1] <= '9') {
+                        value = value * 10 + static_cast<unsigned>(str[++i] - '0');
+                        if (value > 255) {
+                            throw std::invalid_argument("Pattern gaps can't be longer than 255 bytes");
+                        }
+                    }
+                    return static_cast<uint8_t>(value);
+                };
 
-        constexpr std::vector<token_t> tokenizePatternStringRuntime(std::string_view str) {
-            std::vector<token_t> tokens;
-            tokens.reserve(str.size() / 2);
+                uint8_t min = read_decimal(i);
+                uint8_t max = min;
+                if (i + 1 < str.size() && str[i + 1] == '-') {
+                    i++;
+                    max = read_decimal(i);
+                }
+                if (i + 1 >= str.size() || str[i + 1] != ']') {
+                    throw std::invalid_argument("Unclosed gap in pattern");
+                }
+                i++;
+                if (min > max) {
+                    throw std::invalid_argument("The minimum of a pattern gap can't be larger than its maximum");
+                }
+                return token_t(token_t::type_t::gap, min, max);
+            };
 
+            bool sized = false; // whether a token that takes space was emitted
             for (size_t i = 0; i < str.size(); i++) {
                 switch (str[i]) {
                     case ' ': continue;
-                    case '?': tokens.emplace_back(); break;
-                    case '^': tokens.emplace_back(token_t::type_t::cursor); break;
-                    default: {
-                        uint8_t byte = utils::from_hex(str[i]) << 4 | utils::from_hex(str[i + 1]);
-                        tokens.emplace_back(byte);
-                        i++;
-
-                        // check for masked byte
-                        if (i + 1 < str.size() && str[i + 1] == '&') {
-                            uint8_t mask = utils::from_hex(str[i + 2]) << 4 | utils::from_hex(str[i + 3]);
-                            tokens.back() = token_t(byte, mask);
-                            i += 3;
+                    case '[':
+                        if (!sized) {
+                            throw std::invalid_argument("A pattern can't start with a gap");
+                        }
+                        emit(read_gap(i));
+                        break;
+                    case '^': emit(token_t(token_t::type_t::cursor)); break;
+                    case '(': emit(read_alternatives(i)); sized = true; break;
+                    case '@': {
+                        uint8_t offset = read_hex(i);
+                        uint8_t extra = 0;
+                        if (i + 1 < str.size() && str[i + 1] == '+') {
+                            i++;
+                            extra = read_hex(i);
                         }
+                        emit(token_t(token_t::type_t::follow, offset, extra));
                     } break;
+                    default: emit(read_byte(i)); sized = true; break;
                 }
             }
+        }
+
+        template <utils::FixedString S>
+        consteval size_t sizeOfPatternString() {
+            size_t size = 0;
+            parsePatternString(S, [&size](token_t) { size++; });
+            return size;
+        }
+
+        template <utils::FixedString S, size_t N = sizeOfPatternString<S>()>
+        consteval std::array<token_t, N> tokenizePatternString() {
+            std::array<token_t, N> tokens;
+            size_t index = 0;
+            parsePatternString(S, [&](token_t token) { tokens[index++] = token; });
+            return tokens;
+        }
 
+        constexpr std::vector<token_t> tokenizePatternStringRuntime(std::string_view str) {
+            std::vector<token_t> tokens;
+            tokens.reserve(str.size() / 2);
+            parsePatternString(str, [&tokens](token_t token) { tokens.push_back(token); });
             return tokens;
         }
 
@@ -461,10 +1021,16 @@ namespace sinaps {
         consteval auto unwrapToken() {
             if constexpr (Token.type == token_t::type_t::cursor) {
                 return mask::cursor{};
+            } else if constexpr (Token.type == token_t::type_t::follow) {
+                return mask::follow<Token.byte, Token.mask>{};
             } else if constexpr (Token.type == token_t::type_t::byte) {
                 return mask::byte<Token.byte>{};
             } else if constexpr (Token.type == token_t::type_t::masked) {
                 return mask::masked<Token.byte, Token.mask>{};
+            } else if constexpr (Token.type == token_t::type_t::either) {
+                return mask::either<Token.byte, Token.mask>{};
+            } else if constexpr (Token.type == token_t::type_t::gap) {
+                return mask::gap<Token.byte, Token.mask>{};
             } else {
                 return mask::any{};
             }
@@ -491,14 +1057,46 @@ namespace sinaps {
             case token_t::type_t::byte: return utils::hex_to_string(token.byte);
             case token_t::type_t::wildcard: return "?";
             case token_t::type_t::cursor: return "^";
+            case token_t::type_t::follow: {
+                std::string str = "@";
+                if (token.byte) {
+                    str += utils::hex_to_string(token.byte);
+                }
+                if (token.mask) {
+                    str += '+';
+                    str += utils::hex_to_string(token.mask);
+                }
+                return str;
+            }
             case token_t::type_t::masked: {
+                auto hex = utils::hex_to_string(token.byte);
+                if (impl::is_nibble(token)) {
+                    return token.mask == 0xF0 ? std::string{hex[0], '?'} : std::string{'?', hex[1]};
+                }
                 std::string str;
                 str.reserve(6);
-                str += utils::hex_to_string(token.byte);
+                str += hex;
                 str += '&';
                 str += utils::hex_to_string(token.mask);
                 return str;
             } break;
+            case token_t::type_t::gap: {
+                std::string str = "[" + std::to_string(token.byte);
+                if (token.byte != token.mask) {
+                    str += '-';
+                    str += std::to_string(token.mask);
+                }
+                str += ']';
+                return str;
+            }
+            case token_t::type_t::either: {
+                std::string str = "(";
+                str += utils::hex_to_string(token.byte);
+                str += '|';
+                str += utils::hex_to_string(token.mask);
+                str += ')';
+                return str;
+            }
             default: return "";
         }
     }
@@ -518,10 +1116,11 @@ namespace sinaps {
                 case token_t::type_t::cursor:
                     str += "^ ";
                     break;
+                case token_t::type_t::follow:
                 case token_t::type_t::masked:
-                    str += utils::hex_to_string(token.byte);
-                    str += '&';
-                    str += utils::hex_to_string(token.mask);
+                case token_t::type_t::either:
+                case token_t::type_t::gap:
+                    str += to_string(token);
                     str += ' ';
                     break;
                 default: break;
@@ -539,196 +1138,4330 @@ namespace sinaps {
 
 #endif // SINAPS_PATTERN_HPP
 
-#include <array>
+#ifndef SINAPS_SIMD_HPP
+#define SINAPS_SIMD_HPP
+
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 
+#ifndef SINAPS_NO_SIMD
+    #if defined(__AVX2__)
+        #define SINAPS_SIMD_AVX2
+        #include <immintrin.h>
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define SINAPS_SIMD_SSE2
+        #include <emmintrin.h>
+    #elif defined(__ARM_NEON) || defined(_M_ARM64)
+        #define SINAPS_SIMD_NEON
+        #include <arm_neon.h>
+    #endif
 
-#ifndef SINAPS_RESTRICT
-    #if defined(_MSC_VER) || defined(__clang__)
-        #define SINAPS_RESTRICT __restrict
-    #elif defined(__GNUC__)
-        #define SINAPS_RESTRICT __attribute__((restrict))
-    #else
-        #define SINAPS_RESTRICT
+    // wider x86 kernels are compiled with target attributes, and picked at runtime from cpuid
+    #if !defined(SINAPS_NO_DISPATCH) && (defined(SINAPS_SIMD_SSE2) || defined(SINAPS_SIMD_AVX2)) && \
+        (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+        #define SINAPS_SIMD_DISPATCH
+        #include <immintrin.h>
+        #if defined(_MSC_VER) && !defined(__clang__)
+            #include <intrin.h>
+        #else
+            #include <cpuid.h>
+        #endif
     #endif
 #endif
 
-#ifndef SINAPS_HOT
-    #if defined(__GNUC__) || defined(__clang__)
-        #define SINAPS_HOT [[gnu::hot]]
-    #else
-        #define SINAPS_HOT
-    #endif
+#if defined(SINAPS_SIMD_DISPATCH) && (defined(__GNUC__) || defined(__clang__))
+    #define SINAPS_TARGET(isa) [[gnu::target(isa)]]
+    #define SINAPS_TARGET_FLATTEN(isa) [[gnu::target(isa), gnu::flatten]]
+#else
+    #define SINAPS_TARGET(isa)
+    #define SINAPS_TARGET_FLATTEN(isa)
 #endif
 
-namespace sinaps {
-    constexpr intptr_t not_found = -1;
+#if defined(SINAPS_SIMD_AVX2)
+    #define SINAPS_TARGET_AVX2
+#else
+    #define SINAPS_TARGET_AVX2 SINAPS_TARGET("avx2")
+#endif
 
-    /// @brief Find an index of a pattern in a data buffer.
-    /// The pattern is a sequence of masks (see <c>sinaps::masks</c> namespace).
-    /// @param data The data buffer to search in.
-    /// @param size The size of the data buffer.
-    /// @param step_size The step size for the search (default is 1).
-    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
-    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+namespace sinaps::simd {
+    // Every kernel exposes the same interface:
+    // - width: amount of positions compared at once
+    // - lane_bits: amount of bits each position occupies in the returned mask
+    // - match(a, b0, b, b1): bitmask of positions `i` in [0, width) where `a[i] == b0 && b[i] == b1`
+    //
+    // Kernels that can verify a whole window of `width` bytes also expose:
+    // - vector_t: register type
+    // - masked_diff(data, mask, bytes): non-zero lanes where `(data & mask) != bytes`
+    // - merge(a, b): combines two results of `masked_diff`
+    // - none(a): whether all lanes are zero
+
+    /// @brief Word kernel, verifies <c>sizeof(T)</c> bytes at once using general purpose registers.
+    template <typename T>
+    struct word {
+        static constexpr size_t width = sizeof(T);
+        using vector_t = T;
+
+        static vector_t masked_diff(uint8_t const* data, uint8_t const* mask, uint8_t const* bytes) {
+            T d, m, b;
+            std::memcpy(&d, data, sizeof(T));
+            std::memcpy(&m, mask, sizeof(T));
+            std::memcpy(&b, bytes, sizeof(T));
+            return static_cast<T>((d & m) ^ b);
+        }
+
+        static vector_t merge(vector_t a, vector_t b) { return a | b; }
+        static bool none(vector_t a) { return a == 0; }
+    };
+
+    /// @brief Fallback kernel, compares one position at a time.
+    struct scalar {
+        static constexpr size_t width = 1;
+        static constexpr size_t lane_bits = 1;
+        using mask_t = uint32_t;
+
+        static mask_t match(uint8_t const* a, uint8_t b0, uint8_t const* b, uint8_t b1) {
+            return a[0] == b0 && b[0] == b1;
+        }
+    };
+
+#if defined(SINAPS_SIMD_SSE2) || defined(SINAPS_SIMD_AVX2)
+    /// @brief SSE2 kernel, compares 16 positions at once.
+    struct sse2 {
+        static constexpr size_t width = 16;
+        static constexpr size_t lane_bits = 1;
+        using mask_t = uint32_t;
+
+        static mask_t match(uint8_t const* a, uint8_t b0, uint8_t const* b, uint8_t b1) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b));
+            __m128i eq = _mm_and_si128(
+                _mm_cmpeq_epi8(va, _mm_set1_epi8(static_cast<char>(b0))),
+                _mm_cmpeq_epi8(vb, _mm_set1_epi8(static_cast<char>(b1)))
+            );
+            return static_cast<mask_t>(_mm_movemask_epi8(eq));
+        }
+
+        using vector_t = __m128i;
+
+        static vector_t masked_diff(uint8_t const* data, uint8_t const* mask, uint8_t const* bytes) {
+            __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data));
+            __m128i m = _mm_load_si128(reinterpret_cast<__m128i const*>(mask));
+            __m128i b = _mm_load_si128(reinterpret_cast<__m128i const*>(bytes));
+            return _mm_xor_si128(_mm_and_si128(d, m), b);
+        }
+
+        static vector_t merge(vector_t a, vector_t b) { return _mm_or_si128(a, b); }
+        static bool none(vector_t a) { return _mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_setzero_si128())) == 0xFFFF; }
+    };
+#endif
+
+#if defined(SINAPS_SIMD_AVX2) || defined(SINAPS_SIMD_DISPATCH)
+    /// @brief AVX2 kernel, compares 32 positions at once.
+    /// Without <c>-mavx2</c> it's compiled for AVX2 on its own, and only used if the CPU has it (see <c>dispatch_level</c>).
+    struct avx2 {
+        static constexpr size_t width = 32;
+        static constexpr size_t lane_bits = 1;
+        using mask_t = uint32_t;
+
+        SINAPS_TARGET_AVX2 static mask_t match(uint8_t const* a, uint8_t b0, uint8_t const* b, uint8_t b1) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b));
+            __m256i eq = _mm256_and_si256(
+                _mm256_cmpeq_epi8(va, _mm256_set1_epi8(static_cast<char>(b0))),
+                _mm256_cmpeq_epi8(vb, _mm256_set1_epi8(static_cast<char>(b1)))
+            );
+            return static_cast<mask_t>(_mm256_movemask_epi8(eq));
+        }
+
+        using vector_t = __m256i;
+
+        SINAPS_TARGET_AVX2 static vector_t masked_diff(uint8_t const* data, uint8_t const* mask, uint8_t const* bytes) {
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data));
+            __m256i m = _mm256_load_si256(reinterpret_cast<__m256i const*>(mask));
+            __m256i b = _mm256_load_si256(reinterpret_cast<__m256i const*>(bytes));
+            return _mm256_xor_si256(_mm256_and_si256(d, m), b);
+        }
+
+        SINAPS_TARGET_AVX2 static vector_t merge(vector_t a, vector_t b) { return _mm256_or_si256(a, b); }
+        SINAPS_TARGET_AVX2 static bool none(vector_t a) { return _mm256_testz_si256(a, a) != 0; }
+    };
+#endif
+
+#if defined(SINAPS_SIMD_DISPATCH)
+    /// @brief AVX-512 kernel, compares 64 positions at once. Only used for the anchor scan, and only if the CPU has
+    /// AVX-512BW (see <c>dispatch_level</c>).
+    struct avx512 {
+        static constexpr size_t width = 64;
+        static constexpr size_t lane_bits = 1;
+        using mask_t = uint64_t;
+
+        SINAPS_TARGET("avx512f,avx512bw") static mask_t match(uint8_t const* a, uint8_t b0, uint8_t const* b, uint8_t b1) {
+            __m512i va = _mm512_loadu_si512(a);
+            __m512i vb = _mm512_loadu_si512(b);
+            return _mm512_cmpeq_epi8_mask(va, _mm512_set1_epi8(static_cast<char>(b0))) &
+                   _mm512_cmpeq_epi8_mask(vb, _mm512_set1_epi8(static_cast<char>(b1)));
+        }
+    };
+#endif
+
+#if defined(SINAPS_SIMD_NEON)
+    /// @brief NEON kernel, compares 16 positions at once.
+    /// NEON has no movemask, so each position occupies a nibble of the mask.
+    struct neon {
+        static constexpr size_t width = 16;
+        static constexpr size_t lane_bits = 4;
+        using mask_t = uint64_t;
+
+        static mask_t match(uint8_t const* a, uint8_t b0, uint8_t const* b, uint8_t b1) {
+            uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(a), vdupq_n_u8(b0)), vceqq_u8(vld1q_u8(b), vdupq_n_u8(b1)));
+            uint8x8_t packed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+            return vget_lane_u64(vreinterpret_u64_u8(packed), 0);
+        }
+
+        using vector_t = uint8x16_t;
+
+        static vector_t masked_diff(uint8_t const* data, uint8_t const* mask, uint8_t const* bytes) {
+            return veorq_u8(vandq_u8(vld1q_u8(data), vld1q_u8(mask)), vld1q_u8(bytes));
+        }
+
+        static vector_t merge(vector_t a, vector_t b) { return vorrq_u8(a, b); }
+        static bool none(vector_t a) {
+            return vget_lane_u64(vreinterpret_u64_u8(vorr_u8(vget_low_u8(a), vget_high_u8(a))), 0) == 0;
+        }
+    };
+#endif
+
+    /// @brief Kernel selected at compile time, based on the target instruction set.
+#if defined(SINAPS_SIMD_AVX2)
+    using native = avx2;
+#elif defined(SINAPS_SIMD_SSE2)
+    using native = sse2;
+#elif defined(SINAPS_SIMD_NEON)
+    using native = neon;
+#else
+    using native = scalar;
+#endif
+
+    /// @brief Instruction set tiers, for the kernels picked at runtime.
+    enum class level_t : uint8_t {
+        scalar,
+        sse2,   // 16-byte vectors (SSE2, or NEON)
+        avx2,   // 32-byte vectors
+        avx512  // 64-byte vectors (AVX-512BW)
+    };
+
+    /// @brief Tier of the kernel selected at compile time.
+    constexpr level_t native_level =
+#if defined(SINAPS_SIMD_AVX2)
+        level_t::avx2;
+#elif defined(SINAPS_SIMD_SSE2) || defined(SINAPS_SIMD_NEON)
+        level_t::sse2;
+#else
+        level_t::scalar;
+#endif
+
+    namespace impl {
+        /// @brief Highest tier supported by both the CPU and the OS (which must save the wide registers).
+        inline level_t detect_level() {
+#if defined(SINAPS_SIMD_DISPATCH)
+            auto cpuid = [](unsigned leaf, unsigned subleaf, unsigned (&regs)[4]) {
+    #if defined(_MSC_VER) && !defined(__clang__)
+                int out[4];
+                __cpuidex(out, static_cast<int>(leaf), static_cast<int>(subleaf));
+                for (int i = 0; i < 4; i++) regs[i] = static_cast<unsigned>(out[i]);
+                return true;
+    #else
+                return __get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3]) != 0;
+    #endif
+            };
+            auto xgetbv = []() -> uint64_t {
+    #if defined(_MSC_VER) && !defined(__clang__)
+                return _xgetbv(0);
+    #else
+                unsigned lo, hi;
+                __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+                return uint64_t(hi) << 32 | lo;
+    #endif
+            };
+
+            unsigned leaf1[4], leaf7[4];
+            if (!cpuid(1, 0, leaf1) || !(leaf1[2] & (1u << 27)) || !(leaf1[2] & (1u << 28))) {
+                return native_level; // no OSXSAVE or no AVX
+            }
+            uint64_t xcr0 = xgetbv();
+            if ((xcr0 & 0x6) != 0x6 || !cpuid(7, 0, leaf7)) {
+                return native_level;
+            }
+
+            bool avx2 = leaf7[1] & (1u << 5);
+            bool avx512 = (leaf7[1] & (1u << 16)) && (leaf7[1] & (1u << 30)) && (xcr0 & 0xE0) == 0xE0;
+            if (avx2 && avx512) return level_t::avx512;
+            if (avx2) return level_t::avx2;
+#endif
+            return native_level;
+        }
+
+        inline std::atomic<level_t>& dispatch_level_ref() {
+            static std::atomic<level_t> level{detect_level()};
+            return level;
+        }
+    }
+
+    /// @brief Tier used by the scans, detected once on first use. Never lower than <c>native_level</c>.
+    inline level_t dispatch_level() {
+        return impl::dispatch_level_ref().load(std::memory_order_relaxed);
+    }
+
+    /// @brief Lower the tier used by the scans (e.g. to compare kernels), it can't be raised above what the CPU supports.
+    /// @return The tier now in use.
+    inline level_t limit_dispatch_level(level_t level) {
+        level_t supported = impl::detect_level();
+        level_t used = level < supported ? level : supported;
+        if (used < native_level) used = native_level;
+        impl::dispatch_level_ref().store(used, std::memory_order_relaxed);
+        return used;
+    }
+
+    namespace impl {
+        template <size_t N>
+        constexpr auto select_packed_kernel() {
+#if defined(SINAPS_SIMD_AVX2)
+            if constexpr (N >= 32) return avx2{};
+            else
+#endif
+#if defined(SINAPS_SIMD_SSE2) || defined(SINAPS_SIMD_AVX2)
+            if constexpr (N >= 16) return sse2{};
+            else
+#elif defined(SINAPS_SIMD_NEON)
+            if constexpr (N >= 16) return neon{};
+            else
+#endif
+            if constexpr (N >= 8) return word<uint64_t>{};
+            else if constexpr (N >= 4) return word<uint32_t>{};
+            else return word<uint16_t>{};
+        }
+    }
+
+    /// @brief Widest kernel that can verify a window of <c>N</c> bytes (wider windows are split into chunks).
+    template <size_t N>
+    using packed_kernel = decltype(impl::select_packed_kernel<N>());
+}
+
+#endif // SINAPS_SIMD_HPP
+
+#ifndef SINAPS_STATS_HPP
+#define SINAPS_STATS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+namespace sinaps {
+    /// @brief Counters of the scans run inside a <c>sinaps::stats_scope</c>.
+    /// The counters are only collected if <c>SINAPS_ENABLE_STATS</c> is defined (for the whole program),
+    /// otherwise the hooks compile to nothing and only the time is measured.
+    struct scan_stats {
+        uint64_t bytes = 0;       // positions examined by the scan loops
+        uint64_t candidates = 0;  // positions that passed the prefilter (anchor pair, skip byte or batch bucket)
+        uint64_t verifies = 0;    // full checks of the pattern
+        uint64_t matches = 0;     // matches found (parallel scans may find more than the one they return)
+        uint64_t nanoseconds = 0; // time spent in the scope
+
+        constexpr scan_stats& operator+=(scan_stats const& other) {
+            bytes += other.bytes;
+            candidates += other.candidates;
+            verifies += other.verifies;
+            matches += other.matches;
+            nanoseconds += other.nanoseconds;
+            return *this;
+        }
+    };
+
+    namespace impl {
+        /// @brief Where the hooks of the current thread record to.
+        struct stats_sink_t {
+            scan_stats* total = nullptr;
+            std::span<scan_stats> patterns; // per-pattern counters of batch scans, empty if not wanted
+        };
+
+        inline stats_sink_t& stats_sink() {
+            thread_local stats_sink_t sink;
+            return sink;
+        }
+
+        inline void count_stat(uint64_t scan_stats::* field, uint64_t amount) {
+            if (auto* total = stats_sink().total) {
+                total->*field += amount;
+            }
+        }
+
+        /// @brief Count for a single pattern of a batch scan, and for the total.
+        inline void count_pattern_stat(size_t index, uint64_t scan_stats::* field, uint64_t amount) {
+            auto& sink = stats_sink();
+            if (index < sink.patterns.size()) {
+                sink.patterns[index].*field += amount;
+            }
+            if (sink.total) {
+                sink.total->*field += amount;
+            }
+        }
+
+        /// @brief Install a sink on the current thread, the previous one is restored on destruction.
+        class stats_guard {
+        public:
+            explicit stats_guard(stats_sink_t sink) : m_previous(stats_sink()) { stats_sink() = sink; }
+            ~stats_guard() { stats_sink() = m_previous; }
+
+            stats_guard(stats_guard const&) = delete;
+            stats_guard& operator=(stats_guard const&) = delete;
+
+        private:
+            stats_sink_t m_previous;
+        };
+    }
+
+    /// @brief Collect the counters of every scan run on this thread (and by the parallel workers it starts) while
+    /// the scope is alive, and the time it was alive. Scopes nest, the innermost one gets the counters.
+    /// Wrap each <c>find</c> in its own scope to get the numbers of a single pattern.
+    class stats_scope {
+    public:
+        /// @param stats Output, the counters are added to it.
+        explicit stats_scope(scan_stats& stats) : stats_scope(stats, {}) {}
+
+        /// @param stats Output, the counters of all patterns are added to it.
+        /// @param patterns Output, batch scans (<c>sinaps::find_all</c>) also add the counters of pattern <c>k</c>
+        /// to <c>patterns[k]</c>. Patterns without a fully-specified byte are scanned on their own, and only counted in the total.
+        stats_scope(scan_stats& stats, std::span<scan_stats> patterns)
+            : m_stats(stats), m_guard({&stats, patterns}), m_start(std::chrono::steady_clock::now()) {}
+
+        ~stats_scope() {
+            auto elapsed = std::chrono::steady_clock::now() - m_start;
+            m_stats.nanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+        stats_scope(stats_scope const&) = delete;
+        stats_scope& operator=(stats_scope const&) = delete;
+
+    private:
+        scan_stats& m_stats;
+        impl::stats_guard m_guard;
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
+
+#ifdef SINAPS_ENABLE_STATS
+    #define SINAPS_STATS_ADD(field, amount) \
+        do { if (!std::is_constant_evaluated()) ::sinaps::impl::count_stat(&::sinaps::scan_stats::field, amount); } while (false)
+    #define SINAPS_STATS_ADD_PATTERN(index, field, amount) \
+        do { if (!std::is_constant_evaluated()) ::sinaps::impl::count_pattern_stat(index, &::sinaps::scan_stats::field, amount); } while (false)
+#else
+    #define SINAPS_STATS_ADD(field, amount) ((void) 0)
+    #define SINAPS_STATS_ADD_PATTERN(index, field, amount) ((void) 0)
+#endif
+
+#endif // SINAPS_STATS_HPP
+
+#ifndef SINAPS_FIND_HPP
+#define SINAPS_FIND_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+
+#ifndef SINAPS_RESTRICT
+    #if defined(_MSC_VER) || defined(__clang__)
+        #define SINAPS_RESTRICT __restrict
+    #elif defined(__GNUC__)
+        #define SINAPS_RESTRICT __attribute__((restrict))
+    #else
+        #define SINAPS_RESTRICT
+    #endif
+#endif
+
+#ifndef SINAPS_HOT
+    #if defined(__GNUC__) || defined(__clang__)
+        #define SINAPS_HOT [[gnu::hot]]
+    #else
+        #define SINAPS_HOT
+    #endif
+#endif
+
+namespace sinaps {
+    constexpr intptr_t not_found = -1;
+
+    namespace impl {
+        /// @brief Data buffer seen as memory, used to resolve follow tokens (see <c>resolve_follows</c>).
+        /// Positions are indices of the buffer.
+        struct buffer_memory {
+            uint8_t const* data;
+            size_t size;
+
+            /// @brief Whether a position is inside the buffer.
+            [[nodiscard]] constexpr bool readable(intptr_t pos) const {
+                return pos >= 0 && static_cast<size_t>(pos) < size;
+            }
+
+            /// @brief Read a little-endian 32-bit value, fails if it doesn't fit in the buffer.
+            constexpr bool load32(intptr_t pos, int32_t& value) const {
+                if (pos < 0 || static_cast<size_t>(pos) > size || size - static_cast<size_t>(pos) < 4) {
+                    return false;
+                }
+                uint8_t const* p = data + pos;
+                value = static_cast<int32_t>(uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24);
+                return true;
+            }
+        };
+
+        /// @brief Position <c>rel</c> bytes after <c>next</c>, through <c>memory.target(next, rel)</c> if the memory
+        /// has one (positions that are not laid out like addresses, e.g. file offsets of a module).
+        /// @return The target position, or <b>sinaps::not_found</b> if it can't be mapped.
+        template <typename Memory>
+        constexpr intptr_t follow_target(Memory const& memory, intptr_t next, int32_t rel) {
+            if constexpr (requires { memory.target(next, rel); }) {
+                return memory.target(next, rel);
+            } else {
+                return next + rel;
+            }
+        }
+
+        /// @brief Apply the follow tokens of a match, in order.
+        /// Each one reads the displacement at <c>index + offset</c>, and moves the index to its target.
+        /// @param index Index of the cursor of the match.
+        /// @param tokens The pattern tokens, only follow tokens are used.
+        /// @param memory Provides <c>load32(pos, value)</c> and <c>readable(pos)</c>, and optionally <c>target(next, rel)</c>.
+        /// @return The final target, or <b>sinaps::not_found</b> if a displacement or a target can't be read.
+        template <typename Memory>
+        constexpr intptr_t resolve_follows(intptr_t index, std::span<token_t const> tokens, Memory const& memory) {
+            for (auto const& token : tokens) {
+                if (token.type != token_t::type_t::follow) continue;
+
+                intptr_t at = index + token.byte;
+                int32_t rel = 0;
+                if (!memory.load32(at, rel)) {
+                    return not_found;
+                }
+                index = follow_target(memory, at + 4 + token.mask, rel);
+                if (index == not_found || !memory.readable(index)) {
+                    return not_found;
+                }
+            }
+            return index;
+        }
+
+        /// @brief Match the tail of a pattern (the tokens from its first gap on), right after the fixed head.
+        /// Gaps try their lengths from the shortest, so only the bounded window after the head is searched,
+        /// and every byte is read with a bounds check.
+        /// @param pos Position of the first tail byte (the end of the head).
+        /// @param tail The tail tokens, follow tokens are skipped.
+        /// @param cursor Set to the position of the cursor token, if the tail has one.
+        /// @return Whether the tail matches, the whole match must end before <c>size</c>.
+        constexpr bool match_tail(uint8_t const* data, size_t size, size_t pos, std::span<token_t const> tail, intptr_t& cursor) {
+            for (size_t k = 0; k < tail.size(); k++) {
+                auto const& token = tail[k];
+                switch (token.type) {
+                    case token_t::type_t::cursor:
+                        cursor = static_cast<intptr_t>(pos);
+                        continue;
+                    case token_t::type_t::follow:
+                        continue;
+                    case token_t::type_t::gap: {
+                        intptr_t saved = cursor;
+                        for (size_t length = token.byte; length <= token.mask && pos + length <= size; length++) {
+                            if (match_tail(data, size, pos + length, tail.subspan(k + 1), cursor)) {
+                                return true;
+                            }
+                            cursor = saved;
+                        }
+                        return false;
+                    }
+                    default:
+                        if (pos >= size || !token.matches(data[pos])) {
+                            return false;
+                        }
+                        pos++;
+                        break;
+                }
+            }
+            return true;
+        }
+
+        /// @brief Scan for the first candidate that resolves, candidates rejected by <c>resolve</c> are skipped.
+        /// @param begin First position to check.
+        /// @param end End of the scanned range (candidates must fit before it).
+        /// @param next Callable that accepts a position and a size, and returns the first candidate start relative to it.
+        /// @param resolve Callable that accepts a candidate start, and returns the index to report or <b>sinaps::not_found</b>.
+        /// @return The first resolved index, or <b>sinaps::not_found</b>.
+        template <typename Next, typename Resolve>
+        constexpr intptr_t find_resolved(size_t begin, size_t end, size_t step_size, Next&& next, Resolve&& resolve) {
+            for (size_t from = begin; from <= end;) {
+                intptr_t res = next(from, end - from);
+                if (res == not_found) break;
+
+                size_t start = from + static_cast<size_t>(res);
+                intptr_t index = resolve(start);
+                if (index != not_found) {
+                    SINAPS_STATS_ADD(matches, 1);
+                    return index;
+                }
+                from = start + step_size;
+            }
+            return not_found;
+        }
+
+        /// @brief Pattern masks and bytes, split into chunks of the kernel width.
+        /// The last chunk is shifted back to end with the pattern, so no byte past the pattern is ever read.
+        template <typename Pattern, typename Kernel = simd::packed_kernel<Pattern::size>>
+        struct packed_layout {
+            using kernel = Kernel;
+            static constexpr size_t width = Kernel::width;
+            static constexpr size_t chunks = (Pattern::size + width - 1) / width;
+
+            static constexpr size_t offset(size_t chunk) {
+                return chunk + 1 < chunks ? chunk * width : Pattern::size - width;
+            }
+
+            template <auto const& Source>
+            static constexpr auto split() {
+                std::array<uint8_t, chunks * width> result{};
+                for (size_t chunk = 0; chunk < chunks; chunk++) {
+                    for (size_t j = 0; j < width; j++) {
+                        result[chunk * width + j] = Source[offset(chunk) + j];
+                    }
+                }
+                return result;
+            }
+
+            alignas(64) static constexpr std::array<uint8_t, chunks * width> masks = split<Pattern::match_masks>();
+            alignas(64) static constexpr std::array<uint8_t, chunks * width> bytes = split<Pattern::match_bytes>();
+        };
+
+        /// @brief Branch-free verify, checks <c>(data & mask) == bytes</c> for the whole pattern with wide compares.
+        template <typename Pattern>
+        SINAPS_HOT bool verify_packed(uint8_t const* data) {
+            using layout = packed_layout<Pattern>;
+            using kernel = typename layout::kernel;
+
+            return [data]<size_t... I>(std::index_sequence<I...>) {
+                auto diff = kernel::masked_diff(data, layout::masks.data(), layout::bytes.data());
+                ((diff = kernel::merge(diff, kernel::masked_diff(
+                    data + layout::offset(I + 1),
+                    layout::masks.data() + (I + 1) * layout::width,
+                    layout::bytes.data() + (I + 1) * layout::width
+                ))), ...);
+                return kernel::none(diff);
+            }(std::make_index_sequence<layout::chunks - 1>());
+        }
+
+        /// @brief Alignment and padding of the byte and mask rows of runtime patterns (see <c>verify_masked</c>).
+        constexpr size_t row_alignment = 64;
+
+        /// @brief Branch-free verify of a runtime pattern, checks <c>(data & mask) == bytes</c> with the widest kernels
+        /// that fit in <c>size</c>, then narrower ones for the rest. No byte past <c>data + size</c> is read.
+        /// @param masks Masks applied to the data, aligned on <c>row_alignment</c>.
+        /// @param bytes Bytes the masked data is compared to, aligned on <c>row_alignment</c>.
+        SINAPS_HOT constexpr bool verify_masked(uint8_t const* data, uint8_t const* masks, uint8_t const* bytes, size_t size) {
+            if (std::is_constant_evaluated()) {
+                for (size_t j = 0; j < size; j++) {
+                    if ((data[j] & masks[j]) != bytes[j]) return false;
+                }
+                return true;
+            }
+
+            // offsets stay multiples of the kernel width, so the rows can be loaded aligned
+            size_t j = 0;
+            auto step = [&]<typename Kernel>(Kernel) {
+                for (; j + Kernel::width <= size; j += Kernel::width) {
+                    if (!Kernel::none(Kernel::masked_diff(data + j, masks + j, bytes + j))) return false;
+                }
+                return true;
+            };
+            return step(simd::packed_kernel<row_alignment>{}) && step(simd::packed_kernel<16>{}) &&
+                step(simd::word<uint64_t>{}) && step(simd::word<uint32_t>{}) && step(simd::word<uint16_t>{}) &&
+                (j == size || (data[j] & masks[j]) == bytes[j]);
+        }
+
+        /// @brief Either token of a runtime pattern, checked exactly after <c>verify_masked</c>.
+        struct either_t {
+            uint32_t offset = 0; // offset in bytes, excluding zero-sized tokens
+            uint8_t first = 0;
+            uint8_t second = 0;
+        };
+
+        /// @brief Exact check of the either tokens of a runtime pattern.
+        constexpr bool verify_either(uint8_t const* data, std::span<either_t const> either) {
+            for (auto const& token : either) {
+                if (data[token.offset] != token.first && data[token.offset] != token.second) return false;
+            }
+            return true;
+        }
+
+        /// @brief Exact check of the either tokens, the packed verify only compares the bits both bytes share.
+        template <typename Pattern>
+        constexpr bool verify_either(uint8_t const* data) {
+            for (size_t j : Pattern::either_offsets) {
+                if (data[j] != Pattern::bytes[j] && data[j] != Pattern::masks[j]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// @brief Masked compare of a single byte, for the verify used in constant evaluation.
+        struct byte_check_t {
+            size_t offset = 0;
+            uint8_t mask = 0;
+            uint8_t byte = 0;
+        };
+
+        /// @brief Checks of every byte that isn't a wildcard, the anchor pair first since it's the least likely
+        /// to match, so most positions are rejected after one or two compares.
+        template <typename Pattern>
+        consteval auto make_byte_checks() {
+            using pat = Pattern;
+            constexpr size_t count = [] {
+                size_t n = 0;
+                for (auto mask : pat::match_masks) n += mask != 0;
+                return n;
+            }();
+
+            std::array<byte_check_t, count> checks{};
+            size_t index = 0;
+            auto add = [&](size_t j) { checks[index++] = {j, pat::match_masks[j], pat::match_bytes[j]}; };
+            if constexpr (pat::anchor_pair.valid) {
+                add(pat::anchor_pair.first);
+                if (pat::anchor_pair.second != pat::anchor_pair.first) add(pat::anchor_pair.second);
+            }
+            for (size_t j = 0; j < pat::size; j++) {
+                bool anchor = pat::anchor_pair.valid && (j == pat::anchor_pair.first || j == pat::anchor_pair.second);
+                if (pat::match_masks[j] != 0 && !anchor) add(j);
+            }
+            return checks;
+        }
+
+        template <typename Pattern>
+        inline constexpr auto byte_checks = make_byte_checks<Pattern>();
+
+        /// @brief Verify used in constant evaluation: one compare per byte that isn't a wildcard, with an early exit.
+        template <typename Pattern>
+        constexpr bool verify_constant(uint8_t const* data) {
+            for (auto const& check : byte_checks<Pattern>) {
+                if ((data[check.offset] & check.mask) != check.byte) {
+                    return false;
+                }
+            }
+            return verify_either<Pattern>(data);
+        }
+
+        /// @brief Check whether the pattern matches the data at the given pointer.
+        /// @param data Pointer to the first byte of the potential match (at least <c>Pattern::size</c> bytes).
+        template <typename Pattern>
+        constexpr bool verify(uint8_t const* data) {
+            using pat = Pattern;
+
+            if (std::is_constant_evaluated()) {
+                return verify_constant<pat>(data);
+            }
+
+            if constexpr (pat::packed_verify) {
+                if constexpr (pat::either_count > 0) {
+                    return verify_packed<pat>(data) && verify_either<pat>(data);
+                } else {
+                    return verify_packed<pat>(data);
+                }
+            }
+
+            // check for groups
+            for (auto& group : pat::groups) {
+                if (std::memcmp(data + group.offset, pat::bytes.data() + group.offset, group.count) != 0) {
+                    return false;
+                }
+            }
+
+            // check for masked bytes
+            for (size_t j = 0; j < pat::size; j++) {
+                if (pat::types[j] == token_t::type_t::masked && (data[j] & pat::masks[j]) != pat::bytes[j]) {
+                    return false;
+                }
+            }
+
+            return verify_either<pat>(data);
+        }
+
+        /// @brief Size, cursor and anchor of a list of tokens, computed once per scan.
+        /// If the tokens have a gap, everything but <c>tail</c> describes the head (the tokens before it).
+        /// The head is also laid out as a bytes row followed by a masks row, in the same form as
+        /// <c>compiled_pattern</c>, so it's verified with the same packed compares.
+        struct token_layout_t {
+            size_t size = 0;   // size in bytes, excluding zero-sized tokens
+            size_t cursor = 0; // cursor offset in bytes
+            size_t head = 0;   // amount of tokens before the first gap
+            anchor_t anchor;
+            bool has_bytes = false; // whether there is at least one fully-specified byte
+            bool has_follow = false; // whether there is at least one follow token
+            bool has_gap = false;   // whether there is at least one gap token
+            uint8_t skip_byte = 0;  // value of the last fully-specified byte (the skip table reference)
+            skip_table_t skip;
+            size_t stride = 0; // size rounded up to `row_alignment`
+            std::vector<uint8_t, utils::aligned_allocator<uint8_t, row_alignment>> rows; // bytes, then masks, `stride` bytes each
+            std::vector<either_t> either; // either tokens of the head, checked exactly after the rows
+        };
+
+        constexpr token_layout_t layout_tokens(std::span<token_t const> tokens) {
+            token_layout_t layout;
+            size_t last_byte = 0;
+            for (auto const& token : tokens) {
+                if (token.type == token_t::type_t::gap) {
+                    layout.has_gap = true;
+                    break;
+                }
+                layout.head++;
+                if (token.type == token_t::type_t::cursor) {
+                    layout.cursor = layout.size;
+                    continue;
+                }
+                if (token.type == token_t::type_t::follow) {
+                    layout.has_follow = true;
+                    continue;
+                }
+                if (token.type == token_t::type_t::byte) {
+                    layout.has_bytes = true;
+                    layout.skip_byte = token.byte;
+                    last_byte = layout.size;
+                }
+                layout.size++;
+            }
+            for (auto const& token : tokens.subspan(layout.head)) {
+                layout.has_follow |= token.type == token_t::type_t::follow;
+            }
+
+            auto head = tokens.first(layout.head);
+            layout.stride = (layout.size + row_alignment - 1) / row_alignment * row_alignment;
+            layout.rows.assign(layout.stride * 2, 0);
+            size_t offset = 0;
+            for (auto const& token : head) {
+                if (token.zero_sized()) continue;
+
+                // same masks and bytes as `compiled_pattern`
+                uint8_t& byte = layout.rows[offset];
+                uint8_t& mask = layout.rows[layout.stride + offset];
+                switch (token.type) {
+                    case token_t::type_t::byte:
+                        byte = token.byte;
+                        mask = 0xFF;
+                        break;
+                    case token_t::type_t::masked:
+                        byte = token.byte;
+                        mask = token.mask;
+                        break;
+                    case token_t::type_t::either:
+                        byte = token.byte & token.mask;
+                        mask = static_cast<uint8_t>(~(token.byte ^ token.mask));
+                        layout.either.push_back({static_cast<uint32_t>(offset), token.byte, token.mask});
+                        break;
+                    default: break;
+                }
+                offset++;
+            }
+
+            layout.anchor = select_anchor(head);
+            if (layout.has_bytes) {
+                layout.skip = build_skip_table(head, last_byte);
+            }
+            return layout;
+        }
+
+        /// @brief Check whether a list of tokens matches the data at the given pointer, with the packed compares of
+        /// its rows (see <c>verify_masked</c>) and an exact check of the either tokens.
+        /// Only the head is checked if there's a gap (see <c>match_tail</c>).
+        /// @param layout Layout of the tokens (see <c>layout_tokens</c>).
+        constexpr bool verify_layout(uint8_t const* data, token_layout_t const& layout) {
+            return verify_masked(data, layout.rows.data() + layout.stride, layout.rows.data(), layout.size) &&
+                verify_either(data, layout.either);
+        }
+
+        /// @brief Scan for positions where both anchor bytes match, and run the full check only on those.
+        /// @param data The data buffer to search in.
+        /// @param count Amount of positions to check (the last one must leave room for the whole pattern).
+        /// @param off0 Offset of the first anchor byte in the pattern.
+        /// @param b0 Value of the first anchor byte.
+        /// @param off1 Offset of the second anchor byte in the pattern.
+        /// @param b1 Value of the second anchor byte.
+        /// @param verify Callable that accepts a position and returns whether the whole pattern matches there.
+        /// @return The first position accepted by <c>verify</c>, or <b>sinaps::not_found</b>.
+        template <typename Isa = simd::native, typename Verify>
+        SINAPS_HOT intptr_t scan_anchor(
+            uint8_t const* data, size_t count,
+            size_t off0, uint8_t b0, size_t off1, uint8_t b1,
+            Verify&& verify
+        ) {
+            size_t i = 0;
+            for (; i + Isa::width <= count; i += Isa::width) {
+                auto mask = Isa::match(data + i + off0, b0, data + i + off1, b1);
+                while (mask) {
+                    size_t lane = std::countr_zero(mask) / Isa::lane_bits;
+                    SINAPS_STATS_ADD(candidates, 1);
+                    SINAPS_STATS_ADD(verifies, 1);
+                    if (verify(i + lane)) {
+                        SINAPS_STATS_ADD(bytes, i + lane + 1);
+                        return static_cast<intptr_t>(i + lane);
+                    }
+
+                    if constexpr (Isa::lane_bits == 1) {
+                        mask &= mask - 1;
+                    } else {
+                        using mask_t = typename Isa::mask_t;
+                        mask &= ~(((mask_t(1) << Isa::lane_bits) - 1) << (lane * Isa::lane_bits));
+                    }
+                }
+            }
+
+            // tail, which is too short for a full vector
+            for (; i < count; i++) {
+                if (data[i + off0] == b0 && data[i + off1] == b1) {
+                    SINAPS_STATS_ADD(candidates, 1);
+                    SINAPS_STATS_ADD(verifies, 1);
+                    if (verify(i)) {
+                        SINAPS_STATS_ADD(bytes, i + 1);
+                        return static_cast<intptr_t>(i);
+                    }
+                }
+            }
+
+            SINAPS_STATS_ADD(bytes, count);
+            return not_found;
+        }
+
+#if defined(SINAPS_SIMD_DISPATCH)
+        /// @brief Anchored scan compiled for AVX2, the verify callable is inlined into it.
+        template <typename Verify>
+        SINAPS_TARGET_FLATTEN("avx2") intptr_t scan_anchor_avx2(
+            uint8_t const* data, size_t count, size_t off0, uint8_t b0, size_t off1, uint8_t b1, Verify&& verify
+        ) {
+            return scan_anchor<simd::avx2>(data, count, off0, b0, off1, b1, verify);
+        }
+
+        /// @brief Anchored scan compiled for AVX-512BW, the verify callable is inlined into it.
+        template <typename Verify>
+        SINAPS_TARGET_FLATTEN("avx2,avx512f,avx512bw") intptr_t scan_anchor_avx512(
+            uint8_t const* data, size_t count, size_t off0, uint8_t b0, size_t off1, uint8_t b1, Verify&& verify
+        ) {
+            return scan_anchor<simd::avx512>(data, count, off0, b0, off1, b1, verify);
+        }
+#endif
+
+        /// @brief Anchored scan with the widest kernel the CPU supports (see <c>simd::dispatch_level</c>).
+        /// Falls back to the kernel selected at compile time.
+        template <typename Verify>
+        SINAPS_HOT intptr_t scan_anchor_dispatch(
+            uint8_t const* data, size_t count, size_t off0, uint8_t b0, size_t off1, uint8_t b1, Verify&& verify
+        ) {
+#if defined(SINAPS_SIMD_DISPATCH)
+            switch (simd::dispatch_level()) {
+                case simd::level_t::avx512: return scan_anchor_avx512(data, count, off0, b0, off1, b1, verify);
+                case simd::level_t::avx2:
+                    if constexpr (simd::native_level < simd::level_t::avx2) {
+                        return scan_anchor_avx2(data, count, off0, b0, off1, b1, verify);
+                    }
+                    break;
+                default: break;
+            }
+#endif
+            return scan_anchor(data, count, off0, b0, off1, b1, verify);
+        }
+
+        /// @brief Anchored scan from the last position down to the first (see <c>scan_anchor</c>).
+        /// The vectors are loaded from the end, and their candidates are verified from the highest lane.
+        /// @return The last position accepted by <c>verify</c>, or <b>sinaps::not_found</b>.
+        template <typename Isa = simd::native, typename Verify>
+        SINAPS_HOT intptr_t scan_anchor_reverse(
+            uint8_t const* data, size_t count,
+            size_t off0, uint8_t b0, size_t off1, uint8_t b1,
+            Verify&& verify
+        ) {
+            size_t i = count;
+            for (; i >= Isa::width; i -= Isa::width) {
+                size_t base = i - Isa::width;
+                auto mask = Isa::match(data + base + off0, b0, data + base + off1, b1);
+                while (mask) {
+                    size_t lane = (std::bit_width(mask) - 1) / Isa::lane_bits;
+                    SINAPS_STATS_ADD(candidates, 1);
+                    SINAPS_STATS_ADD(verifies, 1);
+                    if (verify(base + lane)) {
+                        SINAPS_STATS_ADD(bytes, count - base - lane);
+                        return static_cast<intptr_t>(base + lane);
+                    }
+
+                    using mask_t = typename Isa::mask_t;
+                    mask &= ~(((mask_t(1) << Isa::lane_bits) - 1) << (lane * Isa::lane_bits));
+                }
+            }
+
+            // head, which is too short for a full vector
+            for (; i > 0; i--) {
+                if (data[i - 1 + off0] == b0 && data[i - 1 + off1] == b1) {
+                    SINAPS_STATS_ADD(candidates, 1);
+                    SINAPS_STATS_ADD(verifies, 1);
+                    if (verify(i - 1)) {
+                        SINAPS_STATS_ADD(bytes, count - i + 1);
+                        return static_cast<intptr_t>(i - 1);
+                    }
+                }
+            }
+
+            SINAPS_STATS_ADD(bytes, count);
+            return not_found;
+        }
+
+#if defined(SINAPS_SIMD_DISPATCH)
+        /// @brief Reverse anchored scan compiled for AVX2.
+        template <typename Verify>
+        SINAPS_TARGET_FLATTEN("avx2") intptr_t scan_anchor_reverse_avx2(
+            uint8_t const* data, size_t count, size_t off0, uint8_t b0, size_t off1, uint8_t b1, Verify&& verify
+        ) {
+            return scan_anchor_reverse<simd::avx2>(data, count, off0, b0, off1, b1, verify);
+        }
+
+        /// @brief Reverse anchored scan compiled for AVX-512BW.
+        template <typename Verify>
+        SINAPS_TARGET_FLATTEN("avx2,avx512f,avx512bw") intptr_t scan_anchor_reverse_avx512(
+            uint8_t const* data, size_t count, size_t off0, uint8_t b0, size_t off1, uint8_t b1, Verify&& verify
+        ) {
+            return scan_anchor_reverse<simd::avx512>(data, count, off0, b0, off1, b1, verify);
+        }
+#endif
+
+        /// @brief Reverse anchored scan with the widest kernel the CPU supports (see <c>scan_anchor_dispatch</c>).
+        template <typename Verify>
+        SINAPS_HOT intptr_t scan_anchor_reverse_dispatch(
+            uint8_t const* data, size_t count, size_t off0, uint8_t b0, size_t off1, uint8_t b1, Verify&& verify
+        ) {
+#if defined(SINAPS_SIMD_DISPATCH)
+            switch (simd::dispatch_level()) {
+                case simd::level_t::avx512: return scan_anchor_reverse_avx512(data, count, off0, b0, off1, b1, verify);
+                case simd::level_t::avx2:
+                    if constexpr (simd::native_level < simd::level_t::avx2) {
+                        return scan_anchor_reverse_avx2(data, count, off0, b0, off1, b1, verify);
+                    }
+                    break;
+                default: break;
+            }
+#endif
+            return scan_anchor_reverse(data, count, off0, b0, off1, b1, verify);
+        }
+
+        /// @brief Plain scan from the last position down to the first, for patterns without an anchor pair.
+        /// @return The last position accepted by <c>verify</c>, or <b>sinaps::not_found</b>.
+        template <typename Verify>
+        constexpr intptr_t scan_reverse(size_t count, Verify&& verify) {
+            for (size_t i = count; i > 0; i--) {
+                SINAPS_STATS_ADD(verifies, 1);
+                if (verify(i - 1)) {
+                    SINAPS_STATS_ADD(bytes, count - i + 1);
+                    return static_cast<intptr_t>(i - 1);
+                }
+            }
+            SINAPS_STATS_ADD(bytes, count);
+            return not_found;
+        }
+
+        /// @brief Whether the skip table should be used instead of the anchored scan.
+        /// On machine code the vector kernels check positions faster than the skip table moves, even for
+        /// long literal tails, so the table only replaces the scalar kernel, or the plain loop when there's no anchor.
+        /// @param skip The skip table of the pattern.
+        /// @param anchored Whether the pattern has a valid anchor pair.
+        constexpr bool prefer_skip_table(skip_table_t const& skip, bool anchored) {
+            return (simd::native::width == 1 || !anchored) && skip.average >= 2;
+        }
+
+        /// @brief Horspool-style scan, jumps ahead by the skip table on every position.
+        /// @param data The data buffer to search in.
+        /// @param count Amount of positions to check (the last one must leave room for the whole pattern).
+        /// @param skip The skip table, its reference byte must be fully-specified.
+        /// @param byte Value of the reference byte.
+        /// @param verify Callable that accepts a position and returns whether the whole pattern matches there.
+        /// @return The first position accepted by <c>verify</c>, or <b>sinaps::not_found</b>.
+        template <typename Verify>
+        SINAPS_HOT constexpr intptr_t scan_skip(uint8_t const* data, size_t count, skip_table_t const& skip, uint8_t byte, Verify&& verify) {
+            for (size_t i = 0; i < count;) {
+                uint8_t c = data[i + skip.offset];
+                if (c == byte) {
+                    SINAPS_STATS_ADD(candidates, 1);
+                    SINAPS_STATS_ADD(verifies, 1);
+                    if (verify(i)) {
+                        SINAPS_STATS_ADD(bytes, i + 1);
+                        return static_cast<intptr_t>(i);
+                    }
+                }
+                i += skip.table[c];
+            }
+            SINAPS_STATS_ADD(bytes, count);
+            return not_found;
+        }
+
+        /// @brief Positions scanned by each inner loop in constant evaluation. Compilers limit the iterations of a
+        /// single loop (GCC: 262144 by default), so longer buffers are scanned in blocks.
+        constexpr size_t constant_block_size = 1 << 16;
+
+        /// @brief Skip table used in constant evaluation: <c>Pattern::skip_table</c>, or the table indexed by the end
+        /// of the longest group if it moves further (the last group can be short, or follow a wildcard).
+        template <typename Pattern>
+        consteval skip_table_t make_constant_skip_table() {
+            using pat = Pattern;
+            if constexpr (pat::group_count < 2) {
+                return pat::skip_table;
+            } else {
+                group_t longest = pat::groups[0];
+                for (auto const& group : pat::groups) {
+                    if (group.count >= longest.count) longest = group;
+                }
+                auto skip = build_skip_table(pat::value, longest.offset + longest.count - 1);
+                return skip.average > pat::skip_table.average ? skip : pat::skip_table;
+            }
+        }
+
+        template <typename Pattern>
+        inline constexpr skip_table_t constant_skip_table = make_constant_skip_table<Pattern>();
+
+        /// @brief Scan used in constant evaluation, where every operation counts against the compiler's limits:
+        /// the skip table when it moves far enough, otherwise the first check of <c>byte_checks</c> (the rarest
+        /// anchor byte) before the rest of the verify.
+        /// @param count Amount of positions to check (the last one must leave room for the whole pattern).
+        template <typename Pattern>
+        constexpr intptr_t find_start_constant(uint8_t const* data, size_t count, size_t step_size) {
+            using pat = Pattern;
+            constexpr auto const& checks = byte_checks<pat>;
+            constexpr auto const& skip = constant_skip_table<pat>;
+
+            for (size_t i = 0; i < count;) {
+                for (size_t end = std::min(count, i + constant_block_size); i < end;) {
+                    if constexpr (pat::group_count > 0 && skip.average >= 2) {
+                        // the reference byte of the skip table ends a group, so it's fully specified
+                        uint8_t c = data[i + skip.offset];
+                        if (c == pat::bytes[skip.offset] && verify_constant<pat>(data + i)) {
+                            return static_cast<intptr_t>(i);
+                        }
+                        i += step_size == 1 ? skip.table[c] : step_size;
+                    } else if constexpr (!checks.empty()) {
+                        constexpr auto first = checks[0];
+                        if ((data[i + first.offset] & first.mask) == first.byte && verify_constant<pat>(data + i)) {
+                            return static_cast<intptr_t>(i);
+                        }
+                        i += step_size;
+                    } else {
+                        if (verify_either<pat>(data + i)) {
+                            return static_cast<intptr_t>(i);
+                        }
+                        i += step_size;
+                    }
+                }
+            }
+            return not_found;
+        }
+
+        /// @brief Find the first position where the pattern starts (ignoring the cursor).
+        /// @param data The data buffer to search in.
+        /// @param size The size of the data buffer.
+        /// @param step_size The step size for the search.
+        /// @return The position of the first match, or <b>sinaps::not_found</b> if not found.
+        template <typename Pattern>
+        SINAPS_HOT constexpr intptr_t find_start(uint8_t const* data, size_t size, size_t step_size) {
+            using pat = Pattern;
+
+            if (size < pat::size) {
+                return not_found;
+            }
+
+            if (std::is_constant_evaluated()) {
+                return find_start_constant<pat>(data, size - pat::size + 1, step_size);
+            }
+
+            // long literal tail: jump ahead using the skip table
+            if constexpr (pat::group_count > 0 && prefer_skip_table(pat::skip_table, pat::anchor_pair.valid)) {
+                if (step_size == 1) {
+                    return scan_skip(
+                        data, size - pat::size + 1, pat::skip_table, pat::bytes[pat::skip_table.offset],
+                        [data](size_t i) { return verify<pat>(data + i); }
+                    );
+                }
+            }
+
+            // look for the rarest bytes of the pattern first, and only verify the candidates
+            if constexpr (pat::anchor_pair.valid) {
+                if (step_size == 1) {
+                    constexpr size_t first = pat::anchor_pair.first;
+                    constexpr size_t second = pat::anchor_pair.second;
+
+                    return scan_anchor_dispatch(
+                        data, size - pat::size + 1,
+                        first, pat::bytes[first], second, pat::bytes[second],
+                        [data](size_t i) { return verify<pat>(data + i); }
+                    );
+                }
+            }
+
+            for (size_t i = 0; i <= size - pat::size; i += step_size) {
+                SINAPS_STATS_ADD(verifies, 1);
+                if (verify<pat>(data + i)) {
+                    SINAPS_STATS_ADD(bytes, i + 1);
+                    return static_cast<intptr_t>(i);
+                }
+            }
+
+            SINAPS_STATS_ADD(bytes, size - pat::size + 1);
+            return not_found;
+        }
+
+        /// @brief Find the last position where the pattern starts (ignoring the cursor), scanning backwards.
+        /// @return The position of the last match, or <b>sinaps::not_found</b> if not found.
+        template <typename Pattern>
+        SINAPS_HOT constexpr intptr_t find_start_reverse(uint8_t const* data, size_t size) {
+            using pat = Pattern;
+
+            if (size < pat::size) {
+                return not_found;
+            }
+
+            auto check = [data](size_t i) { return verify<pat>(data + i); };
+            if constexpr (pat::anchor_pair.valid) {
+                if (!std::is_constant_evaluated()) {
+                    constexpr size_t first = pat::anchor_pair.first;
+                    constexpr size_t second = pat::anchor_pair.second;
+                    return scan_anchor_reverse_dispatch(
+                        data, size - pat::size + 1, first, pat::bytes[first], second, pat::bytes[second], check
+                    );
+                }
+            }
+            return scan_reverse(size - pat::size + 1, check);
+        }
+
+        /// @brief Find the first position where a list of tokens starts (ignoring the cursor).
+        /// @param layout Layout of the tokens (see <c>layout_tokens</c>).
+        /// @param step_size The step size for the search.
+        /// @return The position of the first match, or <b>sinaps::not_found</b> if not found.
+        SINAPS_HOT constexpr intptr_t find_tokens_start(uint8_t const* data, size_t size, token_layout_t const& layout, size_t step_size = 1) {
+            if (size < layout.size) {
+                return not_found;
+            }
+
+            auto verify = [data, &layout](size_t i) { return verify_layout(data + i, layout); };
+
+            if (layout.has_bytes && prefer_skip_table(layout.skip, layout.anchor.valid) && step_size == 1 && !std::is_constant_evaluated()) {
+                return scan_skip(data, size - layout.size + 1, layout.skip, layout.skip_byte, verify);
+            }
+
+            if (layout.anchor.valid && step_size == 1 && !std::is_constant_evaluated()) {
+                return scan_anchor_dispatch(
+                    data, size - layout.size + 1,
+                    layout.anchor.first, layout.anchor.first_byte, layout.anchor.second, layout.anchor.second_byte,
+                    verify
+                );
+            }
+
+            for (size_t i = 0; i + layout.size <= size; i += step_size) {
+                SINAPS_STATS_ADD(verifies, 1);
+                if (verify(i)) {
+                    SINAPS_STATS_ADD(bytes, i + 1);
+                    return static_cast<intptr_t>(i);
+                }
+            }
+
+            SINAPS_STATS_ADD(bytes, size - layout.size + 1);
+            return not_found;
+        }
+
+        /// @brief Find the last position where a list of tokens starts (ignoring the cursor), scanning backwards.
+        /// @param layout Layout of the tokens (see <c>layout_tokens</c>).
+        /// @return The position of the last match, or <b>sinaps::not_found</b> if not found.
+        SINAPS_HOT constexpr intptr_t find_tokens_start_reverse(uint8_t const* data, size_t size, token_layout_t const& layout) {
+            if (size < layout.size) {
+                return not_found;
+            }
+
+            auto verify = [data, &layout](size_t i) { return verify_layout(data + i, layout); };
+            if (layout.anchor.valid && !std::is_constant_evaluated()) {
+                return scan_anchor_reverse_dispatch(
+                    data, size - layout.size + 1,
+                    layout.anchor.first, layout.anchor.first_byte, layout.anchor.second, layout.anchor.second_byte,
+                    verify
+                );
+            }
+            return scan_reverse(size - layout.size + 1, verify);
+        }
+
+        /// @brief Index to report for a match of a list of tokens (the cursor, or the target of the follow tokens).
+        /// @return The index, or <b>sinaps::not_found</b> if the tail doesn't match or a follow token can't be resolved.
+        template <typename Memory>
+        constexpr intptr_t resolve_tokens(
+            uint8_t const* data, size_t size, size_t start, std::span<token_t const> tokens, token_layout_t const& layout, Memory const& memory
+        ) {
+            auto index = static_cast<intptr_t>(start + layout.cursor);
+            if (layout.has_gap && !match_tail(data, size, start + layout.size, tokens.subspan(layout.head), index)) {
+                return not_found;
+            }
+            return layout.has_follow ? resolve_follows(index, tokens, memory) : index;
+        }
+
+        /// @brief Find an index of a list of tokens (see <c>find_tokens_start</c>), including the cursor offset.
+        constexpr intptr_t find_tokens(
+            uint8_t const* data, size_t size, std::span<token_t const> tokens, token_layout_t const& layout, size_t step_size = 1
+        ) {
+            return find_resolved(
+                0, size, step_size,
+                [&](size_t from, size_t count) { return find_tokens_start(data + from, count, layout, step_size); },
+                [&](size_t start) { return resolve_tokens(data, size, start, tokens, layout, buffer_memory{data, size}); }
+            );
+        }
+
+        /// @brief Index to report for a match of a pattern (the cursor, or the target of the follow tokens).
+        /// The tail of patterns with gaps is matched here (see <c>match_tail</c>), the head must already match.
+        /// @param data Origin of the positions, the tail is read before <c>data + size</c>.
+        /// @param start Start of the match.
+        /// @param memory Memory the follow tokens are resolved in (see <c>resolve_follows</c>).
+        /// @return The index, or <b>sinaps::not_found</b> if the tail doesn't match or a follow token can't be resolved.
+        template <typename Pattern, typename Memory>
+        constexpr intptr_t resolve(uint8_t const* data, size_t size, size_t start, Memory const& memory) {
+            auto index = static_cast<intptr_t>(start + Pattern::cursor_pos);
+            if constexpr (Pattern::has_gap) {
+                if (!match_tail(data, size, start + Pattern::size, Pattern::tail, index)) {
+                    return not_found;
+                }
+            }
+            if constexpr (Pattern::follow_count > 0) {
+                return resolve_follows(index, Pattern::follows, memory);
+            } else {
+                return index;
+            }
+        }
+
+        /// @brief Verify a candidate, and get the index to report for it.
+        /// @return The index (see <c>resolve</c>), or <b>sinaps::not_found</b> if the pattern doesn't match there.
+        template <typename Pattern>
+        constexpr intptr_t match_candidate(uint8_t const* data, size_t size, size_t start) {
+            return verify<Pattern>(data + start) ? resolve<Pattern>(data, size, start, buffer_memory{data, size}) : not_found;
+        }
+
+        /// @brief End of the range to scan for the heads of the matches that start before <c>limit</c> (see <c>find_range</c>).
+        constexpr size_t head_end(size_t size, size_t limit, size_t head_size) {
+            return limit < size && head_size > 0 ? std::min(size, limit + head_size - 1) : std::min(size, limit);
+        }
+
+        /// @brief Find the first match that starts in a range, including the cursor offset and follow tokens.
+        /// @param data Origin of the positions, the range <c>[begin, end)</c> is scanned for the head of the pattern.
+        /// @param size End of the data the tail of the pattern can be matched in (at least <c>end</c>).
+        /// @param memory Memory the follow tokens are resolved in, positions are relative to <c>data</c>.
+        /// @return The index of the first match (relative to <c>data</c>), or <b>sinaps::not_found</b> if not found.
+        template <typename Pattern, typename Memory>
+        SINAPS_HOT constexpr intptr_t find_range(
+            uint8_t const* data, size_t size, size_t begin, size_t end, size_t step_size, Memory const& memory
+        ) {
+            if constexpr (Pattern::follow_count == 0 && !Pattern::has_gap) {
+                auto res = find_start<Pattern>(data + begin, end - begin, step_size);
+                if (res == not_found) {
+                    return not_found;
+                }
+                SINAPS_STATS_ADD(matches, 1);
+                return res + static_cast<intptr_t>(begin + Pattern::cursor_pos);
+            } else {
+                return find_resolved(
+                    begin, end, step_size,
+                    [data, step_size](size_t from, size_t count) { return find_start<Pattern>(data + from, count, step_size); },
+                    [data, size, &memory](size_t start) { return resolve<Pattern>(data, size, start, memory); }
+                );
+            }
+        }
+    }
+
+    /// @brief Find an index of a pattern in a data buffer.
+    /// The pattern is a sequence of masks (see <c>sinaps::masks</c> namespace).
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
     SINAPS_HOT constexpr intptr_t find(uint8_t const* SINAPS_RESTRICT data, size_t size, size_t step_size = 1) {
-        using pat = Pattern;
+        return impl::find_range<Pattern>(data, size, 0, size, step_size, impl::buffer_memory{data, size});
+    }
+
+    /// @brief Find an index of a pattern in a data buffer.
+    /// The pattern is a sequence of masks (see <c>sinaps::masks</c> namespace).
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename... Mask> requires (!utils::is_specialization<Mask, pattern>::value && ...)
+    constexpr intptr_t find(uint8_t const* data, size_t size, size_t step_size = 1) {
+        return find<pattern<Mask...>>(data, size, step_size);
+    }
+
+    /// @brief Find an index of a pattern in a data buffer. Pattern is an array of tokens.
+    /// This method is a helper for the other find methods, use if you know what you're doing.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <std::array pattern> requires (pattern.size() > 0)
+    constexpr intptr_t find(uint8_t const* data, size_t size, size_t step_size = 1) {
+        return find<impl::make_pattern<pattern>>(data, size, step_size);
+    }
+
+    /// @brief Find an index of a pattern in a data buffer.
+    /// Builds the pattern from a string literal.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <utils::FixedString S>
+    constexpr intptr_t find(uint8_t const* data, size_t size, size_t step_size = 1) {
+        return find<impl::tokenizePatternString<S>()>(data, size, step_size);
+    }
+
+    /// @brief Find an index of a pattern in a data buffer. Pattern is a list of tokens.
+    /// The layout of the tokens is computed on every call, parse the pattern once with <c>sinaps::compiled_pattern</c> to reuse it.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param pattern_size Amount of tokens in the pattern (including zero-sized ones).
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer (including the cursor offset and follow tokens), or <b>sinaps::not_found</b> if not found.
+    SINAPS_HOT constexpr intptr_t find(uint8_t const* SINAPS_RESTRICT data, size_t size, token_t const* SINAPS_RESTRICT pattern, size_t pattern_size, size_t step_size = 1) {
+        std::span<token_t const> tokens(pattern, pattern_size);
+        return impl::find_tokens(data, size, tokens, impl::layout_tokens(tokens), step_size);
+    }
+
+    /// @brief Find an index of a pattern in a data buffer. Pattern is a list of tokens.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <size_t N>
+    constexpr intptr_t find(uint8_t const* data, size_t size, std::array<token_t, N> const& pattern, size_t step_size = 1) {
+        return find(data, size, pattern.data(), N, step_size);
+    }
+
+    /// @brief Find an index of a pattern in a data buffer. Pattern is a list of tokens.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    constexpr intptr_t find(uint8_t const* data, size_t size, std::span<token_t const> pattern, size_t step_size = 1) {
+        return find(data, size, pattern.data(), pattern.size(), step_size);
+    }
+
+    /// @brief Find an index of a pattern in a data buffer. Pattern is a list of tokens.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    constexpr intptr_t find(uint8_t const* data, size_t size, std::initializer_list<token_t> pattern, size_t step_size = 1) {
+        return find(data, size, pattern.begin(), pattern.size(), step_size);
+    }
+
+    /// @brief Check whether a pattern matches at a known position, e.g. a cached result of <c>find</c>.
+    /// Follow tokens are not resolved, for such patterns the position is the cursor and not the target.
+    /// Patterns with gaps are supported if the cursor is before the first gap.
+    /// @param ptr Pointer to the position <c>find</c> would report (the cursor), the pattern is read from
+    /// <c>ptr - Pattern::cursor_pos</c> to <c>ptr - Pattern::cursor_pos + Pattern::max_size</c>.
+    /// @return Whether the pattern matches there.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    SINAPS_HOT constexpr bool matches_at(uint8_t const* ptr) {
+        static_assert(!Pattern::tail_cursor, "matches_at needs the cursor to be before the first gap");
+        uint8_t const* start = ptr - Pattern::cursor_pos;
+        if constexpr (Pattern::has_gap) {
+            intptr_t cursor = 0;
+            return impl::verify<Pattern>(start) && impl::match_tail(start, Pattern::max_size, Pattern::size, Pattern::tail, cursor);
+        } else {
+            return impl::verify<Pattern>(start);
+        }
+    }
+
+    /// @brief Check whether a pattern matches at a known index of a data buffer, e.g. a cached result of <c>find</c>.
+    /// @param data The data buffer.
+    /// @param size The size of the data buffer.
+    /// @param index The index <c>find</c> would report (including the cursor offset).
+    /// @return Whether the pattern matches there, <c>false</c> if it doesn't fit in the buffer.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr bool matches_at(uint8_t const* data, size_t size, intptr_t index) {
+        static_assert(!Pattern::tail_cursor, "matches_at needs the cursor to be before the first gap");
+        intptr_t start = index - static_cast<intptr_t>(Pattern::cursor_pos);
+        if (start < 0 || static_cast<size_t>(start) > size || size - static_cast<size_t>(start) < Pattern::size) {
+            return false;
+        }
+        if constexpr (Pattern::has_gap) {
+            intptr_t cursor = 0;
+            return impl::verify<Pattern>(data + start) &&
+                impl::match_tail(data, size, static_cast<size_t>(start) + Pattern::size, Pattern::tail, cursor);
+        } else {
+            return impl::verify<Pattern>(data + start);
+        }
+    }
+}
+
+#endif // SINAPS_FIND_HPP
+
+#ifndef SINAPS_COMPILED_PATTERN_HPP
+#define SINAPS_COMPILED_PATTERN_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace sinaps {
+    /// @brief Pattern parsed at runtime, with the same precomputed layout as <c>sinaps::pattern</c>.
+    /// Parse once (e.g. from a config file) and reuse it for every scan, <c>find</c> does not allocate.
+    /// The head is stored as two rows (bytes, then masks) aligned and padded to <c>impl::row_alignment</c>,
+    /// so it's verified with a few wide compares, and the token types are implied by the masks.
+    class compiled_pattern {
+    public:
+        constexpr compiled_pattern() = default;
+
+        /// @brief Parse a pattern string (e.g. "48 8B ? ^ E8").
+        constexpr explicit compiled_pattern(std::string_view pattern)
+            : compiled_pattern(impl::tokenizePatternStringRuntime(pattern)) {}
+
+        /// @brief Build a pattern from a list of tokens.
+        /// @throws std::invalid_argument If the pattern starts with a gap.
+        constexpr explicit compiled_pattern(std::span<token_t const> tokens) {
+            m_tokens.assign(tokens.begin(), tokens.end());
+
+            while (m_head < tokens.size() && tokens[m_head].type != token_t::type_t::gap) m_head++;
+            auto head = tokens.first(m_head);
+
+            for (auto const& token : head) {
+                if (token.type == token_t::type_t::cursor) {
+                    m_cursor_pos = m_size;
+                } else if (token.type == token_t::type_t::follow) {
+                    m_has_follow = true;
+                } else {
+                    m_size++;
+                }
+            }
+
+            m_stride = (m_size + impl::row_alignment - 1) / impl::row_alignment * impl::row_alignment;
+            m_rows.assign(m_stride * 2, 0);
+
+            size_t offset = 0, last_byte = 0;
+            for (auto const& token : head) {
+                if (token.zero_sized()) continue;
+
+                // same masks and bytes as `sinaps::pattern::match_masks` and `match_bytes`
+                uint8_t& byte = m_rows[offset];
+                uint8_t& mask = m_rows[m_stride + offset];
+                switch (token.type) {
+                    case token_t::type_t::byte:
+                        byte = token.byte;
+                        mask = 0xFF;
+                        last_byte = offset;
+                        break;
+                    case token_t::type_t::masked:
+                        byte = token.byte;
+                        mask = token.mask;
+                        break;
+                    case token_t::type_t::either:
+                        byte = token.byte & token.mask;
+                        mask = static_cast<uint8_t>(~(token.byte ^ token.mask));
+                        m_either.push_back({static_cast<uint32_t>(offset), token.byte, token.mask});
+                        break;
+                    default: break;
+                }
+                offset++;
+            }
+
+            m_min_size = m_max_size = m_size;
+            if (has_gap()) {
+                if (m_size == 0) {
+                    throw std::invalid_argument("A pattern can't start with a gap");
+                }
+                for (auto const& token : tail()) {
+                    if (token.type == token_t::type_t::follow) {
+                        m_has_follow = true;
+                    } else if (token.type == token_t::type_t::cursor) {
+                        m_tail_cursor = true;
+                    } else if (token.type == token_t::type_t::gap) {
+                        m_min_size += token.byte;
+                        m_max_size += token.mask;
+                    } else {
+                        m_min_size++;
+                        m_max_size++;
+                    }
+                }
+            }
+
+            m_anchor = select_anchor(head);
+            if (m_anchor.valid) {
+                m_skip = build_skip_table(head, last_byte);
+            }
+        }
+
+        /// @brief Size of the pattern in bytes (excluding zero-sized tokens), only the head if it has gaps.
+        [[nodiscard]] constexpr size_t size() const { return m_size; }
+        /// @brief Smallest amount of bytes a match spans (the size, if there are no gaps).
+        [[nodiscard]] constexpr size_t min_size() const { return m_min_size; }
+        /// @brief Largest amount of bytes a match spans (the size, if there are no gaps).
+        [[nodiscard]] constexpr size_t max_size() const { return m_max_size; }
+        /// @brief Whether the pattern has gaps, only its head is scanned for and the tail is matched after it.
+        [[nodiscard]] constexpr bool has_gap() const { return m_head < m_tokens.size(); }
+        /// @brief Whether the pattern has follow tokens, matches then report their target.
+        [[nodiscard]] constexpr bool has_follow() const { return m_has_follow; }
+        /// @brief Whether the cursor is after the first gap, <c>cursor_pos()</c> is then not used.
+        [[nodiscard]] constexpr bool tail_cursor() const { return m_tail_cursor; }
+        /// @brief Position of the cursor token in the pattern.
+        [[nodiscard]] constexpr size_t cursor_pos() const { return m_cursor_pos; }
+        /// @brief Pair of the least frequent fully-specified bytes, used to prefilter the scan.
+        [[nodiscard]] constexpr anchor_t const& anchor() const { return m_anchor; }
+        /// @brief Bad-character skip table, indexed by the last fully-specified byte.
+        [[nodiscard]] constexpr skip_table_t const& skip_table() const { return m_skip; }
+
+        /// @brief Original tokens (including zero-sized ones), follow tokens are applied in this order.
+        [[nodiscard]] constexpr std::span<token_t const> tokens() const { return m_tokens; }
+        /// @brief Tokens from the first gap on (see <c>impl::match_tail</c>), empty if there are no gaps.
+        [[nodiscard]] constexpr std::span<token_t const> tail() const { return tokens().subspan(m_head); }
+        /// @brief Bytes the masked data of the head is compared to (0x00 for wildcards, the bits both bytes share
+        /// for either tokens), aligned on <c>impl::row_alignment</c>.
+        [[nodiscard]] constexpr std::span<uint8_t const> bytes() const { return std::span(m_rows).first(m_size); }
+        /// @brief Masks applied to the data of the head (0xFF for bytes, 0x00 for wildcards), aligned on <c>impl::row_alignment</c>.
+        [[nodiscard]] constexpr std::span<uint8_t const> masks() const { return std::span(m_rows).subspan(m_stride, m_size); }
+        /// @brief Either tokens of the head, checked exactly after the masked compare.
+        [[nodiscard]] constexpr std::span<impl::either_t const> either() const { return m_either; }
+
+        /// @brief Index to report for a match (the cursor, or the target of the follow tokens).
+        /// The tail is matched here if the pattern has gaps, the head must already match.
+        /// @param data Origin of the positions, the tail is read before <c>data + size</c>.
+        /// @param start Start of the match.
+        /// @param memory Memory the follow tokens are resolved in (see <c>impl::resolve_follows</c>).
+        /// @return The index, or <b>sinaps::not_found</b> if the tail doesn't match or a follow token can't be resolved.
+        template <typename Memory>
+        [[nodiscard]] constexpr intptr_t resolve(uint8_t const* data, size_t size, size_t start, Memory const& memory) const {
+            auto index = static_cast<intptr_t>(start + m_cursor_pos);
+            if (has_gap() && !impl::match_tail(data, size, start + m_size, tail(), index)) {
+                return not_found;
+            }
+            return m_has_follow ? impl::resolve_follows(index, m_tokens, memory) : index;
+        }
+
+        /// @brief Check whether the pattern matches the data at the given pointer.
+        /// @param data Pointer to the first byte of the potential match (at least <c>size()</c> bytes).
+        [[nodiscard]] constexpr bool verify(uint8_t const* data) const {
+            return impl::verify_masked(data, m_rows.data() + m_stride, m_rows.data(), m_size) && impl::verify_either(data, m_either);
+        }
+
+        [[nodiscard]] std::string to_string() const { return sinaps::to_string(m_tokens); }
+
+    private:
+        std::vector<token_t> m_tokens;
+        std::vector<uint8_t, utils::aligned_allocator<uint8_t, impl::row_alignment>> m_rows; // bytes, then masks, `m_stride` bytes each
+        std::vector<impl::either_t> m_either;
+        size_t m_head = 0;   // amount of tokens before the first gap
+        size_t m_size = 0;
+        size_t m_stride = 0; // size rounded up to `impl::row_alignment`
+        size_t m_cursor_pos = 0;
+        size_t m_min_size = 0;
+        size_t m_max_size = 0;
+        bool m_has_follow = false;
+        bool m_tail_cursor = false;
+        anchor_t m_anchor;
+        skip_table_t m_skip;
+    };
+
+    namespace impl {
+        /// @brief Find the first position where a compiled pattern starts (ignoring the cursor).
+        /// @return The position of the first match, or <b>sinaps::not_found</b> if not found.
+        SINAPS_HOT constexpr intptr_t find_compiled_start(uint8_t const* data, size_t size, compiled_pattern const& pattern, size_t step_size) {
+            size_t pattern_size = pattern.size();
+            if (size < pattern_size) {
+                return not_found;
+            }
+
+            // the skip table is only built for patterns that have fully-specified bytes, i.e. a valid anchor
+            auto const& skip = pattern.skip_table();
+            auto const& anchor = pattern.anchor();
+            if (anchor.valid && prefer_skip_table(skip, anchor.valid) && step_size == 1 && !std::is_constant_evaluated()) {
+                return scan_skip(
+                    data, size - pattern_size + 1, skip, pattern.bytes()[skip.offset],
+                    [data, &pattern](size_t i) { return pattern.verify(data + i); }
+                );
+            }
+
+            if (anchor.valid && step_size == 1 && !std::is_constant_evaluated()) {
+                return scan_anchor_dispatch(
+                    data, size - pattern_size + 1,
+                    anchor.first, anchor.first_byte, anchor.second, anchor.second_byte,
+                    [data, &pattern](size_t i) { return pattern.verify(data + i); }
+                );
+            }
+
+            for (size_t i = 0; i <= size - pattern_size; i += step_size) {
+                SINAPS_STATS_ADD(verifies, 1);
+                if (pattern.verify(data + i)) {
+                    SINAPS_STATS_ADD(bytes, i + 1);
+                    return static_cast<intptr_t>(i);
+                }
+            }
+
+            SINAPS_STATS_ADD(bytes, size - pattern_size + 1);
+            return not_found;
+        }
+
+        /// @brief Find the last position where a compiled pattern starts (ignoring the cursor), scanning backwards.
+        /// @return The position of the last match, or <b>sinaps::not_found</b> if not found.
+        constexpr intptr_t find_compiled_start_reverse(uint8_t const* data, size_t size, compiled_pattern const& pattern) {
+            size_t pattern_size = pattern.size();
+            if (size < pattern_size) {
+                return not_found;
+            }
+
+            auto verify = [data, &pattern](size_t i) { return pattern.verify(data + i); };
+            auto const& anchor = pattern.anchor();
+            if (anchor.valid && !std::is_constant_evaluated()) {
+                return scan_anchor_reverse_dispatch(
+                    data, size - pattern_size + 1, anchor.first, anchor.first_byte, anchor.second, anchor.second_byte, verify
+                );
+            }
+            return scan_reverse(size - pattern_size + 1, verify);
+        }
+
+        /// @brief Find the first match of a compiled pattern that starts in a range (see <c>find_range</c>).
+        template <typename Memory>
+        constexpr intptr_t find_compiled_range(
+            uint8_t const* data, size_t size, size_t begin, size_t end, compiled_pattern const& pattern, size_t step_size, Memory const& memory
+        ) {
+            if (!pattern.has_follow() && !pattern.has_gap()) {
+                auto res = find_compiled_start(data + begin, end - begin, pattern, step_size);
+                if (res == not_found) {
+                    return not_found;
+                }
+                SINAPS_STATS_ADD(matches, 1);
+                return res + static_cast<intptr_t>(begin + pattern.cursor_pos());
+            }
+            return find_resolved(
+                begin, end, step_size,
+                [&](size_t from, size_t count) { return find_compiled_start(data + from, count, pattern, step_size); },
+                [&](size_t start) { return pattern.resolve(data, size, start, memory); }
+            );
+        }
+    }
+
+    /// @brief Find an index of a compiled pattern in a data buffer.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    constexpr intptr_t find(uint8_t const* data, size_t size, compiled_pattern const& pattern, size_t step_size = 1) {
+        return impl::find_compiled_range(data, size, 0, size, pattern, step_size, impl::buffer_memory{data, size});
+    }
+
+    /// @brief Find an index of a pattern in a data buffer. Pattern is a string.
+    /// The string is parsed on every call, use <c>sinaps::compiled_pattern</c> to parse it once.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    constexpr intptr_t find(uint8_t const* data, size_t size, std::string_view pattern, size_t step_size = 1) {
+        return find(data, size, compiled_pattern(pattern), step_size);
+    }
+
+    /// @brief Check whether a compiled pattern matches at a known position, e.g. a cached result of <c>find</c>.
+    /// @param ptr Pointer to the position <c>find</c> would report (the cursor), the pattern is read from
+    /// <c>ptr - pattern.cursor_pos()</c> to <c>ptr - pattern.cursor_pos() + pattern.max_size()</c>.
+    /// @param pattern The pattern to check.
+    /// @return Whether the pattern matches there, always <c>false</c> if the cursor is after the first gap.
+    constexpr bool matches_at(uint8_t const* ptr, compiled_pattern const& pattern) {
+        if (pattern.tail_cursor()) {
+            return false;
+        }
+        uint8_t const* start = ptr - pattern.cursor_pos();
+        intptr_t cursor = 0;
+        return pattern.verify(start) &&
+            (!pattern.has_gap() || impl::match_tail(start, pattern.max_size(), pattern.size(), pattern.tail(), cursor));
+    }
+
+    /// @brief Check whether a compiled pattern matches at a known index of a data buffer.
+    /// @param data The data buffer.
+    /// @param size The size of the data buffer.
+    /// @param index The index <c>find</c> would report (including the cursor offset).
+    /// @param pattern The pattern to check.
+    /// @return Whether the pattern matches there, <c>false</c> if it doesn't fit in the buffer or the cursor
+    /// is after the first gap.
+    constexpr bool matches_at(uint8_t const* data, size_t size, intptr_t index, compiled_pattern const& pattern) {
+        intptr_t start = index - static_cast<intptr_t>(pattern.cursor_pos());
+        if (pattern.tail_cursor() || start < 0 || static_cast<size_t>(start) > size || size - static_cast<size_t>(start) < pattern.size()) {
+            return false;
+        }
+        intptr_t cursor = 0;
+        return pattern.verify(data + start) &&
+            (!pattern.has_gap() || impl::match_tail(data, size, static_cast<size_t>(start) + pattern.size(), pattern.tail(), cursor));
+    }
+}
+
+#endif // SINAPS_COMPILED_PATTERN_HPP
+
+#ifndef SINAPS_BATCH_HPP
+#define SINAPS_BATCH_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+namespace sinaps {
+    namespace impl {
+        /// @brief Per-pattern data used by the batch scanner.
+        /// 32-bit offsets keep it at 16 bytes, so large sets stay in cache.
+        struct batch_entry_t {
+            uint32_t first = 0;  // offset of the anchor byte (the bucket key)
+            uint32_t second = 0; // offset of the second anchor byte
+            uint32_t size = 0;   // pattern size in bytes
+            uint8_t second_byte = 0;
+
+            constexpr batch_entry_t() = default;
+            constexpr batch_entry_t(size_t first, size_t second, uint8_t second_byte, size_t size)
+                : first(static_cast<uint32_t>(first)), second(static_cast<uint32_t>(second)),
+                  size(static_cast<uint32_t>(size)), second_byte(second_byte) {}
+        };
+
+        /// @brief Bucket key of a pattern without fully-specified bytes, such patterns are not bucketed.
+        constexpr uint16_t no_bucket = 256;
+
+        /// @brief Group pattern indices by their anchor byte (counting sort).
+        /// @param keys Anchor byte of each pattern, or <c>no_bucket</c>.
+        /// @param start Output, <c>[start[b], start[b + 1])</c> is the range of <c>order</c> anchored on byte <c>b</c>.
+        /// @param order Output, pattern indices sorted by their anchor byte.
+        constexpr void build_buckets(std::span<uint16_t const> keys, std::span<uint32_t, 257> start, std::span<uint32_t> order) {
+            for (auto& s : start) s = 0;
+            for (auto key : keys) {
+                if (key != no_bucket) start[key + 1]++;
+            }
+            for (size_t b = 0; b < 256; b++) {
+                start[b + 1] += start[b];
+            }
+
+            std::array<uint32_t, 256> fill{};
+            for (size_t k = 0; k < keys.size(); k++) {
+                if (keys[k] != no_bucket) {
+                    order[start[keys[k]] + fill[keys[k]]++] = static_cast<uint32_t>(k);
+                }
+            }
+        }
+
+        /// @brief Scan the buffer once, looking for all anchored patterns at the same time.
+        /// Each position is looked up in the bucket table, and only the patterns anchored on that byte are checked.
+        /// @param limit Only the matches that start before this position are reported, the rest of the buffer holds their tails.
+        /// @param start Bucket ranges (see <c>build_buckets</c>).
+        /// @param order Pattern indices sorted by their anchor byte.
+        /// @param entries Per-pattern data.
+        /// @param results Output, must be filled with <b>sinaps::not_found</b> for every pattern that should be searched.
+        /// @param remaining Amount of patterns left to find, the scan stops once it reaches zero.
+        /// @param match Callable that accepts a pattern index and a position, and returns the index to report if the pattern
+        /// matches there (including the cursor offset and follow tokens), or <b>sinaps::not_found</b>.
+        template <typename Match>
+        SINAPS_HOT void scan_batch(
+            uint8_t const* data, size_t size, size_t limit,
+            std::span<uint32_t const, 257> start, std::span<uint32_t const> order,
+            std::span<batch_entry_t const> entries, std::span<intptr_t> results,
+            size_t remaining, Match&& match
+        ) {
+            size_t p = 0;
+            for (; p < size && remaining > 0; p++) {
+                uint8_t byte = data[p];
+                for (uint32_t k = start[byte]; k < start[byte + 1]; k++) {
+                    uint32_t index = order[k];
+                    auto const& entry = entries[index];
+                    if (results[index] != not_found || p < entry.first) {
+                        continue;
+                    }
+
+                    size_t i = p - entry.first;
+                    SINAPS_STATS_ADD_PATTERN(index, candidates, 1);
+                    if (i >= limit || i + entry.size > size || data[i + entry.second] != entry.second_byte) {
+                        continue;
+                    }
+
+                    SINAPS_STATS_ADD_PATTERN(index, verifies, 1);
+                    intptr_t res = match(index, i);
+                    if (res != not_found) {
+                        SINAPS_STATS_ADD_PATTERN(index, matches, 1);
+                        results[index] = res;
+                        remaining--;
+                    }
+                }
+            }
+            SINAPS_STATS_ADD(bytes, p);
+        }
+    }
+
+    /// @brief Set of compile-time patterns, searched for in a single pass.
+    /// Patterns are grouped by their rarest byte, so every position of the buffer is read only once,
+    /// no matter how many patterns are searched. Follow tokens are resolved, so the results are the final targets.
+    /// All the tables (anchor buckets, per-pattern anchor offsets and matchers) are built at compile time,
+    /// so a scan does no setup work and no allocation.
+    /// @tparam Patterns List of patterns (see <c>sinaps::pattern</c>).
+    template <typename... Patterns>
+    struct pattern_set {
+        static_assert(sizeof...(Patterns) > 0, "A pattern set needs at least one pattern");
+        static_assert((utils::is_specialization<Patterns, pattern>::value && ...), "A pattern set holds sinaps::pattern types");
+
+        // amount of patterns in the set
+        static constexpr size_t count = sizeof...(Patterns);
+
+        // anchor byte of each pattern, or `impl::no_bucket` for patterns that are scanned on their own
+        static constexpr std::array<uint16_t, count> keys = {
+            (Patterns::anchor_pair.valid ? Patterns::bytes[Patterns::anchor_pair.first] : impl::no_bucket)...
+        };
+
+        // amount of patterns in the buckets
+        static constexpr size_t bucketed = ((Patterns::anchor_pair.valid ? 1 : 0) + ...);
+
+        static constexpr std::array<impl::batch_entry_t, count> entries = {
+            impl::batch_entry_t{
+                Patterns::anchor_pair.first,
+                Patterns::anchor_pair.second,
+                Patterns::bytes[Patterns::anchor_pair.second],
+                Patterns::size
+            }...
+        };
+
+        // bucket ranges and pattern indices sorted by anchor byte (see `impl::build_buckets`)
+        static constexpr auto buckets = [] {
+            struct {
+                std::array<uint32_t, 257> start{};
+                std::array<uint32_t, count> order{};
+            } buckets;
+            impl::build_buckets(keys, buckets.start, buckets.order);
+            return buckets;
+        }();
+
+        static constexpr std::array<intptr_t(*)(uint8_t const*, size_t, size_t), count> matchers = {&impl::match_candidate<Patterns>...};
+
+        // largest amount of bytes a match of any pattern spans
+        static constexpr size_t max_size = std::max({Patterns::max_size...});
+
+        /// @brief Find every pattern of the set in a data buffer, in a single pass.
+        /// @param data The data buffer to search in.
+        /// @param size The size of the data buffer.
+        /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+        static std::array<intptr_t, count> find_all(uint8_t const* data, size_t size) {
+            return find_all(data, size, size);
+        }
+
+        /// @brief Find every pattern of the set in a data buffer, only reporting the matches that start before a limit.
+        /// Used by the block scans, where the matches that start in the overlap are left to the next block.
+        /// @param limit End of the match starts, the rest of the buffer is only read for the tails and follow targets.
+        /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+        static std::array<intptr_t, count> find_all(uint8_t const* data, size_t size, size_t limit) {
+            std::array<intptr_t, count> results;
+            results.fill(not_found);
+
+            // patterns without fully-specified bytes can't be bucketed
+            [&]<size_t... I>(std::index_sequence<I...>) {
+                ((keys[I] == impl::no_bucket ? (void) (results[I] = impl::find_range<Patterns>(
+                    data, size, 0, impl::head_end(size, limit, Patterns::size), 1, impl::buffer_memory{data, size}
+                )) : (void) 0), ...);
+            }(std::make_index_sequence<count>());
+
+            impl::scan_batch(
+                data, size, limit, buckets.start, buckets.order, entries, results, bucketed,
+                [data, size](uint32_t index, size_t i) { return matchers[index](data, size, i); }
+            );
+
+            return results;
+        }
+    };
+
+    /// @brief Find multiple patterns in a data buffer, in a single pass (see <c>sinaps::pattern_set</c>).
+    /// @tparam Patterns List of patterns (see <c>sinaps::pattern</c>).
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename... Patterns> requires (sizeof...(Patterns) > 0 && (utils::is_specialization<Patterns, pattern>::value && ...))
+    std::array<intptr_t, sizeof...(Patterns)> find_all(uint8_t const* data, size_t size) {
+        return pattern_set<Patterns...>::find_all(data, size);
+    }
+
+    /// @brief Find every pattern of a set in a data buffer, in a single pass.
+    /// @tparam Set The pattern set (see <c>sinaps::pattern_set</c>).
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Set> requires utils::is_specialization<Set, pattern_set>::value
+    std::array<intptr_t, Set::count> find_all(uint8_t const* data, size_t size) {
+        return Set::find_all(data, size);
+    }
+
+    /// @brief Find multiple patterns in a data buffer, in a single pass. Patterns are lists of tokens.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param patterns The patterns to search for.
+    /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    inline std::vector<intptr_t> find_all(uint8_t const* data, size_t size, std::span<std::span<token_t const> const> patterns) {
+        size_t count = patterns.size();
+        std::vector<intptr_t> results(count, not_found);
+        std::vector<impl::batch_entry_t> entries(count);
+        std::vector<impl::token_layout_t> layouts(count);
+        std::vector<uint16_t> keys(count, impl::no_bucket);
+
+        size_t remaining = 0;
+        for (size_t k = 0; k < count; k++) {
+            auto const& layout = layouts[k] = impl::layout_tokens(patterns[k]);
+            if (!layout.anchor.valid) {
+                // nothing to bucket by, scan for it separately
+                results[k] = impl::find_tokens(data, size, patterns[k], layout);
+                continue;
+            }
+
+            entries[k] = impl::batch_entry_t{
+                layout.anchor.first, layout.anchor.second, layout.anchor.second_byte, layout.size
+            };
+            keys[k] = layout.anchor.first_byte;
+            remaining++;
+        }
+
+        std::array<uint32_t, 257> start;
+        std::vector<uint32_t> order(count);
+        impl::build_buckets(keys, start, order);
+
+        impl::scan_batch(
+            data, size, size, start, order, entries, results, remaining,
+            [&](uint32_t index, size_t i) {
+                return impl::verify_layout(data + i, layouts[index])
+                    ? impl::resolve_tokens(data, size, i, patterns[index], layouts[index], impl::buffer_memory{data, size})
+                    : not_found;
+            }
+        );
+
+        return results;
+    }
+
+    namespace impl {
+        /// @brief Find multiple compiled patterns in a data buffer, only reporting the matches that start before a limit
+        /// (see <c>pattern_set::find_all</c>).
+        inline std::vector<intptr_t> find_all_compiled(
+            uint8_t const* data, size_t size, size_t limit, std::span<compiled_pattern const> patterns
+        ) {
+            size_t count = patterns.size();
+            std::vector<intptr_t> results(count, not_found);
+            std::vector<batch_entry_t> entries(count);
+            std::vector<uint16_t> keys(count, no_bucket);
+
+            size_t remaining = 0;
+            for (size_t k = 0; k < count; k++) {
+                auto const& pattern = patterns[k];
+                auto const& anchor = pattern.anchor();
+                if (!anchor.valid) {
+                    results[k] = find_compiled_range(
+                        data, size, 0, head_end(size, limit, pattern.size()), pattern, 1, buffer_memory{data, size}
+                    );
+                    continue;
+                }
+
+                entries[k] = batch_entry_t{anchor.first, anchor.second, anchor.second_byte, pattern.size()};
+                keys[k] = anchor.first_byte;
+                remaining++;
+            }
+
+            std::array<uint32_t, 257> start;
+            std::vector<uint32_t> order(count);
+            build_buckets(keys, start, order);
+
+            scan_batch(
+                data, size, limit, start, order, entries, results, remaining,
+                [&](uint32_t index, size_t i) {
+                    auto const& pattern = patterns[index];
+                    return pattern.verify(data + i) ? pattern.resolve(data, size, i, buffer_memory{data, size}) : not_found;
+                }
+            );
+
+            return results;
+        }
+    }
+
+    /// @brief Find multiple compiled patterns in a data buffer, in a single pass.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param patterns The patterns to search for.
+    /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    inline std::vector<intptr_t> find_all(uint8_t const* data, size_t size, std::span<compiled_pattern const> patterns) {
+        return impl::find_all_compiled(data, size, size, patterns);
+    }
+}
+
+#endif // SINAPS_BATCH_HPP
+
+#ifndef SINAPS_COMPILED_PATTERN_SET_HPP
+#define SINAPS_COMPILED_PATTERN_SET_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+
+namespace sinaps {
+    namespace impl {
+        /// @brief Start of a pattern set arena. Every offset is in bytes from the start of the arena,
+        /// so an arena can be copied or mapped anywhere (as long as it stays aligned on <c>row_alignment</c>).
+        struct set_header_t {
+            uint32_t size = 0;     // size of the arena in bytes
+            uint32_t count = 0;    // amount of patterns
+            uint32_t bucketed = 0; // amount of patterns with an anchor, the others are scanned on their own
+            uint32_t max_size = 0; // largest amount of bytes a match of any pattern spans
+            uint32_t entries = 0;  // batch_entry_t[count]
+            uint32_t start = 0;    // uint32_t[257], bucket ranges (see `build_buckets`)
+            uint32_t order = 0;    // uint32_t[bucketed], pattern indices sorted by anchor byte
+            uint32_t records = 0;  // set_record_t[count]
+        };
+
+        /// @brief What a pattern set arena knows about one of its patterns (see <c>sinaps::compiled_pattern</c>).
+        struct set_record_t {
+            // bits of `flags`
+            static constexpr uint32_t anchored = 1; // the pattern is in the buckets
+            static constexpr uint32_t has_gap = 2;
+            static constexpr uint32_t has_follow = 4;
+            static constexpr uint32_t tail_cursor = 8;
+
+            uint32_t rows = 0;         // bytes row, the masks row is `stride` bytes after it
+            uint32_t stride = 0;
+            uint32_t size = 0;         // size of the head in bytes
+            uint32_t cursor = 0;       // cursor offset in bytes
+            uint32_t tokens = 0;       // token_t[token_count], the original tokens
+            uint32_t token_count = 0;
+            uint32_t head = 0;         // amount of tokens before the first gap
+            uint32_t either = 0;       // either_t[either_count]
+            uint32_t either_count = 0;
+            uint32_t flags = 0;
+        };
+
+        /// @brief Read-only view of a pattern set arena, used by the scans.
+        class set_view {
+        public:
+            constexpr set_view() = default;
+
+            /// @param base Start of the arena, aligned on <c>row_alignment</c>. It must be a valid arena.
+            explicit set_view(uint8_t const* base) : m_base(base) {
+                std::memcpy(&m_header, base, sizeof(m_header));
+            }
+
+            [[nodiscard]] set_header_t const& header() const { return m_header; }
+            [[nodiscard]] size_t count() const { return m_header.count; }
+
+            [[nodiscard]] std::span<batch_entry_t const> entries() const { return {at<batch_entry_t>(m_header.entries), count()}; }
+            [[nodiscard]] std::span<uint32_t const, 257> start() const { return std::span<uint32_t const, 257>(at<uint32_t>(m_header.start), 257); }
+            [[nodiscard]] std::span<uint32_t const> order() const { return {at<uint32_t>(m_header.order), m_header.bucketed}; }
+            [[nodiscard]] set_record_t const& record(size_t index) const { return at<set_record_t>(m_header.records)[index]; }
+
+            [[nodiscard]] std::span<token_t const> tokens(set_record_t const& record) const {
+                return {at<token_t>(record.tokens), record.token_count};
+            }
+
+            /// @brief Check whether a pattern matches the data at the given pointer (at least <c>record.size</c> bytes).
+            [[nodiscard]] bool verify(set_record_t const& record, uint8_t const* data) const {
+                uint8_t const* bytes = m_base + record.rows;
+                return verify_masked(data, bytes + record.stride, bytes, record.size) &&
+                    verify_either(data, {at<either_t>(record.either), record.either_count});
+            }
+
+            /// @brief Index to report for a match of a pattern (see <c>sinaps::compiled_pattern::resolve</c>).
+            template <typename Memory>
+            [[nodiscard]] intptr_t resolve(set_record_t const& record, uint8_t const* data, size_t size, size_t start, Memory const& memory) const {
+                auto index = static_cast<intptr_t>(start + record.cursor);
+                auto tokens = this->tokens(record);
+                if ((record.flags & set_record_t::has_gap) && !match_tail(data, size, start + record.size, tokens.subspan(record.head), index)) {
+                    return not_found;
+                }
+                return (record.flags & set_record_t::has_follow) ? resolve_follows(index, tokens, memory) : index;
+            }
+
+        private:
+            template <typename T>
+            [[nodiscard]] T const* at(uint32_t offset) const { return reinterpret_cast<T const*>(m_base + offset); }
+
+            uint8_t const* m_base = nullptr;
+            set_header_t m_header;
+        };
+
+        /// @brief Whether <c>count</c> items of <c>T</c> at <c>offset</c> are aligned and inside an arena.
+        template <typename T>
+        bool arena_holds(std::span<uint8_t const> arena, uint64_t offset, uint64_t count, size_t alignment = alignof(T)) {
+            return offset % alignment == 0 && offset <= arena.size() && count * sizeof(T) <= arena.size() - offset;
+        }
+
+        /// @brief Check that an arena from an untrusted source (e.g. a file) is consistent: every table and record
+        /// lies inside it, and every index it holds is in range. Scans can then use it without bounds checks.
+        /// @param arena The arena, aligned on <c>row_alignment</c>.
+        inline bool check_arena(std::span<uint8_t const> arena) {
+            set_header_t header;
+            if (arena.size() < sizeof(header) || reinterpret_cast<uintptr_t>(arena.data()) % row_alignment != 0) {
+                return false;
+            }
+            std::memcpy(&header, arena.data(), sizeof(header));
+            if (header.size != arena.size() || header.bucketed > header.count ||
+                !arena_holds<batch_entry_t>(arena, header.entries, header.count) ||
+                !arena_holds<uint32_t>(arena, header.start, 257) ||
+                !arena_holds<uint32_t>(arena, header.order, header.bucketed) ||
+                !arena_holds<set_record_t>(arena, header.records, header.count)) {
+                return false;
+            }
+
+            set_view set(arena.data());
+            auto start = set.start();
+            for (size_t b = 0; b < 256; b++) {
+                if (start[b] > start[b + 1]) return false;
+            }
+            if (start[0] != 0 || start[256] != header.bucketed) {
+                return false;
+            }
+            for (auto index : set.order()) {
+                if (index >= header.count || !(set.record(index).flags & set_record_t::anchored)) return false;
+            }
+
+            for (size_t k = 0; k < set.count(); k++) {
+                auto const& record = set.record(k);
+                auto const& entry = set.entries()[k];
+                if (!arena_holds<token_t>(arena, record.tokens, record.token_count) ||
+                    !arena_holds<either_t>(arena, record.either, record.either_count) ||
+                    !arena_holds<uint8_t>(arena, record.rows, uint64_t(record.stride) * 2, row_alignment) ||
+                    record.stride % row_alignment != 0 || record.size > record.stride ||
+                    record.cursor > record.size || record.head > record.token_count ||
+                    ((record.flags & set_record_t::has_gap) != 0) != (record.head < record.token_count)) {
+                    return false;
+                }
+                if ((record.flags & set_record_t::anchored) && (entry.size != record.size || entry.first >= record.size || entry.second >= record.size)) {
+                    return false;
+                }
+
+                auto either = std::span(reinterpret_cast<either_t const*>(arena.data() + record.either), record.either_count);
+                for (auto const& token : either) {
+                    if (token.offset >= record.size) return false;
+                }
+
+                // the head must be as long as the rows say, the tail is bounded by its gaps
+                auto tokens = set.tokens(record);
+                size_t head_size = 0;
+                for (size_t i = 0; i < tokens.size(); i++) {
+                    auto const& token = tokens[i];
+                    if (token.type > token_t::type_t::gap || (token.type == token_t::type_t::gap && token.byte > token.mask)) return false;
+                    if (i < record.head && !token.zero_sized()) head_size++;
+                }
+                if (head_size != record.size) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// @brief Find every pattern of an arena in a data buffer, in a single pass.
+        /// @param limit Only the matches that start before this position are reported (see <c>pattern_set::find_all</c>).
+        inline std::vector<intptr_t> find_all_set(uint8_t const* data, size_t size, size_t limit, set_view const& set) {
+            std::vector<intptr_t> results(set.count(), not_found);
+            if (results.empty()) {
+                return results;
+            }
+            buffer_memory memory{data, size};
+
+            // patterns without fully-specified bytes can't be bucketed, verify them on every position
+            for (size_t k = 0; k < set.count(); k++) {
+                auto const& record = set.record(k);
+                if (record.flags & set_record_t::anchored) {
+                    continue;
+                }
+                results[k] = find_resolved(
+                    0, head_end(size, limit, record.size), 1,
+                    [&](size_t from, size_t count) {
+                        for (size_t i = 0; i + record.size <= count; i++) {
+                            if (set.verify(record, data + from + i)) return static_cast<intptr_t>(i);
+                        }
+                        return not_found;
+                    },
+                    [&](size_t start) { return set.resolve(record, data, size, start, memory); }
+                );
+            }
+
+            scan_batch(
+                data, size, limit, set.start(), set.order(), set.entries(), results, set.header().bucketed,
+                [&](uint32_t index, size_t i) {
+                    auto const& record = set.record(index);
+                    return set.verify(record, data + i) ? set.resolve(record, data, size, i, memory) : not_found;
+                }
+            );
+
+            return results;
+        }
+    }
+
+    /// @brief Compiled patterns packed into one contiguous arena, with the batch tables built once.
+    /// The byte and mask rows, tokens, anchor entries and buckets of every pattern live in a single aligned buffer,
+    /// so a large set costs one allocation, stays dense in cache, and scans without any setup work.
+    class compiled_pattern_set {
+    public:
+        compiled_pattern_set() = default;
+
+        /// @brief Pack a list of patterns, they are not referenced afterwards.
+        /// @throws std::length_error If the arena would not fit in 32-bit offsets.
+        explicit compiled_pattern_set(std::span<compiled_pattern const> patterns) {
+            using impl::set_record_t;
+
+            size_t end = 0;
+            auto reserve = [&end](size_t bytes, size_t alignment) {
+                size_t offset = (end + alignment - 1) / alignment * alignment;
+                end = offset + bytes;
+                return offset;
+            };
+
+            size_t count = patterns.size(), bucketed = 0;
+            std::vector<uint16_t> keys(count, impl::no_bucket);
+            for (size_t k = 0; k < count; k++) {
+                if (patterns[k].anchor().valid) {
+                    keys[k] = patterns[k].anchor().first_byte;
+                    bucketed++;
+                }
+            }
+
+            impl::set_header_t header;
+            reserve(sizeof(header), alignof(impl::set_header_t));
+            header.count = static_cast<uint32_t>(count);
+            header.bucketed = static_cast<uint32_t>(bucketed);
+            header.entries = narrow(reserve(count * sizeof(impl::batch_entry_t), alignof(impl::batch_entry_t)));
+            header.start = narrow(reserve(257 * sizeof(uint32_t), alignof(uint32_t)));
+            header.order = narrow(reserve(bucketed * sizeof(uint32_t), alignof(uint32_t)));
+            header.records = narrow(reserve(count * sizeof(set_record_t), alignof(set_record_t)));
+
+            std::vector<set_record_t> records(count);
+            for (size_t k = 0; k < count; k++) {
+                auto const& pattern = patterns[k];
+                auto& record = records[k];
+                record.size = narrow(pattern.size());
+                record.cursor = narrow(pattern.cursor_pos());
+                record.token_count = narrow(pattern.tokens().size());
+                record.head = narrow(pattern.tokens().size() - pattern.tail().size());
+                record.either_count = narrow(pattern.either().size());
+                record.flags = (pattern.anchor().valid ? set_record_t::anchored : 0u) |
+                    (pattern.has_gap() ? set_record_t::has_gap : 0u) |
+                    (pattern.has_follow() ? set_record_t::has_follow : 0u) |
+                    (pattern.tail_cursor() ? set_record_t::tail_cursor : 0u);
+                record.tokens = narrow(reserve(record.token_count * sizeof(token_t), alignof(token_t)));
+                record.either = narrow(reserve(record.either_count * sizeof(impl::either_t), alignof(impl::either_t)));
+                header.max_size = std::max(header.max_size, narrow(pattern.max_size()));
+            }
+            for (size_t k = 0; k < count; k++) {
+                auto& record = records[k];
+                record.stride = narrow((record.size + impl::row_alignment - 1) / impl::row_alignment * impl::row_alignment);
+                record.rows = narrow(reserve(record.stride * 2, impl::row_alignment));
+            }
+            header.size = narrow(reserve(0, impl::row_alignment));
+
+            m_arena.assign(header.size, 0);
+            auto write = [this](size_t offset, auto const& values) {
+                auto bytes = std::as_bytes(std::span(values));
+                if (!bytes.empty()) std::memcpy(m_arena.data() + offset, bytes.data(), bytes.size());
+            };
+
+            write(0, std::span(&header, 1));
+            for (size_t k = 0; k < count; k++) {
+                auto const& pattern = patterns[k];
+                auto const& record = records[k];
+                auto const& anchor = pattern.anchor();
+                impl::batch_entry_t entry{anchor.first, anchor.second, anchor.second_byte, pattern.size()};
+                write(header.entries + k * sizeof(entry), std::span(&entry, 1));
+                write(header.records + k * sizeof(record), std::span(&record, 1));
+                write(record.tokens, pattern.tokens());
+                write(record.either, pattern.either());
+                write(record.rows, pattern.bytes());
+                write(record.rows + record.stride, pattern.masks());
+            }
+
+            std::array<uint32_t, 257> start;
+            std::vector<uint32_t> order(bucketed);
+            impl::build_buckets(keys, start, order);
+            write(header.start, start);
+            write(header.order, order);
+        }
+
+        /// @brief Amount of patterns in the set.
+        [[nodiscard]] size_t size() const { return view().count(); }
+        /// @brief Largest amount of bytes a match of any pattern spans.
+        [[nodiscard]] size_t max_size() const { return view().header().max_size; }
+        /// @brief The arena, aligned on <c>impl::row_alignment</c>.
+        [[nodiscard]] std::span<uint8_t const> arena() const { return m_arena; }
+        /// @brief View of the arena, used by the scans.
+        [[nodiscard]] impl::set_view view() const { return m_arena.empty() ? impl::set_view() : impl::set_view(m_arena.data()); }
+
+    private:
+        static uint32_t narrow(size_t value) {
+            if (value > std::numeric_limits<uint32_t>::max()) {
+                throw std::length_error("Pattern set is too large");
+            }
+            return static_cast<uint32_t>(value);
+        }
+
+        std::vector<uint8_t, utils::aligned_allocator<uint8_t, impl::row_alignment>> m_arena;
+    };
+
+    /// @brief Find every pattern of a set in a data buffer, in a single pass.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param set The patterns to search for.
+    /// @return The index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    inline std::vector<intptr_t> find_all(uint8_t const* data, size_t size, compiled_pattern_set const& set) {
+        return impl::find_all_set(data, size, size, set.view());
+    }
+}
+
+#endif // SINAPS_COMPILED_PATTERN_SET_HPP
+
+#ifndef SINAPS_MATCHES_HPP
+#define SINAPS_MATCHES_HPP
+
+#include <cstdint>
+#include <iterator>
+#include <span>
+
+
+namespace sinaps {
+    namespace impl {
+        /// @brief Scanner for a compile-time pattern.
+        template <typename Pattern>
+        struct pattern_scanner {
+            [[nodiscard]] constexpr intptr_t next(uint8_t const* data, size_t size) const {
+                return find_start<Pattern>(data, size, 1);
+            }
+
+            [[nodiscard]] constexpr intptr_t prev(uint8_t const* data, size_t size) const {
+                return find_start_reverse<Pattern>(data, size);
+            }
+
+            [[nodiscard]] constexpr intptr_t result(size_t start) const {
+                return static_cast<intptr_t>(start + Pattern::cursor_pos);
+            }
+
+            [[nodiscard]] constexpr intptr_t resolve(uint8_t const* data, size_t size, size_t start) const {
+                return impl::resolve<Pattern>(data, size, start, buffer_memory{data, size});
+            }
+
+            [[nodiscard]] constexpr size_t size() const { return Pattern::size; }
+        };
+
+        /// @brief Scanner for a list of tokens, the layout is computed once for the whole range.
+        struct token_scanner {
+            std::span<token_t const> tokens;
+            token_layout_t layout;
+
+            constexpr explicit token_scanner(std::span<token_t const> tokens)
+                : tokens(tokens), layout(layout_tokens(tokens)) {}
+
+            [[nodiscard]] constexpr intptr_t next(uint8_t const* data, size_t size) const {
+                return find_tokens_start(data, size, layout);
+            }
+
+            [[nodiscard]] constexpr intptr_t prev(uint8_t const* data, size_t size) const {
+                return find_tokens_start_reverse(data, size, layout);
+            }
+
+            [[nodiscard]] constexpr intptr_t result(size_t start) const {
+                return static_cast<intptr_t>(start + layout.cursor);
+            }
+
+            [[nodiscard]] constexpr intptr_t resolve(uint8_t const* data, size_t size, size_t start) const {
+                return resolve_tokens(data, size, start, tokens, layout, buffer_memory{data, size});
+            }
+
+            [[nodiscard]] constexpr size_t size() const { return layout.size; }
+        };
+
+        /// @brief Scanner for a compiled pattern.
+        struct compiled_scanner {
+            compiled_pattern const* pattern;
+
+            [[nodiscard]] constexpr intptr_t next(uint8_t const* data, size_t size) const {
+                return find_compiled_start(data, size, *pattern, 1);
+            }
+
+            [[nodiscard]] constexpr intptr_t prev(uint8_t const* data, size_t size) const {
+                return find_compiled_start_reverse(data, size, *pattern);
+            }
+
+            [[nodiscard]] constexpr intptr_t result(size_t start) const {
+                return static_cast<intptr_t>(start + pattern->cursor_pos());
+            }
+
+            [[nodiscard]] constexpr intptr_t resolve(uint8_t const* data, size_t size, size_t start) const {
+                return pattern->resolve(data, size, start, buffer_memory{data, size});
+            }
+
+            [[nodiscard]] constexpr size_t size() const { return pattern->size(); }
+        };
+    }
+
+    /// @brief Lazy range of all matches of a pattern in a data buffer.
+    /// Matches may overlap, the next scan starts one byte after the start of the previous match.
+    /// Matches whose tail (after a gap) doesn't match, or whose follow tokens can't be resolved in the buffer, are skipped.
+    /// @tparam Scanner Type that provides <c>next(data, size)</c> (first match start), <c>prev(data, size)</c> (last match
+    /// start, used by the reverse scans), <c>result(start)</c> (cursor index),
+    /// <c>resolve(data, size, start)</c> (index to report, or <b>sinaps::not_found</b> to skip the match)
+    /// and <c>size()</c> (pattern size in bytes).
+    template <typename Scanner>
+    class match_range {
+    public:
+        class iterator {
+        public:
+            using iterator_concept = std::forward_iterator_tag;
+            using value_type = intptr_t;
+            using difference_type = std::ptrdiff_t;
+
+            constexpr iterator() = default;
+            constexpr iterator(match_range const* range, size_t from) : m_range(range) {
+                m_start = m_range->next(from, m_index);
+            }
+
+            /// @brief Index of the current match (including the cursor offset).
+            constexpr intptr_t operator*() const { return m_index; }
+
+            constexpr iterator& operator++() {
+                m_start = m_range->next(static_cast<size_t>(m_start) + 1, m_index);
+                return *this;
+            }
+
+            constexpr iterator operator++(int) {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            constexpr bool operator==(iterator const& other) const { return m_start == other.m_start; }
+            constexpr bool operator==(std::default_sentinel_t) const { return m_start == not_found; }
+
+        private:
+            match_range const* m_range = nullptr;
+            intptr_t m_start = not_found; // start of the current match (without the cursor offset)
+            intptr_t m_index = not_found; // index reported for the current match
+        };
+
+        constexpr match_range(uint8_t const* data, size_t size, Scanner scanner)
+            : m_data(data), m_size(size), m_scanner(scanner) {}
+
+        [[nodiscard]] constexpr iterator begin() const { return iterator(this, 0); }
+        [[nodiscard]] constexpr std::default_sentinel_t end() const { return {}; }
+
+    private:
+        /// @brief Start of the first match at or after the given position.
+        /// @param index Output, the index reported for the match.
+        constexpr intptr_t next(size_t from, intptr_t& index) const {
+            while (from <= m_size) {
+                auto res = m_scanner.next(m_data + from, m_size - from);
+                if (res == not_found) break;
+
+                size_t start = from + static_cast<size_t>(res);
+                index = m_scanner.resolve(m_data, m_size, start);
+                if (index != not_found) {
+                    SINAPS_STATS_ADD(matches, 1);
+                    return static_cast<intptr_t>(start);
+                }
+                from = start + 1;
+            }
+            index = not_found;
+            return not_found;
+        }
+
+        uint8_t const* m_data;
+        size_t m_size;
+        Scanner m_scanner;
+    };
+
+    /// @brief Get a lazy range of all matches of a pattern in a data buffer.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @return Range of indices (including the cursor offset) in ascending order.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr auto matches(uint8_t const* data, size_t size) {
+        return match_range(data, size, impl::pattern_scanner<Pattern>{});
+    }
+
+    /// @brief Get a lazy range of all matches of a pattern in a data buffer.
+    /// @param data The data buffer to search in.
+    /// @return Range of indices (including the cursor offset) in ascending order.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr auto matches(std::span<uint8_t const> data) {
+        return matches<Pattern>(data.data(), data.size());
+    }
+
+    /// @brief Get a lazy range of all matches of a pattern in a data buffer. Pattern is a list of tokens.
+    /// The tokens must outlive the range.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @return Range of indices (including the cursor offset) in ascending order.
+    constexpr auto matches(uint8_t const* data, size_t size, std::span<token_t const> pattern) {
+        return match_range(data, size, impl::token_scanner(pattern));
+    }
+
+    /// @brief Get a lazy range of all matches of a compiled pattern in a data buffer.
+    /// The pattern must outlive the range.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @return Range of indices (including the cursor offset) in ascending order.
+    constexpr auto matches(uint8_t const* data, size_t size, compiled_pattern const& pattern) {
+        return match_range(data, size, impl::compiled_scanner{&pattern});
+    }
+
+    namespace impl {
+        template <typename Scanner>
+        constexpr size_t collect_matches(match_range<Scanner> const& range, std::span<intptr_t> out) {
+            if (out.empty()) {
+                return 0;
+            }
+
+            size_t count = 0;
+            for (auto it = range.begin(); it != std::default_sentinel; ++it) {
+                out[count++] = *it;
+                if (count == out.size()) break; // don't scan for a match that can't be stored
+            }
+            return count;
+        }
+    }
+
+    /// @brief Find all occurrences of a pattern in a data buffer, and write them into a caller-provided buffer.
+    /// The scan stops once the output buffer is full.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param out The output buffer for the indices (including the cursor offset).
+    /// @return Amount of indices written to <c>out</c>.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr size_t find_all(uint8_t const* data, size_t size, std::span<intptr_t> out) {
+        return impl::collect_matches(matches<Pattern>(data, size), out);
+    }
+
+    /// @brief Find all occurrences of a pattern in a data buffer, and write them into a caller-provided buffer.
+    /// Pattern is a list of tokens.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param out The output buffer for the indices (including the cursor offset).
+    /// @return Amount of indices written to <c>out</c>.
+    constexpr size_t find_all(uint8_t const* data, size_t size, std::span<token_t const> pattern, std::span<intptr_t> out) {
+        return impl::collect_matches(matches(data, size, pattern), out);
+    }
+
+    /// @brief Find all occurrences of a compiled pattern in a data buffer, and write them into a caller-provided buffer.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param out The output buffer for the indices (including the cursor offset).
+    /// @return Amount of indices written to <c>out</c>.
+    constexpr size_t find_all(uint8_t const* data, size_t size, compiled_pattern const& pattern, std::span<intptr_t> out) {
+        return impl::collect_matches(matches(data, size, pattern), out);
+    }
+}
+
+#endif // SINAPS_MATCHES_HPP
+
+#ifndef SINAPS_PARALLEL_HPP
+#define SINAPS_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <latch>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace sinaps {
+    /// @brief Options for the parallel scan.
+    struct parallel_options {
+        size_t threads = 0;            // amount of workers, 0 means std::thread::hardware_concurrency()
+        size_t chunk_size = 256 << 10; // amount of starting positions per chunk
+    };
+
+    namespace impl {
+        /// @brief Split the buffer into chunks, and scan them on multiple workers.
+        /// Neighbouring chunks overlap by <c>overlap</c> bytes, so matches that straddle a boundary are found
+        /// by the lower chunk. Workers take chunks in ascending order, and stop once a lower chunk has a match,
+        /// so the result is always the same one a sequential scan would return.
+        /// @param overlap Amount of bytes each chunk is extended by (usually the pattern size minus one).
+        /// @param find_chunk Callable that accepts the range <c>[begin, end)</c> of a chunk, and returns the index of the first
+        /// match that starts in it (an index of the whole buffer, follow tokens may point outside the chunk).
+        /// @param spawn Callable that runs the worker function on <c>workers - 1</c> other threads, and waits for them.
+        /// @return The index of the first match in the whole buffer, or <b>sinaps::not_found</b>.
+        template <typename Find, typename Spawn>
+        intptr_t find_chunked(
+            size_t size, size_t overlap, parallel_options const& options,
+            Find&& find_chunk, Spawn&& spawn
+        ) {
+            size_t chunk_size = std::max<size_t>(options.chunk_size, 1);
+            size_t chunk_count = (size + chunk_size - 1) / chunk_size;
+            if (chunk_count == 0) {
+                return not_found;
+            }
+
+            std::vector<intptr_t> results(chunk_count, not_found);
+            std::atomic<size_t> next_chunk{0};
+            std::atomic<size_t> best_chunk{chunk_count}; // lowest chunk with a match so far
+
+#ifdef SINAPS_ENABLE_STATS
+            // every worker counts on its own, and adds to the sink of the calling thread when it's done
+            scan_stats* caller_stats = impl::stats_sink().total;
+            std::mutex stats_mutex;
+#endif
+
+            auto scan = [&] {
+                while (true) {
+                    size_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+                    if (chunk >= best_chunk.load(std::memory_order_relaxed)) {
+                        return; // out of chunks, or a lower chunk already won
+                    }
+
+                    size_t begin = chunk * chunk_size;
+                    size_t end = std::min(begin + chunk_size + overlap, size);
+                    intptr_t res = find_chunk(begin, end);
+                    if (res == not_found) {
+                        continue;
+                    }
+
+                    results[chunk] = res;
+                    size_t current = best_chunk.load(std::memory_order_relaxed);
+                    while (chunk < current && !best_chunk.compare_exchange_weak(current, chunk, std::memory_order_relaxed)) {}
+                }
+            };
+
+            auto worker = [&] {
+#ifdef SINAPS_ENABLE_STATS
+                if (caller_stats) {
+                    scan_stats local;
+                    {
+                        stats_guard guard(stats_sink_t{&local, {}});
+                        scan();
+                    }
+                    std::lock_guard lock(stats_mutex);
+                    *caller_stats += local;
+                    return;
+                }
+#endif
+                scan();
+            };
+
+            spawn(worker);
+
+            size_t best = best_chunk.load();
+            return best == chunk_count ? not_found : results[best];
+        }
+
+        inline size_t worker_count(parallel_options const& options) {
+            return options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        /// @brief Runs the worker on the current thread and <c>threads - 1</c> new ones.
+        inline auto thread_spawner(size_t threads) {
+            return [threads](auto& worker) {
+                std::vector<std::thread> pool;
+                pool.reserve(threads - 1);
+                for (size_t t = 1; t < threads; t++) {
+                    pool.emplace_back(std::ref(worker));
+                }
+                worker();
+                for (auto& thread : pool) {
+                    thread.join();
+                }
+            };
+        }
+
+        /// @brief Submits the worker to a user-supplied executor <c>threads - 1</c> times, runs it on the current thread
+        /// and waits for the submitted ones to finish.
+        template <typename Executor>
+        auto executor_spawner(Executor& executor, size_t threads) {
+            return [&executor, threads](auto& worker) {
+                std::latch done(static_cast<ptrdiff_t>(threads - 1));
+                for (size_t t = 1; t < threads; t++) {
+                    executor(std::function<void()>([&worker, &done] {
+                        worker();
+                        done.count_down();
+                    }));
+                }
+                worker();
+                done.wait();
+            };
+        }
+    }
+
+    /// @brief Find an index of a pattern in a data buffer, using multiple threads.
+    /// The buffer is split into chunks, which are scanned by <c>options.threads</c> workers.
+    /// The result is always the lowest match, same as <c>sinaps::find</c>.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param options Amount of threads and chunk size.
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    intptr_t find_parallel(uint8_t const* data, size_t size, parallel_options options = {}) {
+        return impl::find_chunked(
+            size, Pattern::size - 1, options,
+            [data, size](size_t begin, size_t end) {
+                return impl::find_range<Pattern>(data, size, begin, end, 1, impl::buffer_memory{data, size});
+            },
+            impl::thread_spawner(impl::worker_count(options))
+        );
+    }
+
+    /// @brief Find an index of a pattern in a data buffer, using a user-supplied executor.
+    /// The executor is called with <c>std::function&lt;void()&gt;</c> tasks, and must eventually run all of them
+    /// (e.g. by posting them to a thread pool). The calling thread takes part in the scan, and waits for the tasks.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param executor Callable that schedules a task.
+    /// @param options Amount of tasks and chunk size.
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern, typename Executor>
+        requires utils::is_specialization<Pattern, pattern>::value && std::invocable<Executor&, std::function<void()>>
+    intptr_t find_parallel(uint8_t const* data, size_t size, Executor&& executor, parallel_options options = {}) {
+        return impl::find_chunked(
+            size, Pattern::size - 1, options,
+            [data, size](size_t begin, size_t end) {
+                return impl::find_range<Pattern>(data, size, begin, end, 1, impl::buffer_memory{data, size});
+            },
+            impl::executor_spawner(executor, impl::worker_count(options))
+        );
+    }
+
+    /// @brief Find an index of a compiled pattern in a data buffer, using multiple threads.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param options Amount of threads and chunk size.
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    inline intptr_t find_parallel(uint8_t const* data, size_t size, compiled_pattern const& pattern, parallel_options options = {}) {
+        return impl::find_chunked(
+            size, pattern.size() - 1, options,
+            [data, size, &pattern](size_t begin, size_t end) {
+                return impl::find_compiled_range(data, size, begin, end, pattern, 1, impl::buffer_memory{data, size});
+            },
+            impl::thread_spawner(impl::worker_count(options))
+        );
+    }
+
+    /// @brief Find an index of a compiled pattern in a data buffer, using a user-supplied executor.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param executor Callable that schedules a task.
+    /// @param options Amount of tasks and chunk size.
+    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Executor> requires std::invocable<Executor&, std::function<void()>>
+    intptr_t find_parallel(uint8_t const* data, size_t size, compiled_pattern const& pattern, Executor&& executor, parallel_options options = {}) {
+        return impl::find_chunked(
+            size, pattern.size() - 1, options,
+            [data, size, &pattern](size_t begin, size_t end) {
+                return impl::find_compiled_range(data, size, begin, end, pattern, 1, impl::buffer_memory{data, size});
+            },
+            impl::executor_spawner(executor, impl::worker_count(options))
+        );
+    }
+}
+
+#endif // SINAPS_PARALLEL_HPP
+
+#ifndef SINAPS_ASYNC_HPP
+#define SINAPS_ASYNC_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+
+namespace sinaps {
+    /// @brief Fixed-size thread pool, usable as the executor of <c>sinaps::async_find</c> and <c>sinaps::find_parallel</c>.
+    /// Tasks run in the order they are submitted. The destructor runs the tasks that are still queued, then joins.
+    class thread_pool {
+    public:
+        /// @param threads Amount of workers, 0 means std::thread::hardware_concurrency().
+        explicit thread_pool(size_t threads = 0) {
+            threads = threads ? threads : std::max(std::thread::hardware_concurrency(), 1u);
+            m_workers.reserve(threads);
+            for (size_t t = 0; t < threads; t++) {
+                m_workers.emplace_back([this](std::stop_token stop) { run(stop); });
+            }
+        }
+
+        thread_pool(thread_pool const&) = delete;
+        thread_pool& operator=(thread_pool const&) = delete;
+
+        ~thread_pool() {
+            for (auto& worker : m_workers) {
+                worker.request_stop();
+            }
+            m_ready.notify_all();
+        }
+
+        /// @brief Queue a task.
+        void operator()(std::function<void()> task) {
+            {
+                std::lock_guard lock(m_mutex);
+                m_tasks.push_back(std::move(task));
+            }
+            m_ready.notify_one();
+        }
+
+        /// @brief Amount of workers.
+        [[nodiscard]] size_t size() const { return m_workers.size(); }
+
+    private:
+        void run(std::stop_token stop) {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock lock(m_mutex);
+                    if (!m_ready.wait(lock, stop, [this] { return !m_tasks.empty(); })) {
+                        return; // stopped, and nothing left to run
+                    }
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable_any m_ready;
+        std::deque<std::function<void()>> m_tasks;
+        std::vector<std::jthread> m_workers; // last, so they are joined before the queue is destroyed
+    };
+
+    namespace impl {
+        /// @brief Amount of starting positions scanned between two checks of the stop token.
+        constexpr size_t async_chunk_size = 1 << 20;
+
+        /// @brief Scan a buffer in chunks, and give up between two chunks once a stop is requested.
+        /// @param overlap Amount of bytes each chunk is extended by (the largest match size minus one).
+        /// @param find_range Callable that accepts the range <c>[begin, end)</c> of a chunk (see <c>find_range</c>).
+        /// @return The index of the first match, or <b>sinaps::not_found</b> if not found or stopped.
+        template <typename FindRange>
+        intptr_t find_cancellable(size_t size, size_t overlap, std::stop_token const& stop, FindRange&& find_range) {
+            for (size_t begin = 0; begin < size; begin += async_chunk_size) {
+                if (stop.stop_requested()) {
+                    return not_found;
+                }
+                intptr_t res = find_range(begin, std::min(begin + async_chunk_size + overlap, size));
+                if (res != not_found) {
+                    return res;
+                }
+            }
+            return not_found;
+        }
+
+        /// @brief Run a scan on an executor, and fulfil a promise with its result.
+        template <typename Executor, typename Scan>
+        std::future<intptr_t> submit_scan(Executor& executor, Scan scan) {
+            auto promise = std::make_shared<std::promise<intptr_t>>();
+            auto future = promise->get_future();
+            executor(std::function<void()>([promise, scan = std::move(scan)] {
+                try {
+                    promise->set_value(scan());
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            }));
+            return future;
+        }
+
+        /// @brief State shared by the tasks of an <c>async_find_all</c>.
+        template <typename Results, typename Callback>
+        struct async_batch {
+            std::promise<Results> promise;
+            Results results;
+            std::atomic<size_t> remaining;
+            std::atomic<bool> failed{false};
+            Callback on_result;
+
+            async_batch(Results results, Callback on_result)
+                : results(std::move(results)), remaining(this->results.size()), on_result(std::move(on_result)) {}
+
+            /// @brief Record the result of one pattern, the last one fulfils the promise.
+            void finish(size_t index, intptr_t result) {
+                results[index] = result;
+                on_result(index, result);
+                done();
+            }
+
+            void fail() {
+                if (!failed.exchange(true)) {
+                    promise.set_exception(std::current_exception());
+                }
+                done();
+            }
+
+            void done() {
+                if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && !failed.load()) {
+                    promise.set_value(std::move(results));
+                }
+            }
+        };
+
+        /// @brief Callback of <c>async_find_all</c> that ignores the results.
+        struct ignore_result {
+            void operator()(size_t, intptr_t) const {}
+        };
+
+        /// @brief Submit one task per pattern, each one reports its result as soon as it's done.
+        /// @param scan Callable that accepts a pattern index, and returns its result.
+        template <typename Results, typename Executor, typename Callback, typename Scan>
+        std::future<Results> submit_batch(Executor& executor, Results results, Callback on_result, Scan scan) {
+            auto batch = std::make_shared<async_batch<Results, Callback>>(std::move(results), std::move(on_result));
+            auto future = batch->promise.get_future();
+            size_t count = batch->results.size(); // the last task moves the results out
+            if (count == 0) {
+                batch->promise.set_value(std::move(batch->results));
+                return future;
+            }
+            for (size_t k = 0; k < count; k++) {
+                executor(std::function<void()>([batch, scan, k] {
+                    try {
+                        batch->finish(k, scan(k));
+                    } catch (...) {
+                        batch->fail();
+                    }
+                }));
+            }
+            return future;
+        }
+    }
+
+    /// @brief Find an index of a pattern in a data buffer, on an executor (e.g. a <c>sinaps::thread_pool</c>).
+    /// The buffer must stay alive until the future is ready.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param executor Callable that schedules a <c>std::function&lt;void()&gt;</c> task, it must outlive the scan.
+    /// @param stop Checked every <c>impl::async_chunk_size</c> positions, a stopped scan reports <b>sinaps::not_found</b>.
+    /// @return The future index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern, typename Executor>
+        requires utils::is_specialization<Pattern, pattern>::value && std::invocable<Executor&, std::function<void()>>
+    std::future<intptr_t> async_find(uint8_t const* data, size_t size, Executor& executor, std::stop_token stop = {}) {
+        return impl::submit_scan(executor, [data, size, stop] {
+            return impl::find_cancellable(size, Pattern::max_size - 1, stop, [data, size](size_t begin, size_t end) {
+                return impl::find_range<Pattern>(data, size, begin, end, 1, impl::buffer_memory{data, size});
+            });
+        });
+    }
+
+    /// @brief Find an index of a compiled pattern in a data buffer, on an executor (see <c>sinaps::async_find</c>).
+    /// The pattern and the buffer must stay alive until the future is ready.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param pattern The pattern to search for.
+    /// @param executor Callable that schedules a task.
+    /// @param stop Cancels the scan, a stopped scan reports <b>sinaps::not_found</b>.
+    /// @return The future index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Executor> requires std::invocable<Executor&, std::function<void()>>
+    std::future<intptr_t> async_find(uint8_t const* data, size_t size, compiled_pattern const& pattern, Executor& executor, std::stop_token stop = {}) {
+        return impl::submit_scan(executor, [data, size, &pattern, stop] {
+            size_t overlap = pattern.max_size() ? pattern.max_size() - 1 : 0;
+            return impl::find_cancellable(size, overlap, stop, [data, size, &pattern](size_t begin, size_t end) {
+                return impl::find_compiled_range(data, size, begin, end, pattern, 1, impl::buffer_memory{data, size});
+            });
+        });
+    }
+
+    /// @brief Find multiple patterns in a data buffer, each one as its own task on an executor.
+    /// Unlike <c>sinaps::find_all</c>, every pattern is reported as soon as its own scan is done, so work that
+    /// depends on it can start without waiting for the others.
+    /// @tparam Patterns List of patterns (see <c>sinaps::pattern</c>).
+    /// @param data The data buffer to search in, it must stay alive until the future is ready.
+    /// @param size The size of the data buffer.
+    /// @param executor Callable that schedules a task.
+    /// @param on_result Callable that accepts a pattern index and its result, called on the worker that found it
+    /// (possibly on several threads at once).
+    /// @param stop Cancels the scans, stopped patterns report <b>sinaps::not_found</b>.
+    /// @return The future index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename... Patterns, typename Executor, typename Callback = impl::ignore_result>
+        requires (sizeof...(Patterns) > 0 && (utils::is_specialization<Patterns, pattern>::value && ...)) &&
+            std::invocable<Executor&, std::function<void()>> && std::invocable<Callback&, size_t, intptr_t>
+    std::future<std::array<intptr_t, sizeof...(Patterns)>> async_find_all(
+        uint8_t const* data, size_t size, Executor& executor, Callback on_result = {}, std::stop_token stop = {}
+    ) {
+        using scan_t = intptr_t (*)(uint8_t const*, size_t, std::stop_token const&);
+        static constexpr std::array<scan_t, sizeof...(Patterns)> scans = {
+            [](uint8_t const* data, size_t size, std::stop_token const& stop) {
+                return impl::find_cancellable(size, Patterns::max_size - 1, stop, [data, size](size_t begin, size_t end) {
+                    return impl::find_range<Patterns>(data, size, begin, end, 1, impl::buffer_memory{data, size});
+                });
+            }...
+        };
+
+        std::array<intptr_t, sizeof...(Patterns)> results;
+        results.fill(not_found);
+        return impl::submit_batch(executor, results, std::move(on_result), [data, size, stop](size_t k) {
+            return scans[k](data, size, stop);
+        });
+    }
+
+    /// @brief Find multiple compiled patterns in a data buffer, each one as its own task (see <c>sinaps::async_find_all</c>).
+    /// The patterns and the buffer must stay alive until the future is ready.
+    /// @param data The data buffer to search in.
+    /// @param size The size of the data buffer.
+    /// @param patterns The patterns to search for.
+    /// @param executor Callable that schedules a task.
+    /// @param on_result Callable that accepts a pattern index and its result, called on the worker that found it.
+    /// @param stop Cancels the scans, stopped patterns report <b>sinaps::not_found</b>.
+    /// @return The future index of each pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
+    template <typename Executor, typename Callback = impl::ignore_result>
+        requires std::invocable<Executor&, std::function<void()>> && std::invocable<Callback&, size_t, intptr_t>
+    std::future<std::vector<intptr_t>> async_find_all(
+        uint8_t const* data, size_t size, std::span<compiled_pattern const> patterns, Executor& executor,
+        Callback on_result = {}, std::stop_token stop = {}
+    ) {
+        return impl::submit_batch(
+            executor, std::vector<intptr_t>(patterns.size(), not_found), std::move(on_result),
+            [data, size, patterns, stop](size_t k) {
+                auto const& pattern = patterns[k];
+                size_t overlap = pattern.max_size() ? pattern.max_size() - 1 : 0;
+                return impl::find_cancellable(size, overlap, stop, [data, size, &pattern](size_t begin, size_t end) {
+                    return impl::find_compiled_range(data, size, begin, end, pattern, 1, impl::buffer_memory{data, size});
+                });
+            }
+        );
+    }
+}
+
+#endif // SINAPS_ASYNC_HPP
+
+#ifndef SINAPS_MODULE_HPP
+#define SINAPS_MODULE_HPP
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+
+namespace sinaps {
+    /// @brief Executable format of a module.
+    enum class module_format {
+        unknown,
+        pe,
+        elf,
+        macho
+    };
+
+    /// @brief How the module is laid out in memory.
+    enum class module_layout {
+        image, // loaded by the OS loader, sections are at their virtual addresses
+        file   // raw file contents, sections are at their file offsets
+    };
+
+    /// @brief Range of a module section (or segment, for loaded ELF images).
+    struct section_t {
+        std::string_view name;       // section name, empty for loaded ELF segments (they are unnamed)
+        uint8_t const* data = nullptr;
+        size_t size = 0;
+        uint64_t address = 0;        // offset from the module base once loaded (e.g. the RVA), also for raw files
+        bool executable = false;
+        bool writable = false;
+    };
+
+    namespace impl {
+        /// @brief Bounds-checked little-endian reads from module headers.
+        struct header_reader {
+            uint8_t const* base;
+            size_t size;
+
+            template <typename T>
+            [[nodiscard]] bool read(uint64_t offset, T& out) const {
+                if (offset > size || sizeof(T) > size - offset) {
+                    return false;
+                }
+                std::memcpy(&out, base + offset, sizeof(T));
+                return true;
+            }
+
+            /// @brief Read a fixed-size, possibly not null-terminated name.
+            [[nodiscard]] std::string_view name(uint64_t offset, size_t max) const {
+                if (offset >= size) {
+                    return {};
+                }
+                auto str = reinterpret_cast<char const*>(base + offset);
+                max = std::min<uint64_t>(max, size - offset);
+                return {str, static_cast<size_t>(std::find(str, str + max, '\0') - str)};
+            }
+
+            /// @brief Add a section, clipped to the known size of the module.
+            void add(std::vector<section_t>& out, section_t section, uint64_t offset, uint64_t section_size) const {
+                if (offset >= size || section_size == 0) {
+                    return;
+                }
+                section.data = base + offset;
+                section.size = static_cast<size_t>(std::min<uint64_t>(section_size, size - offset));
+                out.push_back(section);
+            }
+        };
+
+        inline module_format parse_pe(header_reader const& reader, module_layout layout, std::vector<section_t>& out) {
+            constexpr uint32_t scn_cnt_code = 0x00000020;
+            constexpr uint32_t scn_mem_execute = 0x20000000;
+            constexpr uint32_t scn_mem_write = 0x80000000;
+
+            uint16_t dos_magic = 0;
+            uint32_t nt_offset = 0, nt_magic = 0;
+            if (!reader.read(0, dos_magic) || dos_magic != 0x5A4D || !reader.read(0x3C, nt_offset) ||
+                !reader.read(nt_offset, nt_magic) || nt_magic != 0x00004550) {
+                return module_format::unknown;
+            }
+
+            uint16_t section_count = 0, optional_size = 0;
+            if (!reader.read(nt_offset + 6, section_count) || !reader.read(nt_offset + 20, optional_size)) {
+                return module_format::unknown;
+            }
+
+            uint64_t table = uint64_t(nt_offset) + 24 + optional_size;
+            for (uint64_t s = 0; s < section_count; s++) {
+                uint64_t header = table + s * 40;
+                uint32_t virtual_size = 0, virtual_address = 0, raw_size = 0, raw_offset = 0, characteristics = 0;
+                if (!reader.read(header + 8, virtual_size) || !reader.read(header + 12, virtual_address) ||
+                    !reader.read(header + 16, raw_size) || !reader.read(header + 20, raw_offset) ||
+                    !reader.read(header + 36, characteristics)) {
+                    break;
+                }
+
+                section_t section;
+                section.name = reader.name(header, 8);
+                section.executable = characteristics & (scn_mem_execute | scn_cnt_code);
+                section.writable = characteristics & scn_mem_write;
+                section.address = virtual_address;
+
+                if (layout == module_layout::image) {
+                    reader.add(out, section, virtual_address, virtual_size ? virtual_size : raw_size);
+                } else if (raw_offset != 0) {
+                    // the raw data is padded to the file alignment
+                    reader.add(out, section, raw_offset, virtual_size ? std::min(virtual_size, raw_size) : raw_size);
+                }
+            }
+
+            return module_format::pe;
+        }
+
+        template <bool Is64>
+        module_format parse_elf(header_reader const& reader, module_layout layout, std::vector<section_t>& out) {
+            using word_t = std::conditional_t<Is64, uint64_t, uint32_t>;
+            constexpr uint32_t pt_load = 1;
+            constexpr uint32_t pf_x = 1, pf_w = 2;
+            constexpr uint32_t sht_nobits = 8;
+            constexpr word_t shf_write = 1, shf_alloc = 2, shf_execinstr = 4;
+
+            word_t ph_offset = 0, sh_offset = 0;
+            uint16_t ph_size = 0, ph_count = 0, sh_size = 0, sh_count = 0, sh_strings = 0;
+            bool ok = Is64
+                ? reader.read(0x20, ph_offset) && reader.read(0x28, sh_offset) && reader.read(0x36, ph_size) &&
+                  reader.read(0x38, ph_count) && reader.read(0x3A, sh_size) && reader.read(0x3C, sh_count) &&
+                  reader.read(0x3E, sh_strings)
+                : reader.read(0x1C, ph_offset) && reader.read(0x20, sh_offset) && reader.read(0x2A, ph_size) &&
+                  reader.read(0x2C, ph_count) && reader.read(0x2E, sh_size) && reader.read(0x30, sh_count) &&
+                  reader.read(0x32, sh_strings);
+            if (!ok) {
+                return module_format::unknown;
+            }
+
+            // virtual address of the ELF header, from the first loadable segment
+            word_t bias = 0;
+            for (uint64_t p = 0; p < ph_count; p++) {
+                uint64_t header = ph_offset + p * ph_size;
+                uint32_t type = 0;
+                word_t offset = 0, vaddr = 0;
+                if (!reader.read(header, type) || !reader.read(header + (Is64 ? 8 : 4), offset) || !reader.read(header + (Is64 ? 0x10 : 8), vaddr)) {
+                    break;
+                }
+                if (type == pt_load) {
+                    bias = vaddr - offset;
+                    break;
+                }
+            }
+
+            // section headers are not loaded into memory, so loaded images use the program headers instead
+            if (layout == module_layout::file && sh_count != 0 && sh_offset != 0) {
+                word_t strings_offset = 0;
+                (void) reader.read(sh_offset + uint64_t(sh_strings) * sh_size + (Is64 ? 0x18 : 0x10), strings_offset);
+
+                for (uint64_t s = 0; s < sh_count; s++) {
+                    uint64_t header = sh_offset + s * sh_size;
+                    uint32_t name = 0, type = 0;
+                    word_t flags = 0, addr = 0, offset = 0, size = 0;
+                    if (!reader.read(header, name) || !reader.read(header + 4, type) || !reader.read(header + 8, flags) ||
+                        !reader.read(header + (Is64 ? 0x10 : 0x0C), addr) || !reader.read(header + (Is64 ? 0x18 : 0x10), offset) ||
+                        !reader.read(header + (Is64 ? 0x20 : 0x14), size)) {
+                        break;
+                    }
+                    if (!(flags & shf_alloc) || type == sht_nobits) {
+                        continue;
+                    }
+
+                    section_t section;
+                    section.name = strings_offset ? reader.name(uint64_t(strings_offset) + name, 256) : std::string_view();
+                    section.executable = flags & shf_execinstr;
+                    section.writable = flags & shf_write;
+                    section.address = addr - bias;
+                    reader.add(out, section, offset, size);
+                }
+                return module_format::elf;
+            }
+
+            for (uint64_t p = 0; p < ph_count; p++) {
+                uint64_t header = ph_offset + p * ph_size;
+                uint32_t type = 0, flags = 0;
+                word_t offset = 0, vaddr = 0, file_size = 0, mem_size = 0;
+                if (!reader.read(header, type) || !reader.read(header + (Is64 ? 4 : 0x18), flags) ||
+                    !reader.read(header + (Is64 ? 8 : 4), offset) || !reader.read(header + (Is64 ? 0x10 : 8), vaddr) ||
+                    !reader.read(header + (Is64 ? 0x20 : 0x10), file_size) || !reader.read(header + (Is64 ? 0x28 : 0x14), mem_size)) {
+                    break;
+                }
+                if (type != pt_load) {
+                    continue;
+                }
+
+                section_t section;
+                section.executable = flags & pf_x;
+                section.writable = flags & pf_w;
+                section.address = vaddr - bias;
+                if (layout == module_layout::image) {
+                    if (vaddr >= bias) reader.add(out, section, vaddr - bias, mem_size);
+                } else {
+                    reader.add(out, section, offset, file_size);
+                }
+            }
+
+            return module_format::elf;
+        }
+
+        template <bool Is64>
+        module_format parse_macho(header_reader const& reader, module_layout layout, std::vector<section_t>& out) {
+            using word_t = std::conditional_t<Is64, uint64_t, uint32_t>;
+            constexpr uint32_t lc_segment = Is64 ? 0x19 : 0x1;
+            constexpr uint64_t segment_size = Is64 ? 72 : 56;
+            constexpr uint64_t section_size = Is64 ? 80 : 68;
+            constexpr int32_t vm_prot_write = 2;
+            constexpr uint32_t s_attr_instructions = 0x80000000 | 0x00000400; // pure and some instructions
+            constexpr uint32_t s_type_mask = 0xFF, s_zerofill = 0x1, s_gb_zerofill = 0xC, s_thread_local_zerofill = 0x12;
+
+            uint32_t command_count = 0;
+            if (!reader.read(16, command_count)) {
+                return module_format::unknown;
+            }
+
+            struct segment_t {
+                uint64_t command; // offset of the load command
+                word_t vmaddr, fileoff, filesize;
+                int32_t initprot;
+                uint32_t section_count;
+            };
+
+            auto for_each_segment = [&](auto&& callback) {
+                uint64_t command = Is64 ? 32 : 28;
+                for (uint32_t c = 0; c < command_count; c++) {
+                    uint32_t cmd = 0, cmd_size = 0;
+                    if (!reader.read(command, cmd) || !reader.read(command + 4, cmd_size) || cmd_size == 0) {
+                        return;
+                    }
+
+                    segment_t segment{command, 0, 0, 0, 0, 0};
+                    if (cmd == lc_segment && reader.read(command + 24, segment.vmaddr) &&
+                        reader.read(command + (Is64 ? 40 : 32), segment.fileoff) &&
+                        reader.read(command + (Is64 ? 48 : 36), segment.filesize) &&
+                        reader.read(command + (Is64 ? 60 : 44), segment.initprot) &&
+                        reader.read(command + (Is64 ? 64 : 48), segment.section_count)) {
+                        callback(segment);
+                    }
+                    command += cmd_size;
+                }
+            };
+
+            // sections are placed relative to the segment that maps the header (__TEXT)
+            bool has_base = false;
+            word_t base_vmaddr = 0;
+            for_each_segment([&](segment_t const& segment) {
+                if (!has_base && segment.fileoff == 0 && segment.filesize != 0) {
+                    base_vmaddr = segment.vmaddr;
+                    has_base = true;
+                }
+            });
+            if (!has_base) {
+                return module_format::unknown;
+            }
+
+            for_each_segment([&](segment_t const& segment) {
+                for (uint64_t s = 0; s < segment.section_count; s++) {
+                    uint64_t header = segment.command + segment_size + s * section_size;
+                    word_t addr = 0, size = 0;
+                    uint32_t offset = 0, flags = 0;
+                    if (!reader.read(header + 32, addr) || !reader.read(header + (Is64 ? 40 : 36), size) ||
+                        !reader.read(header + (Is64 ? 48 : 40), offset) || !reader.read(header + (Is64 ? 64 : 56), flags)) {
+                        return;
+                    }
+
+                    uint32_t type = flags & s_type_mask;
+                    bool zerofill = type == s_zerofill || type == s_gb_zerofill || type == s_thread_local_zerofill;
+
+                    section_t section;
+                    section.name = reader.name(header, 16);
+                    section.executable = flags & s_attr_instructions;
+                    section.writable = segment.initprot & vm_prot_write;
+                    section.address = addr - base_vmaddr;
+                    if (layout == module_layout::image) {
+                        if (!zerofill && addr >= base_vmaddr) reader.add(out, section, addr - base_vmaddr, size);
+                    } else if (!zerofill) {
+                        reader.add(out, section, offset, size);
+                    }
+                }
+            });
+
+            return module_format::macho;
+        }
+    }
+
+    /// @brief Executable module (PE, ELF or Mach-O), split into its sections.
+    /// The headers are parsed once on construction, so the module can be kept around and scanned many times.
+    /// Only little-endian modules are supported.
+    class module {
+    public:
+        module() = default;
+
+        /// @brief Parse a module loaded by the OS loader, e.g. an <c>HMODULE</c> on Windows,
+        /// or <c>dli_fbase</c> (from <c>dladdr</c>) on Linux and macOS.
+        /// @param base Address of the module headers.
+        explicit module(void const* base)
+            : module(base, std::numeric_limits<size_t>::max(), module_layout::image) {}
+
+        /// @brief Parse the raw contents of an executable file.
+        /// @param file The file contents.
+        explicit module(std::span<uint8_t const> file)
+            : module(file.data(), file.size(), module_layout::file) {}
+
+        /// @brief Parse a module with a known size.
+        /// @param base Address of the module headers.
+        /// @param size Size of the module in bytes, sections are clipped to it.
+        /// @param layout Whether the module is loaded (sections at virtual addresses) or a raw file.
+        module(void const* base, size_t size, module_layout layout) : m_base(static_cast<uint8_t const*>(base)), m_layout(layout) {
+            impl::header_reader reader{m_base, size};
+            uint32_t magic = 0;
+            uint8_t elf_class = 0, elf_data = 0;
+            if (!m_base || !reader.read(0, magic)) {
+                return;
+            }
+
+            if (magic == 0x464C457F && reader.read(4, elf_class) && reader.read(5, elf_data) && elf_data == 1) {
+                m_format = elf_class == 2 ? impl::parse_elf<true>(reader, layout, m_sections)
+                         : elf_class == 1 ? impl::parse_elf<false>(reader, layout, m_sections)
+                         : module_format::unknown;
+            } else if (magic == 0xFEEDFACF) {
+                m_format = impl::parse_macho<true>(reader, layout, m_sections);
+            } else if (magic == 0xFEEDFACE) {
+                m_format = impl::parse_macho<false>(reader, layout, m_sections);
+            } else if ((magic & 0xFFFF) == 0x5A4D) {
+                m_format = impl::parse_pe(reader, layout, m_sections);
+            }
+
+            if (m_format == module_format::unknown) {
+                m_sections.clear();
+                return;
+            }
+
+            // scanning in address order keeps the result the lowest match
+            std::sort(m_sections.begin(), m_sections.end(), [](auto const& a, auto const& b) { return a.data < b.data; });
+            for (auto const& section : m_sections) {
+                if (section.executable) {
+                    m_code.push_back(section);
+                } else if (!section.writable) {
+                    m_readonly.push_back(section);
+                }
+            }
+        }
+
+        /// @brief Address of the module headers, results of the module scans are relative to it.
+        [[nodiscard]] uint8_t const* base() const { return m_base; }
+        /// @brief Format of the module, <c>module_format::unknown</c> if the headers could not be parsed.
+        [[nodiscard]] module_format format() const { return m_format; }
+        /// @brief Whether the sections are at their virtual addresses or at their file offsets.
+        [[nodiscard]] module_layout layout() const { return m_layout; }
+        /// @brief Whether the headers were parsed successfully.
+        [[nodiscard]] bool valid() const { return m_format != module_format::unknown; }
+
+        /// @brief All sections that are present in memory (or in the file), in address order.
+        [[nodiscard]] std::span<section_t const> sections() const { return m_sections; }
+        /// @brief Executable sections, in address order.
+        [[nodiscard]] std::span<section_t const> code_sections() const { return m_code; }
+        /// @brief Non-executable and non-writable sections (constants, strings), in address order.
+        [[nodiscard]] std::span<section_t const> readonly_sections() const { return m_readonly; }
+
+        /// @brief Find a section by name.
+        /// @return Pointer to the section, or <c>nullptr</c> if there is no such section.
+        [[nodiscard]] section_t const* section(std::string_view name) const {
+            auto it = std::find_if(m_sections.begin(), m_sections.end(), [name](auto const& s) { return s.name == name; });
+            return it == m_sections.end() ? nullptr : &*it;
+        }
+
+    private:
+        uint8_t const* m_base = nullptr;
+        module_format m_format = module_format::unknown;
+        module_layout m_layout = module_layout::image;
+        std::vector<section_t> m_sections;
+        std::vector<section_t> m_code;
+        std::vector<section_t> m_readonly;
+    };
+
+    namespace impl {
+        /// @brief Sections of a module seen as memory, used to resolve follow tokens (see <c>resolve_follows</c>),
+        /// so targets can be in any section. Positions are offsets from the module base.
+        /// In raw files, sections don't keep their distances, so targets go through the section addresses.
+        struct module_memory {
+            module const* mod;
+
+            /// @brief Section that holds <c>size</c> bytes at a position, or <c>nullptr</c>.
+            [[nodiscard]] section_t const* find_section(intptr_t pos, size_t size) const {
+                for (auto const& section : mod->sections()) {
+                    intptr_t begin = section.data - mod->base();
+                    if (pos >= begin && static_cast<size_t>(pos - begin) <= section.size && section.size - static_cast<size_t>(pos - begin) >= size) {
+                        return &section;
+                    }
+                }
+                return nullptr;
+            }
+
+            [[nodiscard]] bool readable(intptr_t pos) const { return find_section(pos, 1) != nullptr; }
+
+            bool load32(intptr_t pos, int32_t& value) const {
+                return find_section(pos, 4) && buffer_memory{mod->base() + pos, 4}.load32(0, value);
+            }
+
+            /// @brief Position <c>rel</c> bytes after <c>next</c> in the loaded module, see <c>follow_target</c>.
+            [[nodiscard]] intptr_t target(intptr_t next, int32_t rel) const {
+                if (mod->layout() == module_layout::image) {
+                    return next + rel;
+                }
+                auto const* source = find_section(next, 0);
+                if (!source) {
+                    return not_found;
+                }
+                uint64_t address = source->address + static_cast<uint64_t>(next - (source->data - mod->base())) + static_cast<uint64_t>(int64_t(rel));
+                for (auto const& section : mod->sections()) {
+                    if (address >= section.address && address - section.address < section.size) {
+                        return static_cast<intptr_t>(section.data - mod->base()) + static_cast<intptr_t>(address - section.address);
+                    }
+                }
+                return not_found;
+            }
+        };
+    }
+
+    /// @brief Run a search on each section, and stop at the first one with a match.
+    /// Matches can't straddle two sections.
+    /// @param mod The module the sections belong to.
+    /// @param sections The sections to search in (usually <c>mod.code_sections()</c>).
+    /// @param find_section Callable that accepts a pointer and a size, and returns the index of the first match.
+    /// @return The offset of the match from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    template <typename Find> requires std::invocable<Find&, uint8_t const*, size_t>
+    intptr_t find_in_sections(module const& mod, std::span<section_t const> sections, Find&& find_section) {
+        for (auto const& section : sections) {
+            intptr_t res = find_section(section.data, section.size);
+            if (res != not_found) {
+                return static_cast<intptr_t>(section.data - mod.base()) + res;
+            }
+        }
+        return not_found;
+    }
+
+    /// @brief Find a pattern in the executable sections of a module.
+    /// Follow tokens are resolved in the whole module, e.g. a rip-relative operand can point into a data section.
+    /// @param mod The module to search in.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The offset of the pattern from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    intptr_t find(module const& mod, size_t step_size = 1) {
+        impl::module_memory memory{&mod};
+        for (auto const& section : mod.code_sections()) {
+            auto begin = static_cast<size_t>(section.data - mod.base());
+            intptr_t res = impl::find_range<Pattern>(mod.base(), begin + section.size, begin, begin + section.size, step_size, memory);
+            if (res != not_found) {
+                return res;
+            }
+        }
+        return not_found;
+    }
+
+    /// @brief Find a pattern in the executable sections of a module.
+    /// The pattern is a sequence of masks (see <c>sinaps::masks</c> namespace).
+    /// @param mod The module to search in.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The offset of the pattern from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    template <typename... Mask> requires (!utils::is_specialization<Mask, pattern>::value && ...)
+    intptr_t find(module const& mod, size_t step_size = 1) {
+        return find<pattern<Mask...>>(mod, step_size);
+    }
+
+    /// @brief Find a pattern in the executable sections of a module.
+    /// Builds the pattern from a string literal.
+    /// @param mod The module to search in.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The offset of the pattern from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    template <utils::FixedString S>
+    intptr_t find(module const& mod, size_t step_size = 1) {
+        return find<impl::make_pattern<impl::tokenizePatternString<S>()>>(mod, step_size);
+    }
 
-        for (size_t i = 0; i <= size - pat::size; i += step_size) {
-            bool found = true;
+    /// @brief Find a compiled pattern in the executable sections of a module.
+    /// @param mod The module to search in.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The offset of the pattern from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    inline intptr_t find(module const& mod, compiled_pattern const& pattern, size_t step_size = 1) {
+        impl::module_memory memory{&mod};
+        for (auto const& section : mod.code_sections()) {
+            auto begin = static_cast<size_t>(section.data - mod.base());
+            intptr_t res = impl::find_compiled_range(mod.base(), begin + section.size, begin, begin + section.size, pattern, step_size, memory);
+            if (res != not_found) {
+                return res;
+            }
+        }
+        return not_found;
+    }
 
-            // check for groups
-            for (auto& group : pat::groups) {
-                if (std::is_constant_evaluated()) {
-                    // memcmp is not allowed in consteval
-                    for (size_t j = 0; j < group.count; j++) {
-                        if (data[i + j + group.offset] != pat::bytes[j + group.offset]) {
-                            found = false;
-                            break;
-                        }
-                    }
-                } else {
-                    auto* data_ptr = data + i + group.offset;
-                    auto* pattern_ptr = pat::bytes.data() + group.offset;
+    /// @brief Find a pattern in the executable sections of a module. Pattern is a string.
+    /// @param mod The module to search in.
+    /// @param pattern The pattern to search for.
+    /// @param step_size The step size for the search (default is 1).
+    /// @return The offset of the pattern from <c>mod.base()</c>, or <b>sinaps::not_found</b> if not found.
+    inline intptr_t find(module const& mod, std::string_view pattern, size_t step_size = 1) {
+        return find(mod, compiled_pattern(pattern), step_size);
+    }
+}
 
-                    if (std::memcmp(data_ptr, pattern_ptr, group.count) != 0) {
-                        found = false;
-                        break;
-                    }
+#endif // SINAPS_MODULE_HPP
+
+#ifndef SINAPS_REVERSE_HPP
+#define SINAPS_REVERSE_HPP
+
+#include <algorithm>
+#include <cstdint>
+
+
+namespace sinaps {
+    namespace impl {
+        /// @brief Start of the last match that starts in <c>[begin, end)</c> and resolves, or <b>sinaps::not_found</b>.
+        /// The range is scanned from <c>end</c> down, so only the part after the match is touched.
+        template <typename Scanner>
+        constexpr intptr_t find_last_start(uint8_t const* data, size_t size, size_t begin, size_t end, Scanner const& scanner) {
+            for (size_t to = end; to > begin;) {
+                intptr_t res = scanner.prev(data + begin, to - begin + scanner.size() - 1);
+                if (res == not_found) break;
+                size_t start = begin + static_cast<size_t>(res);
+                if (scanner.resolve(data, size, start) != not_found) {
+                    return static_cast<intptr_t>(start);
                 }
+                to = start;
             }
+            return not_found;
+        }
 
-            if (found) {
-                // check for masked bytes
-                for (size_t j = 0; j < pat::size; j++) {
-                    if (pat::types[j] == token_t::type_t::masked && (data[i + j] & pat::masks[j]) != pat::bytes[j]) {
-                        found = false;
-                        break;
-                    }
-                }
+        /// @brief Find the last match whose cursor is in <c>[first, last]</c>, scanning backwards from <c>last</c>.
+        /// @return The index of the match (see <c>resolve</c>), or <b>sinaps::not_found</b>.
+        template <typename Scanner>
+        constexpr intptr_t find_reverse(uint8_t const* data, size_t size, Scanner const& scanner, intptr_t first, intptr_t last) {
+            size_t pattern_size = scanner.size();
+            intptr_t cursor = scanner.result(0);
+            if (size < pattern_size || last < cursor) {
+                return not_found;
             }
 
-            // check if we found the pattern
-            if (found) {
-                return i + pat::cursor_pos;
+            // range of match starts, the last possible start leaves room for the pattern
+            size_t count = size - pattern_size + 1;
+            size_t begin = static_cast<size_t>(std::max<intptr_t>(first - cursor, 0));
+            size_t end = std::min(static_cast<size_t>(last - cursor) + 1, count);
+            if (begin >= end) {
+                return not_found;
             }
-        }
 
-        // not found
-        return not_found;
+            auto res = find_last_start(data, size, begin, end, scanner);
+            if (res == not_found) {
+                return not_found;
+            }
+            SINAPS_STATS_ADD(matches, 1);
+            return scanner.resolve(data, size, static_cast<size_t>(res));
+        }
     }
 
-    /// @brief Find an index of a pattern in a data buffer.
-    /// The pattern is a sequence of masks (see <c>sinaps::masks</c> namespace).
+    /// @brief Find the last index of a pattern in a data buffer, scanning from the end.
     /// @param data The data buffer to search in.
     /// @param size The size of the data buffer.
-    /// @param step_size The step size for the search (default is 1).
-    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
-    template <typename... Mask> requires (!utils::is_specialization<Mask, pattern>::value && ...)
-    constexpr intptr_t find(uint8_t const* data, size_t size, size_t step_size = 1) {
-        return find<pattern<Mask...>>(data, size, step_size);
+    /// @return The index of the last occurrence of the pattern, or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr intptr_t find_reverse(uint8_t const* data, size_t size) {
+        return impl::find_reverse(data, size, impl::pattern_scanner<Pattern>{}, 0, static_cast<intptr_t>(size));
     }
 
-    /// @brief Find an index of a pattern in a data buffer. Pattern is an array of tokens.
-    /// This method is a helper for the other find methods, use if you know what you're doing.
+    /// @brief Find the last index of a compiled pattern in a data buffer, scanning from the end.
     /// @param data The data buffer to search in.
     /// @param size The size of the data buffer.
-    /// @param step_size The step size for the search (default is 1).
-    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
-    template <std::array pattern> requires (pattern.size() > 0)
-    constexpr intptr_t find(uint8_t const* data, size_t size, size_t step_size = 1) {
-        return find<impl::make_pattern<pattern>>(data, size, step_size);
+    /// @param pattern The pattern to search for.
+    /// @return The index of the last occurrence of the pattern, or <b>sinaps::not_found</b> if not found.
+    constexpr intptr_t find_reverse(uint8_t const* data, size_t size, compiled_pattern const& pattern) {
+        return impl::find_reverse(data, size, impl::compiled_scanner{&pattern}, 0, static_cast<intptr_t>(size));
     }
 
-    /// @brief Find an index of a pattern in a data buffer.
-    /// Builds the pattern from a string literal.
+    /// @brief Find the nearest occurrence of a pattern at or before a position, e.g. the prologue of the function
+    /// that contains a known address. The scan moves backwards from <c>from</c>, so it stops as soon as it meets
+    /// the pattern instead of scanning the whole buffer forward.
     /// @param data The data buffer to search in.
     /// @param size The size of the data buffer.
-    /// @param step_size The step size for the search (default is 1).
-    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
-    template <utils::FixedString S>
-    constexpr intptr_t find(uint8_t const* data, size_t size, size_t step_size = 1) {
-        return find<impl::tokenizePatternString<S>()>(data, size, step_size);
+    /// @param from The last index (including the cursor offset) the pattern may be reported at. For patterns with
+    /// follow tokens, the distance is measured to the cursor of the match, not to the target.
+    /// @param max_distance Amount of bytes before <c>from</c> that are searched.
+    /// @return The index of the nearest occurrence, or <b>sinaps::not_found</b> if there's none in the window.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr intptr_t find_backward_from(uint8_t const* data, size_t size, intptr_t from, size_t max_distance) {
+        return impl::find_reverse(
+            data, size, impl::pattern_scanner<Pattern>{}, from - static_cast<intptr_t>(std::min(max_distance, size)), from
+        );
     }
 
-    /// @brief Find an index of a pattern in a data buffer. Pattern is a list of tokens.
+    /// @brief Find the nearest occurrence of a compiled pattern at or before a position (see <c>sinaps::find_backward_from</c>).
     /// @param data The data buffer to search in.
     /// @param size The size of the data buffer.
     /// @param pattern The pattern to search for.
-    /// @param pattern_size Amount of tokens in the pattern.
-    /// @param step_size The step size for the search (default is 1).
-    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
-    SINAPS_HOT constexpr intptr_t find(uint8_t const* SINAPS_RESTRICT data, size_t size, token_t const* SINAPS_RESTRICT pattern, size_t pattern_size, size_t step_size = 1) {
-        for (size_t i = 0; i < size - pattern_size; i += step_size) {
-            bool found = true;
-            for (size_t j = 0; j < pattern_size; j++) {
-                switch (pattern[j].type) {
-                    case token_t::type_t::byte:
-                        if (data[i + j] != pattern[j].byte) {
-                            found = false;
-                            break;
-                        }
-                        break;
-                    case token_t::type_t::masked:
-                        if ((data[i + j] & pattern[j].mask) != pattern[j].byte) {
-                            found = false;
-                            break;
-                        }
-                        break;
-                    default:
-                        break;
+    /// @param from The last index (including the cursor offset) the pattern may be reported at.
+    /// @param max_distance Amount of bytes before <c>from</c> that are searched.
+    /// @return The index of the nearest occurrence, or <b>sinaps::not_found</b> if there's none in the window.
+    constexpr intptr_t find_backward_from(uint8_t const* data, size_t size, compiled_pattern const& pattern, intptr_t from, size_t max_distance) {
+        return impl::find_reverse(
+            data, size, impl::compiled_scanner{&pattern}, from - static_cast<intptr_t>(std::min(max_distance, size)), from
+        );
+    }
+}
+
+#endif // SINAPS_REVERSE_HPP
+
+#ifndef SINAPS_STREAM_HPP
+#define SINAPS_STREAM_HPP
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+
+namespace sinaps {
+    /// @brief Incremental scanner for data that arrives in chunks (e.g. page-by-page reads, network captures).
+    /// Only the last <c>size - 1</c> bytes of the previous chunks are kept, so matches that straddle two chunks
+    /// are still found, and the memory use does not depend on the amount of data.
+    /// Matches may overlap, and are reported in ascending order as absolute offsets in the stream.
+    /// Follow tokens are not resolved, since their targets may be in data that's gone: the cursor offset is reported.
+    /// Patterns with gaps are not supported, the chunks could cut their tail at any point.
+    /// @tparam Scanner Scanner policy (see <c>sinaps::match_range</c>).
+    template <typename Scanner>
+    class basic_stream_scanner {
+    public:
+        /// @param scanner The scanner policy.
+        /// @param origin Offset of the first byte of the stream (e.g. the address of the first page).
+        explicit basic_stream_scanner(Scanner scanner, uint64_t origin = 0)
+            : m_scanner(scanner), m_overlap(scanner.size() ? scanner.size() - 1 : 0), m_position(origin) {
+            m_carry.reserve(m_overlap);
+            m_joined.resize(m_overlap * 2);
+        }
+
+        /// @brief Scan the next chunk of the stream, and report every match that ends in it.
+        /// @param data The chunk.
+        /// @param size The size of the chunk.
+        /// @param on_match Callable that accepts the offset of a match (including the cursor offset).
+        /// If it returns <c>bool</c>, returning <c>false</c> stops the scan of this chunk (the chunk is still consumed).
+        template <typename Callback> requires std::invocable<Callback&, intptr_t>
+        void feed(uint8_t const* data, size_t size, Callback&& on_match) {
+            auto report = [&](uint64_t start) {
+                if constexpr (std::is_convertible_v<std::invoke_result_t<Callback&, intptr_t>, bool>) {
+                    return static_cast<bool>(on_match(m_scanner.result(static_cast<size_t>(start))));
+                } else {
+                    on_match(m_scanner.result(static_cast<size_t>(start)));
+                    return true;
+                }
+            };
+
+            bool running = true;
+
+            // matches that start in the carry, they can't be complete in it
+            size_t carry = m_carry.size();
+            if (carry > 0 && size > 0) {
+                size_t head = std::min(size, m_overlap);
+                std::memcpy(m_joined.data(), m_carry.data(), carry);
+                std::memcpy(m_joined.data() + carry, data, head);
+                for (size_t from = 0; running && from < carry;) {
+                    intptr_t res = m_scanner.next(m_joined.data() + from, carry + head - from);
+                    if (res == not_found || from + static_cast<size_t>(res) >= carry) break;
+                    from += static_cast<size_t>(res);
+                    running = report(m_position - carry + from);
+                    from++;
                 }
             }
-            if (found) {
-                return i;
+
+            // matches inside the chunk
+            for (size_t from = 0; running && from < size;) {
+                intptr_t res = m_scanner.next(data + from, size - from);
+                if (res == not_found) break;
+                from += static_cast<size_t>(res);
+                running = report(m_position + from);
+                from++;
+            }
+
+            // keep the tail for the next chunk
+            if (size >= m_overlap) {
+                m_carry.assign(data + size - m_overlap, data + size);
+            } else {
+                size_t keep = std::min(carry, m_overlap - size);
+                m_carry.erase(m_carry.begin(), m_carry.begin() + static_cast<ptrdiff_t>(carry - keep));
+                m_carry.insert(m_carry.end(), data, data + size);
             }
+            m_position += size;
         }
 
-        // not found
-        return not_found;
-    }
+        /// @brief Scan the next chunk of the stream.
+        /// @param data The chunk.
+        /// @param size The size of the chunk.
+        /// @return The offset of the first match that ends in this chunk, or <b>sinaps::not_found</b> if there is none.
+        /// Later matches of the same chunk are skipped, use the callback overload to get all of them.
+        intptr_t feed(uint8_t const* data, size_t size) {
+            intptr_t first = not_found;
+            feed(data, size, [&first](intptr_t offset) {
+                first = offset;
+                return false;
+            });
+            return first;
+        }
 
-    /// @brief Find an index of a pattern in a data buffer. Pattern is a list of tokens.
-    /// @param data The data buffer to search in.
-    /// @param size The size of the data buffer.
+        /// @brief Start a new stream, dropping the carry.
+        /// @param origin Offset of the first byte of the new stream.
+        void reset(uint64_t origin = 0) {
+            m_carry.clear();
+            m_position = origin;
+        }
+
+        /// @brief Offset of the next byte to be fed.
+        [[nodiscard]] uint64_t position() const { return m_position; }
+
+    private:
+        Scanner m_scanner;
+        size_t m_overlap;            // pattern size - 1
+        uint64_t m_position;         // offset of the next chunk
+        std::vector<uint8_t> m_carry;  // last `m_overlap` bytes fed so far (fewer at the start of the stream)
+        std::vector<uint8_t> m_joined; // carry followed by the start of the chunk
+    };
+
+    /// @brief Incremental scanner for a compile-time pattern (see <c>sinaps::basic_stream_scanner</c>).
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    class stream_scanner : public basic_stream_scanner<impl::pattern_scanner<Pattern>> {
+        static_assert(!Pattern::has_gap, "Patterns with gaps can't be streamed");
+
+    public:
+        /// @param origin Offset of the first byte of the stream.
+        explicit stream_scanner(uint64_t origin = 0)
+            : basic_stream_scanner<impl::pattern_scanner<Pattern>>(impl::pattern_scanner<Pattern>{}, origin) {}
+    };
+
+    /// @brief Incremental scanner for a compiled pattern (see <c>sinaps::basic_stream_scanner</c>).
+    /// The pattern must outlive the scanner.
     /// @param pattern The pattern to search for.
-    /// @param step_size The step size for the search (default is 1).
-    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
-    template <size_t N>
-    constexpr intptr_t find(uint8_t const* data, size_t size, std::array<token_t, N> const& pattern, size_t step_size = 1) {
-        return find(data, size, pattern.data(), N, step_size);
+    /// @param origin Offset of the first byte of the stream.
+    /// @throws std::invalid_argument If the pattern has gaps.
+    inline basic_stream_scanner<impl::compiled_scanner> make_stream_scanner(compiled_pattern const& pattern, uint64_t origin = 0) {
+        if (pattern.has_gap()) {
+            throw std::invalid_argument("Patterns with gaps can't be streamed");
+        }
+        return basic_stream_scanner<impl::compiled_scanner>(impl::compiled_scanner{&pattern}, origin);
     }
+}
 
-    /// @brief Find an index of a pattern in a data buffer. Pattern is a list of tokens.
+#endif // SINAPS_STREAM_HPP
+
+#ifndef SINAPS_NEAR_HPP
+#define SINAPS_NEAR_HPP
+
+#include <algorithm>
+#include <cstdint>
+
+
+namespace sinaps {
+    namespace impl {
+        /// @brief Start of the first match that starts in <c>[begin, end)</c> and resolves, or <b>sinaps::not_found</b>.
+        template <typename Scanner>
+        constexpr intptr_t find_first_start(uint8_t const* data, size_t size, size_t begin, size_t end, Scanner const& scanner) {
+            for (size_t from = begin; from < end;) {
+                intptr_t res = scanner.next(data + from, end - from + scanner.size() - 1);
+                if (res == not_found) break;
+                size_t start = from + static_cast<size_t>(res);
+                if (scanner.resolve(data, size, start) != not_found) {
+                    return static_cast<intptr_t>(start);
+                }
+                from = start + 1;
+            }
+            return not_found;
+        }
+
+        /// @brief Find the match that starts nearest to <c>hint</c>, scanning outward in rings.
+        /// The first ring spans <c>radius</c> positions on each side of the hint, and every next ring doubles it,
+        /// until the whole buffer is covered. Each position is scanned once, and the scan stops after the first
+        /// ring with a match, since a nearer match would be in a ring that was already scanned.
+        /// @param hint The expected start of the match.
+        /// @param radius Size of the first ring, usually the expected distance from the hint.
+        /// @return The start of the nearest match (the lower one on a tie), or <b>sinaps::not_found</b>.
+        template <typename Scanner>
+        constexpr intptr_t find_near_start(uint8_t const* data, size_t size, Scanner const& scanner, size_t hint, size_t radius) {
+            size_t pattern_size = scanner.size();
+            if (size < pattern_size) {
+                return not_found;
+            }
+
+            size_t count = size - pattern_size + 1; // amount of possible starts
+            hint = std::min(hint, count - 1);
+            size_t ring = std::max<size_t>(radius, 1);
+
+            size_t forward = hint;  // starts in [hint, forward) were scanned
+            size_t backward = hint; // starts in [backward, hint) were scanned
+            while (forward < count || backward > 0) {
+                size_t forward_end = std::min(count, hint + std::min(ring, count));
+                intptr_t ahead = not_found;
+                if (forward < forward_end) {
+                    ahead = find_first_start(data, size, forward, forward_end, scanner);
+                    forward = forward_end;
+                }
+
+                size_t backward_begin = hint > ring ? hint - ring : 0;
+                intptr_t behind = not_found;
+                if (backward_begin < backward) {
+                    behind = find_last_start(data, size, backward_begin, backward, scanner);
+                    backward = backward_begin;
+                }
+
+                if (ahead != not_found && behind != not_found) {
+                    return static_cast<size_t>(ahead) - hint < hint - static_cast<size_t>(behind) ? ahead : behind;
+                }
+                if (ahead != not_found || behind != not_found) {
+                    return ahead != not_found ? ahead : behind;
+                }
+
+                ring = ring > count ? count : ring * 2;
+            }
+
+            return not_found;
+        }
+
+        template <typename Scanner>
+        constexpr intptr_t find_near(uint8_t const* data, size_t size, Scanner const& scanner, intptr_t hint, size_t radius) {
+            intptr_t cursor = scanner.result(0);
+            intptr_t start = std::max<intptr_t>(hint - cursor, 0);
+            auto res = find_near_start(data, size, scanner, static_cast<size_t>(start), radius);
+            if (res == not_found) {
+                return not_found;
+            }
+            SINAPS_STATS_ADD(matches, 1);
+            return scanner.resolve(data, size, static_cast<size_t>(res));
+        }
+    }
+
+    /// @brief Find the occurrence of a pattern that is nearest to a hint, e.g. a signature that is known to be
+    /// close to another resolved one. The scan starts around the hint and moves outward, so it only touches
+    /// a small part of the buffer when the hint is good, and falls back to the whole buffer otherwise.
     /// @param data The data buffer to search in.
     /// @param size The size of the data buffer.
-    /// @param pattern The pattern to search for.
-    /// @param step_size The step size for the search (default is 1).
-    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
-    constexpr intptr_t find(uint8_t const* data, size_t size, std::span<token_t const> pattern, size_t step_size = 1) {
-        return find(data, size, pattern.data(), pattern.size(), step_size);
+    /// @param hint The expected index of the pattern (including the cursor offset). For patterns with follow tokens,
+    /// the distance is measured to the cursor of the match, not to the target.
+    /// @param radius Expected distance from the hint (size of the first window scanned on each side).
+    /// @return The index of the nearest occurrence (the lower one on a tie), or <b>sinaps::not_found</b> if not found.
+    template <typename Pattern> requires utils::is_specialization<Pattern, pattern>::value
+    constexpr intptr_t find_near(uint8_t const* data, size_t size, intptr_t hint, size_t radius = 4096) {
+        return impl::find_near(data, size, impl::pattern_scanner<Pattern>{}, hint, radius);
     }
 
-    /// @brief Find an index of a pattern in a data buffer. Pattern is a list of tokens.
+    /// @brief Find the occurrence of a compiled pattern that is nearest to a hint (see <c>sinaps::find_near</c>).
     /// @param data The data buffer to search in.
     /// @param size The size of the data buffer.
     /// @param pattern The pattern to search for.
-    /// @param step_size The step size for the search (default is 1).
-    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
-    constexpr intptr_t find(uint8_t const* data, size_t size, std::initializer_list<token_t> pattern, size_t step_size = 1) {
-        return find(data, size, pattern.begin(), pattern.size(), step_size);
+    /// @param hint The expected index of the pattern (including the cursor offset).
+    /// @param radius Expected distance from the hint (size of the first window scanned on each side).
+    /// @return The index of the nearest occurrence (the lower one on a tie), or <b>sinaps::not_found</b> if not found.
+    constexpr intptr_t find_near(uint8_t const* data, size_t size, compiled_pattern const& pattern, intptr_t hint, size_t radius = 4096) {
+        return impl::find_near(data, size, impl::compiled_scanner{&pattern}, hint, radius);
     }
+}
 
-    /// @brief Find an index of a pattern in a data buffer. Pattern is a string.
-    /// @param data The data buffer to search in.
+#endif // SINAPS_NEAR_HPP
+
+#ifndef SINAPS_X86_HPP
+#define SINAPS_X86_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+namespace sinaps::x86 {
+    /// @brief Layout of a decoded x86-64 instruction: its length, and where its operand fields are.
+    /// Offsets are from the first byte of the instruction (prefixes included), sizes are 0 if the field is absent.
+    struct instruction_t {
+        uint8_t length = 0;       // 0 if the bytes don't decode
+        uint8_t disp_offset = 0;  // ModRM displacement
+        uint8_t disp_size = 0;
+        uint8_t imm_offset = 0;   // immediate, branch displacement or memory offset
+        uint8_t imm_size = 0;
+        bool rip_relative = false; // the displacement is relative to the next instruction
+        bool relative = false;     // the immediate is a branch displacement (rel8/rel32)
+
+        [[nodiscard]] constexpr bool valid() const { return length != 0; }
+    };
+
+    namespace impl {
+        /// @brief Kind of immediate that follows an opcode (and its ModRM, if any).
+        enum class imm_t : uint8_t {
+            none,
+            byte,   // 8 bits
+            word,   // 16 bits
+            enter,  // 16 + 8 bits
+            z,      // 16 bits with the operand size prefix, otherwise 32
+            v,      // 16/32/64 bits, following the operand size (mov r64, imm64)
+            moffs,  // 64-bit address, or 32 with the address size prefix
+            rel8,
+            rel32,
+            group3  // imm8 (F6) or immz (F7) only for /0 and /1
+        };
+
+        struct opcode_t {
+            bool modrm = false;
+            bool invalid = false;
+            imm_t imm = imm_t::none;
+        };
+
+        /// @brief One-byte opcode map, in 64-bit mode. Prefixes, REX, VEX and EVEX are handled by <c>decode</c>.
+        constexpr auto make_primary_map() {
+            struct map_t { opcode_t op[256]; } map{};
+            for (int i = 0; i < 0x40; i++) {
+                // ALU ops: r/m,r / r,r/m forms, then AL,imm8 and eAX,immz
+                switch (i & 7) {
+                    case 0: case 1: case 2: case 3: map.op[i].modrm = true; break;
+                    case 4: map.op[i].imm = imm_t::byte; break;
+                    case 5: map.op[i].imm = imm_t::z; break;
+                    default: break;
+                }
+            }
+            for (int i : {0x06, 0x07, 0x0E, 0x16, 0x17, 0x1E, 0x1F, 0x27, 0x2F, 0x37, 0x3F, 0x60, 0x61, 0x82, 0x9A, 0xCE, 0xD4, 0xD5, 0xD6, 0xEA}) {
+                map.op[i].invalid = true;
+            }
+            for (int i : {0x63, 0x69, 0x6B, 0x8F, 0xC0, 0xC1, 0xC6, 0xC7, 0xD0, 0xD1, 0xD2, 0xD3, 0xF6, 0xF7, 0xFE, 0xFF}) {
+                map.op[i].modrm = true;
+            }
+            for (int i = 0x80; i <= 0x8E; i++) map.op[i].modrm = true;
+            for (int i = 0xD8; i <= 0xDF; i++) map.op[i].modrm = true;
+            for (int i = 0x70; i <= 0x7F; i++) map.op[i].imm = imm_t::rel8;
+            for (int i = 0xB0; i <= 0xB7; i++) map.op[i].imm = imm_t::byte;
+            for (int i = 0xB8; i <= 0xBF; i++) map.op[i].imm = imm_t::v;
+            for (int i = 0xA0; i <= 0xA3; i++) map.op[i].imm = imm_t::moffs;
+            for (int i = 0xE0; i <= 0xE3; i++) map.op[i].imm = imm_t::rel8;
+            for (int i = 0xE4; i <= 0xE7; i++) map.op[i].imm = imm_t::byte;
+            for (int i : {0x6A, 0x6B, 0x80, 0x83, 0xA8, 0xC0, 0xC1, 0xC6, 0xCD}) map.op[i].imm = imm_t::byte;
+            for (int i : {0x68, 0x69, 0x81, 0xA9, 0xC7}) map.op[i].imm = imm_t::z;
+            map.op[0xC2].imm = imm_t::word;
+            map.op[0xCA].imm = imm_t::word;
+            map.op[0xC8].imm = imm_t::enter;
+            map.op[0xE8].imm = imm_t::rel32;
+            map.op[0xE9].imm = imm_t::rel32;
+            map.op[0xEB].imm = imm_t::rel8;
+            map.op[0xF6].imm = imm_t::group3;
+            map.op[0xF7].imm = imm_t::group3;
+            return map;
+        }
+
+        /// @brief Two-byte opcode map (<c>0F xx</c>), also used for VEX/EVEX map 1.
+        constexpr auto make_secondary_map() {
+            struct map_t { opcode_t op[256]; } map{};
+            for (auto& op : map.op) op.modrm = true;
+            for (int i : {0x05, 0x06, 0x07, 0x08, 0x09, 0x0B, 0x0E, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x37, 0x77, 0xA0, 0xA1, 0xA2, 0xA8, 0xA9, 0xAA}) {
+                map.op[i].modrm = false;
+            }
+            for (int i : {0x04, 0x0A, 0x0C, 0x24, 0x25, 0x26, 0x27, 0x36, 0x39, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F}) {
+                map.op[i] = {false, true, imm_t::none};
+            }
+            for (int i = 0x80; i <= 0x8F; i++) map.op[i] = {false, false, imm_t::rel32};
+            for (int i = 0xC8; i <= 0xCF; i++) map.op[i].modrm = false;
+            for (int i : {0x0F, 0x70, 0x71, 0x72, 0x73, 0xA4, 0xAC, 0xBA, 0xC2, 0xC4, 0xC5, 0xC6}) map.op[i].imm = imm_t::byte;
+            return map;
+        }
+
+        inline constexpr auto primary_map = make_primary_map();
+        inline constexpr auto secondary_map = make_secondary_map();
+
+        /// @brief Map 1 opcodes of VEX/EVEX instructions that take an imm8.
+        constexpr bool vex_imm8(uint8_t op) {
+            return (op >= 0x70 && op <= 0x73) || op == 0xC2 || op == 0xC4 || op == 0xC5 || op == 0xC6;
+        }
+    }
+
+    /// @brief Decode the length and operand fields of an x86-64 instruction (64-bit mode).
+    /// Covers the legacy, REX, VEX and EVEX encodings, but not 3DNow! and XOP.
+    /// @param code The instruction bytes.
+    /// @param size Amount of readable bytes, at most 15 are read.
+    /// @return The instruction layout, <c>length</c> is 0 if the bytes are not a valid or complete instruction.
+    constexpr instruction_t decode(uint8_t const* code, size_t size) {
+        using impl::imm_t;
+        constexpr size_t max_length = 15;
+        size_t limit = size < max_length ? size : max_length;
+        size_t pos = 0;
+
+        bool operand_size = false, address_size = false, rex_w = false;
+        for (; pos < limit; pos++) {
+            uint8_t b = code[pos];
+            if (b == 0x66) operand_size = true;
+            else if (b == 0x67) address_size = true;
+            else if (b == 0xF0 || b == 0xF2 || b == 0xF3 || b == 0x2E || b == 0x36 || b == 0x3E || b == 0x26 || b == 0x64 || b == 0x65) continue;
+            else break;
+        }
+        if (pos < limit && (code[pos] & 0xF0) == 0x40) {
+            rex_w = (code[pos] & 0x08) != 0;
+            pos++;
+        }
+        if (pos >= limit) {
+            return {};
+        }
+
+        impl::opcode_t op;
+        uint8_t opcode = code[pos++];
+        if (opcode == 0xC4 || opcode == 0xC5 || opcode == 0x62) {
+            // VEX (2 or 3 bytes) and EVEX (4 bytes): payload, opcode, then always a ModRM
+            size_t payload = opcode == 0xC5 ? 1 : opcode == 0xC4 ? 2 : 3;
+            if (pos + payload >= limit) {
+                return {};
+            }
+            uint8_t map = opcode == 0xC5 ? 1 : opcode == 0xC4 ? (code[pos] & 0x1F) : (code[pos] & 0x07);
+            rex_w = opcode != 0xC5 && (code[pos + 1] & 0x80) != 0;
+            pos += payload;
+            opcode = code[pos++];
+            op.modrm = !(map == 1 && opcode == 0x77 && payload < 3); // vzeroupper / vzeroall
+            op.imm = map == 3 || (map == 1 && impl::vex_imm8(opcode)) ? imm_t::byte : imm_t::none;
+        } else if (opcode == 0x0F) {
+            if (pos >= limit) {
+                return {};
+            }
+            opcode = code[pos++];
+            if (opcode == 0x38 || opcode == 0x3A) {
+                if (pos >= limit) {
+                    return {};
+                }
+                pos++; // the opcode, both maps always have a ModRM
+                op.modrm = true;
+                op.imm = opcode == 0x3A ? imm_t::byte : imm_t::none;
+            } else {
+                op = impl::secondary_map.op[opcode];
+            }
+        } else {
+            op = impl::primary_map.op[opcode];
+        }
+        if (op.invalid) {
+            return {};
+        }
+
+        instruction_t ins;
+        uint8_t reg = 0;
+        if (op.modrm) {
+            if (pos >= limit) {
+                return {};
+            }
+            uint8_t modrm = code[pos++];
+            uint8_t mod = modrm >> 6, rm = modrm & 7;
+            reg = (modrm >> 3) & 7;
+            size_t disp = 0;
+            if (mod != 3) {
+                if (rm == 4) {
+                    if (pos >= limit) {
+                        return {};
+                    }
+                    uint8_t sib = code[pos++];
+                    if (mod == 0 && (sib & 7) == 5) disp = 4;
+                } else if (mod == 0 && rm == 5) {
+                    disp = 4;
+                    ins.rip_relative = true;
+                }
+                if (mod == 1) disp = 1;
+                if (mod == 2) disp = 4;
+            }
+            ins.disp_offset = static_cast<uint8_t>(pos);
+            ins.disp_size = static_cast<uint8_t>(disp);
+            pos += disp;
+        }
+
+        size_t imm = 0;
+        switch (op.imm) {
+            case imm_t::none: break;
+            case imm_t::byte: imm = 1; break;
+            case imm_t::word: imm = 2; break;
+            case imm_t::enter: imm = 3; break;
+            case imm_t::z: imm = operand_size ? 2 : 4; break;
+            case imm_t::v: imm = rex_w ? 8 : operand_size ? 2 : 4; break;
+            case imm_t::moffs: imm = address_size ? 4 : 8; break;
+            case imm_t::rel8: imm = 1; ins.relative = true; break;
+            case imm_t::rel32: imm = 4; ins.relative = true; break;
+            case imm_t::group3: imm = reg > 1 ? 0 : opcode == 0xF6 ? 1 : operand_size ? 2 : 4; break;
+        }
+        ins.imm_offset = static_cast<uint8_t>(pos);
+        ins.imm_size = static_cast<uint8_t>(imm);
+        pos += imm;
+
+        if (pos > limit) {
+            return {};
+        }
+        ins.length = static_cast<uint8_t>(pos);
+        return ins;
+    }
+
+    /// @brief Whether a byte of an instruction likely changes between builds or load addresses: branch displacements,
+    /// RIP-relative displacements, and immediates or memory offsets of 32 bits or more (often addresses).
+    /// Small immediates and ModRM displacements (struct offsets, stack slots) are kept.
+    /// @param ins The decoded instruction.
+    /// @param offset Offset of the byte in the instruction.
+    constexpr bool is_volatile(instruction_t const& ins, size_t offset) {
+        bool in_disp = ins.disp_size && offset >= ins.disp_offset && offset < size_t(ins.disp_offset) + ins.disp_size;
+        bool in_imm = ins.imm_size && offset >= ins.imm_offset && offset < size_t(ins.imm_offset) + ins.imm_size;
+        return (in_disp && ins.rip_relative) || (in_imm && (ins.relative || ins.imm_size >= 4));
+    }
+}
+
+#endif // SINAPS_X86_HPP
+
+#ifndef SINAPS_GENERATE_HPP
+#define SINAPS_GENERATE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+namespace sinaps {
+    /// @brief Options of <c>sinaps::make_pattern_at</c>.
+    struct generate_options {
+        size_t max_size = 64;  // longest pattern to try, in bytes
+        bool x86_code = true;  // decode x86-64 instructions at the target, and wildcard their volatile operands
+    };
+
+    namespace impl {
+        /// @brief Tokens of the bytes at <c>target</c>, up to <c>max_size</c> of them. If the bytes are decoded as code,
+        /// the operands that likely change between builds are wildcards (see <c>x86::is_volatile</c>), and bytes that
+        /// don't decode are kept as they are.
+        inline std::vector<token_t> code_tokens(uint8_t const* data, size_t size, size_t target, generate_options const& options) {
+            size_t end = target + std::min(options.max_size, size - target);
+            std::vector<token_t> tokens;
+            tokens.reserve(end - target);
+
+            for (size_t pos = target; pos < end;) {
+                auto ins = options.x86_code ? x86::decode(data + pos, size - pos) : x86::instruction_t{};
+                if (!ins.valid()) {
+                    tokens.emplace_back(data[pos++]);
+                    continue;
+                }
+                for (size_t k = 0; k < ins.length && pos + k < end; k++) {
+                    tokens.push_back(x86::is_volatile(ins, k) ? token_t() : token_t(data[pos + k]));
+                }
+                pos += ins.length;
+            }
+            return tokens;
+        }
+    }
+
+    /// @brief Generate the shortest pattern that only matches at a position of a buffer, e.g. to make a signature
+    /// for a function from its address. The pattern starts at the target, so <c>find</c> reports the target itself.
+    /// All matches of the first two fixed bytes are collected with a single scan, then the pattern grows one byte
+    /// at a time and only those candidates are checked again, until the target is the only one left.
+    /// @param data The data buffer (usually the code section of a module).
     /// @param size The size of the data buffer.
-    /// @param pattern The pattern to search for.
-    /// @param step_size The step size for the search (default is 1).
-    /// @return The index of the pattern in the data buffer, or <b>sinaps::not_found</b> if not found.
-    constexpr intptr_t find(uint8_t const* data, size_t size, std::string_view pattern, size_t step_size = 1) {
-        return find(data, size, impl::tokenizePatternStringRuntime(pattern), step_size);
+    /// @param target Position the pattern must match at.
+    /// @param options Longest pattern, and whether to wildcard the volatile operands of x86-64 code.
+    /// @return The tokens of the pattern (see <c>sinaps::to_string</c>), ending with a fixed byte,
+    /// or an empty list if no pattern up to <c>options.max_size</c> bytes is unique.
+    inline std::vector<token_t> make_pattern_at(uint8_t const* data, size_t size, size_t target, generate_options const& options = {}) {
+        if (target >= size) {
+            return {};
+        }
+        auto tokens = impl::code_tokens(data, size, target, options);
+
+        // the head has two fixed bytes, so it's scanned with the anchor prefilter
+        size_t length = 0, fixed = 0;
+        for (; length < tokens.size() && fixed < 2; length++) {
+            fixed += tokens[length].type == token_t::type_t::byte;
+        }
+        if (fixed == 0) {
+            return {};
+        }
+
+        std::vector<size_t> candidates;
+        compiled_pattern head(std::span<token_t const>(tokens).first(length));
+        for (auto index : matches(data, size, head)) {
+            candidates.push_back(static_cast<size_t>(index));
+        }
+
+        // the target always stays a candidate, since its own bytes are the pattern
+        while (true) {
+            if (candidates.size() == 1 && tokens[length - 1].type == token_t::type_t::byte) {
+                tokens.resize(length);
+                return tokens;
+            }
+            if (length == tokens.size()) {
+                return {};
+            }
+
+            auto const& token = tokens[length];
+            std::erase_if(candidates, [&](size_t start) {
+                return start + length >= size || !token.matches(data[start + length]);
+            });
+            length++;
+        }
+    }
+
+    /// @brief Generate the shortest pattern that only matches at a pointer (see <c>sinaps::make_pattern_at</c>).
+    /// @param data The data buffer, the pointer must be inside it.
+    /// @param target Position the pattern must match at.
+    inline std::vector<token_t> make_pattern_at(std::span<uint8_t const> data, uint8_t const* target, generate_options const& options = {}) {
+        return make_pattern_at(data.data(), data.size(), static_cast<size_t>(target - data.data()), options);
     }
 }
 
+#endif // SINAPS_GENERATE_HPP
+
 #endif // SINAPS_SINGLE_HEADER
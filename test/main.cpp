@@ -1,10 +1,1113 @@
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <stop_token>
+#include <string_view>
+#include <vector>
 #include <sinaps.hpp>
+#include <sinaps/cache.hpp>
+#include <sinaps/database.hpp>
+#include <sinaps/mapped_file.hpp>
+#include <sinaps/process.hpp>
+
+#if !defined(_WIN32)
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
 
 static constexpr uint8_t TEST_STRING[] = "Hello, World! This is a test string to check if the pattern matching works.";
 
+namespace {
+    // pseudo-random bytes with a few known sequences
+    constexpr auto make_blob() {
+        std::array<uint8_t, 8192> blob{};
+        uint32_t state = 12345;
+        for (auto& byte : blob) {
+            state = state * 1664525u + 1013904223u;
+            byte = static_cast<uint8_t>(state >> 24);
+        }
+        constexpr uint8_t code[] = {0x48, 0x8B, 0x05, 0x11, 0x22, 0x33, 0x44, 0xC3, 0x90, 0x55, 0x48, 0x89, 0xE5};
+        for (size_t i = 0; i < sizeof(code); i++) {
+            blob[6000 + i] = code[i];
+            blob[blob.size() - sizeof(code) + i] = code[i];
+        }
+        return blob;
+    }
+
+    constexpr auto blob = make_blob();
+
+    // the constant-evaluated scan (see sinaps::impl::find_start_constant)
+    static_assert(sinaps::find<"48 8B 05 11 22 33 44 C3 90 55 48 89 E5">(blob.data(), blob.size()) == 6000);
+    static_assert(sinaps::find<"48 8B 05 ? ? ? ? C3 90 55">(blob.data(), blob.size()) == 6000);
+    static_assert(sinaps::find<"48 8B 05 ^ ? ? ? ? C3 9? 55">(blob.data(), blob.size()) == 6003);
+    static_assert(sinaps::find<"C3 90 55 48 89 E5 ^">(blob.data() + 6010, blob.size() - 6010) == 8192 - 6010);
+    static_assert(sinaps::find<"48 8B 05 ? ? ? ? C3 90 55 48 89 E5 AA">(blob.data(), blob.size()) == sinaps::not_found);
+    static_assert(sinaps::find<"48 8B 05 11 22 33 44 C3 ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? 90">(blob.data(), blob.size()) == sinaps::not_found);
+    static_assert(sinaps::find<"(48|49) 8B (05|0D)">(blob.data(), blob.size()) <= 6000);
+    static_assert(sinaps::find<"48 8B 05 11">(blob.data(), blob.size(), 2) == 6000);
+
+    // the code sequence of the blob over and over, so the anchor bytes match everywhere and only the last copy
+    // is complete: every candidate but one is rejected by the verify
+    std::vector<uint8_t> make_near_misses() {
+        constexpr uint8_t prefix[] = {0x48, 0x8B, 0x05, 0x11, 0x22, 0x33, 0x44, 0xC3, 0x90, 0x55, 0x48, 0x89};
+        std::vector<uint8_t> data;
+        for (size_t k = 0; k < 300; k++) {
+            data.insert(data.end(), std::begin(prefix), std::end(prefix));
+        }
+        data.insert(data.end(), std::begin(prefix), std::end(prefix));
+        data.push_back(0xE5);
+        return data;
+    }
+
+    int failures = 0;
+
+    void check(bool ok, char const* name) {
+        if (!ok) {
+            std::printf("FAILED: %s\n", name);
+            failures++;
+        }
+    }
+
+    // reference for the scans: every position and every token, without any prefilter
+    intptr_t scalar_find(uint8_t const* data, size_t size, std::string_view pattern) {
+        using type_t = sinaps::token_t::type_t;
+        auto tokens = sinaps::impl::tokenizePatternStringRuntime(pattern);
+        for (size_t i = 0; i < size; i++) {
+            size_t offset = 0, cursor = 0;
+            bool ok = true;
+            for (auto const& token : tokens) {
+                if (token.type == type_t::cursor) {
+                    cursor = offset;
+                    continue;
+                }
+                if (i + offset >= size) {
+                    ok = false;
+                    break;
+                }
+                uint8_t byte = data[i + offset++];
+                if (token.type == type_t::byte) ok = byte == token.byte;
+                else if (token.type == type_t::masked) ok = (byte & token.mask) == token.byte;
+                else if (token.type == type_t::either) ok = byte == token.byte || byte == token.mask;
+                if (!ok) break;
+            }
+            if (ok) {
+                return static_cast<intptr_t>(i + cursor);
+            }
+        }
+        return sinaps::not_found;
+    }
+
+    // every index the scalar find reports, in ascending order
+    std::vector<intptr_t> scalar_find_all(uint8_t const* data, size_t size, std::string_view pattern) {
+        std::vector<intptr_t> found;
+        for (size_t from = 0; from < size;) {
+            intptr_t res = scalar_find(data + from, size - from, pattern);
+            if (res == sinaps::not_found) break;
+            // the first index past the start of this match
+            size_t start = from;
+            while (scalar_find(data + start, size - start, pattern) == res - static_cast<intptr_t>(start - from)) start++;
+            found.push_back(static_cast<intptr_t>(from) + res);
+            from = start;
+        }
+        return found;
+    }
+
+    // the compile-time find agrees with the scalar one at every alignment of the buffer, so that the vector loops
+    // and their scalar tails both see the matches
+    template <sinaps::utils::FixedString S>
+    bool same_as_scalar(uint8_t const* data, size_t size) {
+        for (size_t k = 0; k < 80 && k <= size; k++) {
+            if (sinaps::find<S>(data + k, size - k) != scalar_find(data + k, size - k, S)) return false;
+        }
+        return true;
+    }
+
+    // anchor prefilter: the vector kernels report the same matches as the scalar find
+    void test_anchor_prefilter() {
+        auto near = make_near_misses();
+        auto scan_all = [&] {
+            return same_as_scalar<"48 8B 05 11 22 33 44 C3 90 55 48 89 E5">(blob.data(), blob.size()) &&
+                same_as_scalar<"48 8B 05 ? ? ? ? C3 90 55">(blob.data(), blob.size()) &&
+                same_as_scalar<"C3 90 ^ 55 48">(blob.data(), blob.size()) &&
+                same_as_scalar<"? ? 90 55 48">(blob.data(), blob.size()) &&
+                same_as_scalar<"48 88&F8 05">(blob.data(), blob.size()) &&
+                same_as_scalar<"E5">(blob.data(), blob.size()) &&
+                same_as_scalar<"48 8B 05 ? ? ? ? C3 90 55 48 89 E5">(near.data(), near.size()) &&
+                same_as_scalar<"89 E5">(near.data(), near.size()) &&
+                same_as_scalar<"48 89 E5 48">(near.data(), near.size());
+        };
+        check(scan_all(), "anchored scans agree with the scalar find");
+        check(sinaps::find<"? ?">(blob.data(), blob.size()) == 0, "pattern without bytes uses the plain loop");
+        check(sinaps::find<"48 8B 05 11">(blob.data(), 6004) == 6000 && sinaps::find<"48 8B 05 11">(blob.data(), 6004 - 1) == sinaps::not_found, "anchored match at the last position");
+
+        // every kernel the CPU supports, down to the scalar one
+        using sinaps::simd::level_t;
+        auto detected = sinaps::simd::dispatch_level();
+        for (auto level : {level_t::avx512, level_t::avx2, level_t::sse2, level_t::scalar}) {
+            sinaps::simd::limit_dispatch_level(level);
+            check(scan_all(), "dispatched scans agree with the scalar find");
+        }
+        check(sinaps::simd::limit_dispatch_level(detected) == detected, "detected kernel is restored for the other tests");
+    }
+
+    // anchors: the rarest bytes of machine code, and the same matches as the scalar find
+    void test_rarity_anchor() {
+        using code = sinaps::mask::pattern<"48 8B 05 ? ? ? ? C3">;
+        using prologue = sinaps::mask::pattern<"90 55 48 89 E5">;
+        check(code::anchor_pair.valid && code::anchor_pair.first == 2 && code::anchor_pair.second == 7, "anchor on the rarest bytes");
+        check(prologue::anchor_pair.first == 4 && prologue::anchor_pair.second == 1, "anchor bytes in any order");
+        check(!sinaps::mask::pattern<"? 40&F0">::anchor_pair.valid, "no anchor without a fully-specified byte");
+        check(sinaps::mask::pattern<"? E5 ?">::anchor_pair.first == 1 && sinaps::mask::pattern<"? E5 ?">::anchor_pair.second == 1, "single byte anchors on itself");
+
+        auto near = make_near_misses();
+        check(same_as_scalar<"48 8B 05 ? ? ? ? C3">(blob.data(), blob.size()), "rare anchor agrees with the scalar find");
+        check(same_as_scalar<"90 55 48 89 E5">(blob.data(), blob.size()), "rare anchor at the end agrees with the scalar find");
+        check(same_as_scalar<"90 55 48 89 E5">(near.data(), near.size()), "rare anchor over near misses agrees with the scalar find");
+    }
+
+    // find_all(data, size, patterns): the single-pass batch scan agrees with one scalar find per pattern
+    void test_batch_find_all() {
+        using sinaps::token_t;
+        std::vector<std::vector<token_t>> lists = {
+            {token_t(0x48), token_t(0x8B), token_t(0x05), token_t(), token_t(0x22)},
+            {token_t(0xC3), token_t(0x90), token_t(token_t::type_t::cursor), token_t(0x55)},
+            {token_t(0x48), token_t(0x89), token_t(0xE5)},
+            {token_t(0x48), token_t(0x8B), token_t(0x05), token_t(0x11), token_t(0xAA)},
+            {token_t(), token_t(0x89), token_t(0xE5)},
+        };
+        constexpr char const* strings[] = {"48 8B 05 ? 22", "C3 90 ^ 55", "48 89 E5", "48 8B 05 11 AA", "? 89 E5"};
+        std::vector<std::span<token_t const>> spans(lists.begin(), lists.end());
+        std::vector<sinaps::compiled_pattern> compiled;
+        for (auto const& list : lists) {
+            compiled.emplace_back(std::span<token_t const>(list));
+        }
+
+        auto spans_found = sinaps::find_all(blob.data(), blob.size(), std::span<std::span<token_t const> const>(spans));
+        auto compiled_found = sinaps::find_all(blob.data(), blob.size(), std::span<sinaps::compiled_pattern const>(compiled));
+        bool same = spans_found.size() == lists.size();
+        for (size_t k = 0; same && k < lists.size(); k++) {
+            same = spans_found[k] == scalar_find(blob.data(), blob.size(), strings[k]);
+        }
+        check(same, "token batch find_all agrees with the scalar find");
+        check(compiled_found == spans_found, "compiled batch find_all agrees with the token one");
+        check(spans_found[0] == 6000 && spans_found[1] == 6009 && spans_found[3] == sinaps::not_found, "token batch find_all results");
+
+        auto found = sinaps::find_all<
+            sinaps::mask::pattern<"48 8B 05 ? 22">, sinaps::mask::pattern<"C3 90 ^ 55">, sinaps::mask::pattern<"? 89 E5">
+        >(blob.data(), blob.size());
+        check(found[0] == spans_found[0] && found[1] == spans_found[1] && found[2] == spans_found[4], "compile-time batch find_all agrees with the token one");
+    }
+
+    // find_parallel: matches that straddle a chunk boundary are found by the lower chunk
+    void test_find_parallel() {
+        using code = sinaps::mask::pattern<"48 8B 05 ? ? ? ? C3 90 55 48 89 E5">;
+        auto inline_executor = [](std::function<void()> task) { task(); };
+
+        check(sinaps::find_parallel<code>(blob.data(), blob.size(), {4, 6005}) == 6000, "parallel match across a chunk boundary");
+        check(sinaps::find_parallel<code>(blob.data(), blob.size(), {3, 1}) == 6000, "parallel scan with one position per chunk");
+        check(sinaps::find_parallel<code>(blob.data() + 6001, blob.size() - 6001, {2, 1000}) == 8192 - 13 - 6001, "parallel match at the end of the buffer");
+        check(sinaps::find_parallel<code>(blob.data(), blob.size(), inline_executor, {2, 6010}) == 6000, "parallel match on an executor");
+        check(sinaps::find_parallel<code>(blob.data(), 6012, {4, 100}) == sinaps::not_found, "parallel match cut by the buffer end");
+
+        sinaps::compiled_pattern compiled("48 8B 05 ? ? ? ? C3 90 55 48 89 E5");
+        check(sinaps::find_parallel(blob.data(), blob.size(), compiled, {4, 6003}) == 6000, "compiled parallel match across a chunk boundary");
+    }
+
+    // matches / find_all(out): overlapping matches, and an output buffer that fills up
+    void test_matches() {
+        constexpr uint8_t run[] = {0xAA, 0xAA, 0xAA, 0xAA, 0x00, 0xAA, 0xAA};
+        std::vector<sinaps::token_t> tokens = {sinaps::token_t(0xAA), sinaps::token_t(0xAA)};
+
+        std::vector<intptr_t> found;
+        for (auto index : sinaps::matches<sinaps::mask::pattern<"AA AA">>(run, sizeof(run))) {
+            found.push_back(index);
+        }
+        check(found == std::vector<intptr_t>{0, 1, 2, 5}, "overlapping matches in ascending order");
+
+        found.clear();
+        for (auto index : sinaps::matches<sinaps::mask::pattern<"48 8B 05 ? ? ? ? C3">>(blob.data(), blob.size())) {
+            found.push_back(index);
+        }
+        check(found == std::vector<intptr_t>{6000, 8192 - 13}, "matches of a blob");
+
+        std::array<intptr_t, 2> out{};
+        check(sinaps::find_all<sinaps::mask::pattern<"AA AA">>(run, sizeof(run), out) == 2 && out[0] == 0 && out[1] == 1, "find_all stops once the output is full");
+        check(sinaps::find_all(run, sizeof(run), std::span<sinaps::token_t const>(tokens), out) == 2 && out[1] == 1, "token find_all stops once the output is full");
+        check(sinaps::find_all<sinaps::mask::pattern<"AA AA">>(run, sizeof(run), std::span<intptr_t>()) == 0, "find_all into an empty output");
+
+        sinaps::compiled_pattern compiled("AA AA ^ AA");
+        found.clear();
+        for (auto index : sinaps::matches(run, sizeof(run), compiled)) {
+            found.push_back(index);
+        }
+        check(found == std::vector<intptr_t>{2, 3}, "compiled matches report the cursor");
+        std::array<intptr_t, 8> wide{};
+        check(sinaps::find_all(run, sizeof(run), compiled, wide) == 2 && wide[0] == 2 && wide[1] == 3, "compiled find_all with room to spare");
+    }
+
+    // compiled_pattern: same results as the compile-time pattern, and a stable string form
+    void test_compiled_pattern() {
+        constexpr char const* strings[] = {
+            "48 8B 05 11 22 33 44 C3 90 55 48 89 E5",
+            "48 8B 05 ? ? ? ? C3 90 55",
+            "48 8B 05 ^ ? ? ? ? C3 90 55",
+            "? ? 90 55 48",
+            "48 8B 05 ? ? ? ? C3 90 55 48 89 E5 AA",
+            "48 8B 05 ^ ? ? ? ? C3 9? 55",
+        };
+        constexpr intptr_t expected[] = {
+            6000, 6000, 6003, sinaps::find<"? ? 90 55 48">(blob.data(), blob.size()), sinaps::not_found,
+            6003,
+        };
+        for (size_t k = 0; k < std::size(strings); k++) {
+            sinaps::compiled_pattern compiled(strings[k]);
+            check(sinaps::find(blob.data(), blob.size(), compiled) == expected[k], strings[k]);
+            check(sinaps::find(blob.data(), blob.size(), strings[k]) == expected[k], "string find agrees with the compiled pattern");
+            check(sinaps::compiled_pattern(compiled.to_string()).to_string() == compiled.to_string(), "compiled pattern string round trip");
+        }
+
+        sinaps::compiled_pattern head("48 8B 05 ^ ? ? ? ?");
+        check(head.size() == 7 && head.cursor_pos() == 3, "compiled pattern size and cursor");
+        check(sinaps::find(blob.data(), blob.size(), head, 2) == 6003, "compiled pattern with a step size");
+        check(sinaps::find(blob.data(), blob.size(), head, 7) == sinaps::not_found, "compiled pattern step size skips the match");
+
+        bool thrown = false;
+        try {
+            sinaps::compiled_pattern bad("48 (8B");
+        } catch (std::invalid_argument const&) {
+            thrown = true;
+        }
+        check(thrown, "malformed pattern string throws");
+    }
+
+    // packed verify: patterns up to 64 bytes are checked with wide compares, longer ones group by group
+    void test_packed_verify() {
+        check(!sinaps::mask::pattern<"48">::packed_verify, "single byte is not packed");
+        check(sinaps::mask::pattern<"48 8B">::packed_verify, "two bytes are packed");
+
+        // the prefix of the near misses is 12 bytes long, so these span several copies of it
+        using p17 = sinaps::mask::pattern<"89 48 8B 05 ? 22 33 44 C3 90 55 48 89 48 8B 05 11">;
+        using p64 = sinaps::mask::pattern<
+            "55 48 89 48 8B 05 11 22 33 44 C3 90 55 48 89 48 8B 05 11 22 33 44 C3 90 55 48 89 48 8B 05 11 22 "
+            "33 44 C3 90 55 48 89 48 8B 05 ? ? ? ? C3 90 55 48 89 48 8B 05 11 22 33 44 C3 90 55 48 89 E5">;
+        using p64_miss = sinaps::mask::pattern<
+            "55 48 89 48 8B 05 11 22 33 44 C3 90 55 48 89 48 8B 05 11 22 33 44 C3 90 55 48 89 48 8B 05 11 22 "
+            "33 44 C3 90 55 48 89 48 8B 05 ? ? ? ? C3 90 55 48 89 48 8B 05 11 22 33 44 C3 90 55 48 89 E6">;
+        using p65 = sinaps::mask::pattern<
+            "90 55 48 89 48 8B 05 11 22 33 44 C3 90 55 48 89 48 8B 05 11 22 33 44 C3 90 55 48 89 48 8B 05 11 22 "
+            "33 44 C3 90 55 48 89 48 8B 05 ? ? ? ? C3 90 55 48 89 48 8B 05 11 22 33 44 C3 90 55 48 89 E5">;
+        check(p17::packed_verify && p64::packed_verify && p64::size == 64, "patterns up to 64 bytes are packed");
+        check(!p65::packed_verify && p65::size == 65, "65 bytes are not packed");
+
+        auto near = make_near_misses();
+        check(same_as_scalar<"89 48 8B 05 ? 22 33 44 C3 90 55 48 89 48 8B 05 11">(near.data(), near.size()), "packed verify across the vector width agrees with the scalar find");
+        check(same_as_scalar<"48 8B 05 11 20&F0 33 44 C3">(near.data(), near.size()), "packed verify of a masked byte agrees with the scalar find");
+        check(sinaps::find<p64>(near.data(), near.size()) == static_cast<intptr_t>(near.size() - 64), "64-byte packed match at the end");
+        check(sinaps::find<p64_miss>(near.data(), near.size()) == sinaps::not_found, "64-byte packed verify rejects the last byte");
+        check(sinaps::find<p65>(near.data(), near.size()) == static_cast<intptr_t>(near.size() - 65), "65-byte match verified group by group");
+        check(sinaps::find<p17>(near.data(), near.size()) == scalar_find(near.data(), near.size(), "89 48 8B 05 ? 22 33 44 C3 90 55 48 89 48 8B 05 11"), "17-byte packed match");
+    }
+
+    // skip table scan of a pattern against the scalar find, on every alignment of the buffer
+    template <sinaps::utils::FixedString S>
+    bool skip_same_as_scalar(uint8_t const* data, size_t size) {
+        using pat = sinaps::mask::pattern<S>;
+        for (size_t k = 0; k < 40 && k + pat::size <= size; k++) {
+            intptr_t res = sinaps::impl::scan_skip(
+                data + k, size - k - pat::size + 1, pat::skip_table, pat::bytes[pat::skip_table.offset],
+                [&](size_t i) { return sinaps::impl::verify<pat>(data + k + i); }
+            );
+            if (res != scalar_find(data + k, size - k, S)) return false;
+        }
+        return true;
+    }
+
+    // bad-character skip table: shifts, and the same matches as the scalar find (the table is only picked
+    // over the vector kernels on scalar builds, so the scan is checked on its own)
+    void test_skip_table() {
+        using code = sinaps::mask::pattern<"48 8B 05 11 22 33 44 C3 90 55 48 89 E5">;
+        check(code::skip_table.offset == 12 && code::skip_table.table[0x00] == 13 && code::skip_table.table[0x48] == 2 &&
+            code::skip_table.table[0xE5] == 13, "skip table shifts");
+        check(sinaps::mask::pattern<"48 ? ? E5">::skip_table.table[0x00] == 1, "wildcards limit the shifts");
+
+        auto near = make_near_misses();
+        check(skip_same_as_scalar<"48 8B 05 11 22 33 44 C3 90 55 48 89 E5">(blob.data(), blob.size()), "skip scan agrees with the scalar find");
+        check(skip_same_as_scalar<"48 8B 05 ? ? ? ? C3 90 55">(blob.data(), blob.size()), "skip scan with wildcards agrees with the scalar find");
+        check(skip_same_as_scalar<"? ? 90 55 48">(blob.data(), blob.size()), "skip scan after wildcards agrees with the scalar find");
+        check(skip_same_as_scalar<"48 8B 05 11 22 33 44 C3 90 55 48 89 E5">(near.data(), near.size()), "skip scan over near misses agrees with the scalar find");
+    }
+
+    // synthetic PE file: `.text` at 0x1000 (file offset 0x200), `.data` at 0x3000 (0x300) and `.rdata` at 0x2000 (0x400)
+    std::vector<uint8_t> make_pe_file() {
+        std::vector<uint8_t> file(0x500);
+        auto put32 = [&](size_t pos, uint32_t value) { std::memcpy(file.data() + pos, &value, sizeof(value)); };
+        auto put_section = [&](size_t header, char const* name, uint32_t address, uint32_t offset, uint32_t characteristics) {
+            std::memcpy(file.data() + header, name, std::strlen(name));
+            put32(header + 8, 0x100);
+            put32(header + 12, address);
+            put32(header + 16, 0x100);
+            put32(header + 20, offset);
+            put32(header + 36, characteristics);
+        };
+        file[0] = 'M';
+        file[1] = 'Z';
+        put32(0x3C, 0x40);
+        put32(0x40, 0x00004550);
+        file[0x46] = 3;
+        put_section(0x58, ".text", 0x1000, 0x200, 0x60000020);
+        put_section(0x80, ".data", 0x3000, 0x300, 0xC0000040);
+        put_section(0xA8, ".rdata", 0x2000, 0x400, 0x40000040);
+        return file;
+    }
+
+    constexpr uint8_t code_bytes[] = {0x48, 0x8B, 0x05, 0x11, 0x22, 0x33, 0x44, 0xC3, 0x90, 0x55, 0x48, 0x89, 0xE5};
+
+    // module: sections of a PE file, and scans of the code sections that agree with the scalar find
+    void test_module_sections() {
+        auto file = make_pe_file();
+        std::memcpy(file.data() + 0x240, code_bytes, sizeof(code_bytes));
+        std::memcpy(file.data() + 0x410, code_bytes, sizeof(code_bytes)); // not code, never reported
+
+        sinaps::module mod(file);
+        check(mod.valid() && mod.format() == sinaps::module_format::pe && mod.base() == file.data(), "PE file is parsed");
+        check(mod.sections().size() == 3 && mod.code_sections().size() == 1 && mod.readonly_sections().size() == 1, "PE sections are sorted by kind");
+
+        auto const* text = mod.section(".text");
+        check(text && text->data == file.data() + 0x200 && text->size == 0x100 && text->executable && !text->writable, "PE code section");
+        check(mod.section(".rdata") && mod.section(".rdata")->data == file.data() + 0x400, "PE read-only section");
+        check(mod.section(".bss") == nullptr, "missing section");
+
+        intptr_t expected = text ? scalar_find(text->data, text->size, "48 8B 05 ? ? ? ? C3 90 55") + 0x200 : 0;
+        check(expected == 0x240 && sinaps::find<"48 8B 05 ? ? ? ? C3 90 55">(mod) == expected, "module find agrees with the scalar find");
+        check(sinaps::find<"C3 90 ^ 55 48">(mod) == 0x249, "module find reports the cursor");
+        check(sinaps::find(mod, sinaps::compiled_pattern("48 8B 05 ? ? ? ? C3 90 55")) == expected, "compiled module find agrees with the scalar find");
+
+        std::memset(file.data() + 0x240, 0, sizeof(code_bytes));
+        check(sinaps::find<"48 8B 05 ? ? ? ? C3 90 55">(sinaps::module(file)) == sinaps::not_found, "module find skips the data sections");
+
+        file[0x40] = 'X';
+        check(!sinaps::module(file).valid(), "broken signature is not parsed");
+#if defined(__linux__)
+
+        // the test itself, as an ELF file
+        std::ifstream self("/proc/self/exe", std::ios::binary);
+        std::vector<uint8_t> exe((std::istreambuf_iterator<char>(self)), std::istreambuf_iterator<char>());
+        sinaps::module elf(exe);
+        check(elf.valid() && elf.format() == sinaps::module_format::elf && !elf.code_sections().empty(), "own executable is parsed");
+        check(elf.section(".text") && elf.section(".text")->executable, "own code section");
+#endif
+    }
+
+    // mapped_file: scans of the mapping agree with the scalar find, and failed maps leave the file closed
+    void test_mapped_file() {
+        auto dir = std::filesystem::temp_directory_path();
+        auto path = dir / "sinaps_test_mapped.bin";
+        auto empty = dir / "sinaps_test_empty.bin";
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<char const*>(blob.data()), static_cast<std::streamsize>(blob.size()));
+            std::ofstream(empty, std::ios::binary | std::ios::trunc);
+        }
+
+        sinaps::mapped_file file(path);
+        check(file.valid() && file.size() == blob.size() && std::memcmp(file.data(), blob.data(), blob.size()) == 0, "file is mapped");
+        check(sinaps::find<"48 8B 05 ? ? ? ? C3 90 55">(file) == scalar_find(blob.data(), blob.size(), "48 8B 05 ? ? ? ? C3 90 55"), "mapped find agrees with the scalar find");
+        check(sinaps::find(file, "C3 90 ^ 55 48") == 6009, "mapped string find");
+        std::array<intptr_t, 4> out{};
+        check(sinaps::find_all<sinaps::mask::pattern<"48 8B 05 ? ? ? ? C3">>(file, out) == 2 && out[1] == 8192 - 13, "mapped find_all");
+
+        sinaps::mapped_file moved = std::move(file);
+        check(!file.valid() && file.data() == nullptr && moved.valid() && moved.size() == blob.size(), "moved mapping");
+        moved.close();
+        check(!moved.valid() && moved.data() == nullptr && moved.size() == 0, "closed mapping");
+
+        check(moved.open(empty) && moved.valid() && moved.size() == 0, "empty file is valid");
+        check(sinaps::find<"48">(moved) == sinaps::not_found, "empty file scans nothing");
+        check(!moved.open(dir / "sinaps_test_missing.bin") && !moved.valid() && moved.error(), "missing file is not mapped");
+        check(!moved.open(dir) && !moved.valid() && moved.data() == nullptr && moved.error(), "directory is not mapped");
+
+        std::filesystem::remove(path);
+        std::filesystem::remove(empty);
+    }
+
+    // stream_scanner: matches split across feed calls are reported once, at their stream offset
+    void test_stream_scanner() {
+        using code = sinaps::mask::pattern<"48 8B 05 ? ? ? ? C3 90 55 48 89 E5">;
+        std::vector<intptr_t> expected = {6000, 8192 - 13};
+
+        for (size_t chunk : {size_t(1), size_t(5), size_t(6005), size_t(8192)}) {
+            sinaps::stream_scanner<code> scanner;
+            std::vector<intptr_t> found;
+            for (size_t pos = 0; pos < blob.size(); pos += chunk) {
+                scanner.feed(blob.data() + pos, std::min(chunk, blob.size() - pos), [&](intptr_t offset) { found.push_back(offset); });
+            }
+            check(found == expected && scanner.position() == blob.size(), "stream matches split across chunks");
+        }
+
+        sinaps::compiled_pattern compiled("C3 90 ^ 55 48");
+        auto scanner = sinaps::make_stream_scanner(compiled, 0x1000);
+        check(scanner.feed(blob.data(), 6008) == sinaps::not_found, "stream match not complete yet");
+        check(scanner.feed(blob.data() + 6008, 3) == 0x1000 + 6009, "compiled stream match completed by the next feed");
+        scanner.reset();
+        check(scanner.feed(blob.data() + 6008, 3) == sinaps::not_found, "reset drops the carry");
+
+        bool thrown = false;
+        try {
+            (void) sinaps::make_stream_scanner(sinaps::compiled_pattern("48 [2-4] 05"));
+        } catch (std::invalid_argument const&) {
+            thrown = true;
+        }
+        check(thrown, "stream scanner rejects gaps");
+    }
+
+    // process_scanner: this process, read one page at a time, so the matches straddle two reads.
+    // The bytes are in an executable mapping and only code is scanned, so the copies of the patterns on the heap
+    // and in the constant tables are not reported. The patterns are longer than any immediate operand, so the code
+    // that compares against them doesn't contain them either.
+    void test_process_scanner() {
+        constexpr uint8_t first[] = {0xF1, 0x5A, 0xA5, 0x3C, 0x96, 0xC3, 0xE7, 0x0B, 0x2D, 0x71, 0xB8, 0x4E, 0x9A, 0x13, 0xC6, 0xE4};
+        constexpr uint8_t second[] = {0x0B, 0x7E, 0xD2, 0x19, 0x5F, 0xA3, 0x44, 0x6A, 0x8C, 0x31, 0xE9, 0x27, 0xB5, 0x0D, 0x62, 0xF8};
+        constexpr uint8_t gapped[] = {0xD4, 0x6B, 0x00, 0x00, 0x00, 0xE2, 0x9F};
+        constexpr uint8_t followed[] = {0xD8, 0x2C, 0x67, 0x5E, 0xA1, 0x3F, 0x0C, 0xB7, 0x00, 0x4B, 0x91};
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        size_t page = info.dwPageSize;
+        auto* memory = static_cast<uint8_t*>(VirtualAlloc(nullptr, page * 4, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        void* mapping = mmap(nullptr, page * 4, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        auto* memory = mapping == MAP_FAILED ? nullptr : static_cast<uint8_t*>(mapping);
+#endif
+        if (!memory) {
+            check(false, "test memory is allocated");
+            return;
+        }
+        std::memcpy(memory + page - 3, first, sizeof(first));
+        std::memcpy(memory + page * 2 - 4, second, sizeof(second));
+        std::memcpy(memory + page * 3 - 3, gapped, sizeof(gapped));
+        // two matches in the overlap before the third read, the first one follows into the next block
+        std::memcpy(memory + page * 3 - 50, followed, sizeof(followed));
+        std::memcpy(memory + page * 3 - 30, followed, sizeof(followed));
+        int32_t rel[] = {43, 5};
+        std::memcpy(memory + page * 3 - 39, &rel[0], 4);
+        std::memcpy(memory + page * 3 - 19, &rel[1], 4);
+#if defined(_WIN32)
+        DWORD previous;
+        VirtualProtect(memory, page * 4, PAGE_EXECUTE_READ, &previous);
+        auto self = GetCurrentProcess();
+#else
+        mprotect(memory, page * 4, PROT_READ | PROT_EXEC);
+        auto self = getpid();
+#endif
+
+        auto address = [memory](size_t offset) { return static_cast<intptr_t>(reinterpret_cast<uintptr_t>(memory) + offset); };
+        sinaps::process_scanner scanner(self, {page, true});
+        intptr_t expected = address(scalar_find(memory, page * 4, "F1 5A A5 3C 96 C3 E7 0B 2D 71 B8 4E 9A 13 C6 E4"));
+        check(expected == address(page - 3), "scalar find of the first pattern");
+        check(scanner.find<sinaps::mask::pattern<"F1 5A A5 3C 96 C3 E7 0B 2D 71 B8 4E 9A 13 C6 E4">>() == expected, "process match straddling two reads");
+        check(scanner.find(sinaps::compiled_pattern("F1 5A A5 3C 96 C3 E7 0B 2D 71 B8 4E 9A 13 C6 E4")) == expected, "compiled process match straddling two reads");
+
+        auto found = scanner.find_all<sinaps::mask::pattern<"F1 5A A5 3C 96 C3 E7 0B 2D 71 B8 4E 9A 13 C6 E4">, sinaps::mask::pattern<"0B 7E D2 19 5F A3 ^ 44 6A 8C 31 E9 27 B5 0D 62 F8">>();
+        check(found[0] == expected && found[1] == address(page * 2 + 2), "process find_all across two pairs of reads");
+
+        check(address(scalar_find(memory, page * 4, "D4 6B ? ? ? E2 9F")) == address(page * 3 - 3), "scalar find of the gap pattern");
+        check(scanner.find<sinaps::mask::pattern<"D4 6B [1-6] E2 9F">>() == address(page * 3 - 3), "process gap match straddling two reads");
+        check(scanner.find(sinaps::compiled_pattern("D4 6B [1-6] ^ E2 9F")) == address(page * 3 + 2), "compiled process gap match straddling two reads");
+
+        // the wide pattern makes the blocks overlap by 63 bytes, the matches that start there are left to the next block
+        using wide = sinaps::mask::pattern<"F1 5A A5 3C 96 C3 E7 0B 2D 71 B8 4E 9A 13 C6 E4 ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ?">;
+        using follow = sinaps::mask::pattern<"D8 2C 67 5E A1 3F 0C B7 [1-6] 4B 91 ^ @ ? ? ? ?">;
+        check(address(scalar_find(memory, page * 4, "D8 2C 67 5E A1 3F 0C B7 ? 4B 91")) == address(page * 3 - 50), "scalar find of the follow pattern");
+        check(scanner.find<follow>() == address(page * 3 + 8), "process gap match following into the next read");
+        auto crossing = scanner.find_all<wide, follow>();
+        check(crossing[0] == expected && crossing[1] == address(page * 3 + 8), "process find_all reports the match that crosses the block");
+        std::vector<sinaps::compiled_pattern> compiled{
+            sinaps::compiled_pattern("F1 5A A5 3C 96 C3 E7 0B 2D 71 B8 4E 9A 13 C6 E4 ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ?"), sinaps::compiled_pattern("D8 2C 67 5E A1 3F 0C B7 [1-6] 4B 91 ^ @ ? ? ? ?")
+        };
+        auto expected_all = std::vector<intptr_t>{expected, address(page * 3 + 8)};
+        check(scanner.find_all(std::span<sinaps::compiled_pattern const>(compiled)) == expected_all, "compiled process find_all across the block");
+        check(scanner.find_all(sinaps::compiled_pattern_set(compiled)) == expected_all, "process pattern set across the block");
+#if defined(_WIN32)
+        VirtualFree(memory, 0, MEM_RELEASE);
+#else
+        munmap(memory, page * 4);
+#endif
+    }
+
+    // result_cache: entries survive a save and a load, and stale ones are scanned again
+    void test_result_cache() {
+        using code = sinaps::mask::pattern<"48 8B 05 ? ? ? ? C3 90 55">;
+        auto key = sinaps::compiled_pattern("48 8B 05 ? ? ? ? C3 90 55").to_string();
+        auto file = make_pe_file();
+        std::memcpy(file.data() + 0x240, code_bytes, sizeof(code_bytes));
+        sinaps::module mod(file);
+        auto fingerprint = sinaps::module_fingerprint(mod);
+
+        auto path = std::filesystem::temp_directory_path() / "sinaps_test_cache.txt";
+        auto temp = path;
+        temp += ".tmp";
+        std::filesystem::remove(path);
+        std::ofstream(temp) << "left over by a writer that crashed";
+        {
+            sinaps::result_cache cache(path);
+            check(cache.size() == 0, "missing cache file is empty");
+            check(sinaps::find_cached<code>(cache, mod, fingerprint) == 0x240, "cache miss scans the module");
+            check(cache.lookup(fingerprint, key) == 0x240, "found offset is stored");
+            check(cache.save() && std::filesystem::exists(path) && !std::filesystem::exists(temp), "cache is saved with a rename");
+        }
+
+        sinaps::result_cache cache(path);
+        check(cache.size() == 1 && cache.lookup(fingerprint, key) == 0x240, "cache round trip");
+        check(sinaps::find_cached(cache, mod, fingerprint, sinaps::compiled_pattern("48 8B 05 ? ? ? ? C3 90 55")) == 0x240, "compiled pattern hits the same entry");
+
+        cache.store(fingerprint, key, 0x250);
+        check(sinaps::find_cached<code>(cache, mod, fingerprint) == 0x240 && cache.lookup(fingerprint, key) == 0x240, "stale offset is verified and replaced");
+        cache.store(fingerprint, key, 0x340);
+        check(sinaps::find_cached<code>(cache, mod, fingerprint) == 0x240, "offset outside the code sections is rejected");
+
+        // another build: the header changes, and so does the fingerprint
+        auto rebuilt = file;
+        rebuilt[0x48] ^= 1;
+        std::memmove(rebuilt.data() + 0x260, rebuilt.data() + 0x240, sizeof(code_bytes));
+        std::memset(rebuilt.data() + 0x240, 0, 0x20);
+        sinaps::module other(rebuilt);
+        auto other_fingerprint = sinaps::module_fingerprint(other);
+        check(other_fingerprint != fingerprint, "rebuilt module gets another fingerprint");
+        check(!cache.lookup(other_fingerprint, key), "entries of the old build don't apply");
+        check(sinaps::find_cached<code>(cache, other, other_fingerprint) == 0x260 && cache.lookup(fingerprint, key) == 0x240, "each build keeps its own entry");
+        check(sinaps::module_fingerprint(sinaps::module(file), true) == sinaps::module_fingerprint(mod, true), "code hash is stable");
+
+        std::filesystem::remove(path);
+    }
+
+    // matches_at: the same answer as the scalar find at every index of the buffer
+    void test_matches_at() {
+        using code = sinaps::mask::pattern<"C3 90 ^ 55 48">;
+        sinaps::compiled_pattern compiled("C3 90 ^ 55 48");
+        bool same = true;
+        for (size_t i = 0; i < blob.size() + 4; i++) {
+            bool expected = i >= 2 && i + 2 <= blob.size() && scalar_find(blob.data() + i - 2, 4, "C3 90 ^ 55 48") == 2;
+            auto index = static_cast<intptr_t>(i);
+            same &= sinaps::matches_at<code>(blob.data(), blob.size(), index) == expected;
+            same &= sinaps::matches_at(blob.data(), blob.size(), index, compiled) == expected;
+        }
+        check(same, "matches_at agrees with the scalar find");
+        check(sinaps::matches_at<code>(blob.data(), blob.size(), 6009) && sinaps::matches_at<code>(blob.data(), blob.size(), 8192 - 4), "matches_at of both copies");
+        check(!sinaps::matches_at<code>(blob.data(), blob.size(), -1), "matches_at before the buffer");
+        check(sinaps::matches_at<code>(blob.data() + 6009), "matches_at a pointer");
+    }
+
+    // find_near: the match nearest to the hint (the lower one on a tie), whatever the radius
+    void test_find_near() {
+        using code = sinaps::mask::pattern<"48 8B 05 ? ? ? ? C3 90 55">;
+        auto all = scalar_find_all(blob.data(), blob.size(), "48 8B 05 ? ? ? ? C3 90 55");
+        check(all == std::vector<intptr_t>{6000, 8192 - 13}, "scalar matches of the code");
+
+        bool same = true;
+        for (intptr_t hint = -50; hint < 8300; hint += 37) {
+            intptr_t expected = sinaps::not_found;
+            for (auto index : all) {
+                if (expected == sinaps::not_found || std::abs(index - hint) < std::abs(expected - hint)) expected = index;
+            }
+            same &= sinaps::find_near<code>(blob.data(), blob.size(), hint, 16) == expected;
+            same &= sinaps::find_near<code>(blob.data(), blob.size(), hint) == expected;
+        }
+        check(same, "find_near agrees with the nearest scalar match");
+        check(sinaps::find_near<code>(blob.data(), blob.size(), 7089) == 6000 && sinaps::find_near<code>(blob.data(), blob.size(), 7090) == 8192 - 13, "find_near around the midpoint");
+        check(sinaps::find_near(blob.data(), blob.size(), sinaps::compiled_pattern("C3 90 ^ 55 48"), 6012, 2) == 6009, "compiled find_near reports the cursor");
+        check(sinaps::find_near<sinaps::mask::pattern<"48 8B 05 11 AA">>(blob.data(), blob.size(), 6000) == sinaps::not_found, "find_near without a match");
+    }
+
+    // module file layout: follow targets go through the section addresses, not the file offsets
+    void test_module_file_follow() {
+        auto file = make_pe_file();
+
+        // mov rax, [rip + rel] at 0x1010 targets 0x3010, lea rcx, [rip + rel] at 0x1020 targets past the module
+        constexpr uint8_t code[] = {0x48, 0x8B, 0x05, 0xF9, 0x1F, 0x00, 0x00, 0x48, 0x8D, 0x0D, 0xE9, 0x3F, 0x00, 0x00};
+        std::memcpy(file.data() + 0x210, code, 7);
+        std::memcpy(file.data() + 0x220, code + 7, 7);
+
+        sinaps::module mod(file);
+        check(mod.valid() && mod.layout() == sinaps::module_layout::file, "synthetic file module is parsed");
+        check(sinaps::find<"48 8B 05 ^ @ ? ? ? ?">(mod) == 0x310, "file follow target mapped to the target section offset");
+        check(sinaps::find(mod, sinaps::compiled_pattern("48 8B 05 ^ @ ? ? ? ?")) == 0x310, "compiled file follow target mapped to the target section offset");
+        check(sinaps::find<"48 8D 0D ^ @ ? ? ? ?">(mod) == sinaps::not_found, "file follow target outside every section");
+
+        // the same follow in a plain buffer, where positions are offsets of the buffer
+        std::vector<uint8_t> buffer(0x40);
+        std::memcpy(buffer.data() + 0x10, code, 7);
+        buffer[0x13] = 0x10;
+        buffer[0x14] = buffer[0x15] = buffer[0x16] = 0x00;
+        check(sinaps::find<"48 8B 05 ^ @ ? ? ? ?">(buffer.data(), buffer.size()) == 0x27, "buffer follow target");
+        check(sinaps::find<sinaps::mask::byte<0x48>, sinaps::mask::byte<0x8B>, sinaps::mask::byte<0x05>, sinaps::mask::rel32<>>(buffer.data(), buffer.size()) == 0x27, "rel32 mask follows the displacement");
+    }
+
+    // pattern strings with nibbles and alternatives: parsing, string round trips, and matching at compile time and at runtime
+    void test_pattern_syntax() {
+        using type_t = sinaps::token_t::type_t;
+        auto tokens = sinaps::impl::tokenizePatternStringRuntime("4? ?B (05|0D) (0F|F0)");
+        check(tokens.size() == 4, "nibble and alternative token count");
+        check(tokens[0].type == type_t::masked && tokens[0].byte == 0x40 && tokens[0].mask == 0xF0, "high nibble");
+        check(tokens[1].type == type_t::masked && tokens[1].byte == 0x0B && tokens[1].mask == 0x0F, "low nibble");
+        check(tokens[2].type == type_t::masked && tokens[2].byte == 0x05 && tokens[2].mask == 0xF7, "alternative of one bit is a masked byte");
+        check(tokens[3].type == type_t::either && tokens[3].byte == 0x0F && tokens[3].mask == 0xF0, "alternative of two bytes");
+
+        sinaps::compiled_pattern compiled("4? ?B (05|0D) (0F|F0) ^ ?");
+        check(compiled.to_string() == "4? ?B 05&F7 (0F|F0) ^ ?", "compiled string form");
+        check(sinaps::compiled_pattern(compiled.to_string()).to_string() == compiled.to_string(), "compiled string round trip");
+        check(std::string_view(sinaps::mask::pattern<"4? ?B (05|0D) (0F|F0) ^ ?">::to_string()) == compiled.to_string(), "compile-time string form");
+        check(std::string_view(sinaps::mask::pattern<"(48|49|4A|4B) 8B">::to_string()) == "48&FC 8B", "alternative of two bits");
+
+        constexpr uint8_t data[] = {0xFF, 0x00, 0x4B, 0x48, 0x4B, 0x0D, 0xF0, 0x12};
+        check(scalar_find(data, sizeof(data), "4? ?B (05|0D) (0F|F0) ^ ?") == 7, "scalar find of nibbles and alternatives");
+        check(sinaps::find<"4? ?B (05|0D) (0F|F0) ^ ?">(data, sizeof(data)) == 7, "compile-time find of nibbles and alternatives");
+        check(sinaps::find(data, sizeof(data), compiled) == 7, "runtime find of nibbles and alternatives");
+        check(sinaps::find<"(0F|F0)">(data, sizeof(data)) == 6 && sinaps::find(data, sizeof(data), "(0F|F0)") == 6, "either only matches its two bytes");
+        check(same_as_scalar<"4? 8B (05|0D) ? ? ? ? C3 9?">(blob.data(), blob.size()), "nibbles and alternatives agree with the scalar find");
+        check(same_as_scalar<"(48|E5) (8B|89)">(blob.data(), blob.size()), "either tokens agree with the scalar find");
+
+        for (auto bad : {"(05|", "(05|0D", "()", "(01|02|04)"}) {
+            bool thrown = false;
+            try {
+                sinaps::compiled_pattern pattern(bad);
+            } catch (std::invalid_argument const&) {
+                thrown = true;
+            }
+            check(thrown, bad);
+        }
+    }
+
+    // gap tokens: bounds of the gap, the end of the buffer and a cursor after the gap
+    void test_gaps() {
+        // 48 8B 05 11 22 33 44 C3 90 55 48 89 E5 at 6000 and at the end
+        check(sinaps::find<"48 8B 05 [4] C3">(blob.data(), blob.size()) == 6000, "exact gap");
+        check(sinaps::find<"48 8B 05 [1-3] 44">(blob.data(), blob.size()) == 6000, "gap at its maximum");
+        check(sinaps::find<"48 8B 05 [3-9] 44">(blob.data(), blob.size()) == 6000, "gap at its minimum");
+        check(sinaps::find<"48 8B 05 [1-2] 44">(blob.data(), blob.size()) == sinaps::not_found, "gap longer than its maximum");
+        check(sinaps::find<"48 8B 05 [4-9] 44">(blob.data(), blob.size()) == sinaps::not_found, "gap shorter than its minimum");
+        check(sinaps::find<"48 8B 05 [0-2] 11 [0-8] 89 E5">(blob.data(), blob.size()) == 6000, "several gaps");
+
+        // the last copy of the code, alone
+        auto const* tail = blob.data() + blob.size() - 13;
+        check(sinaps::find<"55 [1-8] E5">(tail, 13) == 9, "gap whose maximum reaches past the buffer end");
+        check(sinaps::find<"55 [1-8] E5">(tail, 12) == sinaps::not_found, "tail cut by the buffer end");
+        check(sinaps::find(tail, 13, sinaps::compiled_pattern("55 [1-8] E5")) == 9, "compiled gap at the buffer end");
+        check(sinaps::find<"89 [0-4] E5">(tail, 13) == 11, "empty gap");
+
+        check(sinaps::find<"48 8B 05 [2-6] ^ C3 90">(blob.data(), blob.size()) == 6007, "cursor after a gap");
+        check(sinaps::find<"C3 [0-2] ^ 55">(blob.data() + 6000, 13) == 9, "cursor after a short gap");
+        check(sinaps::find(blob.data(), blob.size(), sinaps::compiled_pattern("48 8B 05 [2-6] ^ C3 90")) == 6007, "compiled cursor after a gap");
+        check(sinaps::find<"48 8B ^ 05 [2-6] C3 90">(blob.data(), blob.size()) == 6002, "cursor before a gap");
+
+        sinaps::compiled_pattern compiled("48 8B 05 [1-3] 44 C3");
+        check(compiled.has_gap() && compiled.size() == 3 && compiled.min_size() == 6 && compiled.max_size() == 8, "compiled gap sizes");
+        check(compiled.to_string() == "48 8B 05 [1-3] 44 C3" && sinaps::compiled_pattern("05 [4] C3").to_string() == "05 [4] C3", "gap string form");
+
+        std::vector<intptr_t> found;
+        for (auto index : sinaps::matches<sinaps::mask::pattern<"48 8B 05 [2-6] C3">>(blob.data(), blob.size())) {
+            found.push_back(index);
+        }
+        check(found == std::vector<intptr_t>{6000, 8192 - 13}, "matches with a gap");
+    }
+
+    // scan_stats: counters of the scans run in a scope, next to the scalar find result
+    void test_scan_stats() {
+        using code = sinaps::mask::pattern<"48 8B 05 ? ? ? ? C3 90 55">;
+        sinaps::scan_stats stats;
+        intptr_t found = 0;
+        {
+            sinaps::stats_scope scope(stats);
+            found = sinaps::find<code>(blob.data(), blob.size());
+        }
+        check(found == scalar_find(blob.data(), blob.size(), "48 8B 05 ? ? ? ? C3 90 55"), "counted find agrees with the scalar find");
+        check(stats.matches == 1 && stats.verifies >= 1 && stats.candidates >= stats.verifies, "counters of a single find");
+        check(stats.bytes >= static_cast<uint64_t>(found) + 1 && stats.bytes <= blob.size(), "bytes examined up to the match");
+
+        sinaps::scan_stats outer, inner;
+        {
+            sinaps::stats_scope outer_scope(outer);
+            {
+                sinaps::stats_scope inner_scope(inner);
+                (void) sinaps::find<code>(blob.data(), blob.size());
+            }
+            (void) sinaps::find<sinaps::mask::pattern<"48 8B 05 11 AA">>(blob.data(), blob.size());
+        }
+        check(inner.matches == 1 && outer.matches == 0 && outer.bytes == blob.size() - 4, "nested scopes count separately");
+
+        std::array<sinaps::scan_stats, 3> patterns{};
+        sinaps::scan_stats total;
+        std::array<intptr_t, 3> results{};
+        {
+            sinaps::stats_scope scope(total, patterns);
+            results = sinaps::find_all<code, sinaps::mask::pattern<"C3 90 ^ 55">, sinaps::mask::pattern<"48 8B 05 11 AA">>(blob.data(), blob.size());
+        }
+        check(results[0] == found && results[1] == 6009 && results[2] == sinaps::not_found, "counted batch agrees with the scalar find");
+        check(patterns[0].matches == 1 && patterns[1].matches == 1 && patterns[2].matches == 0 && total.matches == 2, "per-pattern batch counters");
+
+        sinaps::scan_stats parallel;
+        {
+            sinaps::stats_scope scope(parallel);
+            found = sinaps::find_parallel<code>(blob.data(), blob.size(), {4, 1000});
+        }
+        check(found == 6000 && parallel.matches >= 1 && parallel.bytes > 0, "parallel workers count into the caller's scope");
+    }
+
+    // pattern_set: one pass over the buffer, the same results as one scalar find per pattern
+    void test_pattern_set() {
+        using set = sinaps::pattern_set<
+            sinaps::mask::pattern<"48 8B 05 ? ? ? ? C3">,
+            sinaps::mask::pattern<"C3 90 ^ 55 48">,
+            sinaps::mask::pattern<"? ? 90 55">,
+            sinaps::mask::pattern<"48 8B 05 11 AA">,
+            sinaps::mask::pattern<"4? ?B">,
+            sinaps::mask::pattern<"E5">
+        >;
+        constexpr char const* strings[] = {"48 8B 05 ? ? ? ? C3", "C3 90 ^ 55 48", "? ? 90 55", "48 8B 05 11 AA", "4? ?B", "E5"};
+        static_assert(set::count == 6 && set::bucketed == 5 && set::max_size == 8);
+
+        auto near = make_near_misses();
+        for (auto [data, size] : {std::pair(blob.data(), blob.size()), std::pair<uint8_t const*, size_t>(near.data(), near.size())}) {
+            auto found = sinaps::find_all<set>(data, size);
+            bool same = true;
+            for (size_t k = 0; k < set::count; k++) {
+                same &= found[k] == scalar_find(data, size, strings[k]);
+            }
+            check(same, "pattern set agrees with the scalar find");
+            check(found == set::find_all(data, size), "pattern set scan");
+        }
+    }
+
+    // find(data, size, tokens): last offset, short buffers and cursor tokens
+    void test_token_find() {
+        using sinaps::token_t;
+        constexpr uint8_t data[] = {0x10, 0x20, 0x30, 0x40, 0x50, 0x60};
+        constexpr size_t size = sizeof(data);
+        auto cursor = token_t(token_t::type_t::cursor);
+
+        check(sinaps::find(data, size, {token_t(0x50), token_t(0x60)}) == 4, "token match at the last offset");
+        check(sinaps::find(data, size, {token_t(0x10), token_t(), token_t(0x30), token_t(0x40), token_t(0x50), token_t(0x60)}) == 0, "token pattern as large as the buffer");
+        check(sinaps::find(data, 2, {token_t(0x10), token_t(0x20), token_t(0x30)}) == sinaps::not_found, "buffer shorter than the token pattern");
+        check(sinaps::find(data, 0, {token_t(0x10)}) == sinaps::not_found, "empty buffer");
+        check(sinaps::find(data, size, {token_t(0x30), cursor, token_t(0x40), token_t(0x50)}) == 3, "cursor in the middle of the tokens");
+        check(sinaps::find(data, size, {token_t(0x50), token_t(0x60), cursor}) == 6, "cursor at the end of the tokens");
+
+        std::array<token_t, 3> tokens = {token_t(0x40), cursor, token_t(0x50, 0xF0)};
+        check(sinaps::find(data, size, tokens) == 4, "token array with a cursor and a masked byte");
+        check(sinaps::find(data, size, std::span<token_t const>(tokens)) == 4, "token span with a cursor and a masked byte");
+
+        // longer than a row of the packed verify, with every kind of token
+        auto near = make_near_misses();
+        auto list = sinaps::impl::tokenizePatternStringRuntime(
+            "48 8B 05 11 22 33 44 C3 90 55 48 89 48 8B 05 11 22 33 44 C3 90 55 48 89 48 8B 05 11 22 33 44 C3 90 55 48 89 "
+            "48 8B 05 11 22 33 44 C3 90 55 48 89 48 8B 05 11 22 33 44 C3 90 55 48 89 4? 8B (05|0D) ? 22 33 44 ^ C3 90 55 48 89 E5"
+        );
+        check(sinaps::find(near.data(), near.size(), std::span<sinaps::token_t const>(list)) == static_cast<intptr_t>(near.size() - 6), "long token pattern with every kind of token");
+        list.back() = token_t(0xE6);
+        check(sinaps::find(near.data(), near.size(), std::span<sinaps::token_t const>(list)) == sinaps::not_found, "long token pattern rejects its last byte");
+    }
+
+    // compiled_pattern_set: one arena for many patterns, the same results as the scalar find
+    void test_compiled_pattern_set() {
+        constexpr char const* strings[] = {"48 8B 05 ? ? ? ? C3", "C3 90 ^ 55 48", "? ? 90 55", "48 8B 05 11 AA", "4? ?B", "E5", "(48|E5) (8B|89)"};
+        std::vector<sinaps::compiled_pattern> patterns(std::begin(strings), std::end(strings));
+        sinaps::compiled_pattern_set set(patterns);
+        check(set.size() == patterns.size() && set.max_size() == 8, "set size");
+        check(reinterpret_cast<uintptr_t>(set.arena().data()) % sinaps::impl::row_alignment == 0, "arena is aligned");
+
+        auto near = make_near_misses();
+        for (auto [data, size] : {std::pair(blob.data(), blob.size()), std::pair<uint8_t const*, size_t>(near.data(), near.size())}) {
+            auto found = sinaps::find_all(data, size, set);
+            bool same = found.size() == patterns.size();
+            for (size_t k = 0; same && k < patterns.size(); k++) {
+                same = found[k] == scalar_find(data, size, strings[k]) && found[k] == sinaps::find(data, size, patterns[k]);
+            }
+            check(same, "pattern set arena agrees with the scalar find");
+        }
+
+        sinaps::compiled_pattern_set gaps(std::vector<sinaps::compiled_pattern>{
+            sinaps::compiled_pattern("48 8B 05 [2-6] ^ C3"), sinaps::compiled_pattern("55 48 [0-4] E5")
+        });
+        check(sinaps::find_all(blob.data(), blob.size(), gaps) == std::vector<intptr_t>{6007, 6009}, "pattern set with gaps");
+        check(sinaps::find_all(blob.data(), blob.size(), sinaps::compiled_pattern_set()).empty(), "empty pattern set");
+
+        // arenas from an untrusted source are checked before they are scanned
+        auto arena = set.arena();
+        check(sinaps::impl::check_arena(arena), "arena of a set passes the checks");
+        check(!sinaps::impl::check_arena(arena.first(arena.size() - 1)), "truncated arena is rejected");
+        check(!sinaps::impl::check_arena({}), "empty arena is rejected");
+
+        std::vector<uint8_t, sinaps::utils::aligned_allocator<uint8_t, sinaps::impl::row_alignment>> copy(arena.begin(), arena.end());
+        auto corrupt = [&](size_t offset, uint32_t value) {
+            auto bytes = copy;
+            std::memcpy(bytes.data() + offset, &value, sizeof(value));
+            return sinaps::impl::check_arena(bytes);
+        };
+        sinaps::impl::set_header_t header;
+        std::memcpy(&header, copy.data(), sizeof(header));
+        check(sinaps::impl::check_arena(copy), "copied arena passes the checks");
+        check(!corrupt(offsetof(sinaps::impl::set_header_t, count), header.count + 1), "pattern count past the records is rejected");
+        check(!corrupt(offsetof(sinaps::impl::set_header_t, records), header.size), "records past the arena are rejected");
+        check(!corrupt(header.order, header.count), "bucket index out of range is rejected");
+        check(!corrupt(header.start + sizeof(uint32_t), 0xFFFF), "unordered bucket ranges are rejected");
+        check(!corrupt(header.records + offsetof(sinaps::impl::set_record_t, size), 0xFFFF), "record larger than its rows is rejected");
+        check(!corrupt(header.records + offsetof(sinaps::impl::set_record_t, rows), 1), "misaligned rows are rejected");
+    }
+
+    // pattern_database: a saved blob is mapped back with the same signatures and results
+    void test_database() {
+        auto db = sinaps::pattern_database::compile("# test\na = 48 8B 05 ? ? ? ? C3\n\nb = C3 90 ^ 55 48\nc = 48 8B 05 [2-6] ^ C3\nd = 48 8B 05 11 AA\n");
+        auto path = std::filesystem::temp_directory_path() / "sinaps_test.db";
+        check(db.valid() && db.size() == 4 && db.name(1) == "b" && db.index_of("d") == 3, "database names");
+        check(db.save(path), "database is saved");
+
+        sinaps::pattern_database loaded(path);
+        check(loaded.valid() && loaded.size() == 4 && loaded.name(2) == "c", "database is mapped back");
+        auto found = loaded.find_all(blob.data(), blob.size());
+        check(found == db.find_all(blob.data(), blob.size()) && found == sinaps::find_all(blob.data(), blob.size(), loaded), "mapped database scan");
+        check(found == std::vector<intptr_t>{
+            scalar_find(blob.data(), blob.size(), "48 8B 05 ? ? ? ? C3"), scalar_find(blob.data(), blob.size(), "C3 90 ^ 55 48"), 6007,
+            scalar_find(blob.data(), blob.size(), "48 8B 05 11 AA")
+        }, "database scan agrees with the scalar find");
+        check(sinaps::compiled_pattern(loaded.tokens(1)).to_string() == "C3 90 ^ 55 48", "database tokens");
+        std::filesystem::remove(path);
+    }
+
+    // pattern_database: blobs that fail the checks leave the database empty
+    void test_database_corrupted() {
+        auto db = sinaps::pattern_database::compile("a = 48 8B 05\nb = C3 90\nc = E8 ? ? ? ?\nd = 55 48 89 E5\n");
+        auto path = std::filesystem::temp_directory_path() / "sinaps_test_corrupted.db";
+        auto open = [&](std::vector<uint8_t> const& blob, sinaps::pattern_database& loaded) {
+            {
+                std::ofstream file(path, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<char const*>(blob.data()), static_cast<std::streamsize>(blob.size()));
+            }
+            return loaded.open(path);
+        };
+
+        std::vector<uint8_t> blob(db.blob().begin(), db.blob().end());
+        sinaps::impl::database_header_t header;
+        std::memcpy(&header, blob.data(), sizeof(header));
+        auto names = blob;
+        uint32_t end = 0xFFFF;
+        std::memcpy(names.data() + header.names, &end, sizeof(end));
+
+        sinaps::pattern_database loaded;
+        check(!open(names, loaded), "corrupted name table is rejected");
+        check(!loaded.valid() && loaded.size() == 0, "rejected blob leaves the database empty");
+        check(loaded.find_all(TEST_STRING, sizeof(TEST_STRING)).empty(), "rejected blob scans nothing");
+
+        // one more byte at the end of the arena: the arena checks pass, but the name table is misaligned
+        auto misaligned = blob;
+        misaligned.insert(misaligned.begin() + header.names, 0);
+        auto shifted = header;
+        shifted.arena_size++;
+        shifted.names++;
+        std::memcpy(misaligned.data(), &shifted, sizeof(shifted));
+        uint32_t arena_size = shifted.arena_size;
+        std::memcpy(misaligned.data() + shifted.arena, &arena_size, sizeof(arena_size));
+        check(!open(misaligned, loaded) && !loaded.valid(), "misaligned name table is rejected");
+
+        check(open(blob, loaded) && loaded.size() == 4, "intact blob is accepted");
+        std::filesystem::remove(path);
+    }
+
+    // async_find / async_find_all: the same results as the scalar find, stop requests and callback exceptions
+    void test_async() {
+        using code = sinaps::mask::pattern<"48 8B 05 ? ? ? ? C3 90 55">;
+        using cursor = sinaps::mask::pattern<"C3 90 ^ 55 48">;
+        using missing = sinaps::mask::pattern<"48 8B 05 11 AA">;
+        intptr_t expected[] = {
+            scalar_find(blob.data(), blob.size(), "48 8B 05 ? ? ? ? C3 90 55"),
+            scalar_find(blob.data(), blob.size(), "C3 90 ^ 55 48"),
+            scalar_find(blob.data(), blob.size(), "48 8B 05 11 AA"),
+        };
+
+        sinaps::thread_pool pool(2);
+        check(sinaps::async_find<code>(blob.data(), blob.size(), pool).get() == expected[0], "async find agrees with the scalar find");
+        sinaps::compiled_pattern compiled("C3 90 ^ 55 48");
+        check(sinaps::async_find(blob.data(), blob.size(), compiled, pool).get() == expected[1], "compiled async find agrees with the scalar find");
+
+        std::atomic<size_t> reported{0};
+        auto found = sinaps::async_find_all<code, cursor, missing>(blob.data(), blob.size(), pool, [&](size_t, intptr_t) { reported++; }).get();
+        check(found[0] == expected[0] && found[1] == expected[1] && found[2] == expected[2] && reported == 3, "async find_all agrees with the scalar find");
+
+        std::vector<sinaps::compiled_pattern> patterns = {sinaps::compiled_pattern("48 8B 05 ? ? ? ? C3 90 55"), compiled};
+        auto compiled_found = sinaps::async_find_all(blob.data(), blob.size(), std::span<sinaps::compiled_pattern const>(patterns), pool).get();
+        check(compiled_found == std::vector<intptr_t>{expected[0], expected[1]}, "compiled async find_all agrees with the scalar find");
+
+        // a stopped scan reports not_found, even if the pattern is there
+        std::stop_source stopped;
+        stopped.request_stop();
+        check(sinaps::async_find<code>(blob.data(), blob.size(), pool, stopped.get_token()).get() == sinaps::not_found, "stopped async find");
+
+        // tasks run one after the other, the first result stops the scans that haven't started yet
+        auto inline_executor = [](std::function<void()> task) { task(); };
+        std::stop_source stop;
+        auto partial = sinaps::async_find_all<code, cursor>(
+            blob.data(), blob.size(), inline_executor, [&](size_t, intptr_t) { stop.request_stop(); }, stop.get_token()
+        ).get();
+        check(partial[0] == expected[0] && partial[1] == sinaps::not_found, "stop requested between two scans");
+
+        bool thrown = false;
+        try {
+            (void) sinaps::async_find_all<code, cursor>(
+                blob.data(), blob.size(), pool, [](size_t index, intptr_t) { if (index == 1) throw std::runtime_error("callback"); }
+            ).get();
+        } catch (std::runtime_error const&) {
+            thrown = true;
+        }
+        check(thrown, "callback exception reaches the future");
+
+        thrown = false;
+        auto throwing_executor = [](std::function<void()>) { throw std::runtime_error("executor"); };
+        try {
+            (void) sinaps::async_find<code>(blob.data(), blob.size(), throwing_executor);
+        } catch (std::runtime_error const&) {
+            thrown = true;
+        }
+        check(thrown, "executor exception reaches the caller");
+    }
+
+    // find_reverse / find_backward_from: the last scalar match, and the nearest one before a position
+    void test_find_reverse() {
+        using code = sinaps::mask::pattern<"48 8B 05 ? ? ? ? C3 90 55">;
+        auto all = scalar_find_all(blob.data(), blob.size(), "48 8B 05 ? ? ? ? C3 90 55");
+        check(sinaps::find_reverse<code>(blob.data(), blob.size()) == all.back(), "reverse find agrees with the last scalar match");
+        check(sinaps::find_reverse(blob.data(), blob.size(), sinaps::compiled_pattern("C3 90 ^ 55 48")) == 8192 - 4, "compiled reverse find reports the cursor");
+        check(sinaps::find_reverse<code>(blob.data(), 8188) == 6000, "reverse find skips a match cut by the buffer end");
+
+        auto near = make_near_misses();
+        auto near_all = scalar_find_all(near.data(), near.size(), "48 8B 05 11 ? 33");
+        check(sinaps::find_reverse<sinaps::mask::pattern<"48 8B 05 11 ? 33">>(near.data(), near.size()) == near_all.back(), "reverse find over near misses");
+
+        bool same = true;
+        for (intptr_t from = 0; from < 8300; from += 41) {
+            for (size_t distance : {size_t(100), size_t(3000), size_t(10000)}) {
+                intptr_t expected = sinaps::not_found;
+                for (auto index : all) {
+                    if (index <= from && from - index <= static_cast<intptr_t>(distance)) expected = index;
+                }
+                same &= sinaps::find_backward_from<code>(blob.data(), blob.size(), from, distance) == expected;
+            }
+        }
+        check(same, "backward find agrees with the scalar matches");
+        check(sinaps::find_backward_from<code>(blob.data(), blob.size(), 6000, 0) == 6000, "backward find at its start");
+        check(sinaps::find_backward_from(blob.data(), blob.size(), sinaps::compiled_pattern("C3 90 ^ 55 48"), 6100, 100) == 6009, "compiled backward find");
+    }
+
+    // x86 decoder: lengths and operand fields of known encodings
+    void test_x86_decode() {
+        struct expected_t {
+            std::vector<uint8_t> code;
+            sinaps::x86::instruction_t ins;
+            std::vector<size_t> volatile_bytes;
+            char const* name;
+        };
+        auto make = [](uint8_t length, uint8_t disp_offset, uint8_t disp_size, uint8_t imm_offset, uint8_t imm_size, bool rip, bool relative) {
+            sinaps::x86::instruction_t ins;
+            ins.length = length;
+            ins.disp_offset = disp_offset;
+            ins.disp_size = disp_size;
+            ins.imm_offset = imm_offset;
+            ins.imm_size = imm_size;
+            ins.rip_relative = rip;
+            ins.relative = relative;
+            return ins;
+        };
+        expected_t cases[] = {
+            {{0xE8, 0x11, 0x22, 0x33, 0x44}, make(5, 1, 0, 1, 4, false, true), {1, 2, 3, 4}, "call rel32"},
+            {{0x48, 0x8B, 0x05, 0x11, 0x22, 0x33, 0x44}, make(7, 3, 4, 7, 0, true, false), {3, 4, 5, 6}, "mov rax, [rip + disp32]"},
+            {{0x66, 0xB8, 0x34, 0x12}, make(4, 0, 0, 2, 2, false, false), {}, "mov ax, imm16"},
+            {{0x48, 0xB8, 1, 2, 3, 4, 5, 6, 7, 8}, make(10, 0, 0, 2, 8, false, false), {2, 3, 4, 5, 6, 7, 8, 9}, "mov rax, imm64"},
+            {{0xF6, 0xC0, 0x01}, make(3, 2, 0, 2, 1, false, false), {}, "test al, imm8"},
+            {{0xF6, 0xD0}, make(2, 2, 0, 2, 0, false, false), {}, "not al"},
+            {{0xC5, 0xF8, 0x77}, make(3, 0, 0, 3, 0, false, false), {}, "vzeroupper"},
+            {{0xC4, 0xE3, 0xFD, 0x00, 0xC1, 0x4E}, make(6, 5, 0, 5, 1, false, false), {}, "vpermq ymm0, ymm1, imm8"},
+            {{0x62, 0xF1, 0xFE, 0x48, 0x6F, 0x40, 0x01}, make(7, 6, 1, 7, 0, false, false), {}, "vmovdqu64 zmm0, [rax + disp8]"},
+        };
+        for (auto const& c : cases) {
+            auto ins = sinaps::x86::decode(c.code.data(), c.code.size());
+            bool same = ins.length == c.ins.length && ins.disp_size == c.ins.disp_size && ins.imm_size == c.ins.imm_size &&
+                ins.rip_relative == c.ins.rip_relative && ins.relative == c.ins.relative &&
+                (!c.ins.disp_size || ins.disp_offset == c.ins.disp_offset) && (!c.ins.imm_size || ins.imm_offset == c.ins.imm_offset);
+            std::vector<size_t> volatile_bytes;
+            for (size_t k = 0; k < ins.length; k++) {
+                if (sinaps::x86::is_volatile(ins, k)) volatile_bytes.push_back(k);
+            }
+            check(same && volatile_bytes == c.volatile_bytes, c.name);
+            check(!sinaps::x86::decode(c.code.data(), c.code.size() - 1).valid(), "truncated instruction");
+        }
+        check(!sinaps::x86::decode(nullptr, 0).valid(), "empty buffer");
+    }
+
+    // make_pattern_at: the shortest unique pattern, past a prefix that is duplicated elsewhere
+    void test_make_pattern_at() {
+        constexpr uint8_t function[] = {0x48, 0x8B, 0x05, 0x11, 0x22, 0x33, 0x44, 0xC3, 0x90, 0x55, 0x48, 0x89, 0xE5, 0x5D};
+        std::vector<uint8_t> code(0x100, 0xCC);
+        std::memcpy(code.data() + 0x40, function, sizeof(function));
+        std::memcpy(code.data() + 0x80, function, sizeof(function));
+        code[0x83] = 0x55; // another displacement, wildcarded anyway
+        code[0x80 + sizeof(function) - 1] = 0xC3;
+
+        auto tokens = sinaps::make_pattern_at(code.data(), code.size(), 0x40);
+        check(sinaps::to_string(tokens) == "48 8B 05 ? ? ? ? C3 90 55 48 89 E5 5D", "pattern extends past the duplicated prefix");
+        check(scalar_find(code.data(), code.size(), sinaps::to_string(tokens)) == 0x40 && sinaps::find(code.data(), code.size(), std::span<sinaps::token_t const>(tokens)) == 0x40, "generated pattern matches its target first");
+        check(sinaps::to_string(sinaps::make_pattern_at(code, code.data() + 0x80)) == "48 8B 05 ? ? ? ? C3 90 55 48 89 E5 C3", "pattern of the second copy");
+        check(sinaps::make_pattern_at(code.data(), code.size(), 0x40, {8, true}).empty(), "no unique pattern within the size limit");
+
+        // the same bytes as data, nothing is wildcarded
+        std::vector<uint8_t> data(0x100, 0x00);
+        for (size_t k = 0; k < 10; k++) {
+            data[0x20 + k] = data[0x60 + k] = static_cast<uint8_t>(0x10 + k);
+        }
+        data[0x2A] = 0xAA;
+        data[0x6A] = 0xBB;
+        auto raw = sinaps::make_pattern_at(data.data(), data.size(), 0x20, {64, false});
+        check(sinaps::to_string(raw) == "10 11 12 13 14 15 16 17 18 19 AA", "data pattern extends past the duplicated prefix");
+        check(sinaps::find(data.data(), data.size(), std::span<sinaps::token_t const>(raw)) == scalar_find(data.data(), data.size(), "10 11 12 13 14 15 16 17 18 19 AA"), "data pattern agrees with the scalar find");
+    }
+}
+
 int main() {
     auto res = sinaps::find<sinaps::mask::string<"test string">>(TEST_STRING, sizeof(TEST_STRING));
     std::cout << "Found at index: " << res << std::endl;
-    return 0;
-}
\ No newline at end of file
+
+    test_anchor_prefilter();
+    test_rarity_anchor();
+    test_batch_find_all();
+    test_find_parallel();
+    test_matches();
+    test_compiled_pattern();
+    test_packed_verify();
+    test_skip_table();
+    test_module_sections();
+    test_mapped_file();
+    test_stream_scanner();
+    test_process_scanner();
+    test_result_cache();
+    test_matches_at();
+    test_find_near();
+    test_module_file_follow();
+    test_pattern_syntax();
+    test_gaps();
+    test_scan_stats();
+    test_pattern_set();
+    test_token_find();
+    test_compiled_pattern_set();
+    test_database();
+    test_database_corrupted();
+    test_async();
+    test_find_reverse();
+    test_x86_decode();
+    test_make_pattern_at();
+    return failures == 0 ? 0 : 1;
+}
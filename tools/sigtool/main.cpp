@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <sinaps.hpp>
+#include <sinaps/database.hpp>
+#include <sinaps/mapped_file.hpp>
+
+// Usage: sinaps_sigtool <signatures> <binary>...
+//
+// The signatures are a text file of `name = pattern` lines, or a database blob (see sinaps::pattern_database).
+// Executables are scanned in their code sections, with follow targets resolved in any section, other files as a
+// whole. For each signature and binary the tool reports the matches, the prefilter candidates per MB and the scan
+// throughput, then looks for the shortest window of the signature (and then the most wildcarded one) that still finds
+// the same single match in every binary where the signature is unique. The exit code is 2 if a signature isn't unique
+// in every binary.
+
+namespace {
+    struct binary_t {
+        std::string path;
+        sinaps::mapped_file file;
+        std::optional<sinaps::module> mod; // set if the file parses as an executable
+        std::vector<std::span<uint8_t const>> ranges; // code sections, or the whole file
+        size_t bytes = 0;
+    };
+
+    struct measure_t {
+        size_t matches = 0;
+        intptr_t first = sinaps::not_found; // file offset of the first match
+        sinaps::scan_stats stats;
+    };
+
+    std::optional<binary_t> load_binary(std::string const& path) {
+        binary_t bin;
+        bin.path = path;
+        if (!bin.file.open(path)) {
+            std::fprintf(stderr, "%s: %s\n", path.c_str(), bin.file.error().message().c_str());
+            return std::nullopt;
+        }
+
+        auto mod = bin.file.as_module();
+        if (mod.valid()) {
+            for (auto const& section : mod.code_sections()) {
+                bin.ranges.emplace_back(section.data, section.size);
+            }
+            bin.mod = std::move(mod);
+        }
+        if (bin.ranges.empty()) {
+            bin.ranges.push_back(bin.file.bytes());
+        }
+        for (auto range : bin.ranges) {
+            bin.bytes += range.size();
+        }
+        return bin;
+    }
+
+    /// @brief Scanner for a code section of a module (see <c>sinaps::match_range</c>). Follow targets are resolved
+    /// in the whole module through the section addresses, as in <c>find(mod, pattern)</c>, so they can point into
+    /// any section. Indices stay relative to the section.
+    struct section_scanner : sinaps::impl::compiled_scanner {
+        sinaps::module const* mod;
+        size_t begin; // offset of the section from the module base
+
+        [[nodiscard]] intptr_t resolve(uint8_t const*, size_t size, size_t start) const {
+            intptr_t index = pattern->resolve(mod->base(), begin + size, begin + start, sinaps::impl::module_memory{mod});
+            return index == sinaps::not_found ? index : index - static_cast<intptr_t>(begin);
+        }
+    };
+
+    /// @brief Count the matches of a pattern in a binary, and collect the scan counters.
+    /// @param limit Stop after this many matches, e.g. 2 to only check uniqueness.
+    measure_t measure(sinaps::compiled_pattern const& pattern, binary_t const& bin, size_t limit = SIZE_MAX) {
+        measure_t m;
+        auto count = [&](auto const& range, intptr_t offset) {
+            for (auto index : range) {
+                if (m.matches++ == 0) {
+                    m.first = offset + index;
+                }
+                if (m.matches >= limit) break;
+            }
+        };
+        {
+            sinaps::stats_scope scope(m.stats);
+            for (auto range : bin.ranges) {
+                auto offset = static_cast<intptr_t>(range.data() - bin.file.data());
+                if (bin.mod) {
+                    section_scanner scanner{{&pattern}, &*bin.mod, static_cast<size_t>(offset)};
+                    count(sinaps::match_range(range.data(), range.size(), scanner), offset);
+                } else {
+                    count(sinaps::matches(range.data(), range.size(), pattern), offset);
+                }
+                if (m.matches >= limit) break;
+            }
+        }
+        return m;
+    }
+
+    double per_mb(uint64_t count, size_t bytes) {
+        return bytes ? static_cast<double>(count) * (1 << 20) / static_cast<double>(bytes) : 0.0;
+    }
+
+    double gb_per_s(size_t bytes, uint64_t nanoseconds) {
+        return nanoseconds ? static_cast<double>(bytes) / static_cast<double>(nanoseconds) : 0.0;
+    }
+
+    /// @brief Where a signature is expected to be found, in the binaries where it's unique.
+    struct reference_t {
+        binary_t const* bin;
+        intptr_t offset;
+    };
+
+    /// @brief Variant of a signature, which reports its match <c>lead</c> bytes after the signature's own.
+    /// The lead is only non-zero when the variant had to drop the cursor (e.g. a window that starts after it).
+    struct variant_t {
+        sinaps::compiled_pattern pattern;
+        intptr_t lead = 0;
+    };
+
+    /// @brief Whether a variant finds the same single match as the signature in every reference binary.
+    /// @param candidates Output, prefilter candidates summed over the references.
+    bool same_match(variant_t const& variant, std::span<reference_t const> refs, uint64_t& candidates) {
+        candidates = 0;
+        for (auto const& ref : refs) {
+            auto m = measure(variant.pattern, *ref.bin, 2);
+            if (m.matches != 1 || m.first - variant.lead != ref.offset) {
+                return false;
+            }
+            candidates += m.stats.candidates;
+        }
+        return true;
+    }
+
+    /// @brief Window <c>[begin, end)</c> of a gap-free signature (in bytes), or nothing if the window would drop a
+    /// follow token, or starts or ends with a wildcard. A cursor outside of the window (including the implicit one at
+    /// the start) becomes the lead of the variant.
+    std::optional<variant_t> window(std::span<sinaps::token_t const> tokens, size_t begin, size_t end) {
+        std::vector<sinaps::token_t> out;
+        size_t pos = 0, cursor = 0;
+        bool has_follow = false;
+        for (auto const& token : tokens) {
+            if (token.zero_sized()) {
+                if (token.type == sinaps::token_t::type_t::cursor) {
+                    cursor = pos;
+                    if (pos < begin || pos > end) continue;
+                } else if (pos < begin || pos > end) {
+                    return std::nullopt;
+                } else {
+                    has_follow = true;
+                }
+                out.push_back(token);
+                continue;
+            }
+            if (pos >= begin && pos < end) {
+                bool edge = pos == begin || pos + 1 == end;
+                if (edge && token.type == sinaps::token_t::type_t::wildcard) return std::nullopt;
+                out.push_back(token);
+            }
+            pos++;
+        }
+
+        // follow targets are read at the cursor, so it can't move
+        bool cursor_inside = cursor >= begin && cursor <= end;
+        if (has_follow && !cursor_inside) {
+            return std::nullopt;
+        }
+        auto lead = cursor_inside ? 0 : static_cast<intptr_t>(begin) - static_cast<intptr_t>(cursor);
+        return variant_t{sinaps::compiled_pattern(out), lead};
+    }
+
+    /// @brief Shortest window of the signature with the same match, the one with the fewest candidates on a tie.
+    std::optional<variant_t> trim(sinaps::compiled_pattern const& pattern, std::span<reference_t const> refs) {
+        size_t size = pattern.size();
+        for (size_t length = 1; length <= size; length++) {
+            std::optional<variant_t> best;
+            uint64_t best_candidates = UINT64_MAX;
+            for (size_t begin = 0; begin + length <= size; begin++) {
+                auto variant = window(pattern.tokens(), begin, begin + length);
+                if (!variant) continue;
+
+                uint64_t candidates = 0;
+                if (same_match(*variant, refs, candidates) && candidates < best_candidates) {
+                    best = std::move(variant);
+                    best_candidates = candidates;
+                }
+            }
+            if (best) {
+                return best;
+            }
+        }
+        return std::nullopt;
+    }
+
+    /// @brief Wildcard the inner bytes of a signature one by one, as long as it keeps the same match and an anchor
+    /// pair (so it still scans with the prefilter). Volatile bytes such as displacements are usually the ones left.
+    std::optional<variant_t> wildcard(variant_t const& base, std::span<reference_t const> refs) {
+        std::vector<sinaps::token_t> tokens(base.pattern.tokens().begin(), base.pattern.tokens().end());
+        size_t first = tokens.size(), last = 0;
+        for (size_t k = 0; k < tokens.size(); k++) {
+            if (!tokens[k].zero_sized()) {
+                first = std::min(first, k);
+                last = k;
+            }
+        }
+
+        bool changed = false;
+        for (size_t k = first + 1; k < last; k++) {
+            if (tokens[k].zero_sized() || tokens[k].type == sinaps::token_t::type_t::wildcard) continue;
+
+            auto saved = tokens[k];
+            tokens[k] = sinaps::token_t();
+            variant_t variant{sinaps::compiled_pattern(tokens), base.lead};
+            uint64_t candidates = 0;
+            if (variant.pattern.anchor().valid && same_match(variant, refs, candidates)) {
+                changed = true;
+            } else {
+                tokens[k] = saved;
+            }
+        }
+        if (!changed) {
+            return std::nullopt;
+        }
+        return variant_t{sinaps::compiled_pattern(tokens), base.lead};
+    }
+
+    /// @brief Printable note for a variant that doesn't report the same position as the signature.
+    std::string lead_note(variant_t const& variant) {
+        if (variant.lead == 0) {
+            return {};
+        }
+        return ", match " + std::string(variant.lead > 0 ? "- " : "+ ") + std::to_string(std::abs(variant.lead)) + " for the same result";
+    }
+
+    sinaps::pattern_database load_signatures(std::filesystem::path const& path) {
+        sinaps::pattern_database db(path);
+        return db.valid() ? std::move(db) : sinaps::pattern_database::compile_file(path);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <signatures> <binary>...\n", argv[0]);
+        return 1;
+    }
+
+    sinaps::pattern_database db;
+    try {
+        db = load_signatures(argv[1]);
+    } catch (std::exception const& e) {
+        std::fprintf(stderr, "%s: %s\n", argv[1], e.what());
+        return 1;
+    }
+
+    std::vector<binary_t> bins;
+    for (int i = 2; i < argc; i++) {
+        auto bin = load_binary(argv[i]);
+        if (!bin) return 1;
+        bins.push_back(std::move(*bin));
+    }
+
+    // all signatures in a single pass, as a startup scan would run them
+    for (auto const& bin : bins) {
+        auto start = std::chrono::steady_clock::now();
+        for (auto range : bin.ranges) {
+            auto res = db.find_all(range.data(), range.size());
+            (void) res;
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        std::printf(
+            "%s: %zu bytes scanned, find_all of %zu signatures at %.2f GB/s\n",
+            bin.path.c_str(), bin.bytes, db.size(), gb_per_s(bin.bytes, static_cast<uint64_t>(ns))
+        );
+    }
+
+    bool all_unique = true;
+    for (size_t k = 0; k < db.size(); k++) {
+        sinaps::compiled_pattern pattern(db.tokens(k));
+        std::printf("\n%.*s = %s\n", static_cast<int>(db.name(k).size()), db.name(k).data(), pattern.to_string().c_str());
+
+        std::vector<reference_t> refs;
+        for (auto const& bin : bins) {
+            auto m = measure(pattern, bin);
+            std::printf("  %s: %zu match%s", bin.path.c_str(), m.matches, m.matches == 1 ? "" : "es");
+            if (m.first != sinaps::not_found) {
+                std::printf(" (first at 0x%llx)", static_cast<unsigned long long>(m.first));
+            }
+            std::printf(
+                ", %.1f candidates/MB, %.1f verifies/MB, %.2f GB/s\n",
+                per_mb(m.stats.candidates, bin.bytes), per_mb(m.stats.verifies, bin.bytes), gb_per_s(bin.bytes, m.stats.nanoseconds)
+            );
+            if (m.matches == 1) {
+                refs.push_back({&bin, m.first});
+            }
+        }
+
+        std::printf("  unique in %zu/%zu binaries\n", refs.size(), bins.size());
+        all_unique = all_unique && refs.size() == bins.size();
+        if (refs.empty()) {
+            continue;
+        }
+        if (pattern.has_gap()) {
+            std::printf("  no suggestion for patterns with gaps\n");
+            continue;
+        }
+
+        auto trimmed = trim(pattern, refs);
+        auto base = trimmed ? *trimmed : variant_t{pattern};
+        if (trimmed && trimmed->pattern.size() < pattern.size()) {
+            std::printf(
+                "  trimmed:    %s (%zu bytes instead of %zu%s)\n", trimmed->pattern.to_string().c_str(), trimmed->pattern.size(),
+                pattern.size(), lead_note(*trimmed).c_str()
+            );
+        }
+        if (auto wildcarded = wildcard(base, refs)) {
+            std::printf("  wildcarded: %s%s\n", wildcarded->pattern.to_string().c_str(), lead_note(*wildcarded).c_str());
+        }
+    }
+
+    return all_unique ? 0 : 2;
+}